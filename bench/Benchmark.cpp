@@ -0,0 +1,176 @@
+﻿#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#include "dsp/Simd.hpp"
+
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+double Seconds(const Clock::duration duration)
+{
+	return std::chrono::duration<double>(duration).count();
+}
+
+/** @brief Runs @p fixture @p runs times and returns the elapsed time. */
+Clock::duration TimeRuns(MT::Bench::Fixture& fixture, const uint64_t runs)
+{
+	const auto start = Clock::now();
+	for (uint64_t i = 0; i < runs; i++)
+		fixture.Run();
+	return Clock::now() - start;
+}
+
+MT::Bench::Result Measure(const MT::Bench::Benchmark& benchmark,
+						  const MT::Bench::CaseConfig& config,
+						  const MT::Bench::RunOptions& options)
+{
+	const std::unique_ptr<MT::Bench::Fixture> fixture =
+		benchmark.Create(config);
+
+	// Warm caches and branch predictors, then size each repetition from the
+	// warm-up rate so short and long blocks get the same time budget.
+	uint64_t runs = 1;
+	Clock::duration elapsed{};
+	while ((elapsed = TimeRuns(*fixture, runs)) < std::chrono::milliseconds(2))
+		runs *= 2;
+	const uint32_t repetitions = std::max(options.Repetitions, 1u);
+	const double runSeconds = Seconds(elapsed) / static_cast<double>(runs);
+	const auto runsPerRepetition = std::max<uint64_t>(1, static_cast<uint64_t>(
+		options.SecondsPerCase / repetitions / runSeconds));
+
+	const double samples = static_cast<double>(runsPerRepetition) *
+		static_cast<double>(fixture->GetSamplesPerRun(config));
+	std::vector<double> nsPerSample;
+	nsPerSample.reserve(repetitions);
+	for (uint32_t repetition = 0; repetition < repetitions; repetition++)
+	{
+		elapsed = TimeRuns(*fixture, runsPerRepetition);
+		nsPerSample.push_back(Seconds(elapsed) * 1e9 / samples);
+	}
+	std::sort(nsPerSample.begin(), nsPerSample.end());
+
+	MT::Bench::Result result;
+	result.Kernel = benchmark.Kernel;
+	result.Variant = benchmark.Variant;
+	result.Config = config;
+	result.NsPerSample = nsPerSample[nsPerSample.size() / 2];
+	result.MinNsPerSample = nsPerSample.front();
+	result.Runs = runsPerRepetition * repetitions;
+	return result;
+}
+
+void WriteString(std::ostream& out, const std::string& text)
+{
+	out << '"';
+	for (const char c : text)
+	{
+		if (c == '"' || c == '\\')
+			out << '\\' << c;
+		else if (static_cast<unsigned char>(c) < 0x20)
+		{
+			char escaped[8];
+			std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+			out << escaped;
+		}
+		else
+			out << c;
+	}
+	out << '"';
+}
+
+std::string CompilerName()
+{
+#if defined(__clang__)
+	return "clang " __clang_version__;
+#elif defined(__GNUC__)
+	return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+	return "msvc " + std::to_string(_MSC_FULL_VER);
+#else
+	return "unknown";
+#endif
+}
+}
+
+
+std::vector<MT::Bench::Result> MT::Bench::RunBenchmarks(
+	const std::vector<Benchmark>& benchmarks, const RunOptions& options,
+	std::ostream* progress)
+{
+	std::vector<Result> results;
+	for (const Benchmark& benchmark : benchmarks)
+	{
+		if (!options.Filter.empty() &&
+			benchmark.GetName().find(options.Filter) == std::string::npos)
+			continue;
+
+		for (const uint32_t sampleRate : options.SampleRates)
+		{
+			for (const uint32_t channels : options.ChannelCounts)
+			{
+				for (const uint32_t blockFrames : options.BlockSizes)
+				{
+					const CaseConfig config{blockFrames, channels,
+											static_cast<float>(sampleRate)};
+					results.push_back(Measure(benchmark, config, options));
+					if (!progress)
+						continue;
+
+					char line[160];
+					std::snprintf(line, sizeof(line),
+								  "%-28s %6u Hz  block %5u  ch %2u  "
+								  "%8.3f ns/sample\n",
+								  benchmark.GetName().c_str(), sampleRate,
+								  blockFrames, channels,
+								  results.back().NsPerSample);
+					*progress << line << std::flush;
+				}
+			}
+		}
+	}
+	return results;
+}
+
+void MT::Bench::WriteJson(std::ostream& out, const std::vector<Result>& results,
+						  const RunOptions& options)
+{
+	out << "{\n";
+	out << "  \"suite\": \"pae_bench\",\n";
+	out << "  \"schema\": 2,\n";
+	out << "  \"compiler\": ";
+	WriteString(out, CompilerName());
+	out << ",\n";
+#ifdef NDEBUG
+	out << "  \"ndebug\": true,\n";
+#else
+	out << "  \"ndebug\": false,\n";
+#endif
+	out << "  \"simd_width\": " << DSP::Simd::Width << ",\n";
+	out << "  \"hardware_threads\": " << std::thread::hardware_concurrency()
+		<< ",\n";
+	out << "  \"seconds_per_case\": " << options.SecondsPerCase << ",\n";
+	out << "  \"results\": [";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const Result& result = results[i];
+		out << (i ? ",\n" : "\n") << "    {\"kernel\": ";
+		WriteString(out, result.Kernel);
+		out << ", \"variant\": ";
+		WriteString(out, result.Variant);
+		out << ", \"block_frames\": " << result.Config.BlockFrames
+			<< ", \"channels\": " << result.Config.Channels
+			<< ", \"sample_rate\": " << result.Config.SampleRate
+			<< ", \"ns_per_sample\": " << result.NsPerSample
+			<< ", \"min_ns_per_sample\": " << result.MinNsPerSample
+			<< ", \"samples_per_second\": "
+			<< (result.NsPerSample > 0.0 ? 1e9 / result.NsPerSample : 0.0)
+			<< ", \"runs\": " << result.Runs << "}";
+	}
+	out << "\n  ]\n}\n";
+}
@@ -0,0 +1,85 @@
+﻿#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace MT::Bench
+{
+/** @brief One configuration a kernel is timed at. */
+struct CaseConfig
+{
+	uint32_t BlockFrames = 512;
+	uint32_t Channels = 2;
+	float SampleRate = 48000.0f;
+};
+
+/**
+ * @brief A kernel set up for one @ref CaseConfig.
+ *
+ * Everything the kernel needs is allocated when the fixture is created;
+ * Run() only processes one block and is what gets timed.
+ */
+class Fixture
+{
+public:
+	virtual ~Fixture() = default;
+
+	virtual void Run() = 0;
+	/** @brief Samples one Run() produces, frames times channels by default. */
+	[[nodiscard]] virtual uint64_t GetSamplesPerRun(
+		const CaseConfig& config) const
+	{
+		return static_cast<uint64_t>(config.BlockFrames) * config.Channels;
+	}
+};
+
+/** @brief A named kernel and how to build a fixture for it. */
+struct Benchmark
+{
+	std::string Kernel;
+	std::string Variant;
+	std::function<std::unique_ptr<Fixture>(const CaseConfig&)> Create;
+
+	[[nodiscard]] std::string GetName() const { return Kernel + "/" + Variant; }
+};
+
+struct Result
+{
+	std::string Kernel;
+	std::string Variant;
+	CaseConfig Config;
+	/** @brief Median over the repetitions. */
+	double NsPerSample = 0.0;
+	double MinNsPerSample = 0.0;
+	uint64_t Runs = 0;
+};
+
+struct RunOptions
+{
+	std::vector<uint32_t> BlockSizes{32, 64, 128, 256, 512, 1024, 2048, 4096};
+	std::vector<uint32_t> ChannelCounts{1, 2, 8};
+	std::vector<uint32_t> SampleRates{48000};
+	/** @brief Wall-clock time spent timing each configuration. */
+	double SecondsPerCase = 0.05;
+	uint32_t Repetitions = 5;
+	/** @brief Only benchmarks whose name contains this run, empty for all. */
+	std::string Filter;
+};
+
+/**
+ * @brief Times every benchmark at every sample rate, block size and
+ * channel count.
+ *
+ * @param progress Receives one human readable line per case, may be null.
+ */
+std::vector<Result> RunBenchmarks(const std::vector<Benchmark>& benchmarks,
+								  const RunOptions& options,
+								  std::ostream* progress = nullptr);
+
+/** @brief Writes @p results and the build they came from as JSON. */
+void WriteJson(std::ostream& out, const std::vector<Result>& results,
+			   const RunOptions& options);
+}
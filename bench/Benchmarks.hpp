@@ -0,0 +1,52 @@
+﻿#pragma once
+#include <ostream>
+#include <vector>
+
+#include "Benchmark.hpp"
+
+namespace MT::Bench
+{
+/**
+ * @brief Oscillator, filter, noise, mixer and voice engine nodes. Voice
+ * engines report time per voice and frame, the additive engine per partial
+ * and frame, the granular engine per grain and frame, the modal engine per
+ * mode and frame, impact generators per frame. FM presets run both
+ * compiled and as a dense matrix product, waveguide strings with both
+ * fractional delays, impacts on the shared bank and with a voice each.
+ * FDN reverbs of 8 to 64 lines run each feedback matrix, the structured
+ * ones both as fast transforms and as dense products.
+ */
+void AddNodeBenchmarks(std::vector<Benchmark>& benchmarks);
+/** @brief Interleaving and float to PCM conversion on the output path. */
+void AddConversionBenchmarks(std::vector<Benchmark>& benchmarks);
+/**
+ * @brief Biquad banks of 4, 8 and 16 filters per SIMD lane, run in
+ * parallel at each interleave, in series at each pipeline depth, and one
+ * scalar filter at a time, timed per filter and frame; plus the cascade
+ * and filter bank nodes.
+ */
+void AddBiquadBenchmarks(std::vector<Benchmark>& benchmarks);
+/**
+ * @brief FDTD membrane and plate grids from 32x32 to 512x512, split over
+ * 1 to 8 threads up to the machine's count, timed per frame.
+ */
+void AddFdtdBenchmarks(std::vector<Benchmark>& benchmarks);
+/**
+ * @brief Writes, per model and thread count, the largest grid of the FDTD
+ * benchmarks in @p results that runs faster than real time.
+ */
+void ReportFdtdCapacity(const std::vector<Result>& results,
+						std::ostream& out);
+/**
+ * @brief Real FFTs of 256 to 65536 points, forward and back, timed per
+ * point; convolution reverbs of 0.5 to 6 second rooms with their tail on
+ * the worker, on the audio thread and uniformly partitioned, per sample.
+ */
+void AddConvolutionBenchmarks(std::vector<Benchmark>& benchmarks);
+/**
+ * @brief Writes, per convolution case in @p results, the latency and the
+ * mean and slowest audio thread time per block.
+ */
+void ReportConvolutionCosts(const std::vector<Result>& results,
+							std::ostream& out);
+}
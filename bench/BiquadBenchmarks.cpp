@@ -0,0 +1,266 @@
+﻿#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Benchmarks.hpp"
+#include "NodeFixture.hpp"
+#include "dsp/BiquadBank.hpp"
+#include "dsp/MemoryArena.hpp"
+#include "dsp/Random.hpp"
+#include "dsp/Simd.hpp"
+#include "dsp/nodes/BiquadFilterNode.hpp"
+#include "dsp/nodes/FilterBankNode.hpp"
+
+
+namespace
+{
+using MT::DSP::BiquadBank;
+using MT::DSP::BiquadCoefficients;
+using MT::DSP::BiquadType;
+
+constexpr uint32_t FiltersPerLane[] = {4, 8, 16};
+constexpr uint32_t Interleaves[] = {1, 2, 4};
+constexpr uint32_t Depths[] = {1, 2, 4, 8};
+
+/** @brief How a bank benchmark chains its filters. */
+enum class Layout
+{
+	/** @brief One input into every filter, the outputs summed. */
+	Parallel,
+	/** @brief Filters in series, a channel per lane, pipelined. */
+	Serial,
+	/** @brief The parallel bank one filter at a time without SIMD. */
+	Scalar
+};
+
+/**
+ * @brief Times a BiquadBank of @p filtersPerLane packets, per filter and
+ * frame whatever the case's channel count.
+ *
+ * Filters spread over the spectrum, band-passes in parallel and bells in
+ * series, so a long chain neither dies out nor blows up; with @p ramp
+ * every block glides to a new set of coefficients, the worst case of a
+ * modulated bank.
+ */
+class BankFixture : public MT::Bench::Fixture
+{
+public:
+	/** @param interleave Or the pipeline depth of a serial bank. */
+	BankFixture(const MT::Bench::CaseConfig& config, const Layout layout,
+				const uint32_t filtersPerLane, const uint32_t interleave,
+				const bool ramp) :
+		m_Layout(layout), m_Packets(filtersPerLane), m_Interleave(interleave),
+		m_Ramp(ramp), m_Frames(config.BlockFrames)
+	{
+		const uint32_t filters = m_Packets * MT::DSP::Simd::Width;
+		m_Bank.Prepare(nullptr, filters);
+		for (uint32_t set = 0; set < 2; set++)
+		{
+			for (uint32_t filter = 0; filter < filters; filter++)
+			{
+				const float frequency = 40.0f * std::pow(
+					400.0f, static_cast<float>(filter) / filters) *
+					(set ? 1.05f : 1.0f);
+				m_Coefficients[set].push_back(BiquadCoefficients::Design(
+					layout == Layout::Serial ? BiquadType::Peak
+											 : BiquadType::BandPass,
+					frequency, 4.0f, filter % 2 ? 3.0f : -3.0f,
+					config.SampleRate));
+			}
+		}
+		Retarget();
+		m_Bank.Snap();
+		m_States.resize(filters * 2);
+
+		MT::DSP::Xorshift32 random;
+		m_Input.resize(m_Frames);
+		for (float& sample : m_Input)
+			sample = random.NextBipolar() * 0.5f;
+		m_Data.Allocate(nullptr, static_cast<size_t>(m_Frames) * m_Packets *
+						MT::DSP::Simd::Width);
+	}
+
+	void Run() override
+	{
+		if (m_Ramp)
+		{
+			m_Set ^= 1;
+			Retarget();
+		}
+		switch (m_Layout)
+		{
+			case Layout::Parallel:
+			{
+				float* sums = m_Data.Data();
+				std::fill_n(sums, static_cast<size_t>(m_Frames) *
+							MT::DSP::Simd::Width, 0.0f);
+				if (m_Interleave == 4)
+					m_Bank.ProcessSum<4>(0, m_Packets, m_Input.data(), sums,
+										 m_Frames);
+				else if (m_Interleave == 2)
+					m_Bank.ProcessSum<2>(0, m_Packets, m_Input.data(), sums,
+										 m_Frames);
+				else
+					m_Bank.ProcessSum<1>(0, m_Packets, m_Input.data(), sums,
+										 m_Frames);
+				break;
+			}
+			case Layout::Serial:
+				for (uint32_t i = 0; i < m_Frames; i++)
+				{
+					std::fill_n(m_Data.Data() + i * MT::DSP::Simd::Width,
+								MT::DSP::Simd::Width, m_Input[i]);
+				}
+				if (m_Interleave == 8)
+					m_Bank.ProcessSeries<8>(0, m_Packets, m_Data.Data(),
+											m_Frames);
+				else if (m_Interleave == 4)
+					m_Bank.ProcessSeries<4>(0, m_Packets, m_Data.Data(),
+											m_Frames);
+				else if (m_Interleave == 2)
+					m_Bank.ProcessSeries<2>(0, m_Packets, m_Data.Data(),
+											m_Frames);
+				else
+					m_Bank.ProcessSeries<1>(0, m_Packets, m_Data.Data(),
+											m_Frames);
+				break;
+			case Layout::Scalar:
+				RunScalar();
+				break;
+		}
+	}
+
+	[[nodiscard]] uint64_t GetSamplesPerRun(
+		const MT::Bench::CaseConfig& config) const override
+	{
+		return static_cast<uint64_t>(config.BlockFrames) * m_Packets *
+			MT::DSP::Simd::Width;
+	}
+
+private:
+	void Retarget()
+	{
+		for (size_t filter = 0; filter < m_Coefficients[m_Set].size();
+			 filter++)
+			m_Bank.SetTarget(static_cast<uint32_t>(filter),
+							 m_Coefficients[m_Set][filter]);
+	}
+
+	/** @brief The textbook loop: every filter over the block in turn. */
+	void RunScalar()
+	{
+		std::fill_n(m_Data.Data(), m_Frames, 0.0f);
+		const std::vector<BiquadCoefficients>& set = m_Coefficients[m_Set];
+		for (size_t filter = 0; filter < set.size(); filter++)
+		{
+			const BiquadCoefficients& c = set[filter];
+			float s1 = m_States[filter * 2];
+			float s2 = m_States[filter * 2 + 1];
+			for (uint32_t i = 0; i < m_Frames; i++)
+			{
+				const float x = m_Input[i];
+				const float y = c.B0 * x + s1;
+				s1 = c.B1 * x - c.A1 * y + s2;
+				s2 = c.B2 * x - c.A2 * y;
+				m_Data[i] += y;
+			}
+			m_States[filter * 2] = s1;
+			m_States[filter * 2 + 1] = s2;
+		}
+	}
+
+private:
+	Layout m_Layout;
+	uint32_t m_Packets;
+	uint32_t m_Interleave;
+	bool m_Ramp;
+	uint32_t m_Frames;
+	uint32_t m_Set = 0;
+	BiquadBank m_Bank;
+	std::vector<BiquadCoefficients> m_Coefficients[2];
+	std::vector<float> m_States;
+	std::vector<float> m_Input;
+	MT::DSP::ArenaArray<float> m_Data;
+};
+
+MT::Bench::Benchmark MakeBankBenchmark(const Layout layout,
+									   const uint32_t filtersPerLane,
+									   const uint32_t interleave,
+									   const bool ramp)
+{
+	static constexpr const char* Names[] = {"parallel", "serial", "scalar"};
+	std::string variant = std::string(Names[static_cast<int>(layout)]) +
+		"-" + std::to_string(filtersPerLane) + "pl";
+	if (layout == Layout::Parallel)
+		variant += "-i" + std::to_string(interleave);
+	else if (layout == Layout::Serial)
+		variant += "-d" + std::to_string(interleave);
+	if (ramp)
+		variant += "-ramp";
+	return {"biquad", variant,
+			[=](const MT::Bench::CaseConfig& config)
+			{
+				return std::make_unique<BankFixture>(
+					config, layout, filtersPerLane, interleave, ramp);
+			}};
+}
+
+/** @brief A filter node fed one noise input after applying @p parameters. */
+template<typename T, typename... Args>
+MT::Bench::Benchmark MakeFilterBenchmark(
+	std::string variant,
+	const std::vector<std::pair<uint32_t, float>>& parameters, Args... args)
+{
+	return {"filter", std::move(variant),
+			[=](const MT::Bench::CaseConfig& config)
+			{
+				auto fixture = std::make_unique<MT::Bench::NodeFixture>(
+					std::make_unique<T>(args...), config, 1);
+				for (const auto& [id, value] : parameters)
+					fixture->GetNode().SetParameter(id, value);
+				return fixture;
+			}};
+}
+}
+
+
+void MT::Bench::AddBiquadBenchmarks(std::vector<Benchmark>& benchmarks)
+{
+	using MT::DSP::BiquadFilterNode;
+	using MT::DSP::FilterBankNode;
+
+	for (const uint32_t filtersPerLane : FiltersPerLane)
+	{
+		benchmarks.push_back(MakeBankBenchmark(Layout::Scalar, filtersPerLane,
+											   1, false));
+		for (const uint32_t interleave : Interleaves)
+		{
+			benchmarks.push_back(MakeBankBenchmark(
+				Layout::Parallel, filtersPerLane, interleave, false));
+		}
+		benchmarks.push_back(MakeBankBenchmark(
+			Layout::Parallel, filtersPerLane, BiquadBank::DefaultInterleave,
+			true));
+		for (const uint32_t depth : Depths)
+		{
+			benchmarks.push_back(MakeBankBenchmark(
+				Layout::Serial, filtersPerLane, depth, false));
+		}
+		benchmarks.push_back(MakeBankBenchmark(
+			Layout::Serial, filtersPerLane, BiquadBank::DefaultDepth, true));
+	}
+
+	for (const uint32_t sections : {1u, 4u, 8u})
+	{
+		benchmarks.push_back(MakeFilterBenchmark<BiquadFilterNode>(
+			"biquad-" + std::to_string(sections),
+			{{BiquadFilterNode::Sections, static_cast<float>(sections)}}));
+	}
+	benchmarks.push_back(MakeFilterBenchmark<FilterBankNode>(
+		"bank-32", {}, 32u));
+	benchmarks.push_back(MakeFilterBenchmark<FilterBankNode>(
+		"bank-128", {}, 128u));
+}
@@ -0,0 +1,90 @@
+﻿#include <vector>
+
+#include "Benchmarks.hpp"
+#include "audio/SampleConversion.hpp"
+#include "dsp/Random.hpp"
+
+
+namespace
+{
+/** @brief Planar graph output to the interleaved device buffer. */
+class InterleaveFixture : public MT::Bench::Fixture
+{
+public:
+	explicit InterleaveFixture(const MT::Bench::CaseConfig& config) :
+		m_Frames(config.BlockFrames),
+		m_Channels(config.Channels),
+		m_Planar(static_cast<size_t>(config.BlockFrames) * config.Channels),
+		m_Interleaved(m_Planar.size())
+	{
+		MT::DSP::Xorshift32 random;
+		for (float& sample : m_Planar)
+			sample = random.NextBipolar();
+	}
+
+	void Run() override
+	{
+		const MT::DSP::BufferView source{m_Planar.data(), m_Channels, m_Frames};
+		MT::Audio::InterleaveScaled(source, m_Frames, 0.5f,
+									m_Interleaved.data(), m_Channels);
+	}
+
+private:
+	uint32_t m_Frames;
+	uint32_t m_Channels;
+	std::vector<float> m_Planar;
+	std::vector<float> m_Interleaved;
+};
+
+/** @brief Interleaved float to the integer formats the WAV writer stores. */
+class EncodeFixture : public MT::Bench::Fixture
+{
+public:
+	EncodeFixture(const MT::Bench::CaseConfig& config, const int bits) :
+		m_Bits(bits),
+		m_Samples(static_cast<size_t>(config.BlockFrames) * config.Channels),
+		m_Encoded(m_Samples.size() * 3)
+	{
+		MT::DSP::Xorshift32 random;
+		for (float& sample : m_Samples)
+			sample = random.NextBipolar();
+	}
+
+	void Run() override
+	{
+		if (m_Bits == 16)
+		{
+			MT::Audio::EncodePcm16(m_Samples.data(), m_Samples.size(),
+								   m_Encoded.data(), m_Dither);
+		}
+		else
+		{
+			MT::Audio::EncodePcm24(m_Samples.data(), m_Samples.size(),
+								   m_Encoded.data());
+		}
+	}
+
+private:
+	int m_Bits;
+	std::vector<float> m_Samples;
+	std::vector<char> m_Encoded;
+	MT::DSP::Xorshift32 m_Dither;
+};
+}
+
+
+void MT::Bench::AddConversionBenchmarks(std::vector<Benchmark>& benchmarks)
+{
+	benchmarks.push_back({"convert", "interleave", [](const CaseConfig& config)
+	{
+		return std::make_unique<InterleaveFixture>(config);
+	}});
+	benchmarks.push_back({"convert", "pcm16-dither", [](const CaseConfig& config)
+	{
+		return std::make_unique<EncodeFixture>(config, 16);
+	}});
+	benchmarks.push_back({"convert", "pcm24", [](const CaseConfig& config)
+	{
+		return std::make_unique<EncodeFixture>(config, 24);
+	}});
+}
@@ -0,0 +1,168 @@
+﻿#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "Benchmarks.hpp"
+#include "NodeFixture.hpp"
+#include "dsp/Convolver.hpp"
+#include "dsp/ImpulseResponse.hpp"
+#include "dsp/RealFft.hpp"
+#include "dsp/Random.hpp"
+#include "dsp/nodes/ConvolutionNode.hpp"
+
+
+namespace
+{
+using MT::DSP::ConvolutionTail;
+
+constexpr uint32_t FftSizes[] = {256, 1024, 4096, 16384, 65536};
+constexpr float ImpulseSeconds[] = {0.5f, 2.0f, 6.0f};
+constexpr const char* Tails[] = {"worker", "audio-thread", "uniform"};
+
+/** @brief A forward and an inverse transform per run, timed per sample. */
+class FftFixture : public MT::Bench::Fixture
+{
+public:
+	explicit FftFixture(const uint32_t size)
+	{
+		m_Fft.Prepare(nullptr, size);
+		m_Time.Allocate(nullptr, size);
+		m_Real.Allocate(nullptr, size / 2);
+		m_Imaginary.Allocate(nullptr, size / 2);
+		MT::DSP::Xorshift32 random;
+		for (float& sample : m_Time)
+			sample = random.NextBipolar();
+	}
+
+	void Run() override
+	{
+		m_Fft.Forward(m_Time.Data(), m_Real.Data(), m_Imaginary.Data());
+		m_Fft.Inverse(m_Real.Data(), m_Imaginary.Data(), m_Time.Data());
+		// Keeps the level steady from run to run.
+		const float scale = 1.0f / static_cast<float>(m_Fft.GetSize());
+		for (float& sample : m_Time)
+			sample *= scale;
+	}
+
+	[[nodiscard]] uint64_t GetSamplesPerRun(
+		const MT::Bench::CaseConfig& /*config*/) const override
+	{
+		return m_Fft.GetSize();
+	}
+
+private:
+	MT::DSP::RealFft m_Fft;
+	MT::DSP::ArenaArray<float> m_Time;
+	MT::DSP::ArenaArray<float> m_Real;
+	MT::DSP::ArenaArray<float> m_Imaginary;
+};
+
+/** @brief Slowest block per case, keyed by variant, frames and channels. */
+using PeakKey = std::tuple<std::string, uint32_t, uint32_t>;
+std::map<PeakKey, uint64_t>& GetPeaks()
+{
+	static std::map<PeakKey, uint64_t> peaks;
+	return peaks;
+}
+
+/**
+ * @brief A convolution node fed noise, which leaves its slowest block
+ * behind for ReportConvolutionCosts(): the mean hides the bursts of tail
+ * work on the audio thread.
+ */
+class ReverbFixture : public MT::Bench::NodeFixture
+{
+public:
+	ReverbFixture(std::string variant, const MT::Bench::CaseConfig& config,
+				  const float seconds, const ConvolutionTail tail) :
+		NodeFixture(std::make_unique<MT::DSP::ConvolutionNode>(
+						MT::DSP::ImpulseResponse::MakeRoom(config.SampleRate,
+														   seconds),
+						0, tail),
+					config, 1),
+		m_Key(std::move(variant), config.BlockFrames, config.Channels) {}
+
+	~ReverbFixture() override
+	{
+		const auto& node = static_cast<const MT::DSP::ConvolutionNode&>(
+			GetNode());
+		GetPeaks()[m_Key] = node.GetStats().MaxBlockNs;
+	}
+
+private:
+	PeakKey m_Key;
+};
+
+std::string GetVariant(const float seconds, const uint32_t tail)
+{
+	char name[64];
+	std::snprintf(name, sizeof(name), "room-%gs-%s", seconds, Tails[tail]);
+	return name;
+}
+}
+
+
+void MT::Bench::AddConvolutionBenchmarks(std::vector<Benchmark>& benchmarks)
+{
+	for (const uint32_t size : FftSizes)
+	{
+		benchmarks.push_back({"fft", "real-" + std::to_string(size),
+							  [=](const CaseConfig& /*config*/)
+							  {
+								  return std::make_unique<FftFixture>(size);
+							  }});
+	}
+	for (const float seconds : ImpulseSeconds)
+	{
+		for (uint32_t tail = 0; tail < std::size(Tails); tail++)
+		{
+			const std::string variant = GetVariant(seconds, tail);
+			benchmarks.push_back({"convolution", variant,
+				[=](const CaseConfig& config)
+				{
+					return std::make_unique<ReverbFixture>(
+						variant, config, seconds,
+						static_cast<ConvolutionTail>(tail));
+				}});
+		}
+	}
+}
+
+void MT::Bench::ReportConvolutionCosts(const std::vector<Result>& results,
+									   std::ostream& out)
+{
+	for (const Result& result : results)
+	{
+		if (result.Kernel != "convolution")
+			continue;
+		const CaseConfig& config = result.Config;
+		// The partition the node picks for the block size, see Convolver.
+		const uint32_t latency = std::clamp(
+			std::bit_ceil(config.BlockFrames), DSP::RealFft::MinSize / 2,
+			DSP::Convolver::MaxPartition);
+		const double blockNs = 1e9 * config.BlockFrames / config.SampleRate;
+		const double meanNs = result.NsPerSample * config.BlockFrames *
+			config.Channels;
+		const auto peak = GetPeaks().find(
+			{result.Variant, config.BlockFrames, config.Channels});
+		const double peakNs = peak != GetPeaks().end()
+			? static_cast<double>(peak->second)
+			: 0.0;
+
+		char line[200];
+		std::snprintf(line, sizeof(line),
+					  "convolution %-24s %4u frames %u ch: latency %u frames, "
+					  "%.1f us per block (%.1f%%), slowest %.1f us (%.0f%%)\n",
+					  result.Variant.c_str(), config.BlockFrames,
+					  config.Channels, latency, meanNs * 1e-3,
+					  100.0 * meanNs / blockNs, peakNs * 1e-3,
+					  100.0 * peakNs / blockNs);
+		out << line;
+	}
+}
@@ -0,0 +1,152 @@
+﻿#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Benchmarks.hpp"
+#include "NodeFixture.hpp"
+#include "dsp/ParallelExecutor.hpp"
+#include "dsp/nodes/FdtdPlateNode.hpp"
+
+
+namespace
+{
+constexpr uint32_t GridSizes[] = {32, 48, 64, 96, 128, 192, 256, 384, 512};
+constexpr uint32_t ThreadCounts[] = {1, 2, 4, 8};
+constexpr const char* Models[] = {"membrane", "plate"};
+
+/** @brief Timed per frame: the whole grid is one voice. */
+class GridFixture : public MT::Bench::NodeFixture
+{
+public:
+	using NodeFixture::NodeFixture;
+
+	[[nodiscard]] uint64_t GetSamplesPerRun(
+		const MT::Bench::CaseConfig& config) const override
+	{
+		return config.BlockFrames;
+	}
+};
+
+/** @brief Thread counts up to the machine's. */
+std::vector<uint32_t> GetThreadCounts()
+{
+	const uint32_t hardware = std::max(std::thread::hardware_concurrency(),
+									   1u);
+	std::vector<uint32_t> counts;
+	for (const uint32_t threads : ThreadCounts)
+	{
+		if (threads <= hardware)
+			counts.push_back(threads);
+	}
+	return counts;
+}
+
+/** @brief A pool of @p threads - 1 workers, built on first use. */
+MT::DSP::ParallelExecutor* GetExecutor(const uint32_t threads)
+{
+	static std::map<uint32_t, std::unique_ptr<MT::DSP::ParallelExecutor>>
+		executors;
+	if (threads <= 1)
+		return nullptr;
+	auto& executor = executors[threads];
+	if (!executor)
+		executor = std::make_unique<MT::DSP::ParallelExecutor>(threads - 1);
+	return executor.get();
+}
+
+std::string GetVariant(const char* model, const uint32_t size,
+					   const uint32_t threads)
+{
+	return std::string(model) + "-" + std::to_string(size) + "x" +
+		std::to_string(size) + "-" + std::to_string(threads) + "t";
+}
+}
+
+
+void MT::Bench::AddFdtdBenchmarks(std::vector<Benchmark>& benchmarks)
+{
+	using MT::DSP::FdtdPlateNode;
+	for (const uint32_t threads : GetThreadCounts())
+	{
+		for (uint32_t model = 0; model < std::size(Models); model++)
+		{
+			for (const uint32_t size : GridSizes)
+			{
+				benchmarks.push_back({"fdtd",
+					GetVariant(Models[model], size, threads),
+					[=](const CaseConfig& config)
+					{
+						auto fixture = std::make_unique<GridFixture>(
+							std::make_unique<FdtdPlateNode>(size, size),
+							config, 0, GetExecutor(threads));
+						DSP::Node& node = fixture->GetNode();
+						// Low enough for the finest plate to stay in tune.
+						node.SetParameter(FdtdPlateNode::Frequency, 1.0f);
+						node.SetParameter(FdtdPlateNode::Stiffness,
+										  static_cast<float>(model));
+						node.OnNote(60, 1.0f);
+						return fixture;
+					}});
+			}
+		}
+	}
+}
+
+void MT::Bench::ReportFdtdCapacity(const std::vector<Result>& results,
+								   std::ostream& out)
+{
+	for (const uint32_t threads : GetThreadCounts())
+	{
+		for (const char* model : Models)
+		{
+			// Best case over the block sizes and channel counts run; the
+			// grid costs the same whatever the output looks like.
+			std::map<uint32_t, double> load;
+			for (const uint32_t size : GridSizes)
+			{
+				const std::string variant = GetVariant(model, size, threads);
+				for (const Result& result : results)
+				{
+					if (result.Kernel != "fdtd" || result.Variant != variant)
+						continue;
+					const double share = result.NsPerSample *
+						result.Config.SampleRate * 1e-9;
+					auto [entry, added] = load.emplace(size, share);
+					if (!added)
+						entry->second = std::min(entry->second, share);
+				}
+			}
+			if (load.empty())
+				continue;
+
+			uint32_t largest = 0;
+			for (const auto& [size, share] : load)
+			{
+				if (share < 1.0)
+					largest = std::max(largest, size);
+			}
+			char line[160];
+			if (largest)
+			{
+				std::snprintf(line, sizeof(line),
+							  "fdtd %-8s %u thread(s): %ux%u in real time, "
+							  "%.0f%% of the time budget\n",
+							  model, threads, largest, largest,
+							  100.0 * load[largest]);
+			}
+			else
+			{
+				std::snprintf(line, sizeof(line),
+							  "fdtd %-8s %u thread(s): no grid run keeps up\n",
+							  model, threads);
+			}
+			out << line;
+		}
+	}
+}
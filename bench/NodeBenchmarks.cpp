@@ -0,0 +1,683 @@
+﻿#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <functional>
+#include <memory>
+#include <numbers>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "Benchmarks.hpp"
+#include "NodeFixture.hpp"
+#include "dsp/ParallelExecutor.hpp"
+#include "dsp/nodes/AdditiveSynthNode.hpp"
+#include "dsp/nodes/FdnReverbNode.hpp"
+#include "dsp/nodes/FmSynthNode.hpp"
+#include "dsp/nodes/GranularNode.hpp"
+#include "dsp/nodes/ImpactNode.hpp"
+#include "dsp/nodes/MixerNode.hpp"
+#include "dsp/nodes/ModalNode.hpp"
+#include "dsp/nodes/NoiseNode.hpp"
+#include "dsp/nodes/OnePoleFilterNode.hpp"
+#include "dsp/nodes/OscillatorNode.hpp"
+#include "dsp/nodes/PolySynthNode.hpp"
+#include "dsp/nodes/SvfFilterNode.hpp"
+#include "dsp/nodes/VirtualAnalogNode.hpp"
+#include "dsp/nodes/WaveguideNode.hpp"
+#include "dsp/nodes/WavetableSynthNode.hpp"
+
+
+namespace
+{
+/**
+ * @brief The white noise path NoiseNode replaced: one std::mt19937 draw per
+ * sample, kept as the baseline the block generators are measured against.
+ */
+class Mt19937NoiseNode : public MT::DSP::Node
+{
+public:
+	void Process(const MT::DSP::ProcessContext& context) override
+	{
+		for (uint32_t channel = 0; channel < context.Output.Channels; channel++)
+		{
+			float* out = context.Output.Channel(channel);
+			for (uint32_t i = 0; i < context.Frames; i++)
+				out[i] = m_Distribution(m_Generator);
+		}
+	}
+
+	[[nodiscard]] const char* GetName() const override { return "mt19937"; }
+
+private:
+	std::mt19937 m_Generator{1};
+	std::uniform_real_distribution<float> m_Distribution{-1.0f, 1.0f};
+};
+
+/**
+ * @brief The modulated state variable filter the obvious way: a channel at
+ * a time, recomputing the coefficients with std::exp2() and std::tan() and
+ * three divisions every sample. Same response as SvfFilterNode's low-pass,
+ * kept as the baseline its vectorized coefficients are measured against.
+ */
+class ExactSvfNode : public MT::DSP::Node
+{
+public:
+	void Prepare(const MT::DSP::PrepareContext& context) override
+	{
+		m_SampleRate = context.SampleRate;
+		m_States.assign(context.Channels * 2, 0.0f);
+	}
+
+	void Process(const MT::DSP::ProcessContext& context) override
+	{
+		const float pitch = std::log2(m_Cutoff / m_SampleRate);
+		for (uint32_t channel = 0; channel < context.Output.Channels; channel++)
+		{
+			const float* in = context.Inputs[0].Channel(channel);
+			const float* modulation = context.Inputs[1].Channel(channel);
+			float* out = context.Output.Channel(channel);
+			float band = m_States[channel * 2];
+			float low = m_States[channel * 2 + 1];
+			for (uint32_t i = 0; i < context.Frames; i++)
+			{
+				const float cutoff = std::clamp(std::exp2(
+					pitch + modulation[i]), 1e-5f, 0.49f);
+				const float g = std::tan(std::numbers::pi_v<float> * cutoff);
+				const float a1 = 1.0f / (1.0f + g * (g + Damping));
+				const float a2 = g * a1;
+				const float a3 = g * a2;
+				const float v3 = in[i] - low;
+				const float v1 = a1 * band + a2 * v3;
+				const float v2 = low + a2 * band + a3 * v3;
+				band = 2.0f * v1 - band;
+				low = 2.0f * v2 - low;
+				out[i] = v2;
+			}
+			m_States[channel * 2] = band;
+			m_States[channel * 2 + 1] = low;
+		}
+	}
+
+	[[nodiscard]] uint32_t GetMaxInputs() const override { return 2; }
+	[[nodiscard]] const char* GetName() const override { return "Exact SVF"; }
+
+private:
+	static constexpr float Damping = 0.5f;
+
+	float m_SampleRate = 48000.0f;
+	float m_Cutoff = 1000.0f;
+	std::vector<float> m_States;
+};
+
+/**
+ * @brief Impacts the way a voice engine plays them: every impact gets its
+ * own resonator and click filter, tuned exactly to its size and rendered
+ * until it dies away. Same scheduler and material as ImpactNode, kept as
+ * the baseline its shared bank is measured against.
+ */
+class VoicePerImpactNode : public MT::DSP::Node
+{
+public:
+	explicit VoicePerImpactNode(const float rate) { m_Scheduler.Rate = rate; }
+
+	void Prepare(const MT::DSP::PrepareContext& context) override
+	{
+		m_SampleRate = context.SampleRate;
+		m_Events.resize(MT::DSP::ImpactScheduler::GetCapacity(
+			m_SampleRate, context.MaxBlockFrames));
+		m_Voices.clear();
+		m_Voices.reserve(MaxVoices);
+		m_Left.assign(context.MaxBlockFrames, 0.0f);
+		m_Right.assign(context.MaxBlockFrames, 0.0f);
+	}
+
+	void Process(const MT::DSP::ProcessContext& context) override
+	{
+		using MT::DSP::ImpactNode;
+		const ImpactNode::MaterialSetting& setting = ImpactNode::Materials[0];
+		const uint32_t frames = context.Frames;
+		const uint32_t count = m_Scheduler.Schedule(frames, m_SampleRate,
+													m_Events);
+		const float level = 1.0f / std::sqrt(std::max(
+			m_Scheduler.Rate * setting.Decay / 6.91f, 1.0f));
+		const float octaves = std::log2(setting.HighFrequency /
+										setting.LowFrequency);
+		const float clickOmega = 2.0f * std::numbers::pi_v<float> *
+			setting.ClickFrequency / m_SampleRate;
+		const float alpha = std::sin(clickOmega) / (2.0f * setting.ClickQ);
+		for (uint32_t n = 0; n < count && m_Voices.size() < MaxVoices; n++)
+		{
+			const MT::DSP::ImpactEvent& event = m_Events[n];
+			const float frequency = setting.LowFrequency * std::exp2(
+				octaves * (1.0f - event.Size));
+			const float ring = setting.Decay * std::sqrt(
+				setting.LowFrequency / frequency);
+			const float radius = std::exp(-6.91f / (ring * m_SampleRate));
+			const float omega = 2.0f * std::numbers::pi_v<float> * frequency /
+				m_SampleRate;
+			const float pan = 0.25f * std::numbers::pi_v<float> *
+				(1.0f + 0.7f * event.Pan);
+			Voice& voice = m_Voices.emplace_back();
+			voice.Onset = event.Frame;
+			voice.Excite = level * event.Amplitude * std::sin(omega);
+			voice.Click = level * event.Amplitude * setting.Click * alpha /
+				(1.0f + alpha);
+			voice.Feedback1 = 2.0f * radius * std::cos(omega);
+			voice.Feedback2 = -radius * radius;
+			voice.ClickFeedback1 = 2.0f * std::cos(clickOmega) / (1.0f + alpha);
+			voice.ClickFeedback2 = -(1.0f - alpha) / (1.0f + alpha);
+			voice.Left = std::cos(pan);
+			voice.Right = std::sin(pan);
+		}
+
+		std::fill_n(m_Left.begin(), frames, 0.0f);
+		std::fill_n(m_Right.begin(), frames, 0.0f);
+		size_t kept = 0;
+		for (Voice& voice : m_Voices)
+		{
+			// Locals, or every store to the mix reloads the whole voice.
+			Voice v = voice;
+			float* left = m_Left.data();
+			float* right = m_Right.data();
+			for (uint32_t i = v.Onset; i < frames; i++)
+			{
+				const float input = i == v.Onset ? v.Pending : 0.0f;
+				const float y = v.Feedback1 * v.State1 +
+					v.Feedback2 * v.State2 + v.Excite * input;
+				v.State2 = v.State1;
+				v.State1 = y;
+				float c = v.Click * (input - v.Input2) +
+					v.ClickFeedback1 * v.Click1 + v.ClickFeedback2 * v.Click2;
+				c = std::abs(c) < ImpactNode::FlushLevel ? 0.0f : c;
+				v.Input2 = v.Input1;
+				v.Input1 = input;
+				v.Click2 = v.Click1;
+				v.Click1 = c;
+				left[i] += v.Left * (y + c);
+				right[i] += v.Right * (y + c);
+			}
+			v.Onset = 0;
+			v.Pending = 0.0f;
+			if (std::abs(v.State1) + std::abs(v.State2) + std::abs(v.Click1) +
+				std::abs(v.Click2) >= ImpactNode::CullLevel)
+				m_Voices[kept++] = v;
+		}
+		m_Voices.resize(kept);
+
+		for (uint32_t channel = 0; channel < context.Output.Channels; channel++)
+		{
+			std::copy_n(channel % 2 ? m_Right.begin() : m_Left.begin(), frames,
+						context.Output.Channel(channel));
+		}
+	}
+
+	[[nodiscard]] const char* GetName() const override
+	{
+		return "Voice per impact";
+	}
+
+private:
+	static constexpr size_t MaxVoices = 65536;
+
+	struct Voice
+	{
+		uint32_t Onset = 0;
+		/** @brief 1 until the impulse at Onset went in. */
+		float Pending = 1.0f;
+		float Excite = 0.0f;
+		float Click = 0.0f;
+		float Feedback1 = 0.0f;
+		float Feedback2 = 0.0f;
+		float ClickFeedback1 = 0.0f;
+		float ClickFeedback2 = 0.0f;
+		float Left = 0.0f;
+		float Right = 0.0f;
+		float State1 = 0.0f;
+		float State2 = 0.0f;
+		float Input1 = 0.0f;
+		float Input2 = 0.0f;
+		float Click1 = 0.0f;
+		float Click2 = 0.0f;
+	};
+
+	float m_SampleRate = 48000.0f;
+	MT::DSP::ImpactScheduler m_Scheduler;
+	std::vector<MT::DSP::ImpactEvent> m_Events;
+	std::vector<Voice> m_Voices;
+	std::vector<float> m_Left;
+	std::vector<float> m_Right;
+};
+
+/**
+ * @brief FM voices that multiply by the whole modulation matrix every
+ * sample, every input reading the previous sample: the generic evaluation
+ * that FmAlgorithm compiles away, kept as the baseline.
+ */
+class DenseFmNode : public MT::DSP::PolyphonicNode
+{
+public:
+	DenseFmNode(const MT::DSP::FmPatch& patch, const uint32_t voices) :
+		PolyphonicNode(voices, MT::DSP::VoiceStealPolicy::Oldest),
+		m_Patch(patch) {}
+
+	[[nodiscard]] const char* GetName() const override { return "Dense FM"; }
+
+private:
+	static constexpr uint32_t MaxOperators = MT::DSP::FmPatch::MaxOperators;
+
+	void PrepareVoices(const MT::DSP::PrepareContext& context) override
+	{
+		m_Phase.Allocate(context.Memory, MaxOperators * m_Capacity);
+		m_Last.Allocate(context.Memory, MaxOperators * m_Capacity);
+		m_Increment.Allocate(context.Memory, m_Capacity);
+	}
+
+	void StartVoice(const uint32_t voice, const uint32_t note,
+					const float /*velocity*/, const bool /*stolen*/) override
+	{
+		m_Increment[voice] = NoteFrequency(note) / m_SampleRate;
+	}
+
+	void RenderGroup(const uint32_t group, const uint32_t frames,
+					 float* sums) override
+	{
+		namespace Simd = MT::DSP::Simd;
+		const uint32_t base = group * Simd::Width;
+		const auto count = static_cast<uint32_t>(m_Patch.Ratios.size());
+		const Simd::Float increment = Simd::LoadAligned(
+			m_Increment.Data() + base);
+		Simd::Float phase[MaxOperators];
+		Simd::Float last[MaxOperators];
+		for (uint32_t op = 0; op < count; op++)
+		{
+			phase[op] = Simd::LoadAligned(m_Phase.Data() + op * m_Capacity +
+				base);
+			last[op] = Simd::LoadAligned(m_Last.Data() + op * m_Capacity +
+				base);
+		}
+
+		for (uint32_t i = 0; i < frames; i++)
+		{
+			Simd::Float next[MaxOperators];
+			Simd::Float mix = Simd::Set(0.0f);
+			for (uint32_t op = 0; op < count; op++)
+			{
+				Simd::Float modulation = Simd::Set(0.0f);
+				for (uint32_t source = 0; source < count; source++)
+				{
+					modulation = Simd::MulAdd(
+						Simd::Set(m_Patch.Modulation(op, source) /
+							(2.0f * std::numbers::pi_v<float>)),
+						last[source], modulation);
+				}
+				const Simd::Float position = Simd::MulAdd(
+					Simd::Set(static_cast<float>(i + 1) * m_Patch.Ratios(op)),
+					increment, phase[op]);
+				next[op] = Simd::SinCycles(Simd::Add(position, modulation));
+				mix = Simd::MulAdd(Simd::Set(m_Patch.Output(op)), next[op],
+								   mix);
+			}
+			for (uint32_t op = 0; op < count; op++)
+				last[op] = next[op];
+			float* sum = sums + i * Simd::Width;
+			Simd::StoreAligned(sum, Simd::Add(Simd::LoadAligned(sum), mix));
+		}
+
+		for (uint32_t op = 0; op < count; op++)
+		{
+			phase[op] = Simd::MulAdd(Simd::Set(static_cast<float>(frames) *
+				m_Patch.Ratios(op)), increment, phase[op]);
+			phase[op] = Simd::Sub(phase[op], Simd::Floor(phase[op]));
+			Simd::StoreAligned(m_Phase.Data() + op * m_Capacity + base,
+							   phase[op]);
+			Simd::StoreAligned(m_Last.Data() + op * m_Capacity + base,
+							   last[op]);
+		}
+	}
+
+	MT::DSP::FmPatch m_Patch;
+	MT::DSP::ArenaArray<float> m_Phase;
+	MT::DSP::ArenaArray<float> m_Last;
+	MT::DSP::ArenaArray<float> m_Increment;
+};
+
+/** @brief Voice engine fixture timed per voice (or partial) and frame. */
+class VoiceFixture : public MT::Bench::NodeFixture
+{
+public:
+	VoiceFixture(std::unique_ptr<MT::DSP::Node> node,
+				 const MT::Bench::CaseConfig& config, const uint32_t voices,
+				 MT::DSP::ParallelExecutor* executor = nullptr,
+				 const uint32_t inputCount = 0) :
+		NodeFixture(std::move(node), config, inputCount, executor),
+		m_Voices(voices) {}
+
+	[[nodiscard]] uint64_t GetSamplesPerRun(
+		const MT::Bench::CaseConfig& config) const override
+	{
+		return static_cast<uint64_t>(config.BlockFrames) * m_Voices;
+	}
+
+private:
+	uint32_t m_Voices;
+};
+
+/** @brief Pool of the benchmarks that split their own work, built on use. */
+MT::DSP::ParallelExecutor& GetSharedExecutor()
+{
+	static MT::DSP::ParallelExecutor executor;
+	return executor;
+}
+
+/** @brief How a voice engine benchmark is set up before it is timed. */
+struct VoiceSetup
+{
+	/** @brief What the time is divided by: voices, partials, grains... */
+	uint32_t Units = 0;
+	std::vector<std::pair<uint32_t, float>> Parameters;
+	/** @brief Notes held, spread over NoteSpan keys from FirstNote. */
+	uint32_t Notes = 0;
+	uint32_t FirstNote = 24;
+	uint32_t NoteSpan = 96;
+	/** @brief Noise inputs connected to the node. */
+	uint32_t Inputs = 0;
+	/** @brief Whether the node may split its work on the shared pool. */
+	bool Parallel = false;
+	/** @brief Seconds rendered before timing, to reach a steady state. */
+	float WarmupSeconds = 0.0f;
+};
+
+/**
+ * @brief A voice engine made by @p create, after applying the parameters,
+ * notes and warmup of @p setup.
+ */
+MT::Bench::Benchmark MakeVoiceBenchmark(
+	std::string kernel, std::string variant, VoiceSetup setup,
+	std::function<std::unique_ptr<MT::DSP::Node>()> create)
+{
+	return {std::move(kernel), std::move(variant),
+			[setup = std::move(setup), create = std::move(create)](
+				const MT::Bench::CaseConfig& config)
+			{
+				auto fixture = std::make_unique<VoiceFixture>(
+					create(), config, setup.Units,
+					setup.Parallel ? &GetSharedExecutor() : nullptr,
+					setup.Inputs);
+				MT::DSP::Node& node = fixture->GetNode();
+				for (const auto& [id, value] : setup.Parameters)
+					node.SetParameter(id, value);
+				for (uint32_t note = 0; note < setup.Notes; note++)
+					node.OnNote(setup.FirstNote + note % setup.NoteSpan, 0.5f);
+				const float warmup = setup.WarmupSeconds * config.SampleRate;
+				for (float frames = 0.0f; frames < warmup;
+					 frames += static_cast<float>(config.BlockFrames))
+					fixture->Run();
+				return fixture;
+			}};
+}
+
+/**
+ * @brief A voice engine built from @p args with @p voices notes held across
+ * the keyboard, after applying @p parameters.
+ */
+template<typename T, typename... Args>
+MT::Bench::Benchmark MakeVoiceBenchmark(
+	std::string kernel, std::string variant, const uint32_t voices,
+	std::vector<std::pair<uint32_t, float>> parameters, Args... args)
+{
+	VoiceSetup setup;
+	setup.Units = voices;
+	setup.Parameters = std::move(parameters);
+	setup.Notes = voices;
+	return MakeVoiceBenchmark(std::move(kernel), std::move(variant),
+							  std::move(setup), [=]
+							  {
+								  return std::make_unique<T>(args...);
+							  });
+}
+}
+
+
+void MT::Bench::AddNodeBenchmarks(std::vector<Benchmark>& benchmarks)
+{
+	using namespace MT::DSP;
+
+	benchmarks.push_back(MakeNodeBenchmark<OscillatorNode>(
+		"oscillator", "sine", 0, 440.0f, false));
+
+	benchmarks.push_back(MakeNodeBenchmark<OnePoleFilterNode>(
+		"filter", "one-pole", 1, 1000.0f));
+	// Input 1 is noise too: the cutoff jumps by up to half an octave a
+	// sample, audio-rate modulation at its worst.
+	benchmarks.push_back(MakeNodeBenchmark<SvfFilterNode>(
+		"filter", "svf", 1));
+	benchmarks.push_back(MakeNodeBenchmark<SvfFilterNode>(
+		"filter", "svf-modulated", 2));
+	benchmarks.push_back(MakeNodeBenchmark<ExactSvfNode>(
+		"filter", "svf-modulated-exact", 2));
+
+	benchmarks.push_back(MakeNodeBenchmark<Mt19937NoiseNode>(
+		"noise", "mt19937", 0));
+	benchmarks.push_back(MakeNodeBenchmark<NoiseNode>(
+		"noise", "white", 0, NoiseColor::White));
+	benchmarks.push_back(MakeNodeBenchmark<NoiseNode>(
+		"noise", "pink", 0, NoiseColor::Pink));
+	benchmarks.push_back(MakeNodeBenchmark<NoiseNode>(
+		"noise", "brown", 0, NoiseColor::Brown));
+	benchmarks.push_back(MakeNodeBenchmark<NoiseNode>(
+		"noise", "velvet", 0, NoiseColor::Velvet));
+
+	benchmarks.push_back(MakeNodeBenchmark<MixerNode>("mix", "mixer-2", 2));
+	benchmarks.push_back(MakeNodeBenchmark<MixerNode>("mix", "mixer-8", 8));
+
+	benchmarks.push_back(MakeVoiceBenchmark<PolySynthNode>(
+		"voices", "poly-saw-256", 256, {}, 256u));
+	benchmarks.push_back(MakeVoiceBenchmark<PolySynthNode>(
+		"voices", "poly-saw-1024", 1024, {}, 1024u));
+
+	const std::shared_ptr<const WavetableBank> bank = WavetableBank::Build(
+		WavetableBank::MakeBasicShapes());
+	benchmarks.push_back(MakeVoiceBenchmark<WavetableSynthNode>(
+		"wavetable", "voices-256", 256, {}, bank, 256u));
+	benchmarks.push_back(MakeVoiceBenchmark<WavetableSynthNode>(
+		"wavetable", "voices-1024", 1024, {}, bank, 1024u));
+	benchmarks.push_back(MakeVoiceBenchmark<WavetableSynthNode>(
+		"wavetable", "morph-256", 256, {{WavetableSynthNode::Morph, 0.5f}},
+		bank, 256u));
+
+	// Same kernel one voice at a time and a SIMD group at a time.
+	using Parameters = std::vector<std::pair<uint32_t, float>>;
+	const std::pair<const char*, Parameters> analogCases[] = {
+		{"saw", {}},
+		{"triangle", {{VirtualAnalogNode::Waveform,
+					   static_cast<float>(AnalogWaveform::Triangle)}}},
+		{"pwm", {{VirtualAnalogNode::Waveform,
+				  static_cast<float>(AnalogWaveform::Pulse)},
+				 {VirtualAnalogNode::PwmDepth, 0.3f},
+				 {VirtualAnalogNode::PwmRate, 2.0f}}},
+		{"sync-saw", {{VirtualAnalogNode::Sync, 1.0f},
+					  {VirtualAnalogNode::SyncRatio, 2.7f}}},
+		{"saw-lowpass", {{VirtualAnalogNode::FilterType,
+						  static_cast<float>(AnalogFilter::LowPass)},
+						 {VirtualAnalogNode::FilterCutoff, 300.0f},
+						 {VirtualAnalogNode::FilterResonance, 4.0f},
+						 {VirtualAnalogNode::FilterEnvelope, 4.0f},
+						 {VirtualAnalogNode::FilterKeyTrack, 0.5f}}}
+	};
+	for (const auto& [name, parameters] : analogCases)
+	{
+		for (const bool vectorized : {false, true})
+		{
+			benchmarks.push_back(MakeVoiceBenchmark<VirtualAnalogNode>(
+				"analog", std::string(name) + (vectorized ? "-simd"
+														  : "-scalar"),
+				256, parameters, 256u, VoiceStealPolicy::Oldest,
+				vectorized));
+		}
+	}
+
+	// Compiled routing against the full matrix product, per preset.
+	const std::vector<FmPatch> fmPatches = FmPatch::MakePresets();
+	for (size_t preset = 0; preset < fmPatches.size(); preset++)
+	{
+		std::string name;
+		for (const char c : fmPatches[preset].Name)
+			name += c == ' ' ? '-' : static_cast<char>(std::tolower(c));
+		benchmarks.push_back(MakeVoiceBenchmark<FmSynthNode>(
+			"fm", name + "-compiled", 256,
+			{{FmSynthNode::Algorithm, static_cast<float>(preset)}},
+			FmSynthNode::CompilePresets(), 256u));
+		benchmarks.push_back(MakeVoiceBenchmark<DenseFmNode>(
+			"fm", name + "-dense", 256, {}, fmPatches[preset], 256u));
+	}
+
+	// Strings and tubes, both interpolators, at the bank sizes of a small
+	// and a large instrument.
+	const float tube = static_cast<float>(WaveguideInstrument::Tube);
+	const float allpass = static_cast<float>(FractionalDelay::Allpass);
+	for (const uint32_t strings : {64u, 256u})
+	{
+		const std::string count = std::to_string(strings);
+		benchmarks.push_back(MakeVoiceBenchmark<WaveguideNode>(
+			"waveguide", "string-lagrange-" + count, strings, {}, strings));
+		benchmarks.push_back(MakeVoiceBenchmark<WaveguideNode>(
+			"waveguide", "string-allpass-" + count, strings,
+			{{WaveguideNode::Interpolation, allpass}}, strings));
+		benchmarks.push_back(MakeVoiceBenchmark<WaveguideNode>(
+			"waveguide", "tube-lagrange-" + count, strings,
+			{{WaveguideNode::Instrument, tube}}, strings));
+	}
+
+	// A drone timed per partial. 64 copies keep all 20k partials below
+	// Nyquist, 16 copies put two thirds of them above it to show the
+	// culling.
+	using Additive = AdditiveSynthNode;
+	const Parameters drift = {{Additive::Density, 64.0f},
+							  {Additive::Shimmer, 0.5f},
+							  {Additive::Drift, 10.0f}};
+	Parameters partitioned = drift;
+	partitioned.emplace_back(Additive::Partitioned, 1.0f);
+	const std::tuple<const char*, uint32_t, Parameters> additiveCases[] = {
+		{"2k", 2048, {}},
+		{"20k", 20480, {{Additive::Density, 64.0f}}},
+		{"20k-culled", 20480, {{Additive::Density, 16.0f}}},
+		{"20k-drift", 20480, drift},
+		{"20k-drift-partitioned", 20480, partitioned}
+	};
+	for (const auto& [name, partials, parameters] : additiveCases)
+	{
+		VoiceSetup setup;
+		setup.Units = partials;
+		setup.Parameters = parameters;
+		for (const auto& [id, value] : parameters)
+			setup.Parallel |= id == Additive::Partitioned;
+		benchmarks.push_back(MakeVoiceBenchmark(
+			"additive", name, std::move(setup), [partials]
+			{
+				return std::make_unique<Additive>(partials, false);
+			}));
+	}
+
+	// A cloud of about that many grains, run until the pool is full and
+	// timed per grain. The Live source granulates white noise.
+	const std::tuple<const char*, uint32_t, GrainSource> granularCases[] = {
+		{"5k-sample", 5000, GrainSource::Sample},
+		{"5k-wavetable", 5000, GrainSource::Wavetable},
+		{"5k-live", 5000, GrainSource::Live},
+		{"20k-sample", 20000, GrainSource::Sample}
+	};
+	for (const auto& [name, grains, source] : granularCases)
+	{
+		constexpr float Duration = 0.1f;
+		VoiceSetup setup;
+		setup.Units = grains;
+		setup.Parameters = {
+			{GranularNode::Source, static_cast<float>(source)},
+			{GranularNode::Duration, Duration},
+			{GranularNode::Density, static_cast<float>(grains) / Duration},
+			{GranularNode::PitchSpread, 12.0f}
+		};
+		setup.Inputs = source == GrainSource::Live ? 1 : 0;
+		setup.WarmupSeconds = 2.0f * Duration;
+		benchmarks.push_back(MakeVoiceBenchmark(
+			"granular", name, std::move(setup), [grains, bank]
+			{
+				return std::make_unique<GranularNode>(2 * grains, bank);
+			}));
+	}
+
+	// Rain on the shared bank or with a voice per impact, timed per frame.
+	// A quarter second of warmup lets the oldest impacts die away.
+	for (const uint32_t rate : {1000u, 10000u, 50000u})
+	{
+		const std::string name = std::to_string(rate / 1000) + "k";
+		const auto impacts = static_cast<float>(rate);
+		VoiceSetup setup;
+		setup.Units = 1;
+		setup.WarmupSeconds = 0.25f;
+		VoiceSetup shared = setup;
+		shared.Parameters = {{ImpactNode::Rate, impacts}};
+		benchmarks.push_back(MakeVoiceBenchmark(
+			"impacts", "shared-" + name, std::move(shared), []
+			{
+				return std::make_unique<ImpactNode>();
+			}));
+		benchmarks.push_back(MakeVoiceBenchmark(
+			"impacts", "voices-" + name, std::move(setup), [impacts]
+			{
+				return std::make_unique<VoicePerImpactNode>(impacts);
+			}));
+	}
+
+	// Hard strikes, low enough that no mode is culled, timed per mode.
+	// Presets 1 and 2 are the plate and the membrane, 256 modes each; the
+	// driven bank is also rubbed with white noise.
+	const auto models = ModalNode::BuildPresets();
+	const std::tuple<const char*, uint32_t, uint32_t, bool> modalCases[] = {
+		{"plate-32", 1, 32, false},
+		{"plate-128", 1, 128, false},
+		{"membrane-128", 2, 128, false},
+		{"plate-128-driven", 1, 128, true}
+	};
+	for (const auto& [name, model, objects, driven] : modalCases)
+	{
+		VoiceSetup setup;
+		setup.Units = objects * models[model]->GetPaddedModeCount();
+		setup.Parameters = {{ModalNode::Model, static_cast<float>(model)},
+							{ModalNode::Hardness, 1.0f}};
+		if (driven)
+			setup.Parameters.emplace_back(ModalNode::InputGain, 0.01f);
+		setup.Notes = objects;
+		setup.FirstNote = 36;
+		setup.NoteSpan = 12;
+		setup.Inputs = driven ? 1 : 0;
+		benchmarks.push_back(MakeVoiceBenchmark(
+			"modal", name, std::move(setup), [models, objects]
+			{
+				return std::make_unique<ModalNode>(models, objects);
+			}));
+	}
+
+	// The dense variants multiply by the very matrices the Hadamard and
+	// Householder transforms apply.
+	constexpr const char* Matrices[] = {"hadamard", "householder", "random"};
+	for (const uint32_t lines : {8u, 16u, 32u, 64u})
+	{
+		for (uint32_t matrix = 0; matrix < std::size(Matrices); matrix++)
+		{
+			const std::string name = std::to_string(lines) + "-" +
+				Matrices[matrix];
+			const auto type = static_cast<FeedbackMatrix>(matrix);
+			benchmarks.push_back(MakeNodeBenchmark<FdnReverbNode>(
+				"fdn", name, 1, lines, type, 1.0f, false));
+			if (type != FeedbackMatrix::RandomOrthogonal)
+			{
+				benchmarks.push_back(MakeNodeBenchmark<FdnReverbNode>(
+					"fdn", name + "-dense", 1, lines, type, 1.0f, true));
+			}
+		}
+	}
+}
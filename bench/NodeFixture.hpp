@@ -0,0 +1,88 @@
+﻿#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Benchmark.hpp"
+#include "dsp/Node.hpp"
+#include "dsp/Random.hpp"
+
+namespace MT::Bench
+{
+/**
+ * @brief Times one DSP::Node processing a block.
+ *
+ * The node is prepared for the case's block size and channel count and fed
+ * @p inputCount buffers of white noise, laid out like a compiled graph lays
+ * out its buffers. An @p executor is handed to the node for splitting its
+ * own work.
+ */
+class NodeFixture : public Fixture
+{
+public:
+	NodeFixture(std::unique_ptr<DSP::Node> node, const CaseConfig& config,
+				const uint32_t inputCount = 0,
+				DSP::ParallelExecutor* executor = nullptr) :
+		m_Node(std::move(node))
+	{
+		const uint32_t stride = (config.BlockFrames +
+			DSP::BufferAlignmentFloats - 1) / DSP::BufferAlignmentFloats *
+			DSP::BufferAlignmentFloats;
+		const size_t bufferFloats = static_cast<size_t>(stride) *
+			config.Channels;
+		m_Storage.resize(bufferFloats * (inputCount + 1) +
+			DSP::BufferAlignmentFloats);
+
+		// Graph buffers start on a cache line, match that.
+		float* base = m_Storage.data();
+		while (reinterpret_cast<uintptr_t>(base) % 64)
+			base++;
+
+		DSP::Xorshift32 random;
+		for (uint32_t input = 0; input < inputCount; input++)
+		{
+			const DSP::BufferView view{base + bufferFloats * input,
+									   config.Channels, stride};
+			for (uint32_t channel = 0; channel < config.Channels; channel++)
+			{
+				for (uint32_t i = 0; i < config.BlockFrames; i++)
+					view.Channel(channel)[i] = random.NextBipolar() * 0.5f;
+			}
+			m_Inputs.push_back(view);
+		}
+
+		m_Context.Frames = config.BlockFrames;
+		m_Context.Inputs = m_Inputs;
+		m_Context.Output = {base + bufferFloats * inputCount, config.Channels,
+							stride};
+		m_Node->EnsurePrepared({config.SampleRate, config.BlockFrames,
+								config.Channels, nullptr, executor,
+								config.BlockFrames});
+	}
+
+	void Run() override { m_Node->Process(m_Context); }
+
+	[[nodiscard]] DSP::Node& GetNode() const { return *m_Node; }
+
+private:
+	std::unique_ptr<DSP::Node> m_Node;
+	std::vector<float> m_Storage;
+	std::vector<DSP::BufferView> m_Inputs;
+	DSP::ProcessContext m_Context;
+};
+
+/** @brief Registers a benchmark of node type @p T built from @p args. */
+template<typename T, typename... Args>
+Benchmark MakeNodeBenchmark(std::string kernel, std::string variant,
+							const uint32_t inputCount, Args... args)
+{
+	return {std::move(kernel), std::move(variant),
+			[=](const CaseConfig& config)
+			{
+				return std::make_unique<NodeFixture>(
+					std::make_unique<T>(args...), config, inputCount);
+			}};
+}
+}
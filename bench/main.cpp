@@ -0,0 +1,163 @@
+﻿#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Benchmark.hpp"
+#include "Benchmarks.hpp"
+
+
+namespace
+{
+struct LaunchOptions
+{
+	MT::Bench::RunOptions Run;
+	/// <summary> JSON destination, empty for stdout. </summary>
+	std::string OutputPath;
+	bool ListOnly = false;
+	bool Quiet = false;
+};
+
+/** @brief Parses all of @p text as a number, leaving @p value alone on failure. */
+template<typename T>
+bool ParseNumber(const std::string_view text, T& value)
+{
+	T parsed{};
+	const char* end = text.data() + text.size();
+	const auto [ptr, ec] = std::from_chars(text.data(), end, parsed);
+	if (ec != std::errc() || ptr != end)
+		return false;
+	value = parsed;
+	return true;
+}
+
+/** @brief Parses a comma separated list of positive integers. */
+bool ParseList(const std::string_view text, std::vector<uint32_t>& values)
+{
+	values.clear();
+	size_t start = 0;
+	while (start <= text.size())
+	{
+		const size_t end = std::min(text.find(',', start), text.size());
+		uint32_t value = 0;
+		if (!ParseNumber(text.substr(start, end - start), value) ||
+			value == 0)
+			return false;
+		values.push_back(value);
+		start = end + 1;
+	}
+	return !values.empty();
+}
+
+bool ParseArguments(const int argc, char** argv, LaunchOptions& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string_view arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		if (arg == "--output" && hasValue)
+			options.OutputPath = argv[++i];
+		else if (arg == "--blocks" && hasValue)
+		{
+			if (!ParseList(argv[++i], options.Run.BlockSizes))
+				return false;
+		}
+		else if (arg == "--channels" && hasValue)
+		{
+			if (!ParseList(argv[++i], options.Run.ChannelCounts))
+				return false;
+		}
+		else if (arg == "--rates" && hasValue)
+		{
+			if (!ParseList(argv[++i], options.Run.SampleRates))
+				return false;
+		}
+		else if (arg == "--seconds" && hasValue)
+		{
+			if (!ParseNumber(argv[++i], options.Run.SecondsPerCase))
+				return false;
+		}
+		else if (arg == "--repetitions" && hasValue)
+		{
+			if (!ParseNumber(argv[++i], options.Run.Repetitions))
+				return false;
+		}
+		else if (arg == "--filter" && hasValue)
+			options.Run.Filter = argv[++i];
+		else if (arg == "--list")
+			options.ListOnly = true;
+		else if (arg == "--quiet")
+			options.Quiet = true;
+		else
+			return false;
+	}
+	return true;
+}
+
+void PrintUsage()
+{
+	std::fputs("Usage: pae_bench [options]\n"
+			   "  --output <path>       Write the JSON report here instead of stdout.\n"
+			   "  --blocks <n,n,...>    Block sizes in frames (default 32..4096).\n"
+			   "  --channels <n,n,...>  Channel counts (default 1,2,8).\n"
+			   "  --rates <hz,hz,...>   Sample rates kernels are prepared for (48000).\n"
+			   "  --seconds <s>         Time spent per configuration (default 0.05).\n"
+			   "  --repetitions <n>     Timed repetitions, the median is reported.\n"
+			   "  --filter <text>       Only run kernel/variant names containing text.\n"
+			   "  --list                Print the benchmark names and exit.\n"
+			   "  --quiet               No progress lines on stderr.\n",
+			   stderr);
+}
+}
+
+
+int main(const int argc, char** argv)
+{
+	LaunchOptions options;
+	if (!ParseArguments(argc, argv, options))
+	{
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	std::vector<MT::Bench::Benchmark> benchmarks;
+	MT::Bench::AddNodeBenchmarks(benchmarks);
+	MT::Bench::AddConversionBenchmarks(benchmarks);
+	MT::Bench::AddBiquadBenchmarks(benchmarks);
+	MT::Bench::AddFdtdBenchmarks(benchmarks);
+	MT::Bench::AddConvolutionBenchmarks(benchmarks);
+
+	if (options.ListOnly)
+	{
+		for (const MT::Bench::Benchmark& benchmark : benchmarks)
+			std::cout << benchmark.GetName() << "\n";
+		return EXIT_SUCCESS;
+	}
+
+	const std::vector<MT::Bench::Result> results = MT::Bench::RunBenchmarks(
+		benchmarks, options.Run, options.Quiet ? nullptr : &std::cerr);
+	if (!options.Quiet)
+	{
+		MT::Bench::ReportFdtdCapacity(results, std::cerr);
+		MT::Bench::ReportConvolutionCosts(results, std::cerr);
+	}
+
+	if (options.OutputPath.empty())
+	{
+		MT::Bench::WriteJson(std::cout, results, options.Run);
+		return EXIT_SUCCESS;
+	}
+
+	std::ofstream file(options.OutputPath);
+	if (!file)
+	{
+		std::cerr << "Cannot write " << options.OutputPath << "\n";
+		return EXIT_FAILURE;
+	}
+	MT::Bench::WriteJson(file, results, options.Run);
+	return file.good() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
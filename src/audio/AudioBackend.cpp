@@ -0,0 +1,30 @@
+﻿#include "AudioBackend.hpp"
+
+#include "NullBackend.hpp"
+#include "WasapiBackend.hpp"
+#include "WavFileBackend.hpp"
+
+
+std::unique_ptr<MT::Audio::AudioBackend> MT::Audio::CreateAudioBackend(
+		const AudioBackendConfig& config)
+{
+	std::unique_ptr<AudioBackend> backend;
+	switch (config.Type)
+	{
+		case BackendType::Wasapi:
+#ifdef _WIN32
+			backend = std::make_unique<WasapiBackend>();
+#endif
+			break;
+		case BackendType::Null:
+			backend = std::make_unique<NullBackend>();
+			break;
+		case BackendType::WavFile:
+			backend = std::make_unique<WavFileBackend>();
+			break;
+	}
+
+	if (!backend || !backend->Open(config))
+		return nullptr;
+	return backend;
+}
@@ -0,0 +1,131 @@
+﻿#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "WavWriter.hpp"
+
+namespace MT::Audio
+{
+/** @brief Available output backends. */
+enum class BackendType
+{
+	Wasapi,
+	Null,
+	WavFile
+};
+
+/**
+ * @brief Interleaved 32-bit float stream layout negotiated with a backend.
+ */
+struct AudioFormat
+{
+	uint32_t SampleRate = 48000;
+	uint32_t Channels = 2;
+};
+
+/**
+ * @brief Settings used to open a backend.
+ *
+ * Zero values mean "use the device default".
+ */
+struct AudioBackendConfig
+{
+#ifdef _WIN32
+	BackendType Type = BackendType::Wasapi;
+#else
+	BackendType Type = BackendType::Null;
+#endif
+	AudioFormat Format{0, 0};
+	/**
+	 * @brief Frames rendered per device wakeup.
+	 *
+	 * Small periods (64-128 frames) trade CPU for latency; backends round
+	 * the request to what the device supports.
+	 */
+	uint32_t PeriodFrames = 0;
+	/** @brief Size of the ring buffer shared with the device, in frames. */
+	uint32_t BufferFrames = 0;
+	/**
+	 * @brief Whether clock-driven backends consume audio at the sample rate.
+	 *
+	 * When false the null and file backends accept frames as fast as the
+	 * engine can produce them, for faster-than-real-time runs.
+	 */
+	bool RealTime = true;
+	/** @brief Output path of the WAV file sink. */
+	std::string FilePath = "output.wav";
+	/** @brief Sample encoding of the WAV file sink. */
+	WavSampleFormat FileFormat = WavSampleFormat::Float32;
+};
+
+/**
+ * @brief Abstract audio output device.
+ *
+ * The render thread blocks in WaitForPeriod() until the device has room for
+ * at least one period, requests a writable region of that size, fills it
+ * with interleaved float samples and commits it back. Everything but the
+ * frame exchange is called from the control thread.
+ */
+class AudioBackend
+{
+public:
+	virtual ~AudioBackend() = default;
+
+	/**
+	 * @brief Opens the device and negotiates the stream format.
+	 * @return true if the backend is ready to be started.
+	 */
+	virtual bool Open(const AudioBackendConfig& config) = 0;
+	/** @brief Releases the device. Safe to call when not open. */
+	virtual void Close() = 0;
+
+	virtual bool Start() = 0;
+	virtual void Stop() = 0;
+
+	/** @brief Called once on the render thread before it starts rendering. */
+	virtual void OnRenderThreadBegin() {}
+	/** @brief Called once on the render thread after it finished rendering. */
+	virtual void OnRenderThreadEnd() {}
+
+	/** @brief Number of frames that can be written without blocking. */
+	virtual uint32_t GetAvailableFrames() = 0;
+	/**
+	 * @brief Blocks until at least one period can be written.
+	 * @param timeoutMs Upper bound on the wait, so the render thread can
+	 * notice a stop request.
+	 * @return Frames that can be written, 0 if the wait timed out.
+	 */
+	virtual uint32_t WaitForPeriod(uint32_t timeoutMs) = 0;
+	/**
+	 * @brief Returns a writable interleaved buffer of @p frames frames.
+	 * @return nullptr if the device could not provide the buffer.
+	 */
+	virtual float* RequestFrames(uint32_t frames) = 0;
+	/** @brief Hands the frames obtained from RequestFrames() to the device. */
+	virtual void CommitFrames(uint32_t frames) = 0;
+
+	[[nodiscard]] virtual AudioFormat GetFormat() const = 0;
+	/** @brief Frames the device consumes between two wakeups. */
+	[[nodiscard]] virtual uint32_t GetPeriodFrames() const = 0;
+	/** @brief Size of the device buffer in frames. */
+	[[nodiscard]] virtual uint32_t GetBufferFrames() const = 0;
+	/** @brief Output latency reported by the device, in frames. */
+	[[nodiscard]] virtual uint32_t GetLatencyFrames() const = 0;
+	/**
+	 * @brief Whether the device consumes audio at the sample rate. Only
+	 * real-time backends can underrun.
+	 */
+	[[nodiscard]] virtual bool IsRealTime() const { return true; }
+	[[nodiscard]] virtual const char* GetName() const = 0;
+};
+
+
+/**
+ * @brief Creates and opens the backend selected in @p config.
+ * @return nullptr if the backend is unavailable on this platform or failed
+ * to open.
+ */
+std::unique_ptr<AudioBackend> CreateAudioBackend(
+		const AudioBackendConfig& config);
+}
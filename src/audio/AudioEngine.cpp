@@ -0,0 +1,269 @@
+﻿#include "AudioEngine.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include "../dsp/CompiledGraph.hpp"
+#include "../dsp/MemoryArena.hpp"
+#include "../dsp/NodeProfiler.hpp"
+#include "../dsp/ParallelExecutor.hpp"
+#include "RealtimeGuard.hpp"
+#include "SampleConversion.hpp"
+#include "ThreadPriority.hpp"
+
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+uint64_t ElapsedNs(const Clock::time_point from, const Clock::time_point to)
+{
+	return static_cast<uint64_t>(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+}
+}
+
+
+MT::Audio::AudioEngine::AudioEngine(AudioBackend& backend,
+									const uint32_t workerThreads) :
+	m_Backend(backend),
+	m_Channels(backend.GetFormat().Channels),
+	m_Arena(std::make_unique<DSP::MemoryArena>()),
+	m_Executor(std::make_unique<DSP::ParallelExecutor>(workerThreads))
+{
+	m_Parameters[static_cast<size_t>(EngineParameter::MasterGain)] = 1.0f;
+#if PAE_ENABLE_PROFILING
+	m_Profiler = std::make_unique<DSP::NodeProfiler>(
+		m_Executor->GetConcurrency());
+#endif
+}
+
+MT::Audio::AudioEngine::~AudioEngine()
+{
+	Stop();
+	CollectRetiredGraphs();
+	delete m_PendingGraph.exchange(nullptr);
+	delete m_Graph;
+}
+
+MT::DSP::PrepareContext MT::Audio::AudioEngine::GetPrepareContext() const
+{
+	const AudioFormat format = m_Backend.GetFormat();
+	return {static_cast<float>(format.SampleRate), MaxBlockFrames,
+			format.Channels, m_Arena.get(), m_Executor.get(),
+			std::min(m_Backend.GetPeriodFrames(), MaxBlockFrames)};
+}
+
+MT::DSP::CompileOptions MT::Audio::AudioEngine::GetCompileOptions() const
+{
+	DSP::CompileOptions options;
+	options.Executor = m_Executor.get();
+	options.Profiler = m_Profiler.get();
+	return options;
+}
+
+void MT::Audio::AudioEngine::SetGraph(std::unique_ptr<DSP::CompiledGraph> graph)
+{
+	CollectRetiredGraphs();
+	// The audio thread never saw a graph that is still pending.
+	delete m_PendingGraph.exchange(graph.release(), std::memory_order_acq_rel);
+}
+
+void MT::Audio::AudioEngine::CollectRetiredGraphs()
+{
+	DSP::CompiledGraph* graph = nullptr;
+	while (m_RetiredGraphs.TryPop(graph))
+		delete graph;
+}
+
+bool MT::Audio::AudioEngine::Start()
+{
+	if (m_Running.load(std::memory_order_acquire))
+		return true;
+
+	if (!m_Backend.Start())
+		return false;
+
+	m_Running.store(true, std::memory_order_release);
+	m_Thread = std::thread(&AudioEngine::RenderThread, this);
+	return true;
+}
+
+void MT::Audio::AudioEngine::Stop()
+{
+	if (!m_Running.exchange(false, std::memory_order_acq_rel))
+		return;
+
+	if (m_Thread.joinable())
+		m_Thread.join();
+	m_Backend.Stop();
+}
+
+void MT::Audio::AudioEngine::RenderThread()
+{
+	PromoteToAudioPriority();
+	m_Backend.OnRenderThreadBegin();
+
+	const uint32_t bufferFrames = m_Backend.GetBufferFrames();
+	const bool realTime = m_Backend.IsRealTime();
+	Clock::time_point lastRefill = Clock::now();
+	bool primed = false;
+	while (m_Running.load(std::memory_order_acquire))
+	{
+		// Bounded so a stop request is noticed even if the device stalls.
+		const uint32_t framesAvailable = m_Backend.WaitForPeriod(100);
+		const Clock::time_point wakeup = Clock::now();
+		if (framesAvailable == 0)
+		{
+			m_Stats.OnEmptyWakeup();
+			continue;
+		}
+
+		// The device played everything we gave it, it is starving.
+		if (realTime && primed && framesAvailable == bufferFrames)
+			m_Stats.OnUnderrun();
+
+		float* buffer = m_Backend.RequestFrames(framesAvailable);
+		if (!buffer)
+			continue;
+
+		const Clock::time_point renderStart = Clock::now();
+		RenderBlock(buffer, framesAvailable);
+		const Clock::time_point renderEnd = Clock::now();
+		m_Backend.CommitFrames(framesAvailable);
+
+		const Clock::time_point written = Clock::now();
+		m_Stats.OnBlock(framesAvailable, ElapsedNs(lastRefill, wakeup),
+						ElapsedNs(renderStart, renderEnd),
+						ElapsedNs(wakeup, written));
+		lastRefill = wakeup;
+		primed = true;
+	}
+
+	m_Backend.OnRenderThreadEnd();
+}
+
+void MT::Audio::AudioEngine::RenderOffline(float* out, const uint32_t frames)
+{
+	const Clock::time_point renderStart = Clock::now();
+	RenderBlock(out, frames);
+	const Clock::time_point renderEnd = Clock::now();
+	m_Stats.OnBlock(frames, 0, ElapsedNs(renderStart, renderEnd), 0);
+
+	// The caller is the control thread, so retired graphs can go right away.
+	CollectRetiredGraphs();
+}
+
+void MT::Audio::AudioEngine::RenderBlock(float* out, const uint32_t frames)
+{
+	const RealtimeScope realtime;
+	SwapGraph();
+	DrainCommands();
+
+	// Split the block at every command offset so changes are sample accurate.
+	size_t next = 0;
+	uint32_t frame = 0;
+	while (frame < frames)
+	{
+		while (next < m_PendingCount && m_Pending[next].SampleOffset <= frame)
+			ApplyCommand(m_Pending[next++]);
+
+		const uint32_t end = next < m_PendingCount
+			? std::min(frames, m_Pending[next].SampleOffset)
+			: frames;
+		RenderSegment(out + static_cast<size_t>(frame) * m_Channels,
+					  end - frame);
+		frame = end;
+	}
+
+	// Whatever is left is due in a later block.
+	size_t kept = 0;
+	for (size_t i = next; i < m_PendingCount; i++)
+	{
+		m_Pending[kept] = m_Pending[i];
+		m_Pending[kept++].SampleOffset -= frames;
+	}
+	m_PendingCount = kept;
+}
+
+void MT::Audio::AudioEngine::RenderSegment(float* out, const uint32_t frames)
+{
+	if (!m_Graph)
+	{
+		std::fill_n(out, static_cast<size_t>(frames) * m_Channels, 0.0f);
+		return;
+	}
+
+	const float gain = m_Parameters[static_cast<size_t>(
+		EngineParameter::MasterGain)];
+	for (uint32_t done = 0; done < frames;)
+	{
+		const uint32_t chunk = std::min(frames - done, MaxBlockFrames);
+		m_Graph->Process(chunk);
+
+		// Planar graph output to the interleaved device buffer.
+		InterleaveScaled(m_Graph->GetOutput(), chunk, gain,
+						 out + static_cast<size_t>(done) * m_Channels,
+						 m_Channels);
+		done += chunk;
+	}
+}
+
+void MT::Audio::AudioEngine::SwapGraph()
+{
+	// Leave the graph pending if it could not be handed back for deletion.
+	if (m_RetiredGraphs.Size() == m_RetiredGraphs.GetCapacity() ||
+		!m_PendingGraph.load(std::memory_order_relaxed))
+		return;
+
+	DSP::CompiledGraph* graph = m_PendingGraph.exchange(
+		nullptr, std::memory_order_acq_rel);
+	if (!graph)
+		return;
+
+	if (m_Graph)
+		m_RetiredGraphs.TryPush(m_Graph);
+	m_Graph = graph;
+}
+
+void MT::Audio::AudioEngine::DrainCommands()
+{
+	Command command;
+	while (m_PendingCount < m_Pending.size() && m_Commands.TryPop(command))
+	{
+		// Insertion keeps the list sorted by offset and stable for ties.
+		size_t slot = m_PendingCount++;
+		while (slot > 0 && m_Pending[slot - 1].SampleOffset >
+			   command.SampleOffset)
+		{
+			m_Pending[slot] = m_Pending[slot - 1];
+			slot--;
+		}
+		m_Pending[slot] = command;
+	}
+}
+
+void MT::Audio::AudioEngine::ApplyCommand(const Command& command)
+{
+	switch (command.Type)
+	{
+		case CommandType::NoteOn:
+			if (m_Graph)
+				m_Graph->OnNote(command.Id, command.Value);
+			break;
+		case CommandType::NoteOff:
+			if (m_Graph)
+				m_Graph->OnNote(command.Id, 0.0f);
+			break;
+		case CommandType::SetParameter:
+			if (command.Target != Command::EngineTarget)
+			{
+				if (m_Graph)
+					m_Graph->SetParameter(command.Target, command.Id,
+										  command.Value);
+			}
+			else if (command.Id < m_Parameters.size())
+				m_Parameters[command.Id] = command.Value;
+			break;
+	}
+}
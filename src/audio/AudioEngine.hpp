@@ -0,0 +1,162 @@
+﻿#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include "AudioBackend.hpp"
+#include "Command.hpp"
+#include "RenderStats.hpp"
+#include "SpscQueue.hpp"
+
+namespace MT::DSP
+{
+class CompiledGraph;
+class MemoryArena;
+class NodeProfiler;
+class ParallelExecutor;
+struct CompileOptions;
+struct PrepareContext;
+}
+
+namespace MT::Audio
+{
+/**
+ * @brief Owns the real-time render thread that keeps the backend buffer full.
+ *
+ * The render thread only produces audio blocks. The UI thread controls it
+ * through Start()/Stop() and Send(), and observes it through GetStats(), so
+ * vsync or a slow UI frame can no longer delay a buffer refill.
+ */
+class AudioEngine
+{
+public:
+	static constexpr size_t CommandQueueCapacity = 1024;
+	/** @brief Largest block a graph is asked to render in one call. */
+	static constexpr uint32_t MaxBlockFrames = 512;
+
+	/**
+	 * @brief Creates an engine rendering into an opened backend.
+	 *
+	 * The engine does not take ownership of the backend; it must outlive it.
+	 *
+	 * @param workerThreads Threads helping the render thread with parallel
+	 * graphs, 0 for one less than the hardware threads.
+	 */
+	explicit AudioEngine(AudioBackend& backend, uint32_t workerThreads = 0);
+	~AudioEngine();
+
+	AudioEngine(const AudioEngine&) = delete;
+	AudioEngine& operator=(const AudioEngine&) = delete;
+
+	/** @brief Starts the device and spawns the render thread. */
+	bool Start();
+	/** @brief Signals the render thread to finish, joins it and stops the device. */
+	void Stop();
+
+	[[nodiscard]] bool IsRunning() const
+	{
+		return m_Running.load(std::memory_order_acquire);
+	}
+
+	/**
+	 * @brief Queues a control change for the audio thread.
+	 *
+	 * Must only be called from one thread (the UI thread). Never blocks;
+	 * commands are drained at the start of the next block.
+	 *
+	 * @return false if the queue is full and the command was dropped.
+	 */
+	bool Send(const Command& command) { return m_Commands.TryPush(command); }
+
+	/**
+	 * @brief Settings graphs must be compiled with to run on this engine.
+	 */
+	[[nodiscard]] DSP::PrepareContext GetPrepareContext() const;
+	/**
+	 * @brief Options that let graphs run on the engine's worker pool.
+	 */
+	[[nodiscard]] DSP::CompileOptions GetCompileOptions() const;
+
+	/**
+	 * @brief Hands a compiled graph to the audio thread.
+	 *
+	 * The swap happens atomically at the start of the next block. The
+	 * previous graph is returned to the control thread and destroyed by
+	 * CollectRetiredGraphs(), never on the audio thread. A graph that was
+	 * replaced before the audio thread picked it up is destroyed right away.
+	 */
+	void SetGraph(std::unique_ptr<DSP::CompiledGraph> graph);
+	/** @brief Destroys graphs the audio thread no longer uses. */
+	void CollectRetiredGraphs();
+
+	/**
+	 * @brief Records how long the last UI frame took.
+	 *
+	 * Only used for reporting; the render thread never waits on the UI.
+	 */
+	void ReportUiFrame(const uint64_t frameNs) { m_Stats.OnUiFrame(frameNs); }
+
+	/**
+	 * @brief Renders @p frames interleaved frames on the calling thread.
+	 *
+	 * Runs the same graph swap, command and mixing path as the render
+	 * thread, without waiting on the backend, for offline bounces. Must only
+	 * be called while the engine is stopped.
+	 */
+	void RenderOffline(float* out, uint32_t frames);
+
+	[[nodiscard]] const AudioBackend& GetBackend() const { return m_Backend; }
+	[[nodiscard]] RenderStats GetStats() const { return m_Stats.Snapshot(); }
+	void ResetPeakStats() { m_Stats.ResetPeaks(); }
+	/** @brief Pool the nodes of this engine's graphs allocate from. */
+	[[nodiscard]] const DSP::MemoryArena& GetArena() const { return *m_Arena; }
+	/**
+	 * @brief Per-node timings of graphs compiled with GetCompileOptions(),
+	 * nullptr when profiling is compiled out.
+	 */
+	[[nodiscard]] DSP::NodeProfiler* GetProfiler() const
+	{
+		return m_Profiler.get();
+	}
+
+private:
+	void RenderThread();
+	void RenderBlock(float* out, uint32_t frames);
+	void RenderSegment(float* out, uint32_t frames);
+
+	/** @brief Installs the pending graph, if any, retiring the current one. */
+	void SwapGraph();
+	/** @brief Moves queued commands into the offset-sorted pending list. */
+	void DrainCommands();
+	void ApplyCommand(const Command& command);
+
+private:
+	AudioBackend& m_Backend;
+	uint32_t m_Channels;
+
+	std::thread m_Thread;
+	std::atomic<bool> m_Running{false};
+	RenderStatsCounters m_Stats;
+
+	SpscQueue<Command, CommandQueueCapacity> m_Commands;
+	// Audio thread only: commands waiting for their sample offset.
+	std::array<Command, CommandQueueCapacity> m_Pending{};
+	size_t m_PendingCount = 0;
+
+	std::array<float, static_cast<size_t>(EngineParameter::Count)>
+	m_Parameters{};
+
+	// Node memory; graphs and nodes must be gone before it is destroyed.
+	std::unique_ptr<DSP::MemoryArena> m_Arena;
+	std::unique_ptr<DSP::ParallelExecutor> m_Executor;
+	std::unique_ptr<DSP::NodeProfiler> m_Profiler;
+
+	// Written by the control thread, taken by the audio thread.
+	std::atomic<DSP::CompiledGraph*> m_PendingGraph{nullptr};
+	// Audio thread only.
+	DSP::CompiledGraph* m_Graph = nullptr;
+	SpscQueue<DSP::CompiledGraph*, 8> m_RetiredGraphs;
+};
+}
@@ -0,0 +1,73 @@
+﻿#pragma once
+#include <cstdint>
+
+namespace MT::Audio
+{
+/** @brief Kind of control change sent to the audio thread. */
+enum class CommandType : uint8_t
+{
+	NoteOn,
+	NoteOff,
+	SetParameter
+};
+
+/** @brief Parameters owned by the engine itself. */
+enum class EngineParameter : uint32_t
+{
+	MasterGain,
+	Count
+};
+
+/**
+ * @brief Fixed-size control message passed from the UI to the audio thread.
+ *
+ * Commands are copied by value into preallocated queue slots, so they must
+ * stay trivially copyable and must not own memory.
+ */
+struct Command
+{
+	/** @brief Addresses the engine rather than a node. */
+	static constexpr uint32_t EngineTarget = 0xFFFFFFFF;
+
+	CommandType Type = CommandType::SetParameter;
+	/**
+	 * @brief Frames after the start of the next block at which the command
+	 * applies. Offsets beyond the block carry over into the following ones.
+	 */
+	uint32_t SampleOffset = 0;
+	/** @brief Receiver of the command, @ref EngineTarget or a node id. */
+	uint32_t Target = EngineTarget;
+	/** @brief Note number or parameter index. */
+	uint32_t Id = 0;
+	/** @brief Note velocity (0-1) or parameter value. */
+	float Value = 0.0f;
+
+	static Command NoteOn(const uint32_t note, const float velocity,
+						  const uint32_t sampleOffset = 0)
+	{
+		return {CommandType::NoteOn, sampleOffset, EngineTarget, note,
+				velocity};
+	}
+
+	static Command NoteOff(const uint32_t note,
+						   const uint32_t sampleOffset = 0)
+	{
+		return {CommandType::NoteOff, sampleOffset, EngineTarget, note, 0.0f};
+	}
+
+	static Command SetParameter(const uint32_t target, const uint32_t id,
+								const float value,
+								const uint32_t sampleOffset = 0)
+	{
+		return {CommandType::SetParameter, sampleOffset, target, id, value};
+	}
+
+	static Command SetParameter(const EngineParameter parameter,
+								const float value,
+								const uint32_t sampleOffset = 0)
+	{
+		return SetParameter(EngineTarget, static_cast<uint32_t>(parameter),
+							value, sampleOffset);
+	}
+};
+}
@@ -0,0 +1,16 @@
+﻿#pragma once
+
+/**
+ * @brief Default of the debugging aids that cost time on the render path,
+ * PAE_ENABLE_PROFILING and PAE_ENABLE_RT_GUARD.
+ *
+ * On in debug builds and off under NDEBUG. Define it to 0 or 1 to flip all
+ * of them at once, or define one of the switches to override it alone.
+ */
+#ifndef PAE_DEBUG_INSTRUMENTATION
+#ifdef NDEBUG
+#define PAE_DEBUG_INSTRUMENTATION 0
+#else
+#define PAE_DEBUG_INSTRUMENTATION 1
+#endif
+#endif
@@ -0,0 +1,94 @@
+﻿#include "NullBackend.hpp"
+
+#include <algorithm>
+#include <thread>
+
+
+bool MT::Audio::NullBackend::Open(const AudioBackendConfig& config)
+{
+	m_Format.SampleRate = config.Format.SampleRate
+		? config.Format.SampleRate
+		: 48000;
+	m_Format.Channels = config.Format.Channels ? config.Format.Channels : 2;
+	// Default to a 10 ms period, like a shared-mode device, double buffered.
+	m_PeriodFrames = config.PeriodFrames
+		? config.PeriodFrames
+		: m_Format.SampleRate / 100;
+	m_BufferFrames = std::max(config.BufferFrames, 2 * m_PeriodFrames);
+	m_RealTime = config.RealTime;
+
+	m_Buffer.assign(static_cast<size_t>(m_BufferFrames) * m_Format.Channels,
+					0.0f);
+	return true;
+}
+
+void MT::Audio::NullBackend::Close() { m_Buffer.clear(); }
+
+bool MT::Audio::NullBackend::Start()
+{
+	m_StartTime = Clock::now();
+	m_WritePosition = 0;
+	return true;
+}
+
+void MT::Audio::NullBackend::Stop() {}
+
+uint64_t MT::Audio::NullBackend::FramesConsumed() const
+{
+	constexpr uint64_t nsPerSecond = 1'000'000'000ull;
+	const auto elapsed = static_cast<uint64_t>(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(
+			Clock::now() - m_StartTime).count());
+	return elapsed / nsPerSecond * m_Format.SampleRate +
+		elapsed % nsPerSecond * m_Format.SampleRate / nsPerSecond;
+}
+
+uint32_t MT::Audio::NullBackend::GetAvailableFrames()
+{
+	if (!m_RealTime)
+		return m_BufferFrames;
+
+	// Frames still queued in the emulated device; none left means it starved.
+	const uint64_t consumed = FramesConsumed();
+	const uint64_t queued = m_WritePosition > consumed
+		? m_WritePosition - consumed
+		: 0;
+	return m_BufferFrames -
+		static_cast<uint32_t>(std::min<uint64_t>(queued, m_BufferFrames));
+}
+
+uint32_t MT::Audio::NullBackend::WaitForPeriod(const uint32_t timeoutMs)
+{
+	if (!m_RealTime)
+		return m_PeriodFrames;
+
+	// A period is free once everything but (buffer - period) frames played.
+	const uint64_t target = m_WritePosition + m_PeriodFrames > m_BufferFrames
+		? m_WritePosition + m_PeriodFrames - m_BufferFrames
+		: 0;
+	const auto deadline = m_StartTime + std::chrono::nanoseconds(
+		(target * 1'000'000'000ull + m_Format.SampleRate - 1) /
+		m_Format.SampleRate);
+	const auto timeout = Clock::now() + std::chrono::milliseconds(timeoutMs);
+	std::this_thread::sleep_until(std::min(deadline, timeout));
+
+	const uint32_t available = GetAvailableFrames();
+	return available >= m_PeriodFrames ? available : 0;
+}
+
+float* MT::Audio::NullBackend::RequestFrames(const uint32_t frames)
+{
+	if (frames > m_BufferFrames)
+		return nullptr;
+	return m_Buffer.data();
+}
+
+void MT::Audio::NullBackend::CommitFrames(const uint32_t frames)
+{
+	OnFramesCommitted(m_Buffer.data(), frames);
+
+	// A starved device restarts its clock from the late block.
+	if (m_RealTime)
+		m_WritePosition = std::max(m_WritePosition, FramesConsumed());
+	m_WritePosition += frames;
+}
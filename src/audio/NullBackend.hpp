@@ -0,0 +1,77 @@
+﻿#pragma once
+#include <chrono>
+#include <vector>
+
+#include "AudioBackend.hpp"
+
+namespace MT::Audio
+{
+/**
+ * @brief Headless backend that discards audio.
+ *
+ * In real-time mode it emulates a device draining its buffer at the sample
+ * rate using the steady clock, and WaitForPeriod() sleeps until the next
+ * period boundary, so the render path is timed like on hardware. Otherwise
+ * a period is always available and the engine runs as fast as it can.
+ */
+class NullBackend : public AudioBackend
+{
+public:
+	bool Open(const AudioBackendConfig& config) override;
+	void Close() override;
+
+	bool Start() override;
+	void Stop() override;
+
+	uint32_t GetAvailableFrames() override;
+	uint32_t WaitForPeriod(uint32_t timeoutMs) override;
+	float* RequestFrames(uint32_t frames) override;
+	void CommitFrames(uint32_t frames) override;
+
+	[[nodiscard]] AudioFormat GetFormat() const override { return m_Format; }
+	[[nodiscard]] uint32_t GetPeriodFrames() const override
+	{
+		return m_PeriodFrames;
+	}
+	[[nodiscard]] uint32_t GetBufferFrames() const override
+	{
+		return m_BufferFrames;
+	}
+	[[nodiscard]] uint32_t GetLatencyFrames() const override
+	{
+		return m_BufferFrames;
+	}
+	[[nodiscard]] bool IsRealTime() const override { return m_RealTime; }
+	[[nodiscard]] const char* GetName() const override { return "Null"; }
+
+	/**
+	 * @brief Write position of the emulated device in frames since Start(),
+	 * including the gaps left behind by underruns.
+	 */
+	[[nodiscard]] uint64_t GetWritePosition() const
+	{
+		return m_WritePosition;
+	}
+
+protected:
+	/** @brief Receives every committed block, on the render thread. */
+	virtual void OnFramesCommitted(const float* /*samples*/,
+								   uint32_t /*frames*/) {}
+
+	/** @brief Frames the emulated device has played since Start(). */
+	[[nodiscard]] uint64_t FramesConsumed() const;
+
+protected:
+	AudioFormat m_Format;
+	uint32_t m_PeriodFrames = 0;
+	uint32_t m_BufferFrames = 0;
+	bool m_RealTime = true;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	std::vector<float> m_Buffer;
+	Clock::time_point m_StartTime;
+	uint64_t m_WritePosition = 0;
+};
+}
@@ -0,0 +1,56 @@
+﻿#include "OfflineBounce.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+
+bool MT::Audio::BounceToWav(AudioEngine& engine,
+							const BounceSettings& settings,
+							BounceResult& result, std::string* error)
+{
+	const AudioFormat format = engine.GetBackend().GetFormat();
+	WavWriter writer;
+	if (!writer.Open(settings.FilePath, format.SampleRate, format.Channels,
+					 settings.Format))
+	{
+		if (error)
+			*error = "cannot open " + settings.FilePath + " for writing";
+		return false;
+	}
+
+	const auto totalFrames = static_cast<uint64_t>(std::llround(
+		std::max(settings.Seconds, 0.0) * format.SampleRate));
+	const uint32_t blockFrames = std::max(settings.BlockFrames, 1u);
+	std::vector<float> block(static_cast<size_t>(blockFrames) *
+		format.Channels);
+
+	const auto start = std::chrono::steady_clock::now();
+	for (uint64_t done = 0; done < totalFrames;)
+	{
+		const auto frames = static_cast<uint32_t>(std::min<uint64_t>(
+			blockFrames, totalFrames - done));
+		engine.RenderOffline(block.data(), frames);
+		if (!writer.Write(block.data(), frames))
+		{
+			writer.Close();
+			if (error)
+				*error = "failed writing to " + settings.FilePath;
+			return false;
+		}
+		done += frames;
+	}
+	if (!writer.Close())
+	{
+		if (error)
+			*error = "failed finishing " + settings.FilePath;
+		return false;
+	}
+	const auto end = std::chrono::steady_clock::now();
+
+	result.Frames = totalFrames;
+	result.AudioSeconds = static_cast<double>(totalFrames) / format.SampleRate;
+	result.WallSeconds = std::chrono::duration<double>(end - start).count();
+	return true;
+}
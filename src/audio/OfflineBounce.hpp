@@ -0,0 +1,46 @@
+﻿#pragma once
+#include <cstdint>
+#include <string>
+
+#include "AudioEngine.hpp"
+#include "WavWriter.hpp"
+
+namespace MT::Audio
+{
+/** @brief What to render in an offline bounce. */
+struct BounceSettings
+{
+	std::string FilePath = "output.wav";
+	WavSampleFormat Format = WavSampleFormat::Float32;
+	double Seconds = 10.0;
+	/** @brief Frames rendered per call, the equivalent of a device period. */
+	uint32_t BlockFrames = AudioEngine::MaxBlockFrames;
+};
+
+struct BounceResult
+{
+	uint64_t Frames = 0;
+	double AudioSeconds = 0.0;
+	/** @brief Wall-clock time spent rendering and writing. */
+	double WallSeconds = 0.0;
+
+	/** @brief Seconds of audio produced per second of wall-clock time. */
+	[[nodiscard]] double GetRealTimeFactor() const
+	{
+		return WallSeconds > 0.0 ? AudioSeconds / WallSeconds : 0.0;
+	}
+};
+
+/**
+ * @brief Renders the engine's current graph straight into a WAV file.
+ *
+ * Runs the engine's renderer on the calling thread as fast as it can, with
+ * no device pacing, in the format of the engine's backend. The engine must
+ * not be running.
+ *
+ * @param error Receives a description of the problem on failure.
+ * @return false if the file could not be written.
+ */
+bool BounceToWav(AudioEngine& engine, const BounceSettings& settings,
+				 BounceResult& result, std::string* error = nullptr);
+}
@@ -0,0 +1,258 @@
+﻿#include "RealtimeGuard.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined(_MSC_VER)
+#include <crtdbg.h>
+#include <intrin.h>
+#include <malloc.h>
+#endif
+
+// Whether the C allocation functions are hooked as well as operator new.
+#if PAE_ENABLE_RT_GUARD && \
+	(defined(__GLIBC__) || (defined(_MSC_VER) && defined(_DEBUG)))
+#define PAE_RT_GUARD_HOOKS_MALLOC 1
+#else
+#define PAE_RT_GUARD_HOOKS_MALLOC 0
+#endif
+
+#if PAE_RT_GUARD_HOOKS_MALLOC && defined(__GLIBC__)
+// glibc's own entry points, behind the interposed versions below.
+extern "C" void* __libc_malloc(size_t bytes);
+extern "C" void* __libc_calloc(size_t count, size_t bytes);
+extern "C" void* __libc_realloc(void* memory, size_t bytes);
+extern "C" void __libc_free(void* memory);
+#endif
+
+
+namespace
+{
+#if PAE_ENABLE_RT_GUARD
+// Plain thread_local ints need no dynamic initialisation, so reading them
+// from operator new cannot recurse into the allocator.
+thread_local uint32_t t_ScopeDepth = 0;
+/** @brief Set while operator new/delete forward a call they counted. */
+thread_local bool t_Forwarding = false;
+
+std::atomic<uint64_t> g_Allocations{0};
+std::atomic<uint64_t> g_Deallocations{0};
+std::atomic<uint64_t> g_Locks{0};
+std::atomic<bool> g_Trap{false};
+
+void OnViolation(std::atomic<uint64_t>& counter)
+{
+	counter.fetch_add(1, std::memory_order_relaxed);
+	if (!g_Trap.load(std::memory_order_relaxed))
+		return;
+#if defined(_MSC_VER)
+	__debugbreak();
+#else
+	std::abort();
+#endif
+}
+
+/** @brief Keeps the malloc hooks from counting a call a second time. */
+class ForwardScope
+{
+public:
+	ForwardScope() { t_Forwarding = true; }
+	~ForwardScope() { t_Forwarding = false; }
+};
+
+/** @brief Counts a C allocation function called inside a scope. */
+[[maybe_unused]] void OnMallocCall(std::atomic<uint64_t>& counter)
+{
+	if (t_ScopeDepth && !t_Forwarding)
+		OnViolation(counter);
+}
+
+void* AllocateChecked(const size_t bytes)
+{
+	if (t_ScopeDepth)
+		OnViolation(g_Allocations);
+	// malloc(0) may return nullptr, operator new must not.
+	ForwardScope forward;
+	if (void* memory = std::malloc(bytes ? bytes : 1))
+		return memory;
+	throw std::bad_alloc();
+}
+
+void* AllocateAlignedChecked(const size_t bytes, const std::align_val_t align)
+{
+	if (t_ScopeDepth)
+		OnViolation(g_Allocations);
+	const auto alignment = static_cast<size_t>(align);
+	ForwardScope forward;
+#if defined(_MSC_VER)
+	void* memory = _aligned_malloc(bytes ? bytes : 1, alignment);
+#else
+	// aligned_alloc wants a size that is a multiple of the alignment.
+	void* memory = std::aligned_alloc(
+		alignment, (bytes + alignment - 1) / alignment * alignment);
+#endif
+	if (memory)
+		return memory;
+	throw std::bad_alloc();
+}
+
+void FreeChecked(void* memory)
+{
+	if (memory && t_ScopeDepth)
+		OnViolation(g_Deallocations);
+	ForwardScope forward;
+	std::free(memory);
+}
+
+void FreeAlignedChecked(void* memory)
+{
+	if (memory && t_ScopeDepth)
+		OnViolation(g_Deallocations);
+	ForwardScope forward;
+#if defined(_MSC_VER)
+	_aligned_free(memory);
+#else
+	std::free(memory);
+#endif
+}
+
+#if PAE_RT_GUARD_HOOKS_MALLOC && defined(_MSC_VER)
+// The debug CRT reports every malloc, realloc and free here, including its
+// own internal blocks, which are left alone.
+int __cdecl OnCrtAllocation(const int type, void*, size_t, const int blockType,
+							long, const unsigned char*, int)
+{
+	if (blockType != _CRT_BLOCK)
+		OnMallocCall(type == _HOOK_FREE ? g_Deallocations : g_Allocations);
+	return TRUE;
+}
+
+[[maybe_unused]] const bool g_CrtHookInstalled =
+	(_CrtSetAllocHook(&OnCrtAllocation), true);
+#endif
+#endif
+}
+
+
+#if PAE_ENABLE_RT_GUARD
+MT::Audio::RealtimeScope::RealtimeScope() { t_ScopeDepth++; }
+MT::Audio::RealtimeScope::~RealtimeScope() { t_ScopeDepth--; }
+#endif
+
+bool MT::Audio::IsInRealtimeScope()
+{
+#if PAE_ENABLE_RT_GUARD
+	return t_ScopeDepth != 0;
+#else
+	return false;
+#endif
+}
+
+MT::Audio::RealtimeViolations MT::Audio::GetRealtimeViolations()
+{
+#if PAE_ENABLE_RT_GUARD
+	return {g_Allocations.load(std::memory_order_relaxed),
+			g_Deallocations.load(std::memory_order_relaxed),
+			g_Locks.load(std::memory_order_relaxed)};
+#else
+	return {};
+#endif
+}
+
+void MT::Audio::SetTrapOnRealtimeViolation([[maybe_unused]] const bool trap)
+{
+#if PAE_ENABLE_RT_GUARD
+	g_Trap.store(trap, std::memory_order_relaxed);
+#endif
+}
+
+void MT::Audio::ReportRealtimeLock()
+{
+#if PAE_ENABLE_RT_GUARD
+	if (t_ScopeDepth)
+		OnViolation(g_Locks);
+#endif
+}
+
+
+#if PAE_ENABLE_RT_GUARD
+// Replacements of the global allocation functions. Every other form
+// (nothrow, sized, array) is defined in terms of these by the standard
+// library, but they are replaced too so no path bypasses the count.
+void* operator new(const size_t bytes) { return AllocateChecked(bytes); }
+void* operator new[](const size_t bytes) { return AllocateChecked(bytes); }
+void* operator new(const size_t bytes, const std::nothrow_t&) noexcept
+{
+	try { return AllocateChecked(bytes); }
+	catch (...) { return nullptr; }
+}
+void* operator new[](const size_t bytes, const std::nothrow_t&) noexcept
+{
+	try { return AllocateChecked(bytes); }
+	catch (...) { return nullptr; }
+}
+void* operator new(const size_t bytes, const std::align_val_t align)
+{
+	return AllocateAlignedChecked(bytes, align);
+}
+void* operator new[](const size_t bytes, const std::align_val_t align)
+{
+	return AllocateAlignedChecked(bytes, align);
+}
+
+void operator delete(void* memory) noexcept { FreeChecked(memory); }
+void operator delete[](void* memory) noexcept { FreeChecked(memory); }
+void operator delete(void* memory, size_t) noexcept { FreeChecked(memory); }
+void operator delete[](void* memory, size_t) noexcept { FreeChecked(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+	FreeChecked(memory);
+}
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+	FreeChecked(memory);
+}
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+	FreeAlignedChecked(memory);
+}
+void operator delete[](void* memory, std::align_val_t) noexcept
+{
+	FreeAlignedChecked(memory);
+}
+void operator delete(void* memory, size_t, std::align_val_t) noexcept
+{
+	FreeAlignedChecked(memory);
+}
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept
+{
+	FreeAlignedChecked(memory);
+}
+#endif
+
+#if PAE_RT_GUARD_HOOKS_MALLOC && defined(__GLIBC__)
+// Definitions in the executable take precedence over libc's, so these see
+// every C allocation in the process, Eigen's and the standard library's.
+extern "C" void* malloc(const size_t bytes) noexcept
+{
+	OnMallocCall(g_Allocations);
+	return __libc_malloc(bytes);
+}
+extern "C" void* calloc(const size_t count, const size_t bytes) noexcept
+{
+	OnMallocCall(g_Allocations);
+	return __libc_calloc(count, bytes);
+}
+extern "C" void* realloc(void* memory, const size_t bytes) noexcept
+{
+	OnMallocCall(g_Allocations);
+	return __libc_realloc(memory, bytes);
+}
+extern "C" void free(void* memory) noexcept
+{
+	if (memory)
+		OnMallocCall(g_Deallocations);
+	__libc_free(memory);
+}
+#endif
@@ -0,0 +1,94 @@
+﻿#pragma once
+#include <cstdint>
+#include <mutex>
+
+#include "Instrumentation.hpp"
+
+/**
+ * @brief Whether heap and lock use on render threads is detected, by
+ * default PAE_DEBUG_INSTRUMENTATION.
+ *
+ * When on, the global operator new/delete are replaced by counting
+ * versions, so only enable it in the executable being debugged. malloc,
+ * calloc, realloc and free, which Eigen allocates through, are counted too
+ * where they can be hooked: interposed on glibc and through the debug
+ * CRT's allocation hook with MSVC.
+ */
+#ifndef PAE_ENABLE_RT_GUARD
+#define PAE_ENABLE_RT_GUARD PAE_DEBUG_INSTRUMENTATION
+#endif
+
+namespace MT::Audio
+{
+/** @brief Forbidden calls made inside a @ref RealtimeScope so far. */
+struct RealtimeViolations
+{
+	uint64_t Allocations = 0;
+	uint64_t Deallocations = 0;
+	uint64_t Locks = 0;
+
+	[[nodiscard]] uint64_t GetTotal() const
+	{
+		return Allocations + Deallocations + Locks;
+	}
+};
+
+/**
+ * @brief Marks the calling thread as rendering a block while alive.
+ *
+ * Scopes nest. Inside one, every heap allocation or release and every lock
+ * of a @ref CheckedMutex counts as a violation, and stops the program when
+ * trapping is enabled. Does nothing when PAE_ENABLE_RT_GUARD is 0.
+ */
+class RealtimeScope
+{
+public:
+#if PAE_ENABLE_RT_GUARD
+	RealtimeScope();
+	~RealtimeScope();
+#else
+	// User-provided so unused scope objects do not trigger warnings.
+	RealtimeScope() {}
+	~RealtimeScope() {}
+#endif
+
+	RealtimeScope(const RealtimeScope&) = delete;
+	RealtimeScope& operator=(const RealtimeScope&) = delete;
+};
+
+/** @brief Whether the calling thread is inside a @ref RealtimeScope. */
+[[nodiscard]] bool IsInRealtimeScope();
+[[nodiscard]] RealtimeViolations GetRealtimeViolations();
+/**
+ * @brief Breaks into the debugger (or aborts) on the next violation instead
+ * of only counting it.
+ */
+void SetTrapOnRealtimeViolation(bool trap);
+/** @brief Counts a lock taken by the calling thread, see @ref CheckedMutex. */
+void ReportRealtimeLock();
+
+/**
+ * @brief std::mutex that reports being locked inside a render block.
+ *
+ * Use it for any mutex the render path could conceivably reach; plain
+ * std::mutex locks cannot be observed.
+ */
+class CheckedMutex
+{
+public:
+	void lock()
+	{
+		ReportRealtimeLock();
+		m_Mutex.lock();
+	}
+	bool try_lock()
+	{
+		ReportRealtimeLock();
+		return m_Mutex.try_lock();
+	}
+	void unlock() { m_Mutex.unlock(); }
+
+private:
+	std::mutex m_Mutex;
+};
+}
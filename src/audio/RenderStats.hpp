@@ -0,0 +1,145 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace MT::Audio
+{
+/**
+ * @brief Snapshot of the render thread timing, safe to copy to the UI thread.
+ *
+ * The refill interval is the wall-clock time between two consecutive buffer
+ * refills on the render thread, and wake-to-write is the time from the
+ * period wakeup to the frames being committed to the device. When audio is
+ * decoupled from the UI, the maximum refill interval stays bounded by the
+ * device period no matter how long a UI frame takes, which is what
+ * @ref IsDecoupledFromUi() checks.
+ */
+struct RenderStats
+{
+	uint64_t BlocksRendered = 0;
+	uint64_t FramesRendered = 0;
+	uint64_t Underruns = 0;
+	/** @brief Wakeups that found less than a period to write. */
+	uint64_t EmptyWakeups = 0;
+
+	uint64_t LastRefillIntervalNs = 0;
+	uint64_t MaxRefillIntervalNs = 0;
+	uint64_t LastRenderTimeNs = 0;
+	uint64_t MaxRenderTimeNs = 0;
+	uint64_t LastWakeToWriteNs = 0;
+	uint64_t MaxWakeToWriteNs = 0;
+
+	uint64_t LastUiFrameNs = 0;
+	uint64_t MaxUiFrameNs = 0;
+
+	/**
+	 * @brief Whether the slowest refill interval stayed below the slowest UI
+	 * frame, i.e. UI stalls did not delay the audio refill.
+	 *
+	 * Only meaningful once the UI has hitched for longer than a device
+	 * period; before any UI frame has been reported this returns true.
+	 */
+	[[nodiscard]] bool IsDecoupledFromUi() const
+	{
+		return MaxUiFrameNs == 0 || MaxRefillIntervalNs < MaxUiFrameNs;
+	}
+};
+
+
+/**
+ * @brief Lock-free accumulator written by the render thread and the UI
+ * thread, read back as a @ref RenderStats snapshot.
+ *
+ * The totals and last values each have a single writer. The maxima are also
+ * cleared by ResetPeaks() on the UI thread, so StoreMax() raises them with a
+ * compare-exchange loop that a concurrent reset cannot undo half-way: the
+ * update either lands before the reset or retries against the cleared value.
+ * No field guards another, so relaxed ordering is enough.
+ */
+class RenderStatsCounters
+{
+public:
+	void OnBlock(const uint32_t frames, const uint64_t refillIntervalNs,
+				 const uint64_t renderTimeNs, const uint64_t wakeToWriteNs)
+	{
+		m_BlocksRendered.fetch_add(1, std::memory_order_relaxed);
+		m_FramesRendered.fetch_add(frames, std::memory_order_relaxed);
+		m_LastRefillIntervalNs.store(refillIntervalNs,
+									 std::memory_order_relaxed);
+		StoreMax(m_MaxRefillIntervalNs, refillIntervalNs);
+		m_LastRenderTimeNs.store(renderTimeNs, std::memory_order_relaxed);
+		StoreMax(m_MaxRenderTimeNs, renderTimeNs);
+		m_LastWakeToWriteNs.store(wakeToWriteNs, std::memory_order_relaxed);
+		StoreMax(m_MaxWakeToWriteNs, wakeToWriteNs);
+	}
+
+	void OnUnderrun() { m_Underruns.fetch_add(1, std::memory_order_relaxed); }
+
+	void OnEmptyWakeup()
+	{
+		m_EmptyWakeups.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void OnUiFrame(const uint64_t frameNs)
+	{
+		m_LastUiFrameNs.store(frameNs, std::memory_order_relaxed);
+		StoreMax(m_MaxUiFrameNs, frameNs);
+	}
+
+	/** @brief Clears the running maxima, keeping the totals. */
+	void ResetPeaks()
+	{
+		m_MaxRefillIntervalNs.store(0, std::memory_order_relaxed);
+		m_MaxRenderTimeNs.store(0, std::memory_order_relaxed);
+		m_MaxWakeToWriteNs.store(0, std::memory_order_relaxed);
+		m_MaxUiFrameNs.store(0, std::memory_order_relaxed);
+	}
+
+	[[nodiscard]] RenderStats Snapshot() const
+	{
+		RenderStats stats;
+		stats.BlocksRendered = m_BlocksRendered.load(std::memory_order_relaxed);
+		stats.FramesRendered = m_FramesRendered.load(std::memory_order_relaxed);
+		stats.Underruns = m_Underruns.load(std::memory_order_relaxed);
+		stats.EmptyWakeups = m_EmptyWakeups.load(std::memory_order_relaxed);
+		stats.LastRefillIntervalNs =
+				m_LastRefillIntervalNs.load(std::memory_order_relaxed);
+		stats.MaxRefillIntervalNs =
+				m_MaxRefillIntervalNs.load(std::memory_order_relaxed);
+		stats.LastRenderTimeNs =
+				m_LastRenderTimeNs.load(std::memory_order_relaxed);
+		stats.MaxRenderTimeNs = m_MaxRenderTimeNs.load(std::memory_order_relaxed);
+		stats.LastWakeToWriteNs =
+				m_LastWakeToWriteNs.load(std::memory_order_relaxed);
+		stats.MaxWakeToWriteNs =
+				m_MaxWakeToWriteNs.load(std::memory_order_relaxed);
+		stats.LastUiFrameNs = m_LastUiFrameNs.load(std::memory_order_relaxed);
+		stats.MaxUiFrameNs = m_MaxUiFrameNs.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+private:
+	static void StoreMax(std::atomic<uint64_t>& target, const uint64_t value)
+	{
+		uint64_t current = target.load(std::memory_order_relaxed);
+		while (value > current &&
+			   !target.compare_exchange_weak(current, value,
+											 std::memory_order_relaxed))
+		{}
+	}
+
+private:
+	std::atomic<uint64_t> m_BlocksRendered{0};
+	std::atomic<uint64_t> m_FramesRendered{0};
+	std::atomic<uint64_t> m_Underruns{0};
+	std::atomic<uint64_t> m_EmptyWakeups{0};
+	std::atomic<uint64_t> m_LastRefillIntervalNs{0};
+	std::atomic<uint64_t> m_MaxRefillIntervalNs{0};
+	std::atomic<uint64_t> m_LastRenderTimeNs{0};
+	std::atomic<uint64_t> m_MaxRenderTimeNs{0};
+	std::atomic<uint64_t> m_LastWakeToWriteNs{0};
+	std::atomic<uint64_t> m_MaxWakeToWriteNs{0};
+	std::atomic<uint64_t> m_LastUiFrameNs{0};
+	std::atomic<uint64_t> m_MaxUiFrameNs{0};
+};
+}
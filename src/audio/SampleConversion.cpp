@@ -0,0 +1,66 @@
+﻿#include "SampleConversion.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace
+{
+/** @brief Rounds to the nearest step of a signed @p bits integer and clips. */
+int32_t Quantize(const float sample, const int bits)
+{
+	const auto limit = static_cast<float>(1 << (bits - 1));
+	const float scaled = std::nearbyint(sample * limit);
+	return static_cast<int32_t>(std::clamp(scaled, -limit, limit - 1.0f));
+}
+}
+
+
+void MT::Audio::InterleaveScaled(const DSP::BufferView& source,
+								 const uint32_t frames, const float gain,
+								 float* out, const uint32_t outChannels)
+{
+	const uint32_t sourceChannels = std::min(source.Channels, outChannels);
+	for (uint32_t channel = 0; channel < outChannels; channel++)
+	{
+		float* destination = out + channel;
+		if (channel >= sourceChannels)
+		{
+			for (uint32_t i = 0; i < frames; i++)
+				destination[static_cast<size_t>(i) * outChannels] = 0.0f;
+			continue;
+		}
+
+		const float* in = source.Channel(channel);
+		for (uint32_t i = 0; i < frames; i++)
+			destination[static_cast<size_t>(i) * outChannels] = in[i] * gain;
+	}
+}
+
+void MT::Audio::EncodePcm16(const float* samples, const size_t count,
+							char* out, DSP::Xorshift32& dither)
+{
+	// Triangular dither of +-1 LSB decorrelates the rounding error from the
+	// signal, quiet tails fade into noise instead of distortion.
+	constexpr float lsb = 1.0f / 32768.0f;
+	for (size_t i = 0; i < count; i++)
+	{
+		const float noise = (dither.NextUnipolar() - dither.NextUnipolar()) *
+			lsb;
+		const int32_t value = Quantize(samples[i] + noise, 16);
+		out[2 * i] = static_cast<char>(value);
+		out[2 * i + 1] = static_cast<char>(value >> 8);
+	}
+}
+
+void MT::Audio::EncodePcm24(const float* samples, const size_t count,
+							char* out)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		const int32_t value = Quantize(samples[i], 24);
+		out[3 * i] = static_cast<char>(value);
+		out[3 * i + 1] = static_cast<char>(value >> 8);
+		out[3 * i + 2] = static_cast<char>(value >> 16);
+	}
+}
@@ -0,0 +1,29 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "../dsp/Node.hpp"
+#include "../dsp/Random.hpp"
+
+namespace MT::Audio
+{
+/**
+ * @brief Writes planar @p source into an interleaved buffer, scaled by
+ * @p gain.
+ *
+ * @p out has @p outChannels channels; channels @p source does not have are
+ * filled with silence.
+ */
+void InterleaveScaled(const DSP::BufferView& source, uint32_t frames,
+					  float gain, float* out, uint32_t outChannels);
+
+/**
+ * @brief Converts floats to little-endian 16-bit PCM with TPDF dither.
+ *
+ * @p out receives 2 * @p count bytes. Samples are clipped to [-1, 1).
+ */
+void EncodePcm16(const float* samples, size_t count, char* out,
+				 DSP::Xorshift32& dither);
+/** @brief Converts floats to packed little-endian 24-bit PCM (3 bytes each). */
+void EncodePcm24(const float* samples, size_t count, char* out);
+}
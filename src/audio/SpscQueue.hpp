@@ -0,0 +1,89 @@
+﻿#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+namespace MT::Audio
+{
+/** @brief Alignment used to keep data written by different threads apart. */
+inline constexpr size_t CacheLineSize = 64;
+
+/**
+ * @brief Bounded, wait-free single-producer/single-consumer ring buffer.
+ *
+ * All storage lives inside the object, so pushing and popping never
+ * allocate or lock. Exactly one thread may push and exactly one (other)
+ * thread may pop.
+ *
+ * @tparam T Trivially copyable element type.
+ * @tparam Capacity Number of slots, must be a power of two.
+ */
+template<typename T, size_t Capacity>
+class SpscQueue
+{
+	static_assert(std::is_trivially_copyable_v<T>,
+				  "SpscQueue elements are copied without constructors.");
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+				  "SpscQueue capacity must be a power of two.");
+
+public:
+	/**
+	 * @brief Producer side. Copies @p item into the queue.
+	 * @return false if the queue is full; the item is not enqueued.
+	 */
+	bool TryPush(const T& item)
+	{
+		const size_t tail = m_Tail.load(std::memory_order_relaxed);
+		if (tail - m_CachedHead == Capacity)
+		{
+			m_CachedHead = m_Head.load(std::memory_order_acquire);
+			if (tail - m_CachedHead == Capacity)
+				return false;
+		}
+
+		m_Slots[tail & Mask] = item;
+		m_Tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * @brief Consumer side. Moves the oldest item into @p item.
+	 * @return false if the queue is empty.
+	 */
+	bool TryPop(T& item)
+	{
+		const size_t head = m_Head.load(std::memory_order_relaxed);
+		if (head == m_CachedTail)
+		{
+			m_CachedTail = m_Tail.load(std::memory_order_acquire);
+			if (head == m_CachedTail)
+				return false;
+		}
+
+		item = m_Slots[head & Mask];
+		m_Head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	/** @brief Approximate number of queued items, exact on either end. */
+	[[nodiscard]] size_t Size() const
+	{
+		return m_Tail.load(std::memory_order_acquire) -
+			m_Head.load(std::memory_order_acquire);
+	}
+
+	[[nodiscard]] static constexpr size_t GetCapacity() { return Capacity; }
+
+private:
+	static constexpr size_t Mask = Capacity - 1;
+
+	// Producer and consumer indices live on separate cache lines, each next
+	// to the other side's index cached locally to avoid cross-core traffic.
+	alignas(CacheLineSize) std::atomic<size_t> m_Tail{0};
+	size_t m_CachedHead = 0;
+	alignas(CacheLineSize) std::atomic<size_t> m_Head{0};
+	size_t m_CachedTail = 0;
+	alignas(CacheLineSize) std::array<T, Capacity> m_Slots{};
+};
+}
@@ -0,0 +1,22 @@
+﻿#include "ThreadPriority.hpp"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+
+void MT::Audio::PromoteToAudioPriority()
+{
+#ifdef _WIN32
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+#else
+	// Real-time scheduling usually needs rtkit or CAP_SYS_NICE, so this
+	// commonly fails on build machines, which is fine.
+	sched_param param{};
+	param.sched_priority = sched_get_priority_min(SCHED_FIFO) + 10;
+	pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+#endif
+}
@@ -0,0 +1,13 @@
+﻿#pragma once
+
+namespace MT::Audio
+{
+/**
+ * @brief Raises the calling thread to the highest priority the OS grants
+ * without special privileges, for threads rendering inside the audio
+ * deadline.
+ *
+ * Failure is not an error: the thread just keeps its normal priority.
+ */
+void PromoteToAudioPriority();
+}
@@ -0,0 +1,286 @@
+﻿#ifdef _WIN32
+#include "WasapiBackend.hpp"
+
+#include <Audioclient.h>
+#include <Windows.h>
+#include <algorithm>
+#include <avrt.h>
+#include <iostream>
+#include <ksmedia.h>
+#include <mmdeviceapi.h>
+#include <mmreg.h>
+#include <print>
+
+
+namespace
+{
+template<typename T>
+void SafeRelease(T*& ptr)
+{
+	if (ptr)
+	{
+		ptr->Release();
+		ptr = nullptr;
+	}
+}
+
+/// <summary> Converts a REFERENCE_TIME (100 ns units) into frames. </summary>
+uint32_t ToFrames(const REFERENCE_TIME time, const uint32_t sampleRate)
+{
+	return static_cast<uint32_t>(time * sampleRate / 10'000'000);
+}
+}
+
+
+bool MT::Audio::WasapiBackend::Open(const AudioBackendConfig& config)
+{
+	Close();
+
+	// Init COM (Component Object Model).
+	HRESULT result = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+	if (FAILED(result))
+		return false;
+	m_ComInitialized = true;
+
+	// "IMMDeviceEnumerator" lists audio devices.
+	result = CoCreateInstance(__uuidof(MMDeviceEnumerator),
+							  nullptr,
+							  CLSCTX_ALL,
+							  __uuidof(IMMDeviceEnumerator),
+							  IID_PPV_ARGS_Helper(&m_DeviceEnumerator));
+	if (FAILED(result))
+	{
+		Close();
+		return false;
+	}
+
+	// Get default audio device. eRender -> Output, eConsole -> (use-case) normal app.
+	result = m_DeviceEnumerator->GetDefaultAudioEndpoint(
+			eRender, eConsole, &m_Device);
+	if (FAILED(result))
+	{
+		std::cerr << "Failed to get default audio device.\n";
+		Close();
+		return false;
+	}
+
+	// Lets us communicate with the audio device.
+	result = m_Device->Activate(__uuidof(IAudioClient),
+								CLSCTX_ALL,
+								nullptr,
+								IID_PPV_ARGS_Helper(&m_AudioClient));
+	if (FAILED(result))
+	{
+		std::cerr << "Failed to activate the audio client.\n";
+		Close();
+		return false;
+	}
+
+	WAVEFORMATEX* mixFormat = nullptr;
+	result = m_AudioClient->GetMixFormat(&mixFormat);
+	if (FAILED(result))
+	{
+		std::cerr << "Failed to get mix format.\n";
+		Close();
+		return false;
+	}
+
+	std::println("Channels: {}\nSampleRate: {}\nBits per sample: {}",
+				 mixFormat->nChannels, mixFormat->nSamplesPerSec,
+				 mixFormat->wBitsPerSample);
+
+	m_Format.SampleRate = config.Format.SampleRate
+		? config.Format.SampleRate
+		: mixFormat->nSamplesPerSec;
+	m_Format.Channels = config.Format.Channels
+		? config.Format.Channels
+		: mixFormat->nChannels;
+	const bool sameLayout = m_Format.Channels == mixFormat->nChannels &&
+		mixFormat->wFormatTag == WAVE_FORMAT_EXTENSIBLE;
+	const DWORD channelMask = sameLayout
+		? reinterpret_cast<WAVEFORMATEXTENSIBLE*>(mixFormat)->dwChannelMask
+		: 0;
+	const uint32_t mixRate = mixFormat->nSamplesPerSec;
+	const uint32_t mixChannels = mixFormat->nChannels;
+	CoTaskMemFree(mixFormat);
+
+	// Always render float, let the audio engine convert to the mix format.
+	WAVEFORMATEXTENSIBLE format{};
+	format.Format.wFormatTag = WAVE_FORMAT_EXTENSIBLE;
+	format.Format.nChannels = static_cast<WORD>(m_Format.Channels);
+	format.Format.nSamplesPerSec = m_Format.SampleRate;
+	format.Format.wBitsPerSample = 32;
+	format.Format.nBlockAlign = static_cast<WORD>(m_Format.Channels * 4);
+	format.Format.nAvgBytesPerSec = m_Format.SampleRate *
+		format.Format.nBlockAlign;
+	format.Format.cbSize = sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX);
+	format.Samples.wValidBitsPerSample = 32;
+	format.dwChannelMask = channelMask;
+	format.SubFormat = KSDATAFORMAT_SUBTYPE_IEEE_FLOAT;
+
+	const bool atMixRate = m_Format.SampleRate == mixRate &&
+		m_Format.Channels == mixChannels;
+	if (!(config.PeriodFrames && atMixRate &&
+		  InitializeLowLatency(&format.Format, config.PeriodFrames)))
+	{
+		// Shared-mode streams always run at the engine period, only the
+		// buffer size can be chosen.
+		const REFERENCE_TIME bufferDuration = static_cast<REFERENCE_TIME>(
+			config.BufferFrames) * 10'000'000 / m_Format.SampleRate;
+		result = m_AudioClient->Initialize(
+			AUDCLNT_SHAREMODE_SHARED,
+			AUDCLNT_STREAMFLAGS_EVENTCALLBACK |
+			AUDCLNT_STREAMFLAGS_AUTOCONVERTPCM |
+			AUDCLNT_STREAMFLAGS_SRC_DEFAULT_QUALITY,
+			bufferDuration, 0, &format.Format, nullptr);
+		if (FAILED(result))
+		{
+			std::cerr << "IAudioClient::Initialize failed!\n";
+			Close();
+			return false;
+		}
+
+		REFERENCE_TIME defaultPeriod = 0;
+		m_AudioClient->GetDevicePeriod(&defaultPeriod, nullptr);
+		m_PeriodFrames = ToFrames(defaultPeriod, m_Format.SampleRate);
+	}
+	std::println("Audio client initialized successfully!");
+
+	m_PeriodEvent = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+	if (!m_PeriodEvent || FAILED(m_AudioClient->SetEventHandle(m_PeriodEvent)))
+	{
+		std::cerr << "Failed to register the period event.\n";
+		Close();
+		return false;
+	}
+
+	// Actually write audio into buffer.
+	result = m_AudioClient->GetService(__uuidof(IAudioRenderClient),
+									   IID_PPV_ARGS_Helper(&m_RenderClient));
+	if (FAILED(result))
+	{
+		Close();
+		return false;
+	}
+
+	m_AudioClient->GetBufferSize(&m_BufferFrames);
+	m_PeriodFrames = std::min(m_PeriodFrames, m_BufferFrames);
+	REFERENCE_TIME streamLatency = 0;
+	m_AudioClient->GetStreamLatency(&streamLatency);
+	m_LatencyFrames = m_BufferFrames +
+		ToFrames(streamLatency, m_Format.SampleRate);
+	return true;
+}
+
+bool MT::Audio::WasapiBackend::InitializeLowLatency(
+		const WAVEFORMATEX* format, const uint32_t periodFrames)
+{
+	IAudioClient3* audioClient3 = nullptr;
+	if (FAILED(m_AudioClient->QueryInterface(
+		__uuidof(IAudioClient3), IID_PPV_ARGS_Helper(&audioClient3))))
+		return false;
+
+	UINT32 defaultPeriod = 0, fundamentalPeriod = 0;
+	UINT32 minPeriod = 0, maxPeriod = 0;
+	HRESULT result = audioClient3->GetSharedModeEnginePeriod(
+		format, &defaultPeriod, &fundamentalPeriod, &minPeriod, &maxPeriod);
+	if (SUCCEEDED(result))
+	{
+		// Periods must be a multiple of the fundamental period.
+		const uint32_t rounded = (periodFrames + fundamentalPeriod - 1) /
+			fundamentalPeriod * fundamentalPeriod;
+		m_PeriodFrames = std::clamp<uint32_t>(rounded, minPeriod, maxPeriod);
+		result = audioClient3->InitializeSharedAudioStream(
+			AUDCLNT_STREAMFLAGS_EVENTCALLBACK, m_PeriodFrames, format,
+			nullptr);
+	}
+	audioClient3->Release();
+
+	if (FAILED(result))
+	{
+		// A failed Initialize leaves the client unusable, start over.
+		SafeRelease(m_AudioClient);
+		m_Device->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr,
+						   IID_PPV_ARGS_Helper(&m_AudioClient));
+		return false;
+	}
+	return true;
+}
+
+void MT::Audio::WasapiBackend::Close()
+{
+	if (m_PeriodEvent)
+	{
+		CloseHandle(m_PeriodEvent);
+		m_PeriodEvent = nullptr;
+	}
+	SafeRelease(m_RenderClient);
+	SafeRelease(m_AudioClient);
+	SafeRelease(m_Device);
+	SafeRelease(m_DeviceEnumerator);
+	if (m_ComInitialized)
+	{
+		CoUninitialize();
+		m_ComInitialized = false;
+	}
+}
+
+bool MT::Audio::WasapiBackend::Start()
+{
+	return m_AudioClient && SUCCEEDED(m_AudioClient->Start());
+}
+
+void MT::Audio::WasapiBackend::Stop()
+{
+	if (m_AudioClient)
+		m_AudioClient->Stop();
+}
+
+void MT::Audio::WasapiBackend::OnRenderThreadBegin()
+{
+	// The COM objects live in the process-wide MTA, join it from this thread.
+	CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+	// Let MMCSS schedule the render thread as pro audio.
+	DWORD taskIndex = 0;
+	m_MmcssTask = AvSetMmThreadCharacteristicsW(L"Pro Audio", &taskIndex);
+}
+
+void MT::Audio::WasapiBackend::OnRenderThreadEnd()
+{
+	if (m_MmcssTask)
+	{
+		AvRevertMmThreadCharacteristics(m_MmcssTask);
+		m_MmcssTask = nullptr;
+	}
+	CoUninitialize();
+}
+
+uint32_t MT::Audio::WasapiBackend::GetAvailableFrames()
+{
+	uint32_t padding = 0;
+	if (FAILED(m_AudioClient->GetCurrentPadding(&padding)))
+		return 0;
+	return m_BufferFrames - padding;
+}
+
+uint32_t MT::Audio::WasapiBackend::WaitForPeriod(const uint32_t timeoutMs)
+{
+	if (WaitForSingleObject(m_PeriodEvent, timeoutMs) != WAIT_OBJECT_0)
+		return 0;
+	return GetAvailableFrames();
+}
+
+float* MT::Audio::WasapiBackend::RequestFrames(const uint32_t frames)
+{
+	BYTE* buffer = nullptr;
+	if (FAILED(m_RenderClient->GetBuffer(frames, &buffer)))
+		return nullptr;
+	return reinterpret_cast<float*>(buffer);
+}
+
+void MT::Audio::WasapiBackend::CommitFrames(const uint32_t frames)
+{
+	m_RenderClient->ReleaseBuffer(frames, 0);
+}
+#endif
@@ -0,0 +1,84 @@
+﻿#pragma once
+#ifdef _WIN32
+#include "AudioBackend.hpp"
+
+struct IMMDeviceEnumerator;
+struct IMMDevice;
+struct IAudioClient;
+struct IAudioRenderClient;
+struct tWAVEFORMATEX;
+
+namespace MT::Audio
+{
+/**
+ * @brief Shared-mode WASAPI output on the default render endpoint.
+ *
+ * The stream is always opened as interleaved 32-bit float; WASAPI converts
+ * to the device mix format when the requested rate or channel count differ.
+ * Refills are event driven: the render thread sleeps on the event WASAPI
+ * signals every device period. When a period is requested and the stream
+ * runs at the mix format, IAudioClient3 is used to get engine periods
+ * shorter than the 10 ms shared-mode default.
+ */
+class WasapiBackend : public AudioBackend
+{
+public:
+	WasapiBackend() = default;
+	~WasapiBackend() override { Close(); }
+
+	WasapiBackend(const WasapiBackend&) = delete;
+	WasapiBackend& operator=(const WasapiBackend&) = delete;
+
+	bool Open(const AudioBackendConfig& config) override;
+	void Close() override;
+
+	bool Start() override;
+	void Stop() override;
+
+	void OnRenderThreadBegin() override;
+	void OnRenderThreadEnd() override;
+
+	uint32_t GetAvailableFrames() override;
+	uint32_t WaitForPeriod(uint32_t timeoutMs) override;
+	float* RequestFrames(uint32_t frames) override;
+	void CommitFrames(uint32_t frames) override;
+
+	[[nodiscard]] AudioFormat GetFormat() const override { return m_Format; }
+	[[nodiscard]] uint32_t GetPeriodFrames() const override
+	{
+		return m_PeriodFrames;
+	}
+	[[nodiscard]] uint32_t GetBufferFrames() const override
+	{
+		return m_BufferFrames;
+	}
+	[[nodiscard]] uint32_t GetLatencyFrames() const override
+	{
+		return m_LatencyFrames;
+	}
+	[[nodiscard]] const char* GetName() const override { return "WASAPI"; }
+
+private:
+	/**
+	 * @brief Tries a low-latency shared stream with the requested period.
+	 * @return false if the device or format does not allow it.
+	 */
+	bool InitializeLowLatency(const tWAVEFORMATEX* format,
+							  uint32_t periodFrames);
+
+private:
+	bool m_ComInitialized = false;
+	IMMDeviceEnumerator* m_DeviceEnumerator = nullptr;
+	IMMDevice* m_Device = nullptr;
+	IAudioClient* m_AudioClient = nullptr;
+	IAudioRenderClient* m_RenderClient = nullptr;
+	void* m_PeriodEvent = nullptr;
+	void* m_MmcssTask = nullptr;
+
+	AudioFormat m_Format;
+	uint32_t m_PeriodFrames = 0;
+	uint32_t m_BufferFrames = 0;
+	uint32_t m_LatencyFrames = 0;
+};
+}
+#endif
@@ -0,0 +1,22 @@
+﻿#include "WavFileBackend.hpp"
+
+
+bool MT::Audio::WavFileBackend::Open(const AudioBackendConfig& config)
+{
+	if (!NullBackend::Open(config))
+		return false;
+	return m_Writer.Open(config.FilePath, m_Format.SampleRate,
+						 m_Format.Channels, config.FileFormat);
+}
+
+void MT::Audio::WavFileBackend::Close()
+{
+	m_Writer.Close();
+	NullBackend::Close();
+}
+
+void MT::Audio::WavFileBackend::OnFramesCommitted(const float* samples,
+												  const uint32_t frames)
+{
+	m_Writer.Write(samples, frames);
+}
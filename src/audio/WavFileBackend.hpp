@@ -0,0 +1,27 @@
+﻿#pragma once
+#include "NullBackend.hpp"
+#include "WavWriter.hpp"
+
+namespace MT::Audio
+{
+/**
+ * @brief Headless backend that records everything it is given to a WAV file.
+ *
+ * Paced like @ref NullBackend, either at the sample rate or as fast as the
+ * engine can render.
+ */
+class WavFileBackend : public NullBackend
+{
+public:
+	bool Open(const AudioBackendConfig& config) override;
+	void Close() override;
+
+	[[nodiscard]] const char* GetName() const override { return "WAV file"; }
+
+protected:
+	void OnFramesCommitted(const float* samples, uint32_t frames) override;
+
+private:
+	WavWriter m_Writer;
+};
+}
@@ -0,0 +1,125 @@
+﻿#include "WavWriter.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include "SampleConversion.hpp"
+
+
+namespace
+{
+template<typename T>
+void WriteLE(std::ofstream& file, T value)
+{
+	// WAV is little-endian, as is every platform we target.
+	file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+}
+
+
+bool MT::Audio::WavWriter::Open(const std::string& path,
+								const uint32_t sampleRate,
+								const uint32_t channels,
+								const WavSampleFormat format)
+{
+	Close();
+
+	m_File.open(path, std::ios::binary | std::ios::trunc);
+	if (!m_File.is_open())
+		return false;
+
+	m_SampleRate = sampleRate;
+	m_Channels = channels;
+	m_Format = format;
+	m_FramesWritten = 0;
+	WriteHeader(0);
+	return m_File.good();
+}
+
+bool MT::Audio::WavWriter::Close()
+{
+	if (!m_File.is_open())
+		return true;
+
+	// RIFF sizes are 32-bit, longer recordings keep a clamped header.
+	const uint64_t dataBytes = m_FramesWritten * m_Channels *
+		GetBytesPerSample();
+	m_File.seekp(0);
+	WriteHeader(static_cast<uint32_t>(std::min<uint64_t>(
+		dataBytes, std::numeric_limits<uint32_t>::max() - 36)));
+	m_File.flush();
+	const bool ok = m_File.good();
+	m_File.close();
+	return ok && !m_File.fail();
+}
+
+bool MT::Audio::WavWriter::Write(const float* samples, const uint32_t frames)
+{
+	const size_t count = static_cast<size_t>(frames) * m_Channels;
+	if (m_Format == WavSampleFormat::Float32)
+	{
+		m_File.write(reinterpret_cast<const char*>(samples),
+					 static_cast<std::streamsize>(count * sizeof(float)));
+	}
+	else
+	{
+		const size_t chunk = m_Encoded.size() / GetBytesPerSample();
+		for (size_t done = 0; done < count; done += chunk)
+			WriteEncoded(samples + done, std::min(chunk, count - done));
+	}
+	m_FramesWritten += frames;
+	return m_File.good();
+}
+
+void MT::Audio::WavWriter::WriteEncoded(const float* samples,
+										const size_t count)
+{
+	char* out = m_Encoded.data();
+	if (m_Format == WavSampleFormat::Int16)
+		EncodePcm16(samples, count, out, m_Dither);
+	else
+		EncodePcm24(samples, count, out);
+	m_File.write(out, static_cast<std::streamsize>(count *
+		GetBytesPerSample()));
+}
+
+uint32_t MT::Audio::WavWriter::GetBytesPerSample() const
+{
+	switch (m_Format)
+	{
+		case WavSampleFormat::Int16:
+			return 2;
+		case WavSampleFormat::Int24:
+			return 3;
+		case WavSampleFormat::Float32:
+			break;
+	}
+	return 4;
+}
+
+void MT::Audio::WavWriter::WriteHeader(const uint32_t dataBytes)
+{
+	constexpr uint16_t formatPcm = 1;
+	constexpr uint16_t formatIeeeFloat = 3;
+	const auto bitsPerSample = static_cast<uint16_t>(GetBytesPerSample() * 8);
+	const auto blockAlign = static_cast<uint16_t>(m_Channels *
+		bitsPerSample / 8);
+
+	m_File.write("RIFF", 4);
+	WriteLE<uint32_t>(m_File, 36 + dataBytes);
+	m_File.write("WAVE", 4);
+
+	m_File.write("fmt ", 4);
+	WriteLE<uint32_t>(m_File, 16);
+	WriteLE<uint16_t>(m_File, m_Format == WavSampleFormat::Float32
+		? formatIeeeFloat
+		: formatPcm);
+	WriteLE<uint16_t>(m_File, static_cast<uint16_t>(m_Channels));
+	WriteLE<uint32_t>(m_File, m_SampleRate);
+	WriteLE<uint32_t>(m_File, m_SampleRate * blockAlign);
+	WriteLE<uint16_t>(m_File, blockAlign);
+	WriteLE<uint16_t>(m_File, bitsPerSample);
+
+	m_File.write("data", 4);
+	WriteLE<uint32_t>(m_File, dataBytes);
+}
@@ -0,0 +1,77 @@
+﻿#pragma once
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include "../dsp/Random.hpp"
+
+namespace MT::Audio
+{
+/** @brief Sample encodings a @ref WavWriter can store. */
+enum class WavSampleFormat
+{
+	/** @brief 16-bit PCM, TPDF dithered. */
+	Int16,
+	/** @brief 24-bit packed PCM. */
+	Int24,
+	/** @brief 32-bit IEEE float, written unchanged. */
+	Float32
+};
+
+/**
+ * @brief Streams interleaved float audio into a RIFF/WAVE file.
+ *
+ * The header is written with placeholder sizes on Open() and patched on
+ * Close(), so the file can be written incrementally block by block. Integer
+ * formats are converted through a fixed buffer, so Write() never allocates.
+ */
+class WavWriter
+{
+public:
+	WavWriter() = default;
+	~WavWriter() { Close(); }
+
+	WavWriter(const WavWriter&) = delete;
+	WavWriter& operator=(const WavWriter&) = delete;
+
+	/**
+	 * @brief Creates (or truncates) @p path and writes the WAV header.
+	 * @return false if the file could not be opened.
+	 */
+	bool Open(const std::string& path, uint32_t sampleRate,
+			  uint32_t channels,
+			  WavSampleFormat format = WavSampleFormat::Float32);
+	/**
+	 * @brief Patches the header sizes, flushes and closes the file.
+	 * @return false if any write to the file failed.
+	 */
+	bool Close();
+
+	/**
+	 * @brief Appends @p frames interleaved frames.
+	 * @return false if the stream has failed.
+	 */
+	bool Write(const float* samples, uint32_t frames);
+
+	[[nodiscard]] bool IsOpen() const { return m_File.is_open(); }
+	[[nodiscard]] uint64_t GetFramesWritten() const { return m_FramesWritten; }
+
+private:
+	void WriteHeader(uint32_t dataBytes);
+	/** @brief Converts and writes @p count samples, at most one buffer. */
+	void WriteEncoded(const float* samples, size_t count);
+
+	[[nodiscard]] uint32_t GetBytesPerSample() const;
+
+private:
+	std::ofstream m_File;
+	uint32_t m_SampleRate = 0;
+	uint32_t m_Channels = 0;
+	WavSampleFormat m_Format = WavSampleFormat::Float32;
+	uint64_t m_FramesWritten = 0;
+
+	std::array<char, 12288> m_Encoded{};
+	DSP::Xorshift32 m_Dither;
+};
+}
@@ -1,32 +1,497 @@
 ﻿#include "Application.hpp"
 
+#include <algorithm>
+#include <iterator>
 
+#include "../audio/AudioEngine.hpp"
+#include "../audio/RealtimeGuard.hpp"
+#include "../dsp/MemoryArena.hpp"
+#include "../dsp/NodeProfiler.hpp"
 #include "IMGUI/imgui.h"
 
 
-MT::Application::Application(GLFWwindow* win) :
-	m_Window(win)
+MT::Application::Application(GLFWwindow* win, Audio::AudioEngine& engine,
+							  DSP::Graph& graph,
+							  const DSP::DefaultPatch& patch) :
+	m_Window(win),
+	m_Engine(engine),
+	m_Graph(graph),
+	m_Patch(patch)
 {
 	glfwSetWindowUserPointer(m_Window, this);
 	glfwSetKeyCallback(m_Window, KeyCallback);
 }
 
 void MT::Application::Update()
-{}
+{
+	// Graphs replaced on the audio thread are freed here, off the audio path.
+	m_Engine.CollectRetiredGraphs();
+	if (DSP::NodeProfiler* profiler = m_Engine.GetProfiler())
+		profiler->Collect();
+}
 
 void MT::Application::Render()
 {
-	ImGui::Begin("Hello ImGui");
-	ImGui::Text("Hello World!");
-	ImGui::End();
+	DrawAudioStats();
+	DrawPatchControls();
+	DrawProfiler();
 }
 
 
 void MT::Application::OnKey(const int key, int scancode,
 							const int action,
-							int mods) const
+							int mods)
 {
 	// Close application when the Escape key is pressed.
 	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
 		glfwSetWindowShouldClose(m_Window, true);
+
+	// Bottom letter row plays one octave from C3, tracker style.
+	constexpr int pianoKeys[] = {
+		GLFW_KEY_Z, GLFW_KEY_S, GLFW_KEY_X, GLFW_KEY_D, GLFW_KEY_C,
+		GLFW_KEY_V, GLFW_KEY_G, GLFW_KEY_B, GLFW_KEY_H, GLFW_KEY_N,
+		GLFW_KEY_J, GLFW_KEY_M
+	};
+	constexpr uint32_t baseNote = 48;
+	for (uint32_t i = 0; i < std::size(pianoKeys); i++)
+	{
+		if (key != pianoKeys[i] || action == GLFW_REPEAT)
+			continue;
+		m_Engine.Send(action == GLFW_PRESS
+			? Audio::Command::NoteOn(baseNote + i, 1.0f)
+			: Audio::Command::NoteOff(baseNote + i));
+	}
+
+	if (action != GLFW_RELEASE)
+	{
+		if (key == GLFW_KEY_UP)
+			SetMasterGain(m_MasterGain + 0.05f);
+		else if (key == GLFW_KEY_DOWN)
+			SetMasterGain(m_MasterGain - 0.05f);
+	}
+}
+
+void MT::Application::SetNodeParameter(const DSP::NodeId node,
+									   const uint32_t parameter,
+									   const float value)
+{
+	m_Engine.Send(Audio::Command::SetParameter(node, parameter, value));
+}
+
+void MT::Application::SetMasterGain(const float gain)
+{
+	m_MasterGain = std::clamp(gain, 0.0f, 1.0f);
+	m_Engine.Send(Audio::Command::SetParameter(
+		Audio::EngineParameter::MasterGain, m_MasterGain));
+}
+
+void MT::Application::DrawAudioStats()
+{
+	const Audio::RenderStats stats = m_Engine.GetStats();
+	constexpr double nsToMs = 1.0 / 1'000'000.0;
+
+	const Audio::AudioBackend& backend = m_Engine.GetBackend();
+	const Audio::AudioFormat format = backend.GetFormat();
+
+	ImGui::Begin("Audio Engine");
+	ImGui::Text("Backend: %s (%u Hz, %u ch)", backend.GetName(),
+				format.SampleRate, format.Channels);
+	ImGui::Text("Period: %u frames  Buffer: %u frames  Latency: %u frames",
+				backend.GetPeriodFrames(), backend.GetBufferFrames(),
+				backend.GetLatencyFrames());
+	ImGui::Text("Render thread: %s",
+				m_Engine.IsRunning() ? "running" : "stopped");
+	ImGui::Text("Blocks: %llu  Frames: %llu  Underruns: %llu  "
+				"Empty wakeups: %llu",
+				static_cast<unsigned long long>(stats.BlocksRendered),
+				static_cast<unsigned long long>(stats.FramesRendered),
+				static_cast<unsigned long long>(stats.Underruns),
+				static_cast<unsigned long long>(stats.EmptyWakeups));
+	ImGui::Separator();
+	ImGui::Text("Refill interval: %.3f ms (max %.3f ms)",
+				stats.LastRefillIntervalNs * nsToMs,
+				stats.MaxRefillIntervalNs * nsToMs);
+	ImGui::Text("Block render time: %.3f ms (max %.3f ms)",
+				stats.LastRenderTimeNs * nsToMs,
+				stats.MaxRenderTimeNs * nsToMs);
+	ImGui::Text("Wakeup to write: %.3f ms (max %.3f ms)",
+				stats.LastWakeToWriteNs * nsToMs,
+				stats.MaxWakeToWriteNs * nsToMs);
+	ImGui::Text("UI frame time: %.3f ms (max %.3f ms)",
+				stats.LastUiFrameNs * nsToMs, stats.MaxUiFrameNs * nsToMs);
+	ImGui::Text("Refill independent of UI: %s",
+				stats.IsDecoupledFromUi() ? "yes" : "no");
+	const DSP::MemoryArena& arena = m_Engine.GetArena();
+	ImGui::Text("Node memory: %.1f KiB used of %.1f KiB reserved",
+				arena.GetUsedBytes() / 1024.0,
+				arena.GetReservedBytes() / 1024.0);
+#if PAE_ENABLE_RT_GUARD
+	const Audio::RealtimeViolations violations =
+		Audio::GetRealtimeViolations();
+	ImGui::Text("Render thread alloc: %llu  free: %llu  locks: %llu",
+				static_cast<unsigned long long>(violations.Allocations),
+				static_cast<unsigned long long>(violations.Deallocations),
+				static_cast<unsigned long long>(violations.Locks));
+#endif
+	if (ImGui::Button("Reset peaks"))
+		m_Engine.ResetPeakStats();
+	ImGui::Separator();
+	float gain = m_MasterGain;
+	if (ImGui::SliderFloat("Master gain", &gain, 0.0f, 1.0f))
+		SetMasterGain(gain);
+	ImGui::End();
+}
+
+void MT::Application::DrawProfiler()
+{
+	ImGui::Begin("Profiler");
+	DSP::NodeProfiler* profiler = m_Engine.GetProfiler();
+	if (!profiler)
+	{
+		ImGui::TextUnformatted("Built without PAE_ENABLE_PROFILING.");
+		ImGui::End();
+		return;
+	}
+
+	// Share of the time between two device wakeups, the real budget.
+	const Audio::AudioBackend& backend = m_Engine.GetBackend();
+	const double periodNs = 1e9 * backend.GetPeriodFrames() /
+		backend.GetFormat().SampleRate;
+	constexpr double nsToUs = 1.0 / 1'000.0;
+
+	ImGui::Text("Last %u blocks per node, %llu samples dropped",
+				DSP::NodeProfiler::WindowBlocks,
+				static_cast<unsigned long long>(
+					profiler->GetDroppedSamples()));
+	if (ImGui::Button("Reset"))
+		profiler->Reset();
+
+	if (ImGui::BeginTable("Nodes", 7, ImGuiTableFlags_Borders |
+						  ImGuiTableFlags_RowBg))
+	{
+		for (const char* header : {"Node", "Blocks", "Min us", "Mean us",
+								   "P99 us", "Max us", "Period %"})
+			ImGui::TableSetupColumn(header);
+		ImGui::TableHeadersRow();
+
+		for (const DSP::NodeTiming& timing : profiler->GetTimings())
+		{
+			const DSP::Node* node = m_Graph.GetNode(timing.Id);
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::Text("%u %s", timing.Id, node ? node->GetName() : "-");
+			ImGui::TableNextColumn();
+			ImGui::Text("%u", timing.Blocks);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", timing.MinNs * nsToUs);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", timing.MeanNs * nsToUs);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", timing.P99Ns * nsToUs);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", timing.MaxNs * nsToUs);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", periodNs > 0.0
+				? 100.0 * timing.MeanNs / periodNs
+				: 0.0);
+		}
+		ImGui::EndTable();
+	}
+	ImGui::End();
+}
+
+void MT::Application::DrawPatchControls()
+{
+	ImGui::Begin("Patch");
+	ImGui::Text("Nodes: %u", m_Graph.GetIdLimit());
+	if (ImGui::SliderFloat("Noise gain", &m_NoiseGain, 0.0f, 1.0f))
+		SetNodeParameter(m_Patch.Noise, DSP::NoiseNode::Gain, m_NoiseGain);
+	if (ImGui::Combo("Noise color", &m_NoiseColor, "White\0Pink\0Brown\0Velvet\0"))
+		SetNodeParameter(m_Patch.Noise, DSP::NoiseNode::Color,
+						 static_cast<float>(m_NoiseColor));
+	if (ImGui::SliderFloat("Noise cutoff", &m_FilterCutoff, 20.0f, 20000.0f,
+						   "%.0f Hz", ImGuiSliderFlags_Logarithmic))
+		SetNodeParameter(m_Patch.Filter, DSP::OnePoleFilterNode::Cutoff,
+						 m_FilterCutoff);
+	if (ImGui::SliderFloat("Synth gain", &m_SynthGain, 0.0f, 1.0f))
+		SetNodeParameter(m_Patch.Synth, DSP::PolyphonicNode::Gain, m_SynthGain);
+	DSP::Node* synth = m_Graph.GetNode(m_Patch.Synth);
+	if (dynamic_cast<DSP::PolyphonicNode*>(synth) &&
+		ImGui::Combo("Voice stealing", &m_StealPolicy,
+					 "Oldest\0Quietest\0Lowest priority\0"))
+		SetNodeParameter(m_Patch.Synth, DSP::PolyphonicNode::StealPolicy,
+						 static_cast<float>(m_StealPolicy));
+	if (dynamic_cast<DSP::WavetableSynthNode*>(synth) &&
+		ImGui::SliderFloat("Wavetable morph", &m_Morph, 0.0f, 1.0f))
+		SetNodeParameter(m_Patch.Synth, DSP::WavetableSynthNode::Morph, m_Morph);
+	if (dynamic_cast<DSP::VirtualAnalogNode*>(synth))
+	{
+		using Analog = DSP::VirtualAnalogNode;
+		if (ImGui::Combo("Waveform", &m_Waveform,
+						 "Saw\0Square\0Triangle\0Pulse\0"))
+			SetNodeParameter(m_Patch.Synth, Analog::Waveform,
+							 static_cast<float>(m_Waveform));
+		if (ImGui::SliderFloat("Pulse width", &m_PulseWidth, 0.05f, 0.95f))
+			SetNodeParameter(m_Patch.Synth, Analog::PulseWidth, m_PulseWidth);
+		if (ImGui::SliderFloat("PWM depth", &m_PwmDepth, 0.0f, 0.45f))
+			SetNodeParameter(m_Patch.Synth, Analog::PwmDepth, m_PwmDepth);
+		if (ImGui::Checkbox("Hard sync", &m_Sync))
+			SetNodeParameter(m_Patch.Synth, Analog::Sync, m_Sync ? 1.0f : 0.0f);
+		if (ImGui::SliderFloat("Sync ratio", &m_SyncRatio, 1.0f, 8.0f))
+			SetNodeParameter(m_Patch.Synth, Analog::SyncRatio, m_SyncRatio);
+		if (ImGui::Combo("Filter", &m_AnalogFilter,
+						 "Off\0Low-pass\0Band-pass\0High-pass\0Notch\0"))
+			SetNodeParameter(m_Patch.Synth, Analog::FilterType,
+							 static_cast<float>(m_AnalogFilter));
+		if (ImGui::SliderFloat("Filter cutoff", &m_AnalogCutoff, 20.0f,
+							   20000.0f, "%.0f Hz",
+							   ImGuiSliderFlags_Logarithmic))
+			SetNodeParameter(m_Patch.Synth, Analog::FilterCutoff,
+							 m_AnalogCutoff);
+		if (ImGui::SliderFloat("Filter Q", &m_AnalogResonance, 0.5f, 20.0f,
+							   "%.2f", ImGuiSliderFlags_Logarithmic))
+			SetNodeParameter(m_Patch.Synth, Analog::FilterResonance,
+							 m_AnalogResonance);
+		if (ImGui::SliderFloat("Filter envelope", &m_AnalogEnvelope, -4.0f,
+							   8.0f, "%.1f oct"))
+			SetNodeParameter(m_Patch.Synth, Analog::FilterEnvelope,
+							 m_AnalogEnvelope);
+	}
+	if (const auto* additive = dynamic_cast<DSP::AdditiveSynthNode*>(synth))
+	{
+		using Additive = DSP::AdditiveSynthNode;
+		if (ImGui::SliderFloat("Brightness", &m_Brightness, -24.0f, 0.0f,
+							   "%.1f dB/oct"))
+			SetNodeParameter(m_Patch.Synth, Additive::Brightness, m_Brightness);
+		if (ImGui::SliderInt("Copies per harmonic", &m_Density, 1, 64))
+			SetNodeParameter(m_Patch.Synth, Additive::Density,
+							 static_cast<float>(m_Density));
+		if (ImGui::SliderFloat("Detune", &m_Detune, 0.0f, 100.0f, "%.0f cents"))
+			SetNodeParameter(m_Patch.Synth, Additive::Detune, m_Detune);
+		if (ImGui::SliderFloat("Stretch", &m_Stretch, 0.0f, 0.01f, "%.5f",
+							   ImGuiSliderFlags_Logarithmic))
+			SetNodeParameter(m_Patch.Synth, Additive::Stretch, m_Stretch);
+		if (ImGui::SliderFloat("Shimmer", &m_Shimmer, 0.0f, 1.0f))
+			SetNodeParameter(m_Patch.Synth, Additive::Shimmer, m_Shimmer);
+		if (ImGui::SliderFloat("Drift", &m_Drift, 0.0f, 50.0f, "%.0f cents"))
+			SetNodeParameter(m_Patch.Synth, Additive::Drift, m_Drift);
+		if (ImGui::SliderFloat("Cull below", &m_CullThreshold, -140.0f, -40.0f,
+							   "%.0f dBFS"))
+			SetNodeParameter(m_Patch.Synth, Additive::Threshold,
+							 m_CullThreshold);
+		if (ImGui::Checkbox("Split across workers", &m_PartitionPartials))
+			SetNodeParameter(m_Patch.Synth, Additive::Partitioned,
+							 m_PartitionPartials ? 1.0f : 0.0f);
+		ImGui::Text("Partials: %u / %u", additive->GetActivePartialCount(),
+					additive->GetPartialCapacity());
+	}
+	if (const auto* fm = dynamic_cast<DSP::FmSynthNode*>(synth))
+	{
+		using Fm = DSP::FmSynthNode;
+		const auto& algorithms = fm->GetAlgorithms();
+		m_FmAlgorithm = std::min(m_FmAlgorithm,
+								 static_cast<int>(algorithms.size()) - 1);
+		if (ImGui::BeginCombo("Algorithm",
+							  algorithms[m_FmAlgorithm]->GetName().c_str()))
+		{
+			for (int i = 0; i < static_cast<int>(algorithms.size()); i++)
+			{
+				if (!ImGui::Selectable(algorithms[i]->GetName().c_str(),
+									   i == m_FmAlgorithm))
+					continue;
+				m_FmAlgorithm = i;
+				SetNodeParameter(m_Patch.Synth, Fm::Algorithm,
+								 static_cast<float>(i));
+			}
+			ImGui::EndCombo();
+		}
+		if (ImGui::SliderFloat("Modulation index", &m_ModulationIndex, 0.0f,
+							   4.0f))
+			SetNodeParameter(m_Patch.Synth, Fm::ModulationIndex,
+							 m_ModulationIndex);
+		if (ImGui::SliderFloat("Feedback", &m_FmFeedback, 0.0f, 2.0f))
+			SetNodeParameter(m_Patch.Synth, Fm::Feedback, m_FmFeedback);
+		if (ImGui::SliderFloat("Velocity sensitivity", &m_VelocitySensitivity,
+							   0.0f, 1.0f))
+			SetNodeParameter(m_Patch.Synth, Fm::VelocitySensitivity,
+							 m_VelocitySensitivity);
+	}
+	if (const auto* granular = dynamic_cast<DSP::GranularNode*>(synth))
+	{
+		using Granular = DSP::GranularNode;
+		if (ImGui::Combo("Grain source", &m_GrainSource,
+						 "Wavetable\0Sample\0Live input\0"))
+			SetNodeParameter(m_Patch.Synth, Granular::Source,
+							 static_cast<float>(m_GrainSource));
+		if (ImGui::Combo("Grain window", &m_GrainWindow,
+						 "Hann\0Gaussian\0Tukey\0Decay\0"))
+			SetNodeParameter(m_Patch.Synth, Granular::Window,
+							 static_cast<float>(m_GrainWindow));
+		if (ImGui::SliderFloat("Grains per second", &m_GrainDensity, 1.0f,
+							   100000.0f, "%.0f",
+							   ImGuiSliderFlags_Logarithmic))
+			SetNodeParameter(m_Patch.Synth, Granular::Density,
+							 m_GrainDensity);
+		if (ImGui::SliderFloat("Grain length", &m_GrainDuration, 0.001f, 1.0f,
+							   "%.3f s", ImGuiSliderFlags_Logarithmic))
+			SetNodeParameter(m_Patch.Synth, Granular::Duration,
+							 m_GrainDuration);
+		if (ImGui::SliderFloat("Position", &m_GrainPosition, 0.0f, 1.0f))
+			SetNodeParameter(m_Patch.Synth, Granular::Position,
+							 m_GrainPosition);
+		if (ImGui::SliderFloat("Position spread", &m_GrainSpread, 0.0f, 1.0f))
+			SetNodeParameter(m_Patch.Synth, Granular::PositionSpread,
+							 m_GrainSpread);
+		if (ImGui::SliderFloat("Grain pitch", &m_GrainPitch, -24.0f, 24.0f,
+							   "%.1f st"))
+			SetNodeParameter(m_Patch.Synth, Granular::Pitch, m_GrainPitch);
+		if (ImGui::SliderFloat("Pitch spread", &m_GrainPitchSpread, 0.0f,
+							   24.0f, "%.1f st"))
+			SetNodeParameter(m_Patch.Synth, Granular::PitchSpread,
+							 m_GrainPitchSpread);
+		if (ImGui::SliderFloat("Stereo spread", &m_GrainStereo, 0.0f, 1.0f))
+			SetNodeParameter(m_Patch.Synth, Granular::Stereo, m_GrainStereo);
+		if (ImGui::Checkbox("Play from keyboard", &m_GrainFollowNotes))
+			SetNodeParameter(m_Patch.Synth, Granular::FollowNotes,
+							 m_GrainFollowNotes ? 1.0f : 0.0f);
+		ImGui::Text("Grains: %u / %u, %llu dropped",
+					granular->GetActiveGrainCount(),
+					granular->GetGrainCapacity(),
+					static_cast<unsigned long long>(
+						granular->GetDroppedGrainCount()));
+	}
+	if (dynamic_cast<DSP::WaveguideNode*>(synth))
+	{
+		using Waveguide = DSP::WaveguideNode;
+		if (ImGui::Combo("Instrument", &m_Instrument, "String\0Tube\0"))
+			SetNodeParameter(m_Patch.Synth, Waveguide::Instrument,
+							 static_cast<float>(m_Instrument));
+		if (ImGui::Combo("Fractional delay", &m_FractionalDelay,
+						 "Lagrange\0Allpass\0"))
+			SetNodeParameter(m_Patch.Synth, Waveguide::Interpolation,
+							 static_cast<float>(m_FractionalDelay));
+		if (ImGui::SliderFloat("Ring time", &m_RingTime, 0.1f, 30.0f, "%.1f s",
+							   ImGuiSliderFlags_Logarithmic))
+			SetNodeParameter(m_Patch.Synth, Waveguide::RingTime, m_RingTime);
+		if (ImGui::SliderFloat("String brightness", &m_StringBrightness,
+							   0.0f, 1.0f))
+			SetNodeParameter(m_Patch.Synth, Waveguide::Brightness,
+							 m_StringBrightness);
+		if (ImGui::SliderFloat("Stiffness", &m_Stiffness, 0.0f, 1.0f))
+			SetNodeParameter(m_Patch.Synth, Waveguide::Stiffness, m_Stiffness);
+		if (ImGui::SliderFloat("Pluck position", &m_PluckPosition, 0.0f, 0.5f))
+			SetNodeParameter(m_Patch.Synth, Waveguide::PluckPosition,
+							 m_PluckPosition);
+		if (ImGui::SliderFloat("Breath pressure", &m_Pressure, 0.0f, 1.5f))
+			SetNodeParameter(m_Patch.Synth, Waveguide::Pressure, m_Pressure);
+		if (ImGui::SliderFloat("Breath noise", &m_BreathNoise, 0.0f, 1.0f))
+			SetNodeParameter(m_Patch.Synth, Waveguide::BreathNoise,
+							 m_BreathNoise);
+		if (ImGui::SliderFloat("Noise excitation", &m_ExcitationGain, 0.0f,
+							   0.2f))
+			SetNodeParameter(m_Patch.Synth, Waveguide::InputGain,
+							 m_ExcitationGain);
+	}
+	if (const auto* modal = dynamic_cast<DSP::ModalNode*>(synth))
+	{
+		using Modal = DSP::ModalNode;
+		const auto& models = modal->GetModels();
+		m_ModalModel = std::min(m_ModalModel,
+								static_cast<int>(models.size()) - 1);
+		if (ImGui::BeginCombo("Object",
+							  models[m_ModalModel]->GetName().c_str()))
+		{
+			for (int i = 0; i < static_cast<int>(models.size()); i++)
+			{
+				if (!ImGui::Selectable(models[i]->GetName().c_str(),
+									   i == m_ModalModel))
+					continue;
+				m_ModalModel = i;
+				SetNodeParameter(m_Patch.Synth, Modal::Model,
+								 static_cast<float>(i));
+			}
+			ImGui::EndCombo();
+		}
+		if (ImGui::SliderFloat("Strike position", &m_StrikePosition, 0.0f,
+							   1.0f))
+			SetNodeParameter(m_Patch.Synth, Modal::Position, m_StrikePosition);
+		if (ImGui::SliderFloat("Mallet hardness", &m_Hardness, 0.0f, 1.0f))
+			SetNodeParameter(m_Patch.Synth, Modal::Hardness, m_Hardness);
+		if (ImGui::SliderFloat("Damping", &m_ModalDamping, 0.1f, 10.0f, "%.2f",
+							   ImGuiSliderFlags_Logarithmic))
+			SetNodeParameter(m_Patch.Synth, Modal::Damping, m_ModalDamping);
+		if (ImGui::SliderFloat("Noise contact", &m_ContactGain, 0.0f, 0.1f))
+			SetNodeParameter(m_Patch.Synth, Modal::InputGain, m_ContactGain);
+		ImGui::Text("Modes: %u", modal->GetActiveModeCount());
+	}
+	if (const auto* plate = dynamic_cast<DSP::FdtdPlateNode*>(synth))
+	{
+		using Plate = DSP::FdtdPlateNode;
+		if (ImGui::Checkbox("Play from keyboard", &m_PlateFollowNotes))
+			SetNodeParameter(m_Patch.Synth, Plate::FollowNotes,
+							 m_PlateFollowNotes ? 1.0f : 0.0f);
+		if (!m_PlateFollowNotes &&
+			ImGui::SliderFloat("Frequency", &m_PlateFrequency, 20.0f, 2000.0f,
+							   "%.1f Hz", ImGuiSliderFlags_Logarithmic))
+			SetNodeParameter(m_Patch.Synth, Plate::Frequency, m_PlateFrequency);
+		// Plates are tuned by bending from a small share on.
+		if (ImGui::SliderFloat("Stiffness", &m_PlateStiffness, 0.0f, 1.0f,
+							   "%.4f", ImGuiSliderFlags_Logarithmic))
+			SetNodeParameter(m_Patch.Synth, Plate::Stiffness, m_PlateStiffness);
+		if (ImGui::SliderFloat("Decay", &m_PlateDecay, 0.1f, 20.0f, "%.2f s",
+							   ImGuiSliderFlags_Logarithmic))
+			SetNodeParameter(m_Patch.Synth, Plate::Decay, m_PlateDecay);
+		if (ImGui::SliderFloat("Brightness", &m_PlateBrightness, 0.0f, 1.0f))
+			SetNodeParameter(m_Patch.Synth, Plate::Brightness,
+							 m_PlateBrightness);
+		if (ImGui::SliderFloat2("Strike point", m_PlateStrike, 0.0f, 1.0f))
+		{
+			SetNodeParameter(m_Patch.Synth, Plate::StrikeX, m_PlateStrike[0]);
+			SetNodeParameter(m_Patch.Synth, Plate::StrikeY, m_PlateStrike[1]);
+		}
+		if (ImGui::SliderFloat("Mallet hardness", &m_PlateHardness, 0.0f,
+							   1.0f))
+			SetNodeParameter(m_Patch.Synth, Plate::Hardness, m_PlateHardness);
+		if (ImGui::SliderFloat("Noise drive", &m_PlateDrive, 0.0f, 0.1f))
+			SetNodeParameter(m_Patch.Synth, Plate::InputGain, m_PlateDrive);
+		ImGui::Text("Grid: %ux%u in %u strips, lowest mode %.1f Hz",
+					plate->GetWidth(), plate->GetHeight(),
+					plate->GetStripCount(), plate->GetEffectiveFrequency());
+	}
+	if (const auto* impacts = dynamic_cast<DSP::ImpactNode*>(synth))
+	{
+		using Impact = DSP::ImpactNode;
+		if (ImGui::Combo("Material", &m_ImpactMaterial,
+						 "Rain\0Gravel\0Hail\0"))
+			SetNodeParameter(m_Patch.Synth, Impact::Material,
+							 static_cast<float>(m_ImpactMaterial));
+		if (ImGui::SliderFloat("Impacts/s", &m_ImpactRate, 10.0f, 100000.0f,
+							   "%.0f", ImGuiSliderFlags_Logarithmic))
+			SetNodeParameter(m_Patch.Synth, Impact::Rate, m_ImpactRate);
+		if (ImGui::SliderFloat("Gusts", &m_ImpactGusts, 0.0f, 1.0f))
+			SetNodeParameter(m_Patch.Synth, Impact::Gusts, m_ImpactGusts);
+		if (ImGui::SliderFloat("Particle size", &m_ImpactSize, 0.0f, 1.0f))
+			SetNodeParameter(m_Patch.Synth, Impact::Size, m_ImpactSize);
+		if (ImGui::SliderFloat("Size spread", &m_ImpactSpread, 0.0f, 1.0f))
+			SetNodeParameter(m_Patch.Synth, Impact::Spread, m_ImpactSpread);
+		if (ImGui::SliderFloat("Ring", &m_ImpactDecay, 0.1f, 10.0f, "%.2f",
+							   ImGuiSliderFlags_Logarithmic))
+			SetNodeParameter(m_Patch.Synth, Impact::Decay, m_ImpactDecay);
+		if (ImGui::SliderFloat("Click", &m_ImpactClick, 0.0f, 4.0f))
+			SetNodeParameter(m_Patch.Synth, Impact::Click, m_ImpactClick);
+		if (ImGui::SliderFloat("Width", &m_ImpactStereo, 0.0f, 1.0f))
+			SetNodeParameter(m_Patch.Synth, Impact::Stereo, m_ImpactStereo);
+		ImGui::Text("Resonators: %u / %u sounding, %llu impacts",
+					impacts->GetSoundingCount(),
+					impacts->GetResonatorCount(),
+					static_cast<unsigned long long>(
+						impacts->GetImpactCount()));
+	}
+	if (const auto* voices = dynamic_cast<const DSP::PolyphonicNode*>(synth))
+	{
+		ImGui::Text("Voices: %u / %u", voices->GetActiveVoiceCount(),
+					voices->GetVoiceCapacity());
+	}
+	ImGui::TextUnformatted("Play the synth with Z-M (S, D, G, H, J sharps).");
+	ImGui::End();
 }
@@ -1,18 +1,25 @@
 ﻿#pragma once
+#include "../dsp/Patches.hpp"
 #include "GLFW/glfw3.h"
 
 namespace MT
 {
+namespace Audio
+{
+class AudioEngine;
+}
+
 class Application
 {
 public:
-	Application(GLFWwindow* win);
+	Application(GLFWwindow* win, Audio::AudioEngine& engine,
+				DSP::Graph& graph, const DSP::DefaultPatch& patch);
 
 	void Update();
 	void Render();
 
 private:
-	void OnKey(int key, int scancode, int action, int mods) const;
+	void OnKey(int key, int scancode, int action, int mods);
 
 	/// <summary> GLFW static callback to key press detection. </summary>
 	static void KeyCallback(GLFWwindow* window, const int key,
@@ -24,7 +31,85 @@ private:
 			app->OnKey(key, scancode, action, mods);
 	}
 
+private:
+	void DrawAudioStats();
+	void DrawPatchControls();
+	void DrawProfiler();
+	void SetMasterGain(float gain);
+	void SetNodeParameter(DSP::NodeId node, uint32_t parameter, float value);
+
 private:
 	GLFWwindow* m_Window;
+	Audio::AudioEngine& m_Engine;
+	DSP::Graph& m_Graph;
+	DSP::DefaultPatch m_Patch;
+	float m_MasterGain = 1.0f;
+	float m_NoiseGain = 1.0f;
+	int m_NoiseColor = 0;
+	float m_FilterCutoff = 20000.0f;
+	float m_SynthGain = 0.25f;
+	int m_StealPolicy = 0;
+	float m_Morph = 0.0f;
+	int m_Waveform = 0;
+	float m_PulseWidth = 0.5f;
+	float m_PwmDepth = 0.0f;
+	bool m_Sync = false;
+	float m_SyncRatio = 2.0f;
+	int m_AnalogFilter = 0;
+	float m_AnalogCutoff = 2000.0f;
+	float m_AnalogResonance = 0.70710678f;
+	float m_AnalogEnvelope = 0.0f;
+	float m_Brightness = -6.0f;
+	int m_Density = 16;
+	float m_Detune = 15.0f;
+	float m_Stretch = 0.0f;
+	float m_Shimmer = 0.0f;
+	float m_Drift = 0.0f;
+	float m_CullThreshold = -96.0f;
+	bool m_PartitionPartials = false;
+	int m_FmAlgorithm = 0;
+	float m_ModulationIndex = 1.0f;
+	float m_FmFeedback = 1.0f;
+	float m_VelocitySensitivity = 0.5f;
+	int m_GrainSource = 1;
+	int m_GrainWindow = 0;
+	float m_GrainDensity = 200.0f;
+	float m_GrainDuration = 0.1f;
+	float m_GrainPosition = 0.5f;
+	float m_GrainSpread = 0.5f;
+	float m_GrainPitch = 0.0f;
+	float m_GrainPitchSpread = 0.0f;
+	float m_GrainStereo = 0.5f;
+	bool m_GrainFollowNotes = false;
+	int m_Instrument = 0;
+	int m_FractionalDelay = 0;
+	float m_RingTime = 4.0f;
+	float m_StringBrightness = 0.5f;
+	float m_Stiffness = 0.0f;
+	float m_PluckPosition = 0.13f;
+	float m_Pressure = 0.75f;
+	float m_BreathNoise = 0.1f;
+	float m_ExcitationGain = 0.0f;
+	int m_ModalModel = 0;
+	float m_StrikePosition = 0.0f;
+	float m_Hardness = 0.5f;
+	float m_ModalDamping = 1.0f;
+	float m_ContactGain = 0.0f;
+	bool m_PlateFollowNotes = true;
+	float m_PlateFrequency = 80.0f;
+	float m_PlateStiffness = 0.0f;
+	float m_PlateDecay = 2.0f;
+	float m_PlateBrightness = 0.5f;
+	float m_PlateStrike[2] = {0.4f, 0.45f};
+	float m_PlateHardness = 0.5f;
+	float m_PlateDrive = 0.0f;
+	int m_ImpactMaterial = 0;
+	float m_ImpactRate = 2000.0f;
+	float m_ImpactGusts = 0.0f;
+	float m_ImpactSize = 0.5f;
+	float m_ImpactSpread = 0.3f;
+	float m_ImpactDecay = 1.0f;
+	float m_ImpactClick = 1.0f;
+	float m_ImpactStereo = 0.7f;
 };
 }
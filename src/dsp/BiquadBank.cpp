@@ -0,0 +1,136 @@
+﻿#include "BiquadBank.hpp"
+
+#include <cmath>
+#include <numbers>
+
+
+MT::DSP::BiquadCoefficients MT::DSP::BiquadCoefficients::Design(
+	const BiquadType type, const float frequency, const float q,
+	const float gain, const float sampleRate)
+{
+	// Double precision keeps low cutoffs at high rates accurate.
+	const double omega = 2.0 * std::numbers::pi * std::clamp(
+		static_cast<double>(frequency), 1.0, 0.49 * sampleRate) / sampleRate;
+	const double cosine = std::cos(omega);
+	const double alpha = std::sin(omega) / (2.0 * std::max(q, 0.01f));
+	const double amplitude = std::pow(10.0, gain / 40.0);
+	const double root = 2.0 * std::sqrt(amplitude) * alpha;
+
+	double b0 = 1.0, b1 = 0.0, b2 = 0.0, a0 = 1.0, a1 = 0.0, a2 = 0.0;
+	switch (type)
+	{
+		case BiquadType::LowPass:
+			b0 = b2 = 0.5 * (1.0 - cosine);
+			b1 = 1.0 - cosine;
+			a0 = 1.0 + alpha;
+			a1 = -2.0 * cosine;
+			a2 = 1.0 - alpha;
+			break;
+		case BiquadType::HighPass:
+			b0 = b2 = 0.5 * (1.0 + cosine);
+			b1 = -(1.0 + cosine);
+			a0 = 1.0 + alpha;
+			a1 = -2.0 * cosine;
+			a2 = 1.0 - alpha;
+			break;
+		case BiquadType::BandPass:
+			b0 = alpha;
+			b2 = -alpha;
+			a0 = 1.0 + alpha;
+			a1 = -2.0 * cosine;
+			a2 = 1.0 - alpha;
+			break;
+		case BiquadType::Notch:
+			b0 = b2 = 1.0;
+			b1 = -2.0 * cosine;
+			a0 = 1.0 + alpha;
+			a1 = -2.0 * cosine;
+			a2 = 1.0 - alpha;
+			break;
+		case BiquadType::Peak:
+			b0 = 1.0 + alpha * amplitude;
+			b1 = -2.0 * cosine;
+			b2 = 1.0 - alpha * amplitude;
+			a0 = 1.0 + alpha / amplitude;
+			a1 = -2.0 * cosine;
+			a2 = 1.0 - alpha / amplitude;
+			break;
+		case BiquadType::LowShelf:
+			b0 = amplitude * ((amplitude + 1.0) - (amplitude - 1.0) * cosine +
+				root);
+			b1 = 2.0 * amplitude * ((amplitude - 1.0) - (amplitude + 1.0) *
+				cosine);
+			b2 = amplitude * ((amplitude + 1.0) - (amplitude - 1.0) * cosine -
+				root);
+			a0 = (amplitude + 1.0) + (amplitude - 1.0) * cosine + root;
+			a1 = -2.0 * ((amplitude - 1.0) + (amplitude + 1.0) * cosine);
+			a2 = (amplitude + 1.0) + (amplitude - 1.0) * cosine - root;
+			break;
+		case BiquadType::HighShelf:
+			b0 = amplitude * ((amplitude + 1.0) + (amplitude - 1.0) * cosine +
+				root);
+			b1 = -2.0 * amplitude * ((amplitude - 1.0) + (amplitude + 1.0) *
+				cosine);
+			b2 = amplitude * ((amplitude + 1.0) + (amplitude - 1.0) * cosine -
+				root);
+			a0 = (amplitude + 1.0) - (amplitude - 1.0) * cosine + root;
+			a1 = 2.0 * ((amplitude - 1.0) - (amplitude + 1.0) * cosine);
+			a2 = (amplitude + 1.0) - (amplitude - 1.0) * cosine - root;
+			break;
+		default:
+			break;
+	}
+	return {static_cast<float>(b0 / a0), static_cast<float>(b1 / a0),
+			static_cast<float>(b2 / a0), static_cast<float>(a1 / a0),
+			static_cast<float>(a2 / a0)};
+}
+
+void MT::DSP::BiquadBank::Prepare(MemoryArena* memory, const uint32_t filters)
+{
+	const uint32_t count = (filters + Simd::Width - 1) / Simd::Width *
+		Simd::Width;
+	for (ArenaArray<float>* array : {&m_B0, &m_B1, &m_B2, &m_A1, &m_A2,
+									 &m_TargetB0, &m_TargetB1, &m_TargetB2,
+									 &m_TargetA1, &m_TargetA2, &m_S1, &m_S2})
+		array->Allocate(memory, count);
+	m_B0.Fill(1.0f);
+	m_TargetB0.Fill(1.0f);
+	m_Ramping.Allocate(memory, count / Simd::Width);
+}
+
+void MT::DSP::BiquadBank::SetTarget(const uint32_t filter,
+									const BiquadCoefficients& coefficients)
+{
+	m_TargetB0[filter] = coefficients.B0;
+	m_TargetB1[filter] = coefficients.B1;
+	m_TargetB2[filter] = coefficients.B2;
+	m_TargetA1[filter] = -coefficients.A1;
+	m_TargetA2[filter] = -coefficients.A2;
+	m_Ramping[filter / Simd::Width] = 1;
+}
+
+void MT::DSP::BiquadBank::Snap()
+{
+	for (uint32_t packet = 0; packet < m_Ramping.Size(); packet++)
+	{
+		if (m_Ramping[packet])
+			FinishRamp(packet);
+	}
+}
+
+void MT::DSP::BiquadBank::Reset(const uint32_t first, const uint32_t count)
+{
+	std::fill_n(m_S1.Data() + first * Simd::Width, count * Simd::Width, 0.0f);
+	std::fill_n(m_S2.Data() + first * Simd::Width, count * Simd::Width, 0.0f);
+}
+
+void MT::DSP::BiquadBank::FinishRamp(const uint32_t packet)
+{
+	const size_t at = static_cast<size_t>(packet) * Simd::Width;
+	std::copy_n(m_TargetB0.Data() + at, Simd::Width, m_B0.Data() + at);
+	std::copy_n(m_TargetB1.Data() + at, Simd::Width, m_B1.Data() + at);
+	std::copy_n(m_TargetB2.Data() + at, Simd::Width, m_B2.Data() + at);
+	std::copy_n(m_TargetA1.Data() + at, Simd::Width, m_A1.Data() + at);
+	std::copy_n(m_TargetA2.Data() + at, Simd::Width, m_A2.Data() + at);
+	m_Ramping[packet] = 0;
+}
@@ -0,0 +1,376 @@
+﻿#pragma once
+#include <algorithm>
+#include <cstdint>
+
+#include "MemoryArena.hpp"
+#include "Simd.hpp"
+
+namespace MT::DSP
+{
+/** @brief Responses of BiquadCoefficients::Design(). */
+enum class BiquadType : uint32_t
+{
+	LowPass,
+	HighPass,
+	/** @brief 0 dB at the centre frequency. */
+	BandPass,
+	Notch,
+	/** @brief Bell boosting or cutting by the gain around the frequency. */
+	Peak,
+	LowShelf,
+	HighShelf,
+	Count
+};
+
+/** @brief One second-order section, normalized so a0 is 1. */
+struct BiquadCoefficients
+{
+	float B0 = 1.0f;
+	float B1 = 0.0f;
+	float B2 = 0.0f;
+	float A1 = 0.0f;
+	float A2 = 0.0f;
+
+	/**
+	 * @brief The Audio EQ Cookbook design of @p type at @p frequency Hz.
+	 * @param q Quality, for the shelves too (Q, not the cookbook slope S).
+	 * @param gain Decibels, used by Peak and the shelves only.
+	 */
+	static BiquadCoefficients Design(BiquadType type, float frequency,
+									 float q, float gain, float sampleRate);
+};
+
+/**
+ * @brief Many independent biquads, stored as structure of arrays and run
+ * a SIMD packet of filters at a time.
+ *
+ * Filters use the transposed direct form II,
+ *   y = b0 x + s1,  s1 = b1 x - a1 y + s2,  s2 = b2 x - a2 y,
+ * which keeps two states per filter and behaves well in float. Lanes are
+ * whatever the caller makes them: voices, channels, or the bands of a
+ * filter bank fed one signal.
+ *
+ * New coefficients given to SetTarget() are reached over the next block,
+ * linearly per sample, so sweeps do not zipper. Interpolating a1 and a2
+ * stays inside the stability triangle, which is convex, so a ramp between
+ * two stable filters is stable throughout. Only packets with a pending
+ * target pay for the ramp.
+ *
+ * Audio is laid out packet major: a packet's frames, Simd::Width lanes
+ * each, then the next packet's. Interleave packets are run together to
+ * hide the latency of the recurrence.
+ */
+class BiquadBank
+{
+public:
+	/** @brief Packets run together by default, fastest in the benchmark. */
+	static constexpr uint32_t DefaultInterleave = 4;
+	/** @brief Series packets pipelined together by default, likewise. */
+	static constexpr uint32_t DefaultDepth = 4;
+	/**
+	 * @brief States below this are flushed at the end of every block, so a
+	 * filter left ringing into silence does not go denormal.
+	 */
+	static constexpr float FlushLevel = 1e-20f;
+
+	/**
+	 * @brief Control thread. Sizes the bank for @p filters, rounded up to
+	 * whole packets, all passing their input through with cleared state.
+	 */
+	void Prepare(MemoryArena* memory, uint32_t filters);
+
+	[[nodiscard]] uint32_t GetFilterCount() const
+	{
+		return static_cast<uint32_t>(m_B0.Size());
+	}
+	[[nodiscard]] uint32_t GetPacketCount() const
+	{
+		return GetFilterCount() / Simd::Width;
+	}
+
+	/** @brief Moves @p filter to @p coefficients over the next block. */
+	void SetTarget(uint32_t filter, const BiquadCoefficients& coefficients);
+	/** @brief Jumps to every pending target at once, for a fresh start. */
+	void Snap();
+	/** @brief Clears the state of @p count packets from @p first on. */
+	void Reset(uint32_t first, uint32_t count);
+
+	/**
+	 * @brief Filters @p count packets from @p first in place. @p data holds
+	 * @p frames frames of each, packet major.
+	 */
+	template<uint32_t Interleave = DefaultInterleave>
+	void Process(const uint32_t first, const uint32_t count, float* data,
+				 const uint32_t frames)
+	{
+		Run<Interleave, false>(first, count, data, nullptr, frames);
+	}
+
+	/**
+	 * @brief Runs @p data, one packet of @p frames frames, through @p count
+	 * packets from @p first in series, in place.
+	 *
+	 * Depth packets are pipelined: while packet k filters frame i, packet
+	 * k + 1 filters frame i - 1, so the sections do not wait on each other.
+	 */
+	template<uint32_t Depth = DefaultDepth>
+	void ProcessSeries(uint32_t first, const uint32_t count, float* data,
+					   const uint32_t frames)
+	{
+		const uint32_t end = first + count;
+		for (; first + Depth <= end; first += Depth)
+			Series<Depth>(first, data, frames);
+		if constexpr (Depth > 1)
+		{
+			if (first < end)
+				ProcessSeries<Depth / 2>(first, end - first, data, frames);
+		}
+	}
+
+	/**
+	 * @brief Feeds @p input to every filter of @p count packets from
+	 * @p first and adds their outputs to @p sums, Simd::Width lanes per
+	 * frame for the caller to sum.
+	 */
+	template<uint32_t Interleave = DefaultInterleave>
+	void ProcessSum(const uint32_t first, const uint32_t count,
+					const float* input, float* sums, const uint32_t frames)
+	{
+		Run<Interleave, true>(first, count, sums, input, frames);
+	}
+
+private:
+	template<uint32_t Interleave, bool Sum>
+	void Run(const uint32_t first, const uint32_t count, float* data,
+			 const float* input, const uint32_t frames)
+	{
+		uint32_t packet = first;
+		const uint32_t end = first + count;
+		for (; packet + Interleave <= end; packet += Interleave)
+		{
+			float* at = Sum ? data : data + static_cast<size_t>(
+				packet - first) * frames * Simd::Width;
+			if (IsRamping(packet, Interleave))
+				Render<Interleave, true, Sum>(packet, at, input, frames);
+			else
+				Render<Interleave, false, Sum>(packet, at, input, frames);
+		}
+		for (; packet < end; packet++)
+		{
+			float* at = Sum ? data : data + static_cast<size_t>(
+				packet - first) * frames * Simd::Width;
+			if (IsRamping(packet, 1))
+				Render<1, true, Sum>(packet, at, input, frames);
+			else
+				Render<1, false, Sum>(packet, at, input, frames);
+		}
+	}
+
+	template<uint32_t Count>
+	void Series(const uint32_t packet, float* data, const uint32_t frames)
+	{
+		// Too short a block to fill the pipeline.
+		if (frames + 1 < Count)
+		{
+			for (uint32_t k = 0; k < Count; k++)
+				Series<1>(packet + k, data, frames);
+			return;
+		}
+		if (IsRamping(packet, Count))
+			RenderSeries<Count, true>(packet, data, frames);
+		else
+			RenderSeries<Count, false>(packet, data, frames);
+	}
+
+	[[nodiscard]] bool IsRamping(const uint32_t packet,
+								 const uint32_t count) const
+	{
+		return std::any_of(m_Ramping.Data() + packet,
+						   m_Ramping.Data() + packet + count,
+						   [](const uint8_t ramping) { return ramping; });
+	}
+
+	/**
+	 * @brief The coefficients and states of @p Count packets, held in
+	 * registers for one Render*() call.
+	 */
+	template<uint32_t Count, bool Ramp>
+	struct Packets
+	{
+		Simd::Float B0[Count], B1[Count], B2[Count], A1[Count], A2[Count];
+		Simd::Float DeltaB0[Count], DeltaB1[Count], DeltaB2[Count],
+			DeltaA1[Count], DeltaA2[Count];
+		Simd::Float S1[Count], S2[Count];
+
+		Packets(const BiquadBank& bank, const uint32_t packet,
+				const uint32_t frames)
+		{
+			const Simd::Float step = Simd::Set(1.0f / static_cast<float>(
+				std::max(frames, 1u)));
+			for (uint32_t k = 0; k < Count; k++)
+			{
+				const size_t at = static_cast<size_t>(packet + k) *
+					Simd::Width;
+				B0[k] = Simd::LoadAligned(bank.m_B0.Data() + at);
+				B1[k] = Simd::LoadAligned(bank.m_B1.Data() + at);
+				B2[k] = Simd::LoadAligned(bank.m_B2.Data() + at);
+				A1[k] = Simd::LoadAligned(bank.m_A1.Data() + at);
+				A2[k] = Simd::LoadAligned(bank.m_A2.Data() + at);
+				S1[k] = Simd::LoadAligned(bank.m_S1.Data() + at);
+				S2[k] = Simd::LoadAligned(bank.m_S2.Data() + at);
+				if constexpr (Ramp)
+				{
+					DeltaB0[k] = Simd::Mul(step, Simd::Sub(Simd::LoadAligned(
+						bank.m_TargetB0.Data() + at), B0[k]));
+					DeltaB1[k] = Simd::Mul(step, Simd::Sub(Simd::LoadAligned(
+						bank.m_TargetB1.Data() + at), B1[k]));
+					DeltaB2[k] = Simd::Mul(step, Simd::Sub(Simd::LoadAligned(
+						bank.m_TargetB2.Data() + at), B2[k]));
+					DeltaA1[k] = Simd::Mul(step, Simd::Sub(Simd::LoadAligned(
+						bank.m_TargetA1.Data() + at), A1[k]));
+					DeltaA2[k] = Simd::Mul(step, Simd::Sub(Simd::LoadAligned(
+						bank.m_TargetA2.Data() + at), A2[k]));
+				}
+			}
+		}
+
+		/** @brief One sample @p x through packet @p k. */
+		Simd::Float Tick(const uint32_t k, const Simd::Float& x)
+		{
+			if constexpr (Ramp)
+			{
+				B0[k] = Simd::Add(B0[k], DeltaB0[k]);
+				B1[k] = Simd::Add(B1[k], DeltaB1[k]);
+				B2[k] = Simd::Add(B2[k], DeltaB2[k]);
+				A1[k] = Simd::Add(A1[k], DeltaA1[k]);
+				A2[k] = Simd::Add(A2[k], DeltaA2[k]);
+			}
+			const Simd::Float y = Simd::MulAdd(B0[k], x, S1[k]);
+			S1[k] = Simd::MulAdd(B1[k], x, Simd::MulAdd(A1[k], y, S2[k]));
+			S2[k] = Simd::MulAdd(A2[k], y, Simd::Mul(B2[k], x));
+			return y;
+		}
+
+		/**
+		 * @brief Writes the states back, flushed, and settles a ramp on
+		 * its targets.
+		 */
+		void Store(BiquadBank& bank, const uint32_t packet)
+		{
+			const Simd::Float flush = Simd::Set(FlushLevel);
+			const Simd::Float zero = Simd::Set(0.0f);
+			for (uint32_t k = 0; k < Count; k++)
+			{
+				const size_t at = static_cast<size_t>(packet + k) *
+					Simd::Width;
+				Simd::StoreAligned(bank.m_S1.Data() + at, Simd::Select(
+					Simd::Less(Simd::Abs(S1[k]), flush), zero, S1[k]));
+				Simd::StoreAligned(bank.m_S2.Data() + at, Simd::Select(
+					Simd::Less(Simd::Abs(S2[k]), flush), zero, S2[k]));
+				if constexpr (Ramp)
+					bank.FinishRamp(packet + k);
+			}
+		}
+	};
+
+	/**
+	 * @brief @p Count packets from @p packet. In place, packet k's frames
+	 * follow packet k - 1's in @p data; with Sum, every filter reads
+	 * @p input and adds into @p data.
+	 */
+	template<uint32_t Count, bool Ramp, bool Sum>
+	void Render(const uint32_t packet, float* data, const float* input,
+				const uint32_t frames)
+	{
+		Packets<Count, Ramp> packets(*this, packet, frames);
+		for (uint32_t i = 0; i < frames; i++)
+		{
+			if constexpr (Sum)
+			{
+				const Simd::Float x = Simd::Set(input[i]);
+				Simd::Float sum = Simd::LoadAligned(data + i * Simd::Width);
+				for (uint32_t k = 0; k < Count; k++)
+					sum = Simd::Add(sum, packets.Tick(k, x));
+				Simd::StoreAligned(data + i * Simd::Width, sum);
+			}
+			else
+			{
+				for (uint32_t k = 0; k < Count; k++)
+				{
+					float* frame = data + (static_cast<size_t>(k) * frames +
+						i) * Simd::Width;
+					Simd::StoreAligned(frame, packets.Tick(
+						k, Simd::LoadAligned(frame)));
+				}
+			}
+		}
+		packets.Store(*this, packet);
+	}
+
+	/**
+	 * @brief @p Count packets from @p packet in series on the one packet of
+	 * @p data, which holds at least Count - 1 frames.
+	 */
+	template<uint32_t Count, bool Ramp>
+	void RenderSeries(const uint32_t packet, float* data,
+					  const uint32_t frames)
+	{
+		Packets<Count, Ramp> packets(*this, packet, frames);
+		Simd::Float carry[Count];
+		// Packet k at step t filters frame t - k. Later packets go first,
+		// so each still sees what the one before it produced on the
+		// previous step.
+		const auto edge = [&](const uint32_t t)
+		{
+			for (uint32_t k = Count; k-- > 0;)
+			{
+				if (t < k || t - k >= frames)
+					continue;
+				carry[k] = packets.Tick(k, k ? carry[k - 1]
+					: Simd::LoadAligned(data + static_cast<size_t>(t) *
+										Simd::Width));
+				if (k == Count - 1)
+				{
+					Simd::StoreAligned(data + static_cast<size_t>(t - k) *
+									   Simd::Width, carry[k]);
+				}
+			}
+		};
+		for (uint32_t t = 0; t < Count - 1; t++)
+			edge(t);
+		for (uint32_t t = Count - 1; t < frames; t++)
+		{
+			for (uint32_t k = Count - 1; k > 0; k--)
+				carry[k] = packets.Tick(k, carry[k - 1]);
+			carry[0] = packets.Tick(0, Simd::LoadAligned(
+				data + static_cast<size_t>(t) * Simd::Width));
+			Simd::StoreAligned(data + static_cast<size_t>(t - (Count - 1)) *
+							   Simd::Width, carry[Count - 1]);
+		}
+		for (uint32_t t = frames; t < frames + Count - 1; t++)
+			edge(t);
+		packets.Store(*this, packet);
+	}
+
+	/** @brief Lands exactly on the targets of @p packet. */
+	void FinishRamp(uint32_t packet);
+
+private:
+	// The feedback coefficients are kept negated, -a1 and -a2, so the
+	// recurrence is all multiply-adds.
+	ArenaArray<float> m_B0;
+	ArenaArray<float> m_B1;
+	ArenaArray<float> m_B2;
+	ArenaArray<float> m_A1;
+	ArenaArray<float> m_A2;
+	ArenaArray<float> m_TargetB0;
+	ArenaArray<float> m_TargetB1;
+	ArenaArray<float> m_TargetB2;
+	ArenaArray<float> m_TargetA1;
+	ArenaArray<float> m_TargetA2;
+	ArenaArray<float> m_S1;
+	ArenaArray<float> m_S2;
+	/** @brief Per packet, whether a target is pending. */
+	ArenaArray<uint8_t> m_Ramping;
+};
+}
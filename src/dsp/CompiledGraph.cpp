@@ -0,0 +1,253 @@
+﻿#include "CompiledGraph.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "NodeProfiler.hpp"
+#include "ParallelExecutor.hpp"
+
+
+namespace
+{
+enum class VisitState : uint8_t
+{
+	Unvisited,
+	Visiting,
+	Done
+};
+
+/**
+ * @brief Depth-first post-order walk from the output, which yields a
+ * topological order of exactly the nodes the output depends on.
+ */
+bool SortFrom(const MT::DSP::Graph& graph, const MT::DSP::NodeId id,
+			  std::vector<VisitState>& state,
+			  std::vector<MT::DSP::NodeId>& order)
+{
+	if (state[id] == VisitState::Done)
+		return true;
+	if (state[id] == VisitState::Visiting)
+		return false;
+
+	state[id] = VisitState::Visiting;
+	for (const MT::DSP::NodeId input : graph.GetInputs(id))
+	{
+		if (!SortFrom(graph, input, state, order))
+			return false;
+	}
+	state[id] = VisitState::Done;
+	order.push_back(id);
+	return true;
+}
+}
+
+
+std::unique_ptr<MT::DSP::CompiledGraph> MT::DSP::CompiledGraph::Compile(
+		const Graph& graph, const PrepareContext& context, std::string* error,
+		const CompileOptions& options)
+{
+	const NodeId output = graph.GetOutput();
+	if (!graph.Contains(output))
+	{
+		if (error)
+			*error = "The graph has no output node.";
+		return nullptr;
+	}
+
+	std::vector<VisitState> state(graph.GetIdLimit(), VisitState::Unvisited);
+	std::vector<NodeId> order;
+	if (!SortFrom(graph, output, state, order))
+	{
+		if (error)
+			*error = "The graph contains a feedback cycle.";
+		return nullptr;
+	}
+
+	auto compiled = std::unique_ptr<CompiledGraph>(new CompiledGraph());
+	compiled->m_Context = context;
+	compiled->m_ScheduleIndex.assign(graph.GetIdLimit(), Unscheduled);
+	for (size_t index = 0; index < order.size(); index++)
+		compiled->m_ScheduleIndex[order[index]] = static_cast<uint32_t>(index);
+
+	// Longest path from a source gives each node a level; nodes on the same
+	// level never depend on each other.
+	std::vector<uint32_t> level(order.size(), 0);
+	std::vector<uint32_t> levelWidth(order.size(), 0);
+	for (size_t index = 0; index < order.size(); index++)
+	{
+		for (const NodeId input : graph.GetInputs(order[index]))
+		{
+			level[index] = std::max(level[index],
+									level[compiled->m_ScheduleIndex[input]] + 1);
+		}
+		levelWidth[level[index]]++;
+	}
+	const uint32_t width = *std::max_element(levelWidth.begin(),
+											 levelWidth.end());
+	const bool parallel = options.Executor &&
+		options.Executor->GetConcurrency() > 1 &&
+		order.size() >= options.MinParallelNodes &&
+		width >= options.MinParallelWidth;
+
+	// Count how many times each output is read, to know when it is dead.
+	std::vector<uint32_t> remainingReads(graph.GetIdLimit(), 0);
+	for (const NodeId id : order)
+	{
+		for (const NodeId input : graph.GetInputs(id))
+			remainingReads[input]++;
+	}
+	remainingReads[output]++;
+
+	// Assign buffer slots; a slot is recycled once its last reader ran. The
+	// node's own slot is taken before its inputs are released, so nothing
+	// processes in place. Parallel graphs have no global order to rely on.
+	std::vector<uint32_t> bufferOf(graph.GetIdLimit(), 0);
+	std::vector<uint32_t> freeSlots;
+	uint32_t slotCount = 0;
+	for (const NodeId id : order)
+	{
+		if (freeSlots.empty())
+			bufferOf[id] = slotCount++;
+		else
+		{
+			bufferOf[id] = freeSlots.back();
+			freeSlots.pop_back();
+		}
+
+		for (const NodeId input : graph.GetInputs(id))
+		{
+			if (--remainingReads[input] == 0 && !parallel)
+				freeSlots.push_back(bufferOf[input]);
+		}
+	}
+
+	const uint32_t stride = (context.MaxBlockFrames + BufferAlignmentFloats - 1) /
+		BufferAlignmentFloats * BufferAlignmentFloats;
+	const size_t slotFloats = static_cast<size_t>(stride) * context.Channels;
+	compiled->m_BufferCount = slotCount;
+	// Arena blocks start on a cache line, the padded stride keeps every
+	// slot aligned.
+	compiled->m_BufferStorage.Allocate(context.Memory,
+									   slotFloats * slotCount);
+	float* base = compiled->m_BufferStorage.Data();
+
+	const auto viewOf = [&](const NodeId id)
+	{
+		return BufferView{base + slotFloats * bufferOf[id], context.Channels,
+						  stride};
+	};
+
+	compiled->m_Schedule.reserve(order.size());
+	compiled->m_Nodes.reserve(order.size());
+	for (const NodeId id : order)
+	{
+		const std::shared_ptr<Node>& node = graph.GetNodeHandle(id);
+		node->EnsurePrepared(context);
+
+		const auto firstInput = static_cast<uint32_t>(
+			compiled->m_InputViews.size());
+		for (const NodeId input : graph.GetInputs(id))
+			compiled->m_InputViews.push_back(viewOf(input));
+
+		compiled->m_Schedule.push_back({
+			node.get(), id, viewOf(id), firstInput,
+			static_cast<uint32_t>(graph.GetInputs(id).size())
+		});
+		compiled->m_Nodes.push_back(node);
+		if (node->WantsNotes())
+			compiled->m_NoteReceivers.push_back(node.get());
+	}
+	compiled->m_Output = viewOf(output);
+	compiled->m_Profiler = options.Profiler;
+
+	if (parallel)
+	{
+		// Successor lists and input counts over distinct scheduled edges.
+		const size_t count = order.size();
+		std::vector<std::vector<uint32_t>> successors(count);
+		compiled->m_DependencyCounts.assign(count, 0);
+		for (size_t index = 0; index < count; index++)
+		{
+			std::vector<NodeId> inputs = graph.GetInputs(order[index]);
+			std::sort(inputs.begin(), inputs.end());
+			inputs.erase(std::unique(inputs.begin(), inputs.end()),
+						 inputs.end());
+			for (const NodeId input : inputs)
+			{
+				successors[compiled->m_ScheduleIndex[input]].push_back(
+					static_cast<uint32_t>(index));
+			}
+			compiled->m_DependencyCounts[index] =
+				static_cast<uint32_t>(inputs.size());
+			if (inputs.empty())
+				compiled->m_Roots.push_back(static_cast<uint32_t>(index));
+		}
+
+		compiled->m_SuccessorOffsets.reserve(count + 1);
+		for (const std::vector<uint32_t>& list : successors)
+		{
+			compiled->m_SuccessorOffsets.push_back(
+				static_cast<uint32_t>(compiled->m_Successors.size()));
+			compiled->m_Successors.insert(compiled->m_Successors.end(),
+										  list.begin(), list.end());
+		}
+		compiled->m_SuccessorOffsets.push_back(
+			static_cast<uint32_t>(compiled->m_Successors.size()));
+
+		compiled->m_PendingInputs =
+			std::make_unique<std::atomic<uint32_t>[]>(count);
+		compiled->m_Executor = options.Executor;
+	}
+	return compiled;
+}
+
+void MT::DSP::CompiledGraph::Process(const uint32_t frames)
+{
+	if (m_Executor)
+	{
+		m_Executor->Process(*this, frames);
+		return;
+	}
+
+	for (uint32_t index = 0; index < m_Schedule.size(); index++)
+		ProcessNode(index, frames, 0);
+}
+
+void MT::DSP::CompiledGraph::ProcessNode(const uint32_t index,
+										 const uint32_t frames,
+										 [[maybe_unused]] const uint32_t thread)
+{
+	const ScheduleEntry& entry = m_Schedule[index];
+	const ProcessContext context{
+		frames,
+		{m_InputViews.data() + entry.FirstInput, entry.InputCount},
+		entry.Output
+	};
+#if PAE_ENABLE_PROFILING
+	if (m_Profiler)
+	{
+		const NodeProfiler::Clock::time_point start =
+			NodeProfiler::Clock::now();
+		entry.Processor->Process(context);
+		m_Profiler->Record(thread, entry.Id,
+						   NodeProfiler::Clock::now() - start);
+		return;
+	}
+#endif
+	entry.Processor->Process(context);
+}
+
+void MT::DSP::CompiledGraph::SetParameter(const NodeId id,
+										  const uint32_t parameter,
+										  const float value)
+{
+	if (id >= m_ScheduleIndex.size() || m_ScheduleIndex[id] == Unscheduled)
+		return;
+	m_Schedule[m_ScheduleIndex[id]].Processor->SetParameter(parameter, value);
+}
+
+void MT::DSP::CompiledGraph::OnNote(const uint32_t note, const float velocity)
+{
+	for (Node* receiver : m_NoteReceivers)
+		receiver->OnNote(note, velocity);
+}
@@ -0,0 +1,126 @@
+﻿#pragma once
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Graph.hpp"
+#include "MemoryArena.hpp"
+
+namespace MT::DSP
+{
+class NodeProfiler;
+class ParallelExecutor;
+
+/** @brief How a graph should be scheduled. */
+struct CompileOptions
+{
+	/**
+	 * @brief Pool used to run independent branches concurrently, nullptr
+	 * for a purely serial schedule.
+	 */
+	ParallelExecutor* Executor = nullptr;
+	/** @brief Graphs with fewer scheduled nodes always run serially. */
+	uint32_t MinParallelNodes = 8;
+	/**
+	 * @brief Graphs whose widest dependency level has fewer nodes always run
+	 * serially, a plain chain cannot be split.
+	 */
+	uint32_t MinParallelWidth = 2;
+	/**
+	 * @brief Receives the processing time of every node, nullptr to skip
+	 * timing. Ignored unless PAE_ENABLE_PROFILING is set.
+	 */
+	NodeProfiler* Profiler = nullptr;
+};
+
+/**
+ * @brief Flat, topologically ordered execution schedule of a @ref Graph.
+ *
+ * Built on the control thread by Compile(), then handed to the audio
+ * thread which only walks the contiguous schedule. Every node output is
+ * assigned a buffer up front; in serial graphs buffers are reused as soon as
+ * their last consumer ran, so a long chain needs only a handful of them.
+ * Graphs run by a @ref ParallelExecutor give every node its own buffer,
+ * since independent branches may run in any order.
+ */
+class CompiledGraph
+{
+public:
+	/**
+	 * @brief Schedules the nodes that feed the graph output and prepares them.
+	 *
+	 * Nodes not connected to the output are left out.
+	 *
+	 * @param error Receives a description of the problem on failure.
+	 * @return nullptr if the graph has no output or contains a cycle.
+	 */
+	static std::unique_ptr<CompiledGraph> Compile(const Graph& graph,
+												  const PrepareContext& context,
+												  std::string* error = nullptr,
+												  const CompileOptions& options =
+														  {});
+
+	CompiledGraph(const CompiledGraph&) = delete;
+	CompiledGraph& operator=(const CompiledGraph&) = delete;
+
+	/** @brief Renders one block, @p frames must not exceed MaxBlockFrames. */
+	void Process(uint32_t frames);
+
+	/** @brief Output of the last Process() call. */
+	[[nodiscard]] const BufferView& GetOutput() const { return m_Output; }
+	[[nodiscard]] const PrepareContext& GetContext() const { return m_Context; }
+	[[nodiscard]] size_t GetNodeCount() const { return m_Schedule.size(); }
+	[[nodiscard]] size_t GetBufferCount() const { return m_BufferCount; }
+	/** @brief Whether blocks are split across the executor's threads. */
+	[[nodiscard]] bool IsParallel() const { return m_Executor != nullptr; }
+
+	/** @brief Forwards a parameter change to node @p id, if scheduled. */
+	void SetParameter(NodeId id, uint32_t parameter, float value);
+	/** @brief Forwards a note event to every node that wants notes. */
+	void OnNote(uint32_t note, float velocity);
+
+private:
+	friend class ParallelExecutor;
+
+	CompiledGraph() = default;
+
+	/** @param thread Render thread index, 0 for the audio thread. */
+	void ProcessNode(uint32_t index, uint32_t frames, uint32_t thread);
+
+	struct ScheduleEntry
+	{
+		Node* Processor;
+		NodeId Id;
+		BufferView Output;
+		uint32_t FirstInput;
+		uint32_t InputCount;
+	};
+
+	static constexpr uint32_t Unscheduled = 0xFFFFFFFF;
+
+	std::vector<ScheduleEntry> m_Schedule;
+	// Input views of all entries, back to back in schedule order.
+	std::vector<BufferView> m_InputViews;
+	std::vector<Node*> m_NoteReceivers;
+	// Node id -> schedule index, Unscheduled for pruned nodes.
+	std::vector<uint32_t> m_ScheduleIndex;
+	// Keeps every scheduled node alive while the audio thread uses it.
+	std::vector<std::shared_ptr<Node>> m_Nodes;
+	NodeProfiler* m_Profiler = nullptr;
+
+	// Dependency graph for the parallel executor, in schedule indices.
+	ParallelExecutor* m_Executor = nullptr;
+	std::vector<uint32_t> m_SuccessorOffsets;
+	std::vector<uint32_t> m_Successors;
+	std::vector<uint32_t> m_DependencyCounts;
+	std::vector<uint32_t> m_Roots;
+	// Unfinished inputs per node during the current block.
+	std::unique_ptr<std::atomic<uint32_t>[]> m_PendingInputs;
+
+	ArenaArray<float> m_BufferStorage;
+	size_t m_BufferCount = 0;
+	BufferView m_Output;
+	PrepareContext m_Context;
+};
+}
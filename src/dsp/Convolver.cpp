@@ -0,0 +1,382 @@
+﻿#include "Convolver.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <vector>
+
+#include "ImpulseResponse.hpp"
+
+
+namespace
+{
+/** @brief Copies @p count samples of a ring starting at @p position. */
+void ReadRing(const float* ring, const uint32_t mask, const uint64_t position,
+			  float* destination, const uint32_t count)
+{
+	const auto at = static_cast<uint32_t>(position) & mask;
+	const uint32_t first = std::min(count, mask + 1 - at);
+	std::copy_n(ring + at, first, destination);
+	std::copy_n(ring, count - first, destination + first);
+}
+
+/** @brief Whether counter @p done, wrapping, has reached @p target. */
+bool Reached(const uint32_t done, const uint32_t target)
+{
+	return static_cast<int32_t>(done - target) >= 0;
+}
+}
+
+
+MT::DSP::Convolver::~Convolver()
+{
+	StopWorker();
+}
+
+void MT::DSP::Convolver::Prepare(MemoryArena* memory,
+								 const ImpulseResponse& impulse,
+								 const float sampleRate,
+								 const uint32_t channels,
+								 const uint32_t partition,
+								 const ConvolutionTail tail)
+{
+	StopWorker();
+	m_Channels = std::max(channels, 1u);
+	m_Impulses = impulse.GetChannels();
+	m_SampleRate = sampleRate;
+	m_Tail = tail;
+	m_Partition = std::clamp(std::bit_ceil(std::max(partition, 1u)),
+							 RealFft::MinSize / 2, MaxPartition);
+
+	std::vector<std::vector<float>> responses;
+	for (uint32_t channel = 0; channel < m_Impulses; channel++)
+		responses.push_back(impulse.Resample(channel, sampleRate));
+	const auto length = static_cast<uint32_t>(responses.front().size());
+
+	// Stage s has partitions of B * Growth^s from 2 B Growth^s on, so each
+	// tail block is due a partition and a head partition after its input
+	// completes. The last stage takes whatever is left.
+	const uint32_t stages = m_Tail == ConvolutionTail::Uniform
+		? 1
+		: MaxTailStages + 1;
+	m_StageCount = 0;
+	for (uint32_t size = m_Partition; m_StageCount < stages; size *= Growth)
+	{
+		Stage& stage = m_Stages[m_StageCount++];
+		stage.Partition = size;
+		stage.Offset = m_StageCount == 1 ? 0 : 2 * size;
+		const uint32_t end = m_StageCount == stages
+			? std::max(length, stage.Offset)
+			: std::min(length, 2 * size * Growth);
+		stage.Partitions = std::max((end - stage.Offset + size - 1) / size,
+									1u);
+
+		const uint32_t points = 2 * size;
+		stage.Fft.Prepare(memory, points);
+		stage.Sum.Allocate(memory, points);
+		stage.Frame.Allocate(memory, points);
+		stage.Spectra.Allocate(memory, static_cast<size_t>(m_Channels) *
+							   stage.Partitions * points);
+		stage.Results.Allocate(memory, static_cast<size_t>(m_Channels) * 2 *
+							   size);
+		stage.Filters.Allocate(memory, static_cast<size_t>(m_Impulses) *
+							   stage.Partitions * points);
+		// The inverse transform's factor is taken out here, once.
+		const float scale = 1.0f / static_cast<float>(points);
+		for (uint32_t channel = 0; channel < m_Impulses; channel++)
+		{
+			for (uint32_t part = 0; part < stage.Partitions; part++)
+			{
+				float* frame = stage.Frame.Data();
+				std::fill_n(frame, points, 0.0f);
+				const uint32_t first = stage.Offset + part * size;
+				for (uint32_t i = 0; i < size && first + i < length; i++)
+					frame[i] = responses[channel][first + i] * scale;
+				float* filter = stage.Filters.Data() +
+					(static_cast<size_t>(channel) * stage.Partitions + part) *
+						points;
+				stage.Fft.Forward(frame, filter, filter + size);
+			}
+		}
+
+		stage.Posted.store(0, std::memory_order_relaxed);
+		stage.Done.store(0, std::memory_order_relaxed);
+		stage.Next = 0;
+		stage.LastJobNs.store(0, std::memory_order_relaxed);
+		stage.MaxJobNs.store(0, std::memory_order_relaxed);
+		if (end >= length)
+			break;
+	}
+
+	// Tail jobs read their input up to three partitions after it arrived.
+	const uint32_t history = std::bit_ceil(
+		4 * m_Stages[m_StageCount - 1].Partition);
+	m_HistoryMask = history - 1;
+	m_History.Allocate(memory, static_cast<size_t>(m_Channels) * history);
+	m_Ready.Allocate(memory, static_cast<size_t>(m_Channels) * m_Partition);
+	m_Written = 0;
+	m_Fill = 0;
+	m_LastBlockNs.store(0, std::memory_order_relaxed);
+	m_MaxBlockNs.store(0, std::memory_order_relaxed);
+	m_LateJobs.store(0, std::memory_order_relaxed);
+
+	if (m_Tail == ConvolutionTail::Worker && m_StageCount > 1)
+		m_Worker = std::thread(&Convolver::WorkerLoop, this);
+}
+
+void MT::DSP::Convolver::Process(const float* const* inputs,
+								 float* const* outputs,
+								 const uint32_t channels,
+								 const uint32_t frames, const float dry,
+								 const float wet)
+{
+	const Clock::time_point start = Clock::now();
+	const uint32_t used = std::min(channels, m_Channels);
+	const uint32_t ring = m_HistoryMask + 1;
+	uint32_t done = 0;
+	while (done < frames)
+	{
+		const uint32_t count = std::min(frames - done, m_Partition - m_Fill);
+		const auto at = static_cast<uint32_t>(m_Written) & m_HistoryMask;
+		const uint32_t first = std::min(count, ring - at);
+		for (uint32_t channel = 0; channel < used; channel++)
+		{
+			float* history = m_History.Data() +
+				static_cast<size_t>(channel) * ring;
+			std::copy_n(inputs[channel] + done, first, history + at);
+			std::copy_n(inputs[channel] + done + first, count - first,
+						history);
+			std::copy_n(m_Ready.Data() + static_cast<size_t>(channel) *
+							m_Partition + m_Fill,
+						count, outputs[channel] + done);
+		}
+		// Channels left out of this call hear silence, so their stale
+		// history does not keep ringing through the tail stages.
+		for (uint32_t channel = used; channel < m_Channels; channel++)
+		{
+			float* history = m_History.Data() +
+				static_cast<size_t>(channel) * ring;
+			std::fill_n(history + at, first, 0.0f);
+			std::fill_n(history, count - first, 0.0f);
+		}
+		m_Fill += count;
+		m_Written += count;
+		done += count;
+		if (m_Fill == m_Partition)
+		{
+			RunChunk(dry, wet);
+			m_Fill = 0;
+		}
+	}
+
+	const auto elapsed = static_cast<uint64_t>(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(
+			Clock::now() - start).count());
+	m_LastBlockNs.store(elapsed, std::memory_order_relaxed);
+	if (elapsed > m_MaxBlockNs.load(std::memory_order_relaxed))
+		m_MaxBlockNs.store(elapsed, std::memory_order_relaxed);
+}
+
+MT::DSP::Convolver::Stats MT::DSP::Convolver::GetStats() const
+{
+	Stats stats;
+	stats.Latency = m_Partition;
+	stats.LastBlockNs = m_LastBlockNs.load(std::memory_order_relaxed);
+	stats.MaxBlockNs = m_MaxBlockNs.load(std::memory_order_relaxed);
+	stats.LateJobs = m_LateJobs.load(std::memory_order_relaxed);
+	stats.Stages = m_StageCount;
+	for (uint32_t index = 0; index < m_StageCount; index++)
+	{
+		const Stage& stage = m_Stages[index];
+		StageStats& out = stats.Stage[index];
+		out.Partition = stage.Partition;
+		out.Partitions = stage.Partitions;
+		out.Offset = stage.Offset;
+		out.LastJobNs = stage.LastJobNs.load(std::memory_order_relaxed);
+		out.MaxJobNs = stage.MaxJobNs.load(std::memory_order_relaxed);
+		// The head is due within its own block, a tail block a partition
+		// plus a head partition after its input completed.
+		const uint32_t window = index == 0 ? m_Partition
+										   : stage.Partition + m_Partition;
+		out.BudgetNs = static_cast<uint64_t>(
+			1e9 * window / static_cast<double>(m_SampleRate));
+	}
+	return stats;
+}
+
+void MT::DSP::Convolver::RunJob(Stage& stage, const uint64_t job)
+{
+	const Clock::time_point start = Clock::now();
+	const uint32_t size = stage.Partition;
+	const uint32_t points = 2 * size;
+	const uint32_t partitions = stage.Partitions;
+	const auto slot = static_cast<uint32_t>(job % partitions);
+	const uint32_t ring = m_HistoryMask + 1;
+	float* frame = stage.Frame.Data();
+	float* sum = stage.Sum.Data();
+
+	for (uint32_t channel = 0; channel < m_Channels; channel++)
+	{
+		// Overlap-save: the block and the one before it, of which only the
+		// second half of the circular convolution is kept.
+		ReadRing(m_History.Data() + static_cast<size_t>(channel) * ring,
+				 m_HistoryMask, job * size - size, frame, points);
+		float* spectra = stage.Spectra.Data() +
+			static_cast<size_t>(channel) * partitions * points;
+		float* spectrum = spectra + static_cast<size_t>(slot) * points;
+		stage.Fft.Forward(frame, spectrum, spectrum + size);
+
+		// Bins outer, partitions inner, so the sum stays in cache while
+		// every partition's spectra stream past.
+		const float* filters = stage.Filters.Data() +
+			static_cast<size_t>(channel % m_Impulses) * partitions * points;
+		const uint32_t used = static_cast<uint32_t>(
+			std::min<uint64_t>(job + 1, partitions));
+		std::fill_n(sum, points, 0.0f);
+		for (uint32_t bin = 0; bin < size; bin += BinsPerPass)
+		{
+			const uint32_t bins = std::min(BinsPerPass, size - bin);
+			for (uint32_t part = 0; part < used; part++)
+			{
+				const float* input = spectra + static_cast<size_t>(
+					(slot + partitions - part) % partitions) * points;
+				const float* filter = filters +
+					static_cast<size_t>(part) * points;
+				RealFft::MultiplyAdd(input, input + size, filter,
+									 filter + size, sum, sum + size, bin,
+									 bins);
+			}
+		}
+		stage.Fft.Inverse(sum, sum + size, frame);
+		std::copy_n(frame + size, size, stage.Results.Data() +
+					(static_cast<size_t>(channel) * 2 + job % 2) * size);
+	}
+
+	stage.Done.store(static_cast<uint32_t>(job + 1),
+					 std::memory_order_release);
+	if (m_Tail == ConvolutionTail::Worker && &stage != &m_Stages[0])
+		stage.Done.notify_all();
+
+	const auto elapsed = static_cast<uint64_t>(
+		std::chrono::duration_cast<std::chrono::nanoseconds>(
+			Clock::now() - start).count());
+	stage.LastJobNs.store(elapsed, std::memory_order_relaxed);
+	if (elapsed > stage.MaxJobNs.load(std::memory_order_relaxed))
+		stage.MaxJobNs.store(elapsed, std::memory_order_relaxed);
+}
+
+void MT::DSP::Convolver::RunChunk(const float dry, const float wet)
+{
+	const uint32_t size = m_Partition;
+	const uint64_t chunk = m_Written / size - 1;
+	const uint64_t begin = chunk * size;
+	const uint32_t ring = m_HistoryMask + 1;
+
+	Stage& head = m_Stages[0];
+	RunJob(head, chunk);
+	for (uint32_t channel = 0; channel < m_Channels; channel++)
+	{
+		std::copy_n(head.Results.Data() +
+						(static_cast<size_t>(channel) * 2 + chunk % 2) * size,
+					size, m_Ready.Data() + static_cast<size_t>(channel) * size);
+	}
+
+	// Tail blocks overlapping this one: each is a whole stage partition,
+	// so a head block lies within a single job of every stage.
+	for (uint32_t index = 1; index < m_StageCount; index++)
+	{
+		Stage& stage = m_Stages[index];
+		if (begin < stage.Offset)
+			continue;
+		const uint64_t job = (begin - stage.Offset) / stage.Partition;
+		WaitFor(stage, job + 1);
+		const uint64_t within = begin - stage.Offset - job * stage.Partition;
+		for (uint32_t channel = 0; channel < m_Channels; channel++)
+		{
+			const float* result = stage.Results.Data() +
+				(static_cast<size_t>(channel) * 2 + job % 2) *
+					stage.Partition + within;
+			float* ready = m_Ready.Data() + static_cast<size_t>(channel) * size;
+			for (uint32_t i = 0; i < size; i++)
+				ready[i] += result[i];
+		}
+	}
+
+	// Partitions divide the history, so the block is contiguous in it.
+	const auto at = static_cast<uint32_t>(begin) & m_HistoryMask;
+	for (uint32_t channel = 0; channel < m_Channels; channel++)
+	{
+		const float* input = m_History.Data() +
+			static_cast<size_t>(channel) * ring + at;
+		float* ready = m_Ready.Data() + static_cast<size_t>(channel) * size;
+		for (uint32_t i = 0; i < size; i++)
+			ready[i] = wet * ready[i] + dry * input[i];
+	}
+
+	// Hand out the tail blocks this one completed, after their previous
+	// results were read above.
+	for (uint32_t index = 1; index < m_StageCount; index++)
+	{
+		Stage& stage = m_Stages[index];
+		if (m_Written % stage.Partition)
+			continue;
+		const uint64_t job = m_Written / stage.Partition - 1;
+		if (m_Tail != ConvolutionTail::Worker)
+		{
+			RunJob(stage, job);
+			continue;
+		}
+		stage.Posted.store(static_cast<uint32_t>(job + 1),
+						   std::memory_order_release);
+		m_Signal.fetch_add(1, std::memory_order_release);
+		m_Signal.notify_one();
+	}
+}
+
+void MT::DSP::Convolver::WaitFor(Stage& stage, const uint64_t jobs)
+{
+	const auto target = static_cast<uint32_t>(jobs);
+	uint32_t done = stage.Done.load(std::memory_order_acquire);
+	if (Reached(done, target))
+		return;
+	m_LateJobs.fetch_add(1, std::memory_order_relaxed);
+	while (!Reached(done, target))
+	{
+		stage.Done.wait(done, std::memory_order_acquire);
+		done = stage.Done.load(std::memory_order_acquire);
+	}
+}
+
+void MT::DSP::Convolver::WorkerLoop()
+{
+	while (true)
+	{
+		const uint32_t signal = m_Signal.load(std::memory_order_acquire);
+		if (m_Stop.load(std::memory_order_acquire))
+			return;
+
+		// Smaller stages first, their blocks are due soonest.
+		bool ran = false;
+		for (uint32_t index = 1; index < m_StageCount && !ran; index++)
+		{
+			Stage& stage = m_Stages[index];
+			if (stage.Posted.load(std::memory_order_acquire) ==
+				static_cast<uint32_t>(stage.Next))
+				continue;
+			RunJob(stage, stage.Next++);
+			ran = true;
+		}
+		if (!ran)
+			m_Signal.wait(signal, std::memory_order_acquire);
+	}
+}
+
+void MT::DSP::Convolver::StopWorker()
+{
+	if (!m_Worker.joinable())
+		return;
+	m_Stop.store(true, std::memory_order_release);
+	m_Signal.fetch_add(1, std::memory_order_release);
+	m_Signal.notify_all();
+	m_Worker.join();
+	m_Stop.store(false, std::memory_order_relaxed);
+}
@@ -0,0 +1,191 @@
+﻿#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include "MemoryArena.hpp"
+#include "RealFft.hpp"
+
+namespace MT::DSP
+{
+class ImpulseResponse;
+
+/** @brief Where a @ref Convolver computes the tail of the response. */
+enum class ConvolutionTail : uint32_t
+{
+	/** @brief Growing partitions on a worker thread. */
+	Worker,
+	/** @brief Growing partitions on the audio thread, in bursts. */
+	AudioThread,
+	/** @brief No tail: head partitions all the way, an even cost per block. */
+	Uniform,
+	Count
+};
+
+/**
+ * @brief Multichannel convolution with a long impulse response at a small,
+ * fixed latency.
+ *
+ * The response is cut into stages of uniformly partitioned overlap-save
+ * convolution (UPOLS): every Partition samples of input are transformed
+ * once into a ring of spectra, and a stage's output block is the sum of
+ * the last Partitions input spectra times the response's partition
+ * spectra. The head stage's partition sets the latency and covers the
+ * first 2 * Growth partitions of the response; each tail stage after it
+ * uses partitions Growth times larger and starts at twice its partition
+ * size, so a multi-second response costs a handful of large transforms
+ * per second instead of thousands of small products per block.
+ *
+ * The head runs on the audio thread at every partition boundary. A tail
+ * stage's block is due Partition + head partition samples after its input
+ * completes, which leaves time to compute it on a worker thread of normal
+ * priority, below the audio thread's. If the worker falls behind, the
+ * audio thread waits for it and counts a late job: faster than real time
+ * the output stays exact, in real time a late job means a dropout.
+ * The tail stages may also run on the audio thread as their inputs
+ * complete, the same total work in occasional bursts, or be left out for
+ * head partitions over the whole response, see @ref ConvolutionTail.
+ *
+ * Prepare() allocates on the control thread; Process() neither allocates
+ * nor locks.
+ */
+class Convolver
+{
+public:
+	/** @brief Partition size ratio between successive stages. */
+	static constexpr uint32_t Growth = 8;
+	/** @brief Stages besides the head. */
+	static constexpr uint32_t MaxTailStages = 4;
+	/** @brief Largest head partition chosen from a block size. */
+	static constexpr uint32_t MaxPartition = 8192;
+	/** @brief Spectrum bins multiplied per pass over a stage's partitions. */
+	static constexpr uint32_t BinsPerPass = 256;
+
+	/** @brief Cost of one stage, see Stats. */
+	struct StageStats
+	{
+		/** @brief Samples per partition. */
+		uint32_t Partition = 0;
+		uint32_t Partitions = 0;
+		/** @brief First sample of the response the stage covers. */
+		uint32_t Offset = 0;
+		uint64_t LastJobNs = 0;
+		uint64_t MaxJobNs = 0;
+		/** @brief Real time a job may take before its output is due. */
+		uint64_t BudgetNs = 0;
+	};
+
+	/** @brief Latency and per-block cost, readable from any thread. */
+	struct Stats
+	{
+		/** @brief Frames the output lags the input by. */
+		uint32_t Latency = 0;
+		/** @brief Audio thread time of the last and slowest Process(). */
+		uint64_t LastBlockNs = 0;
+		uint64_t MaxBlockNs = 0;
+		/** @brief Tail jobs the audio thread had to wait for. */
+		uint64_t LateJobs = 0;
+		/** @brief The head first. */
+		uint32_t Stages = 0;
+		StageStats Stage[MaxTailStages + 1];
+	};
+
+	Convolver() = default;
+	~Convolver();
+
+	Convolver(const Convolver&) = delete;
+	Convolver& operator=(const Convolver&) = delete;
+
+	/**
+	 * @brief Plans the stages and transforms @p impulse, resampled to
+	 * @p sampleRate. Restarts from silence.
+	 *
+	 * @param partition Head partition, rounded up to a power of two of at
+	 * least RealFft::MinSize / 2; the latency.
+	 */
+	void Prepare(MemoryArena* memory, const ImpulseResponse& impulse,
+				 float sampleRate, uint32_t channels, uint32_t partition,
+				 ConvolutionTail tail);
+
+	/**
+	 * @brief Convolves @p frames samples of each of @p channels channels,
+	 * at most the prepared count, and writes @p wet times the convolution
+	 * plus @p dry times the input, both GetLatency() frames late. Prepared
+	 * channels beyond @p channels are fed silence.
+	 */
+	void Process(const float* const* inputs, float* const* outputs,
+				 uint32_t channels, uint32_t frames, float dry, float wet);
+
+	[[nodiscard]] uint32_t GetLatency() const { return m_Partition; }
+	[[nodiscard]] Stats GetStats() const;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	/** @brief One uniformly partitioned section of the response. */
+	struct Stage
+	{
+		uint32_t Partition = 0;
+		uint32_t Partitions = 0;
+		uint32_t Offset = 0;
+		RealFft Fft;
+		/** @brief Response spectra, per impulse channel and partition. */
+		ArenaArray<float> Filters;
+		/** @brief Ring of input spectra, per channel and partition. */
+		ArenaArray<float> Spectra;
+		/** @brief Accumulated output spectrum. */
+		ArenaArray<float> Sum;
+		/** @brief Input frame of two partitions, then the output. */
+		ArenaArray<float> Frame;
+		/** @brief Two output blocks per channel, by job parity. */
+		ArenaArray<float> Results;
+
+		/** @brief Jobs handed out, written by the audio thread. */
+		std::atomic<uint32_t> Posted{0};
+		/** @brief Jobs finished, written by whoever runs them. */
+		std::atomic<uint32_t> Done{0};
+		/** @brief The worker's next job, not wrapped like Done. */
+		uint64_t Next = 0;
+		std::atomic<uint64_t> LastJobNs{0};
+		std::atomic<uint64_t> MaxJobNs{0};
+	};
+
+	/** @brief Transforms input block @p job of @p stage into its output. */
+	void RunJob(Stage& stage, uint64_t job);
+	/** @brief Finishes the head block just filled, see Process(). */
+	void RunChunk(float dry, float wet);
+	/** @brief Blocks until @p stage has finished @p jobs jobs. */
+	void WaitFor(Stage& stage, uint64_t jobs);
+	void WorkerLoop();
+	void StopWorker();
+
+private:
+	uint32_t m_Partition = 0;
+	uint32_t m_Channels = 0;
+	uint32_t m_Impulses = 0;
+	uint32_t m_StageCount = 0;
+	ConvolutionTail m_Tail = ConvolutionTail::Worker;
+	float m_SampleRate = 48000.0f;
+	Stage m_Stages[MaxTailStages + 1];
+
+	/** @brief Input history per channel, a power of two long. */
+	ArenaArray<float> m_History;
+	uint32_t m_HistoryMask = 0;
+	/** @brief Input samples consumed so far. */
+	uint64_t m_Written = 0;
+	/** @brief Samples into the current head partition. */
+	uint32_t m_Fill = 0;
+	/** @brief Last full partition's output, played while the next fills. */
+	ArenaArray<float> m_Ready;
+
+	std::thread m_Worker;
+	/** @brief Bumped with every post, the worker sleeps on it. */
+	std::atomic<uint32_t> m_Signal{0};
+	std::atomic<bool> m_Stop{false};
+
+	std::atomic<uint64_t> m_LastBlockNs{0};
+	std::atomic<uint64_t> m_MaxBlockNs{0};
+	std::atomic<uint64_t> m_LateJobs{0};
+};
+}
@@ -0,0 +1,98 @@
+﻿#include "EnvelopeBank.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace
+{
+/** @brief Per-sample factor that decays by 60 dB over @p seconds. */
+float DecayFactor(const float seconds, const float sampleRate)
+{
+	return std::exp(std::log(0.001f) / std::max(seconds * sampleRate, 1.0f));
+}
+}
+
+
+void MT::DSP::EnvelopeBank::Prepare(MemoryArena* memory,
+									const uint32_t capacity,
+									const float sampleRate)
+{
+	m_SampleRate = sampleRate;
+	m_Stages.Allocate(memory, capacity);
+	m_Levels.Allocate(memory, capacity);
+	m_Scales.Allocate(memory, capacity);
+	m_Offsets.Allocate(memory, capacity);
+	UpdateCoefficients();
+}
+
+void MT::DSP::EnvelopeBank::SetAttack(const float seconds)
+{
+	m_Attack = std::max(seconds, 0.0f);
+	UpdateCoefficients();
+}
+
+void MT::DSP::EnvelopeBank::SetDecay(const float seconds)
+{
+	m_Decay = std::max(seconds, 0.0f);
+	UpdateCoefficients();
+}
+
+void MT::DSP::EnvelopeBank::SetSustain(const float level)
+{
+	m_Sustain = std::clamp(level, 0.0f, 1.0f);
+	UpdateCoefficients();
+}
+
+void MT::DSP::EnvelopeBank::SetRelease(const float seconds)
+{
+	m_Release = std::max(seconds, 0.0f);
+	UpdateCoefficients();
+}
+
+void MT::DSP::EnvelopeBank::Trigger(const uint32_t voice, const bool restart)
+{
+	if (restart)
+		m_Levels[voice] = 0.0f;
+	SetStage(voice, Stage::Attack);
+}
+
+void MT::DSP::EnvelopeBank::Release(const uint32_t voice)
+{
+	if (m_Stages[voice] != Stage::Idle)
+		SetStage(voice, Stage::Release);
+}
+
+void MT::DSP::EnvelopeBank::SetStage(const uint32_t voice, const Stage stage)
+{
+	m_Stages[voice] = stage;
+	switch (stage)
+	{
+		case Stage::Idle:
+			m_Scales[voice] = 0.0f;
+			m_Offsets[voice] = 0.0f;
+			break;
+		case Stage::Attack:
+			m_Scales[voice] = 1.0f;
+			m_Offsets[voice] = m_AttackStep;
+			break;
+		case Stage::Decay:
+			m_Scales[voice] = m_DecayFactor;
+			m_Offsets[voice] = m_Sustain * (1.0f - m_DecayFactor);
+			break;
+		case Stage::Release:
+			m_Scales[voice] = m_ReleaseFactor;
+			m_Offsets[voice] = 0.0f;
+			break;
+	}
+}
+
+void MT::DSP::EnvelopeBank::UpdateCoefficients()
+{
+	m_AttackStep = 1.0f / std::max(m_Attack * m_SampleRate, 1.0f);
+	m_DecayFactor = DecayFactor(m_Decay, m_SampleRate);
+	m_ReleaseFactor = DecayFactor(m_Release, m_SampleRate);
+
+	for (uint32_t voice = 0; voice < m_Stages.Size(); voice++)
+		SetStage(voice, m_Stages[voice]);
+}
@@ -0,0 +1,109 @@
+﻿#pragma once
+#include <cstdint>
+
+#include "MemoryArena.hpp"
+#include "Simd.hpp"
+
+namespace MT::DSP
+{
+/**
+ * @brief ADSR envelopes of a voice pool, stored as structure of arrays.
+ *
+ * Every stage is the recurrence level = level * scale + offset, clamped to
+ * [0, 1]: attack adds a constant step, decay and release approach their
+ * target exponentially. Voices only differ in their scale and offset, so a
+ * SIMD group of voices steps with Step() and no branches. Stage changes are
+ * made by Advance(), which the voice engine calls on its control grid.
+ */
+class EnvelopeBank
+{
+public:
+	/** @brief Level below which a released voice counts as finished. */
+	static constexpr float SilenceLevel = 1e-4f;
+
+	/** @brief Control thread. Every voice starts idle at level 0. */
+	void Prepare(MemoryArena* memory, uint32_t capacity, float sampleRate);
+
+	/** @brief Seconds from silence to full level. */
+	void SetAttack(float seconds);
+	/** @brief Seconds to fall about 60 dB toward the sustain level. */
+	void SetDecay(float seconds);
+	/** @brief Level 0-1 held until the note is released. */
+	void SetSustain(float level);
+	/** @brief Seconds to fall about 60 dB after the note is released. */
+	void SetRelease(float seconds);
+
+	/**
+	 * @brief Starts the attack of @p voice.
+	 * @param restart Start from silence rather than the current level; a
+	 * stolen voice keeps its level so it does not click.
+	 */
+	void Trigger(uint32_t voice, bool restart);
+	void Release(uint32_t voice);
+
+	/**
+	 * @brief Moves finished attacks to decay and calls @p onFinished with
+	 * every released voice that has fallen silent, which goes idle.
+	 */
+	template<typename Callback>
+	void Advance(Callback&& onFinished)
+	{
+		for (uint32_t voice = 0; voice < m_Stages.Size(); voice++)
+		{
+			const Stage stage = m_Stages[voice];
+			if (stage == Stage::Attack && m_Levels[voice] >= 1.0f)
+				SetStage(voice, Stage::Decay);
+			else if (stage == Stage::Release &&
+					 m_Levels[voice] < SilenceLevel)
+			{
+				m_Levels[voice] = 0.0f;
+				SetStage(voice, Stage::Idle);
+				onFinished(voice);
+			}
+		}
+	}
+
+	/** @brief One sample of the envelopes of a SIMD group or one voice. */
+	template<typename P>
+	static P Step(const P& level, const P& scale, const P& offset)
+	{
+		return Simd::Min(Simd::Max(Simd::MulAdd(level, scale, offset),
+								   Simd::Set<P>(0.0f)), Simd::Set<P>(1.0f));
+	}
+
+	/** @brief Current level of every voice, written back by the renderer. */
+	[[nodiscard]] float* GetLevels() { return m_Levels.Data(); }
+	[[nodiscard]] const float* GetLevels() const { return m_Levels.Data(); }
+	[[nodiscard]] const float* GetScales() const { return m_Scales.Data(); }
+	[[nodiscard]] const float* GetOffsets() const { return m_Offsets.Data(); }
+
+private:
+	enum class Stage : uint8_t
+	{
+		Idle,
+		Attack,
+		Decay,
+		Release
+	};
+
+	void SetStage(uint32_t voice, Stage stage);
+	/** @brief Recomputes the per-sample constants and every recurrence. */
+	void UpdateCoefficients();
+
+private:
+	float m_SampleRate = 48000.0f;
+	float m_Attack = 0.005f;
+	float m_Decay = 0.3f;
+	float m_Sustain = 0.6f;
+	float m_Release = 0.25f;
+
+	float m_AttackStep = 0.0f;
+	float m_DecayFactor = 0.0f;
+	float m_ReleaseFactor = 0.0f;
+
+	ArenaArray<Stage> m_Stages;
+	ArenaArray<float> m_Levels;
+	ArenaArray<float> m_Scales;
+	ArenaArray<float> m_Offsets;
+};
+}
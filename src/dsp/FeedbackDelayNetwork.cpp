@@ -0,0 +1,468 @@
+﻿#include "FeedbackDelayNetwork.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <numbers>
+
+#include <Eigen/QR>
+
+#include "Random.hpp"
+
+
+namespace
+{
+namespace Simd = MT::DSP::Simd;
+constexpr uint32_t Width = Simd::Width;
+constexpr uint32_t Packets = MT::DSP::FeedbackDelayNetwork::Chunk / Width;
+
+/** @brief Entry (row, column) of the unnormalized Sylvester matrix. */
+float HadamardSign(const uint32_t row, const uint32_t column)
+{
+	return std::popcount(row & column) % 2 ? -1.0f : 1.0f;
+}
+
+bool IsPrime(const uint32_t value)
+{
+	if (value < 2)
+		return false;
+	for (uint32_t divisor = 2; divisor * divisor <= value; divisor++)
+	{
+		if (value % divisor == 0)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * @brief The loss filters over the first @p count frames of a transposed
+ * tile, flushing tiny outputs; returns the state after the last.
+ */
+Simd::Float DampPartial(Simd::Float (&rows)[Width], const uint32_t count,
+						const Simd::Float& pole, const Simd::Float& gain,
+						Simd::Float state)
+{
+	const Simd::Float floor = Simd::Set(
+		MT::DSP::FeedbackDelayNetwork::FlushLevel);
+	for (uint32_t row = 0; row < count; row++)
+	{
+		state = Simd::MulAdd(pole, state, Simd::Mul(gain, rows[row]));
+		rows[row] = Simd::Select(Simd::Less(Simd::Abs(state), floor),
+								 Simd::Set(0.0f), state);
+	}
+	return rows[count - 1];
+}
+
+/**
+ * @brief One pass of a fast Walsh-Hadamard transform over rows of Chunk
+ * floats: log2 Radix butterfly stages, spans @p span to Radix / 2 * span.
+ * In place when @p source is @p destination.
+ */
+template<uint32_t Radix>
+void WalshHadamard(const float* source, float* destination,
+				   const uint32_t span, const uint32_t lines,
+				   const uint32_t packets)
+{
+	constexpr uint32_t Chunk = MT::DSP::FeedbackDelayNetwork::Chunk;
+	for (uint32_t first = 0; first < lines; first += Radix * span)
+	{
+		for (uint32_t line = first; line < first + span; line++)
+		{
+			for (uint32_t packet = 0; packet < packets; packet++)
+			{
+				const size_t at = line * Chunk + packet * Width;
+				Simd::Float x[Radix];
+				for (uint32_t k = 0; k < Radix; k++)
+					x[k] = Simd::LoadAligned(source + at + k * span * Chunk);
+				for (uint32_t half = 1; half < Radix; half *= 2)
+				{
+					for (uint32_t k = 0; k < Radix; k++)
+					{
+						if (k & half)
+							continue;
+						const Simd::Float a = x[k];
+						x[k] = Simd::Add(a, x[k + half]);
+						x[k + half] = Simd::Sub(a, x[k + half]);
+					}
+				}
+				for (uint32_t k = 0; k < Radix; k++)
+				{
+					Simd::StoreAligned(destination + at + k * span * Chunk,
+									   x[k]);
+				}
+			}
+		}
+	}
+}
+
+/** @brief Copies @p count samples of a line starting at @p position. */
+void ReadLine(const float* line, const uint32_t length, const uint32_t position,
+			  float* destination, const uint32_t count)
+{
+	const uint32_t first = std::min(count, length - position);
+	std::copy_n(line + position, first, destination);
+	std::copy_n(line, count - first, destination + first);
+}
+
+void WriteLine(float* line, const uint32_t length, const uint32_t position,
+			   const float* source, const uint32_t count)
+{
+	const uint32_t first = std::min(count, length - position);
+	std::copy_n(source, first, line + position);
+	std::copy_n(source + first, count - first, line);
+}
+}
+
+
+Eigen::MatrixXf MT::DSP::FeedbackDelayNetwork::MakeMatrix(
+	const FeedbackMatrix matrix, const uint32_t lines, const uint32_t seed)
+{
+	const auto size = static_cast<Eigen::Index>(lines);
+	if (matrix == FeedbackMatrix::Hadamard)
+	{
+		Eigen::MatrixXf hadamard(size, size);
+		for (uint32_t row = 0; row < lines; row++)
+		{
+			for (uint32_t column = 0; column < lines; column++)
+				hadamard(row, column) = HadamardSign(row, column);
+		}
+		return hadamard / std::sqrt(static_cast<float>(lines));
+	}
+	if (matrix == FeedbackMatrix::Householder)
+	{
+		return Eigen::MatrixXf::Identity(size, size) -
+			Eigen::MatrixXf::Constant(size, size,
+									  2.0f / static_cast<float>(lines));
+	}
+
+	// Box-Muller normals. Flipping Q's columns to make R's diagonal positive
+	// makes the decomposition unique, and Q then uniformly distributed.
+	Xorshift32 random(seed);
+	Eigen::MatrixXd gaussian(size, size);
+	for (Eigen::Index i = 0; i < gaussian.size(); i++)
+	{
+		const double radius = std::sqrt(-2.0 * std::log(
+			1.0 - static_cast<double>(random.NextUnipolar())));
+		gaussian(i) = radius * std::cos(2.0 * std::numbers::pi *
+			static_cast<double>(random.NextUnipolar()));
+	}
+	const Eigen::HouseholderQR<Eigen::MatrixXd> qr(gaussian);
+	Eigen::MatrixXd q = qr.householderQ();
+	for (Eigen::Index column = 0; column < size; column++)
+	{
+		if (qr.matrixQR()(column, column) < 0.0)
+			q.col(column) = -q.col(column);
+	}
+	return q.cast<float>();
+}
+
+void MT::DSP::FeedbackDelayNetwork::Prepare(MemoryArena* memory,
+											const uint32_t lines,
+											const FeedbackMatrix matrix,
+											const float sampleRate,
+											const uint32_t channels,
+											const float size, const bool dense)
+{
+	m_Lines = std::clamp(std::bit_ceil(lines), std::max(MinLines, Width),
+						 MaxLines);
+	m_Channels = channels;
+	m_Matrix = matrix;
+	m_Dense = dense || matrix == FeedbackMatrix::RandomOrthogonal;
+	m_SampleRate = sampleRate;
+
+	// Geometrically spread primes: no two lines share a factor, so their
+	// echoes do not pile up on common multiples.
+	for (ArenaArray<uint32_t>* array : {&m_Offsets, &m_Lengths, &m_Positions})
+		array->Allocate(memory, m_Lines);
+	const float shortest = ShortestDelay * std::clamp(size, 0.1f, 4.0f) *
+		sampleRate;
+	uint32_t total = 0;
+	uint32_t previous = 0;
+	for (uint32_t line = 0; line < m_Lines; line++)
+	{
+		const float target = shortest * std::pow(
+			LongestDelay / ShortestDelay, static_cast<float>(line) /
+			static_cast<float>(m_Lines - 1));
+		uint32_t length = std::max({static_cast<uint32_t>(target), Chunk,
+									previous + 1});
+		while (!IsPrime(length))
+			length++;
+		m_Offsets[line] = total;
+		m_Lengths[line] = length;
+		total += length;
+		previous = length;
+	}
+	m_Memory.Allocate(memory, total);
+
+	for (ArenaArray<float>* array : {&m_Pole, &m_Gain, &m_State,
+									 &m_InputSigns})
+		array->Allocate(memory, m_Lines);
+	m_OutputSigns.Allocate(memory, static_cast<size_t>(channels) * m_Lines);
+	// Taps carry the 1 / sqrt(N) of the fast Hadamard transform already,
+	// see SetDecay().
+	const float scale = !m_Dense && matrix == FeedbackMatrix::Hadamard
+		? 1.0f
+		: 1.0f / std::sqrt(static_cast<float>(m_Lines));
+	for (uint32_t line = 0; line < m_Lines; line++)
+	{
+		m_InputSigns[line] = HashSeed(line + 1) % 2 ? -1.0f : 1.0f;
+		// Row 0 is all ones; every channel gets a different later row.
+		for (uint32_t channel = 0; channel < channels; channel++)
+		{
+			m_OutputSigns[channel * m_Lines + line] = scale * HadamardSign(
+				channel % (m_Lines - 1) + 1, line);
+		}
+	}
+
+	m_Coefficients.Reset();
+	if (m_Dense)
+	{
+		const Eigen::MatrixXf coefficients = MakeMatrix(matrix, m_Lines);
+		m_Coefficients.Allocate(memory, static_cast<size_t>(m_Lines) *
+								m_Lines);
+		for (uint32_t row = 0; row < m_Lines; row++)
+		{
+			for (uint32_t column = 0; column < m_Lines; column++)
+			{
+				m_Coefficients[row * m_Lines + column] = coefficients(row,
+																	  column);
+			}
+		}
+	}
+	m_Taps.Allocate(memory, static_cast<size_t>(m_Lines) * Chunk);
+	m_Feedback.Allocate(memory, static_cast<size_t>(m_Lines) * Chunk);
+	SetDecay(2.0f, 0.5f);
+}
+
+void MT::DSP::FeedbackDelayNetwork::SetDecay(const float seconds,
+											 const float damping)
+{
+	const float low = std::max(seconds, 0.05f) * m_SampleRate;
+	const float high = low * (1.0f - std::clamp(damping, 0.0f, 0.95f));
+	// The fast Hadamard transform is unnormalized; its scale rides along
+	// with the loss, and Prepare() takes it back out of the outputs.
+	const float scale = !m_Dense && m_Matrix == FeedbackMatrix::Hadamard
+		? 1.0f / std::sqrt(static_cast<float>(m_Lines))
+		: 1.0f;
+	for (uint32_t line = 0; line < m_Lines; line++)
+	{
+		// -60 dB over the decay time is a gain of 10^(-3 length / time).
+		const auto length = static_cast<float>(m_Lengths[line]);
+		const float dc = std::pow(10.0f, -3.0f * length / low);
+		const float nyquist = std::pow(10.0f, -3.0f * length / high);
+		// Gain (1 - p) / (1 - p z^-1) is dc at DC and nyquist at Nyquist.
+		const float pole = (dc - nyquist) / (dc + nyquist);
+		m_Pole[line] = pole;
+		m_Gain[line] = scale * dc * (1.0f - pole);
+	}
+}
+
+void MT::DSP::FeedbackDelayNetwork::Process(const float* const* inputs,
+											float* const* outputs,
+											uint32_t channels,
+											const uint32_t frames,
+											const float dry, const float wet)
+{
+	channels = std::min(channels, m_Channels);
+	if (channels == 0)
+		return;
+	const uint32_t lines = m_Lines;
+	for (uint32_t start = 0; start < frames; start += Chunk)
+	{
+		const uint32_t count = std::min(Chunk, frames - start);
+		const uint32_t packets = (count + Width - 1) / Width;
+		ReadLines(count);
+		Damp(count);
+		if (m_Dense)
+			MixDense(packets);
+		else
+			Mix(packets);
+
+		for (uint32_t line = 0; line < lines; line++)
+		{
+			const float* input = inputs[line % channels] + start;
+			float* feedback = m_Feedback.Data() + line * Chunk;
+			const Simd::Float sign = Simd::Set(m_InputSigns[line]);
+			for (uint32_t packet = 0; packet < packets; packet++)
+			{
+				float* at = feedback + packet * Width;
+				Simd::StoreAligned(at, Simd::MulAdd(
+					sign, Simd::LoadAligned(input + packet * Width),
+					Simd::LoadAligned(at)));
+			}
+		}
+
+		// Outputs last: an output may share memory with its input.
+		for (uint32_t channel = 0; channel < channels; channel++)
+		{
+			const float* signs = m_OutputSigns.Data() + channel * lines;
+			Simd::Float sums[Packets];
+			for (uint32_t packet = 0; packet < packets; packet++)
+				sums[packet] = Simd::Set(0.0f);
+			for (uint32_t line = 0; line < lines; line++)
+			{
+				const float* taps = m_Taps.Data() + line * Chunk;
+				const Simd::Float sign = Simd::Set(signs[line]);
+				for (uint32_t packet = 0; packet < packets; packet++)
+				{
+					sums[packet] = Simd::MulAdd(sign, Simd::LoadAligned(
+						taps + packet * Width), sums[packet]);
+				}
+			}
+			const float* input = inputs[channel] + start;
+			float* output = outputs[channel] + start;
+			for (uint32_t packet = 0; packet < packets; packet++)
+			{
+				const uint32_t at = packet * Width;
+				Simd::StoreAligned(output + at, Simd::MulAdd(
+					Simd::Set(wet), sums[packet], Simd::Mul(
+						Simd::Set(dry), Simd::LoadAligned(input + at))));
+			}
+		}
+		WriteLines(count);
+	}
+}
+
+void MT::DSP::FeedbackDelayNetwork::ReadLines(const uint32_t frames)
+{
+	for (uint32_t line = 0; line < m_Lines; line++)
+	{
+		ReadLine(m_Memory.Data() + m_Offsets[line], m_Lengths[line],
+				 m_Positions[line], m_Taps.Data() + line * Chunk, frames);
+	}
+}
+
+void MT::DSP::FeedbackDelayNetwork::Damp(const uint32_t frames)
+{
+	const Simd::Float floor = Simd::Set(FlushLevel);
+	const Simd::Float zero = Simd::Set(0.0f);
+	for (uint32_t first = 0; first < m_Lines; first += Width)
+	{
+		const Simd::Float pole = Simd::LoadAligned(m_Pole.Data() + first);
+		const Simd::Float gain = Simd::LoadAligned(m_Gain.Data() + first);
+		Simd::Float state = Simd::LoadAligned(m_State.Data() + first);
+		float* taps = m_Taps.Data() + first * Chunk;
+		for (uint32_t frame = 0; frame < frames; frame += Width)
+		{
+			// Lines across lanes, one row per frame.
+			Simd::Float rows[Width];
+			for (uint32_t row = 0; row < Width; row++)
+				rows[row] = Simd::LoadAligned(taps + row * Chunk + frame);
+			Simd::Transpose(rows);
+			// A fixed trip count keeps the tile in registers; only a block's
+			// last, partial packet takes the indexed path.
+			if (frames - frame >= Width)
+			{
+				for (uint32_t row = 0; row < Width; row++)
+				{
+					state = Simd::MulAdd(pole, state,
+										 Simd::Mul(gain, rows[row]));
+					rows[row] = Simd::Select(Simd::Less(Simd::Abs(state),
+														floor), zero, state);
+				}
+				state = rows[Width - 1];
+			}
+			else
+			{
+				state = DampPartial(rows, frames - frame, pole, gain, state);
+			}
+			Simd::Transpose(rows);
+			for (uint32_t row = 0; row < Width; row++)
+				Simd::StoreAligned(taps + row * Chunk + frame, rows[row]);
+		}
+		Simd::StoreAligned(m_State.Data() + first, state);
+	}
+}
+
+void MT::DSP::FeedbackDelayNetwork::Mix(const uint32_t packets)
+{
+	const uint32_t lines = m_Lines;
+	const float* taps = m_Taps.Data();
+	float* feedback = m_Feedback.Data();
+	if (m_Matrix == FeedbackMatrix::Householder)
+	{
+		// x - 2/N (1^T x) 1: one sum over the lines, one update of each.
+		Simd::Float sums[Packets];
+		for (uint32_t packet = 0; packet < packets; packet++)
+			sums[packet] = Simd::Set(0.0f);
+		for (uint32_t line = 0; line < lines; line++)
+		{
+			for (uint32_t packet = 0; packet < packets; packet++)
+			{
+				sums[packet] = Simd::Add(sums[packet], Simd::LoadAligned(
+					taps + line * Chunk + packet * Width));
+			}
+		}
+		const Simd::Float scale = Simd::Set(-2.0f /
+											static_cast<float>(lines));
+		for (uint32_t packet = 0; packet < packets; packet++)
+			sums[packet] = Simd::Mul(scale, sums[packet]);
+		for (uint32_t line = 0; line < lines; line++)
+		{
+			for (uint32_t packet = 0; packet < packets; packet++)
+			{
+				const uint32_t at = line * Chunk + packet * Width;
+				Simd::StoreAligned(feedback + at, Simd::Add(
+					Simd::LoadAligned(taps + at), sums[packet]));
+			}
+		}
+		return;
+	}
+
+	// Walsh-Hadamard butterflies, up to three stages per pass over the
+	// rows so the passes stay in registers; the scale is in the loss
+	// filter gains.
+	const float* source = taps;
+	for (uint32_t span = 1; span < lines; )
+	{
+		const uint32_t radix = std::min(lines / span, 8u);
+		if (radix == 8)
+			WalshHadamard<8>(source, feedback, span, lines, packets);
+		else if (radix == 4)
+			WalshHadamard<4>(source, feedback, span, lines, packets);
+		else
+			WalshHadamard<2>(source, feedback, span, lines, packets);
+		source = feedback;
+		span *= radix;
+	}
+}
+
+void MT::DSP::FeedbackDelayNetwork::MixDense(const uint32_t packets)
+{
+	const uint32_t lines = m_Lines;
+	const float* taps = m_Taps.Data();
+	for (uint32_t row = 0; row < lines; row++)
+	{
+		// Every packet of the chunk accumulates at once, so one broadcast
+		// coefficient serves several independent multiply-adds.
+		const float* coefficients = m_Coefficients.Data() + row * lines;
+		Simd::Float sums[Packets];
+		for (uint32_t packet = 0; packet < packets; packet++)
+			sums[packet] = Simd::Set(0.0f);
+		for (uint32_t column = 0; column < lines; column++)
+		{
+			const Simd::Float coefficient = Simd::Set(coefficients[column]);
+			const float* source = taps + column * Chunk;
+			for (uint32_t packet = 0; packet < packets; packet++)
+			{
+				sums[packet] = Simd::MulAdd(coefficient, Simd::LoadAligned(
+					source + packet * Width), sums[packet]);
+			}
+		}
+		float* feedback = m_Feedback.Data() + row * Chunk;
+		for (uint32_t packet = 0; packet < packets; packet++)
+			Simd::StoreAligned(feedback + packet * Width, sums[packet]);
+	}
+}
+
+void MT::DSP::FeedbackDelayNetwork::WriteLines(const uint32_t frames)
+{
+	for (uint32_t line = 0; line < m_Lines; line++)
+	{
+		const uint32_t length = m_Lengths[line];
+		WriteLine(m_Memory.Data() + m_Offsets[line], length,
+				  m_Positions[line], m_Feedback.Data() + line * Chunk, frames);
+		const uint32_t position = m_Positions[line] + frames;
+		m_Positions[line] = position >= length ? position - length : position;
+	}
+}
@@ -0,0 +1,154 @@
+﻿#pragma once
+#include <cstdint>
+
+#include <Eigen/Core>
+
+#include "MemoryArena.hpp"
+#include "Simd.hpp"
+
+namespace MT::DSP
+{
+/** @brief Orthogonal matrix a @ref FeedbackDelayNetwork mixes through. */
+enum class FeedbackMatrix : uint32_t
+{
+	/**
+	 * @brief Sylvester Hadamard matrix: every line feeds every other with
+	 * equal weight. Applied as a fast Walsh-Hadamard transform.
+	 */
+	Hadamard,
+	/**
+	 * @brief Reflection I - 2/N 11^T: cheapest, but each line mostly feeds
+	 * itself once there are many. Applied as a rank-one update.
+	 */
+	Householder,
+	/** @brief Q of the QR decomposition of a Gaussian matrix; dense. */
+	RandomOrthogonal,
+	Count
+};
+
+/**
+ * @brief Feedback delay network reverb: delay lines of mutually prime
+ * lengths whose outputs are damped, mixed through an orthogonal matrix
+ * and fed back into their inputs.
+ *
+ * Each line's one-pole loss filter sets its gain at DC and at Nyquist so
+ * that, whatever the line's length, the network decays 60 dB in the decay
+ * time at low frequencies and in a shorter one at high frequencies, after
+ * Jot. The input channels are spread over the lines with alternating
+ * signs, and each output channel sums all lines with the signs of another
+ * Hadamard row, so the channels come out decorrelated.
+ *
+ * A block is run Chunk frames at a time. Every line is at least Chunk
+ * long, so the frames of a chunk do not depend on each other: the network
+ * reads Chunk samples from each line into a buffer, one row per line,
+ * works on the rows a SIMD packet of frames at a time, and writes them
+ * back. The feedback matrix then costs the same vertical operations as a
+ * scalar version would per frame, so the Hadamard and Householder
+ * matrices never need a dense product; the loss filters, recursive in
+ * time, run across lines on tiles transposed in registers.
+ *
+ * All delay lines share one contiguous arena block, laid end to end.
+ * Prepare() allocates on the control thread; SetDecay() and Process()
+ * neither allocate nor lock.
+ */
+class FeedbackDelayNetwork
+{
+public:
+	static constexpr uint32_t MinLines = 8;
+	static constexpr uint32_t MaxLines = 64;
+	/** @brief Frames run together, and the shortest line length. */
+	static constexpr uint32_t Chunk = 64;
+	/** @brief Shortest and longest delay at size 1, in seconds. */
+	static constexpr float ShortestDelay = 0.013f;
+	static constexpr float LongestDelay = 0.065f;
+	/**
+	 * @brief Line outputs below this are flushed to zero, so a network
+	 * left ringing into silence does not go denormal.
+	 */
+	static constexpr float FlushLevel = 1e-20f;
+
+	/**
+	 * @brief Control thread. The orthonormal @p matrix of size @p lines,
+	 * a power of two for Hadamard; @p seed picks the random one.
+	 */
+	static Eigen::MatrixXf MakeMatrix(FeedbackMatrix matrix, uint32_t lines,
+									  uint32_t seed = 1);
+
+	/**
+	 * @brief Sizes the network and restarts it from silence.
+	 *
+	 * @param lines Rounded up to a power of two within MinLines and
+	 * MaxLines, and to at least one packet.
+	 * @param size Scales the delay lengths, and with them the room.
+	 * @param dense Multiplies by the matrix even when it has a fast
+	 * transform, the baseline for benchmarks.
+	 */
+	void Prepare(MemoryArena* memory, uint32_t lines, FeedbackMatrix matrix,
+				 float sampleRate, uint32_t channels, float size = 1.0f,
+				 bool dense = false);
+
+	/**
+	 * @brief Sets the 60 dB decay time in seconds and @p damping, 0-1, how
+	 * much shorter it is at high frequencies.
+	 */
+	void SetDecay(float seconds, float damping);
+
+	/**
+	 * @brief Runs @p frames frames of each of @p channels channels, at most
+	 * the prepared count, and writes @p wet times the reverb plus @p dry
+	 * times the input. Inputs and outputs are read and written up to the
+	 * next whole packet, as graph buffers allow.
+	 */
+	void Process(const float* const* inputs, float* const* outputs,
+				 uint32_t channels, uint32_t frames, float dry, float wet);
+
+	[[nodiscard]] uint32_t GetLines() const { return m_Lines; }
+	/** @brief Delay of line @p line in samples. */
+	[[nodiscard]] uint32_t GetLength(const uint32_t line) const
+	{
+		return m_Lengths[line];
+	}
+
+private:
+	/** @brief Copies the next @p frames samples of every line into m_Taps. */
+	void ReadLines(uint32_t frames);
+	/** @brief Runs the loss filters over m_Taps in place. */
+	void Damp(uint32_t frames);
+	/** @brief m_Feedback = the matrix times m_Taps, @p packets columns. */
+	void Mix(uint32_t packets);
+	void MixDense(uint32_t packets);
+	/** @brief Writes m_Feedback over what ReadLines() read, and advances. */
+	void WriteLines(uint32_t frames);
+
+private:
+	uint32_t m_Lines = 0;
+	uint32_t m_Channels = 0;
+	FeedbackMatrix m_Matrix = FeedbackMatrix::Hadamard;
+	/** @brief Mixes with MixDense(), not a fast transform. */
+	bool m_Dense = false;
+	float m_SampleRate = 48000.0f;
+
+	/** @brief Every line end to end, line i from m_Offsets[i]. */
+	ArenaArray<float> m_Memory;
+	ArenaArray<uint32_t> m_Offsets;
+	ArenaArray<uint32_t> m_Lengths;
+	/** @brief Next sample to read, and then overwrite, per line. */
+	ArenaArray<uint32_t> m_Positions;
+
+	/** @brief Loss filter y = Pole y + Gain x per line, see SetDecay(). */
+	ArenaArray<float> m_Pole;
+	ArenaArray<float> m_Gain;
+	ArenaArray<float> m_State;
+	/** @brief Row-major matrix, for the dense product only. */
+	ArenaArray<float> m_Coefficients;
+	/** @brief +-1 per line, the input channel's sign. */
+	ArenaArray<float> m_InputSigns;
+	/** @brief Per output channel and line, a signed Hadamard row. */
+	ArenaArray<float> m_OutputSigns;
+
+	/** @brief Line outputs of the chunk, Chunk floats per line. */
+	ArenaArray<float> m_Taps;
+	/** @brief Line inputs of the chunk, likewise. */
+	ArenaArray<float> m_Feedback;
+};
+}
@@ -0,0 +1,253 @@
+﻿#include "FmAlgorithm.hpp"
+
+#include <algorithm>
+#include <numbers>
+
+
+namespace
+{
+constexpr uint32_t Unvisited = 0xFFFFFFFF;
+
+/**
+ * @brief Tarjan's strongly connected components over the live operators.
+ *
+ * An edge runs from a modulator to the operator it modulates. Components
+ * come out sinks first, the reverse of a topological order.
+ */
+class ComponentFinder
+{
+public:
+	ComponentFinder(const Eigen::MatrixXf& modulation,
+					const std::vector<bool>& live) :
+		m_Modulation(modulation),
+		m_Live(live),
+		m_Index(live.size(), Unvisited),
+		m_LowLink(live.size(), 0),
+		m_OnStack(live.size(), false) {}
+
+	std::vector<std::vector<uint32_t>> Run()
+	{
+		for (uint32_t op = 0; op < m_Live.size(); op++)
+		{
+			if (m_Live[op] && m_Index[op] == Unvisited)
+				Visit(op);
+		}
+		return std::move(m_Components);
+	}
+
+private:
+	void Visit(const uint32_t op)
+	{
+		m_Index[op] = m_LowLink[op] = m_Next++;
+		m_Stack.push_back(op);
+		m_OnStack[op] = true;
+
+		for (uint32_t target = 0; target < m_Live.size(); target++)
+		{
+			if (target == op || !m_Live[target] ||
+				m_Modulation(target, op) == 0.0f)
+				continue;
+			if (m_Index[target] == Unvisited)
+			{
+				Visit(target);
+				m_LowLink[op] = std::min(m_LowLink[op], m_LowLink[target]);
+			}
+			else if (m_OnStack[target])
+				m_LowLink[op] = std::min(m_LowLink[op], m_Index[target]);
+		}
+
+		if (m_LowLink[op] != m_Index[op])
+			return;
+		std::vector<uint32_t> component;
+		uint32_t member;
+		do
+		{
+			member = m_Stack.back();
+			m_Stack.pop_back();
+			m_OnStack[member] = false;
+			component.push_back(member);
+		}
+		while (member != op);
+		std::sort(component.begin(), component.end());
+		m_Components.push_back(std::move(component));
+	}
+
+private:
+	const Eigen::MatrixXf& m_Modulation;
+	const std::vector<bool>& m_Live;
+	std::vector<uint32_t> m_Index;
+	std::vector<uint32_t> m_LowLink;
+	std::vector<bool> m_OnStack;
+	std::vector<uint32_t> m_Stack;
+	uint32_t m_Next = 0;
+	std::vector<std::vector<uint32_t>> m_Components;
+};
+
+MT::DSP::FmPatch MakePatch(std::string name, const uint32_t operators,
+						   std::initializer_list<float> ratios,
+						   std::initializer_list<float> output)
+{
+	MT::DSP::FmPatch patch;
+	patch.Name = std::move(name);
+	patch.Modulation = Eigen::MatrixXf::Zero(operators, operators);
+	patch.Ratios = Eigen::Map<const Eigen::VectorXf>(ratios.begin(),
+													 operators);
+	patch.Output = Eigen::Map<const Eigen::VectorXf>(output.begin(),
+													 operators);
+	return patch;
+}
+}
+
+
+std::vector<MT::DSP::FmPatch> MT::DSP::FmPatch::MakePresets()
+{
+	std::vector<FmPatch> presets;
+
+	// Modulation(i, j): operator j modulates operator i.
+	FmPatch stack = MakePatch("Stack", 4, {1.0f, 1.0f, 2.0f, 3.0f},
+							  {1.0f, 0.0f, 0.0f, 0.0f});
+	stack.Modulation(0, 1) = 1.5f;
+	stack.Modulation(1, 2) = 1.2f;
+	stack.Modulation(2, 3) = 0.8f;
+	stack.Modulation(3, 3) = 0.6f;
+	presets.push_back(std::move(stack));
+
+	FmPatch piano = MakePatch("Electric piano", 4, {1.0f, 14.0f, 1.0f, 1.0f},
+							  {0.5f, 0.0f, 0.5f, 0.0f});
+	piano.Modulation(0, 1) = 0.7f;
+	piano.Modulation(2, 3) = 1.2f;
+	piano.Modulation(3, 3) = 0.4f;
+	presets.push_back(std::move(piano));
+
+	FmPatch brass = MakePatch("Brass", 4, {1.0f, 1.0f, 2.0f, 3.0f},
+							  {1.0f, 0.0f, 0.0f, 0.0f});
+	brass.Modulation(0, 1) = 1.8f;
+	brass.Modulation(0, 2) = 1.0f;
+	brass.Modulation(0, 3) = 0.5f;
+	brass.Modulation(1, 1) = 0.9f;
+	presets.push_back(std::move(brass));
+
+	FmPatch organ = MakePatch("Organ", 4, {0.5f, 1.0f, 2.0f, 3.0f},
+							  {0.4f, 0.3f, 0.2f, 0.1f});
+	organ.Modulation(3, 3) = 0.3f;
+	presets.push_back(std::move(organ));
+
+	// Cross feedback: 0 -> 1 -> 2 -> 0.
+	FmPatch ring = MakePatch("Feedback ring", 3, {1.0f, 1.5f, 2.0f},
+							 {1.0f, 0.0f, 0.0f});
+	ring.Modulation(1, 0) = 0.8f;
+	ring.Modulation(2, 1) = 0.8f;
+	ring.Modulation(0, 2) = 0.8f;
+	presets.push_back(std::move(ring));
+
+	FmPatch bell = MakePatch(
+		"Eight operator bell", 8,
+		{1.0f, 3.5f, 7.1f, 1.0f, 2.0f, 5.19f, 0.5f, 1.41f},
+		{0.35f, 0.0f, 0.0f, 0.35f, 0.0f, 0.0f, 0.3f, 0.0f});
+	bell.Modulation(0, 1) = 2.0f;
+	bell.Modulation(1, 2) = 1.0f;
+	bell.Modulation(3, 4) = 1.5f;
+	bell.Modulation(3, 5) = 0.8f;
+	bell.Modulation(4, 5) = 0.6f;
+	bell.Modulation(6, 7) = 1.2f;
+	bell.Modulation(7, 7) = 0.5f;
+	bell.Modulation(1, 7) = 0.4f;
+	presets.push_back(std::move(bell));
+
+	return presets;
+}
+
+std::shared_ptr<const MT::DSP::FmAlgorithm> MT::DSP::FmAlgorithm::Compile(
+	const FmPatch& patch, std::string* error)
+{
+	const auto fail = [error](const char* message)
+	{
+		if (error)
+			*error = message;
+		return nullptr;
+	};
+
+	const auto count = static_cast<uint32_t>(patch.Modulation.rows());
+	if (count == 0 || count > FmPatch::MaxOperators ||
+		patch.Modulation.cols() != count || patch.Output.size() != count ||
+		patch.Ratios.size() != count)
+		return fail("An FM patch needs 1-8 operators and matching sizes.");
+	if (!patch.Modulation.allFinite() || !patch.Output.allFinite() ||
+		!patch.Ratios.allFinite())
+		return fail("An FM patch must only contain finite values.");
+
+	// Live operators: the carriers and whatever modulates a live operator.
+	std::vector<bool> live(count, false);
+	std::vector<uint32_t> pending;
+	for (uint32_t op = 0; op < count; op++)
+	{
+		if (patch.Output(op) != 0.0f)
+		{
+			live[op] = true;
+			pending.push_back(op);
+		}
+	}
+	if (pending.empty())
+		return fail("No operator of the FM patch reaches the output.");
+	while (!pending.empty())
+	{
+		const uint32_t target = pending.back();
+		pending.pop_back();
+		for (uint32_t source = 0; source < count; source++)
+		{
+			if (!live[source] && patch.Modulation(target, source) != 0.0f)
+			{
+				live[source] = true;
+				pending.push_back(source);
+			}
+		}
+	}
+
+	std::vector<std::vector<uint32_t>> components =
+		ComponentFinder(patch.Modulation, live).Run();
+	std::reverse(components.begin(), components.end());
+
+	auto algorithm = std::shared_ptr<FmAlgorithm>(new FmAlgorithm());
+	algorithm->m_Name = patch.Name;
+	algorithm->m_Operators.resize(count);
+	for (uint32_t op = 0; op < count; op++)
+	{
+		Operator& entry = algorithm->m_Operators[op];
+		entry.Ratio = patch.Ratios(op);
+		entry.Output = patch.Output(op);
+	}
+
+	// Step of every live operator; inputs from the operator's own step are
+	// on a loop and read the previous frame.
+	constexpr float CyclesPerRadian = 0.5f / std::numbers::pi_v<float>;
+	std::vector<uint32_t> stepOf(count, Unvisited);
+	for (const std::vector<uint32_t>& component : components)
+	{
+		for (const uint32_t op : component)
+			stepOf[op] = static_cast<uint32_t>(algorithm->m_Steps.size());
+		algorithm->m_Steps.push_back({
+			static_cast<uint32_t>(algorithm->m_Order.size()),
+			static_cast<uint32_t>(component.size())});
+		algorithm->m_Order.insert(algorithm->m_Order.end(), component.begin(),
+								  component.end());
+	}
+	for (const uint32_t op : algorithm->m_Order)
+	{
+		Operator& entry = algorithm->m_Operators[op];
+		entry.Feedback = patch.Modulation(op, op) * CyclesPerRadian;
+		entry.FirstTerm = static_cast<uint32_t>(algorithm->m_Terms.size());
+		for (const uint32_t source : algorithm->m_Order)
+		{
+			const float depth = patch.Modulation(op, source);
+			if (source == op || depth == 0.0f)
+				continue;
+			algorithm->m_Terms.push_back({source, depth * CyclesPerRadian,
+										  stepOf[source] == stepOf[op]});
+		}
+		entry.TermCount = static_cast<uint32_t>(algorithm->m_Terms.size()) -
+			entry.FirstTerm;
+		if (entry.Output != 0.0f)
+			algorithm->m_Carriers.push_back(op);
+	}
+	return algorithm;
+}
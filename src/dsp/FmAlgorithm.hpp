@@ -0,0 +1,122 @@
+﻿#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace MT::DSP
+{
+/** @brief Operator routing of an FM voice, as the patch author writes it. */
+struct FmPatch
+{
+	static constexpr uint32_t MaxOperators = 8;
+
+	std::string Name;
+	/**
+	 * @brief Modulation(i, j) is the peak phase deviation in radians that
+	 * operator j adds to operator i. The diagonal is self feedback; any
+	 * other entry that closes a loop is cross feedback.
+	 */
+	Eigen::MatrixXf Modulation;
+	/** @brief Level of each operator in the voice output, 0 if silent. */
+	Eigen::VectorXf Output;
+	/** @brief Frequency of each operator over the note frequency. */
+	Eigen::VectorXf Ratios;
+
+	/** @brief Stacks, branches, parallel carriers and feedback loops. */
+	static std::vector<FmPatch> MakePresets();
+};
+
+/**
+ * @brief An @ref FmPatch compiled into the order its operators are
+ * evaluated in, immutable.
+ *
+ * The modulation matrix is split into strongly connected components and
+ * put in topological order, and operators that do not reach the output
+ * are dropped. Each surviving operator keeps a list of its nonzero inputs,
+ * so the voice loop only visits the connections that exist instead of
+ * multiplying by the whole matrix.
+ *
+ * An operator outside any loop depends only on operators evaluated before
+ * it and is rendered for a whole chunk of frames at once. Self feedback is
+ * still a single-operator step. Operators on a longer loop form one step
+ * that is evaluated frame by frame, and every connection inside the loop
+ * reads the previous frame, as on a DX pipeline. That costs one sample of
+ * delay per connection but leaves the operators of a frame independent, so
+ * their sines overlap instead of waiting on each other.
+ */
+class FmAlgorithm
+{
+public:
+	/** @brief One nonzero input of an operator. */
+	struct Term
+	{
+		uint32_t Source;
+		/** @brief Peak deviation in cycles. */
+		float Depth;
+		/** @brief Reads the source's previous frame; both are on one loop. */
+		bool Delayed;
+	};
+
+	/** @brief Operators evaluated together, in order. */
+	struct Step
+	{
+		/** @brief Range in GetOrder(). */
+		uint32_t First;
+		uint32_t Count;
+	};
+
+	struct Operator
+	{
+		float Ratio = 1.0f;
+		/** @brief Level in the voice output, 0 for pure modulators. */
+		float Output = 0.0f;
+		/** @brief Self feedback in cycles, applied to the mean of the last
+		 * two outputs, which keeps high settings from turning to noise. */
+		float Feedback = 0.0f;
+		/** @brief Range of the operator's inputs in GetTerms(). */
+		uint32_t FirstTerm = 0;
+		uint32_t TermCount = 0;
+	};
+
+	/**
+	 * @param error Receives a description of the problem on failure.
+	 * @return nullptr if the sizes disagree, there are more than
+	 * MaxOperators, a value is not finite, or nothing reaches the output.
+	 */
+	static std::shared_ptr<const FmAlgorithm> Compile(
+		const FmPatch& patch, std::string* error = nullptr);
+
+	[[nodiscard]] const std::string& GetName() const { return m_Name; }
+	[[nodiscard]] const std::vector<Step>& GetSteps() const { return m_Steps; }
+	/** @brief Operator indices of all steps, back to back. */
+	[[nodiscard]] const std::vector<uint32_t>& GetOrder() const
+	{
+		return m_Order;
+	}
+	[[nodiscard]] const std::vector<Term>& GetTerms() const { return m_Terms; }
+	/** @brief Every operator of the patch, dropped ones included. */
+	[[nodiscard]] const std::vector<Operator>& GetOperators() const
+	{
+		return m_Operators;
+	}
+	/** @brief Operators with a nonzero output level, in evaluation order. */
+	[[nodiscard]] const std::vector<uint32_t>& GetCarriers() const
+	{
+		return m_Carriers;
+	}
+
+private:
+	FmAlgorithm() = default;
+
+private:
+	std::string m_Name;
+	std::vector<Step> m_Steps;
+	std::vector<uint32_t> m_Order;
+	std::vector<Term> m_Terms;
+	std::vector<Operator> m_Operators;
+	std::vector<uint32_t> m_Carriers;
+};
+}
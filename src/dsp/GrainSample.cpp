@@ -0,0 +1,73 @@
+﻿#include "GrainSample.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <utility>
+
+#include "Random.hpp"
+
+
+MT::DSP::GrainSample::GrainSample(std::vector<float> samples,
+								  const float sampleRate) :
+	m_Samples(std::move(samples)),
+	m_Length(static_cast<uint32_t>(m_Samples.size())),
+	m_SampleRate(sampleRate)
+{
+	m_Samples.push_back(m_Samples.front());
+}
+
+std::shared_ptr<const MT::DSP::GrainSample> MT::DSP::GrainSample::Create(
+	std::vector<float> samples, const float sampleRate)
+{
+	if (samples.empty() || !(sampleRate > 0.0f))
+		return nullptr;
+	return std::shared_ptr<const GrainSample>(
+		new GrainSample(std::move(samples), sampleRate));
+}
+
+std::shared_ptr<const MT::DSP::GrainSample>
+MT::DSP::GrainSample::MakeDroplets(const float sampleRate, const float seconds,
+								   const uint32_t seed)
+{
+	const auto length = static_cast<uint32_t>(
+		std::max(seconds, 0.1f) * sampleRate);
+	std::vector<float> samples(length, 0.0f);
+
+	// A drop is a small bubble ringing up in pitch as it closes.
+	Xorshift32 random(seed);
+	const auto drops = static_cast<uint32_t>(seconds * 12.0f) + 1;
+	for (uint32_t drop = 0; drop < drops; drop++)
+	{
+		const auto start = static_cast<uint32_t>(
+			random.NextUnipolar() * static_cast<float>(length));
+		const float frequency = 600.0f * std::exp2(3.0f *
+			random.NextUnipolar());
+		const float rise = 1.0f + 2.0f * random.NextUnipolar();
+		const float decay = 0.01f + 0.04f * random.NextUnipolar();
+		const float level = 0.2f + 0.8f * random.NextUnipolar();
+		const auto frames = static_cast<uint32_t>(6.0f * decay * sampleRate);
+
+		float phase = 0.0f;
+		for (uint32_t i = 0; i < frames; i++)
+		{
+			const float t = static_cast<float>(i) / sampleRate;
+			const float envelope = std::exp(-t / decay);
+			phase += frequency * (1.0f + rise * t / (6.0f * decay)) /
+				sampleRate;
+			phase -= std::floor(phase);
+			samples[(start + i) % length] += level * envelope *
+				std::sin(2.0f * std::numbers::pi_v<float> * phase);
+		}
+	}
+
+	float peak = 0.0f;
+	for (const float sample : samples)
+		peak = std::max(peak, std::abs(sample));
+	if (peak > 0.0f)
+	{
+		for (float& sample : samples)
+			sample *= 0.9f / peak;
+	}
+	return Create(std::move(samples), sampleRate);
+}
@@ -0,0 +1,42 @@
+﻿#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace MT::DSP
+{
+/**
+ * @brief Mono recording a @ref GranularNode reads grains from, immutable.
+ *
+ * One guard sample past the end repeats the first, so grains interpolate
+ * across the loop point without a bounds check.
+ */
+class GrainSample
+{
+public:
+	/** @param samples At least one sample, at @p sampleRate. */
+	static std::shared_ptr<const GrainSample> Create(
+		std::vector<float> samples, float sampleRate);
+
+	/**
+	 * @brief Procedural water drops: short sine chirps rising in pitch with
+	 * an exponential decay, scattered at random over @p seconds.
+	 */
+	static std::shared_ptr<const GrainSample> MakeDroplets(
+		float sampleRate, float seconds = 4.0f, uint32_t seed = 1);
+
+	/** @brief Samples without the guard. */
+	[[nodiscard]] uint32_t GetLength() const { return m_Length; }
+	[[nodiscard]] float GetSampleRate() const { return m_SampleRate; }
+	/** @brief GetLength() + 1 samples. */
+	[[nodiscard]] const float* GetData() const { return m_Samples.data(); }
+
+private:
+	GrainSample(std::vector<float> samples, float sampleRate);
+
+private:
+	std::vector<float> m_Samples;
+	uint32_t m_Length;
+	float m_SampleRate;
+};
+}
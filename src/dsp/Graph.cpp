@@ -0,0 +1,58 @@
+﻿#include "Graph.hpp"
+
+#include <algorithm>
+
+
+MT::DSP::NodeId MT::DSP::Graph::AddNode(std::shared_ptr<Node> node)
+{
+	// Ids stay stable, so removed slots are never reused.
+	m_Nodes.push_back({std::move(node), {}});
+	return static_cast<NodeId>(m_Nodes.size() - 1);
+}
+
+void MT::DSP::Graph::RemoveNode(const NodeId id)
+{
+	if (!Contains(id))
+		return;
+
+	m_Nodes[id].Processor.reset();
+	m_Nodes[id].Inputs.clear();
+	for (Entry& entry : m_Nodes)
+		std::erase(entry.Inputs, id);
+	if (m_Output == id)
+		m_Output = InvalidNode;
+}
+
+bool MT::DSP::Graph::Connect(const NodeId source, const NodeId destination)
+{
+	if (!Contains(source) || !Contains(destination) || source == destination)
+		return false;
+
+	std::vector<NodeId>& inputs = m_Nodes[destination].Inputs;
+	if (inputs.size() >= m_Nodes[destination].Processor->GetMaxInputs())
+		return false;
+
+	inputs.push_back(source);
+	return true;
+}
+
+void MT::DSP::Graph::Disconnect(const NodeId source, const NodeId destination)
+{
+	if (!Contains(destination))
+		return;
+
+	std::vector<NodeId>& inputs = m_Nodes[destination].Inputs;
+	const auto it = std::find(inputs.begin(), inputs.end(), source);
+	if (it != inputs.end())
+		inputs.erase(it);
+}
+
+bool MT::DSP::Graph::Contains(const NodeId id) const
+{
+	return id < m_Nodes.size() && m_Nodes[id].Processor;
+}
+
+MT::DSP::Node* MT::DSP::Graph::GetNode(const NodeId id) const
+{
+	return Contains(id) ? m_Nodes[id].Processor.get() : nullptr;
+}
@@ -0,0 +1,70 @@
+﻿#pragma once
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "Node.hpp"
+
+namespace MT::DSP
+{
+/**
+ * @brief Editable description of a patch, owned by the control thread.
+ *
+ * Nodes are addressed by the id returned when adding them. The graph is
+ * never processed directly; it is turned into a @ref CompiledGraph whose
+ * schedule the audio thread walks.
+ */
+class Graph
+{
+public:
+	/** @brief Constructs a node of type @p T in place and adds it. */
+	template<typename T, typename... Args>
+	NodeId Add(Args&&... args)
+	{
+		return AddNode(std::make_shared<T>(std::forward<Args>(args)...));
+	}
+
+	NodeId AddNode(std::shared_ptr<Node> node);
+	/** @brief Removes a node and every connection touching it. */
+	void RemoveNode(NodeId id);
+
+	/**
+	 * @brief Feeds the output of @p source into the next free input of
+	 * @p destination.
+	 * @return false if either node is missing or @p destination is full.
+	 */
+	bool Connect(NodeId source, NodeId destination);
+	void Disconnect(NodeId source, NodeId destination);
+
+	/** @brief Selects the node whose output is sent to the device. */
+	void SetOutput(const NodeId id) { m_Output = id; }
+	[[nodiscard]] NodeId GetOutput() const { return m_Output; }
+
+	[[nodiscard]] bool Contains(NodeId id) const;
+	[[nodiscard]] Node* GetNode(NodeId id) const;
+	/** @brief Shared handle, kept alive by every graph compiled from this one. */
+	[[nodiscard]] const std::shared_ptr<Node>& GetNodeHandle(NodeId id) const
+	{
+		return m_Nodes[id].Processor;
+	}
+	[[nodiscard]] const std::vector<NodeId>& GetInputs(const NodeId id) const
+	{
+		return m_Nodes[id].Inputs;
+	}
+	/** @brief Upper bound (exclusive) of the node ids in use. */
+	[[nodiscard]] NodeId GetIdLimit() const
+	{
+		return static_cast<NodeId>(m_Nodes.size());
+	}
+
+private:
+	struct Entry
+	{
+		std::shared_ptr<Node> Processor;
+		std::vector<NodeId> Inputs;
+	};
+
+	std::vector<Entry> m_Nodes;
+	NodeId m_Output = InvalidNode;
+};
+}
@@ -0,0 +1,102 @@
+﻿#include "ImpulseResponse.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <utility>
+
+#include "Random.hpp"
+
+
+MT::DSP::ImpulseResponse::ImpulseResponse(
+	std::vector<std::vector<float>> channels, const float sampleRate) :
+	m_Channels(std::move(channels)), m_SampleRate(sampleRate)
+{
+	for (const std::vector<float>& channel : m_Channels)
+	{
+		m_Length = std::max(m_Length,
+							static_cast<uint32_t>(channel.size()));
+	}
+	for (std::vector<float>& channel : m_Channels)
+		channel.resize(m_Length, 0.0f);
+}
+
+std::shared_ptr<const MT::DSP::ImpulseResponse>
+MT::DSP::ImpulseResponse::Create(std::vector<std::vector<float>> channels,
+								 const float sampleRate)
+{
+	if (channels.empty() || !(sampleRate > 0.0f))
+		return nullptr;
+	return std::shared_ptr<const ImpulseResponse>(
+		new ImpulseResponse(std::move(channels), sampleRate));
+}
+
+std::shared_ptr<const MT::DSP::ImpulseResponse>
+MT::DSP::ImpulseResponse::MakeRoom(const float sampleRate,
+								   const float seconds,
+								   const uint32_t channels,
+								   const float damping, const uint32_t seed)
+{
+	const auto length = static_cast<uint32_t>(
+		std::max(seconds, 0.01f) * sampleRate);
+	const float fade = 0.005f * sampleRate;
+	// 60 dB over the length, the cutoff falling by up to 8 octaves.
+	const float decay = std::log(1000.0f) / static_cast<float>(length);
+	const float fall = 8.0f * std::clamp(damping, 0.0f, 1.0f) /
+		static_cast<float>(length);
+
+	std::vector<std::vector<float>> data(std::max(channels, 1u));
+	for (uint32_t channel = 0; channel < data.size(); channel++)
+	{
+		std::vector<float>& samples = data[channel];
+		samples.resize(length);
+		Xorshift32 random(seed * 7919u + channel);
+		float low = 0.0f;
+		double energy = 0.0;
+		for (uint32_t i = 0; i < length; i++)
+		{
+			const auto t = static_cast<float>(i);
+			const float cutoff = std::min(
+				20000.0f * std::exp2(-fall * t), 0.45f * sampleRate);
+			const float coefficient = 1.0f - std::exp(
+				-2.0f * std::numbers::pi_v<float> * cutoff / sampleRate);
+			low += coefficient * (random.NextBipolar() - low);
+			samples[i] = low * std::exp(-decay * t) * std::min(t / fade, 1.0f);
+			energy += static_cast<double>(samples[i]) * samples[i];
+		}
+		if (energy > 0.0)
+		{
+			const auto scale = static_cast<float>(1.0 / std::sqrt(energy));
+			for (float& sample : samples)
+				sample *= scale;
+		}
+	}
+	return Create(std::move(data), sampleRate);
+}
+
+std::vector<float> MT::DSP::ImpulseResponse::Resample(
+	const uint32_t channel, const float sampleRate) const
+{
+	const std::vector<float>& source = m_Channels[channel];
+	if (sampleRate == m_SampleRate || m_Length == 0)
+		return source;
+
+	const double step = static_cast<double>(m_SampleRate) / sampleRate;
+	const auto length = static_cast<uint32_t>(
+		static_cast<double>(m_Length) / step);
+	std::vector<float> samples(std::max(length, 1u));
+	for (uint32_t i = 0; i < samples.size(); i++)
+	{
+		const double position = static_cast<double>(i) * step;
+		const auto index = static_cast<uint32_t>(position);
+		const auto fraction = static_cast<float>(position - index);
+		const float next = index + 1 < m_Length ? source[index + 1] : 0.0f;
+		samples[i] = source[std::min(index, m_Length - 1)] +
+			fraction * (next - source[std::min(index, m_Length - 1)]);
+	}
+	// Keeps the energy, as a denser response sums more taps.
+	const float scale = static_cast<float>(std::sqrt(step));
+	for (float& sample : samples)
+		sample *= scale;
+	return samples;
+}
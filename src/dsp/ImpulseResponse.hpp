@@ -0,0 +1,61 @@
+﻿#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace MT::DSP
+{
+/**
+ * @brief Impulse response a @ref ConvolutionNode plays, immutable.
+ *
+ * One or more channels of equal length; a convolver feeds channel c of
+ * its signal through channel c modulo GetChannels().
+ */
+class ImpulseResponse
+{
+public:
+	/**
+	 * @param channels At least one channel, shorter ones are padded with
+	 * silence, at @p sampleRate.
+	 */
+	static std::shared_ptr<const ImpulseResponse> Create(
+		std::vector<std::vector<float>> channels, float sampleRate);
+
+	/**
+	 * @brief Procedural room: noise decaying by 60 dB over @p seconds, its
+	 * highs dying faster with more @p damping (0-1), every channel
+	 * decorrelated. Normalized to unit energy per channel, so the wet
+	 * signal keeps the level of a noisy input.
+	 */
+	static std::shared_ptr<const ImpulseResponse> MakeRoom(
+		float sampleRate, float seconds, uint32_t channels = 2,
+		float damping = 0.5f, uint32_t seed = 1);
+
+	[[nodiscard]] uint32_t GetChannels() const
+	{
+		return static_cast<uint32_t>(m_Channels.size());
+	}
+	[[nodiscard]] uint32_t GetLength() const { return m_Length; }
+	[[nodiscard]] float GetSampleRate() const { return m_SampleRate; }
+	[[nodiscard]] const float* GetData(const uint32_t channel) const
+	{
+		return m_Channels[channel].data();
+	}
+
+	/**
+	 * @brief Channel @p channel at @p sampleRate, linearly interpolated, or
+	 * copied when the rates match.
+	 */
+	[[nodiscard]] std::vector<float> Resample(uint32_t channel,
+											  float sampleRate) const;
+
+private:
+	ImpulseResponse(std::vector<std::vector<float>> channels,
+					float sampleRate);
+
+private:
+	std::vector<std::vector<float>> m_Channels;
+	uint32_t m_Length = 0;
+	float m_SampleRate;
+};
+}
@@ -0,0 +1,66 @@
+﻿#include "MemoryArena.hpp"
+
+#include <algorithm>
+#include <bit>
+
+
+MT::DSP::MemoryArena::MemoryArena(const size_t chunkBytes) :
+	m_ChunkBytes(std::max(chunkBytes, BlockAlignment)) {}
+
+MT::DSP::MemoryArena::~MemoryArena() = default;
+
+void* MT::DSP::MemoryArena::Allocate(const size_t bytes)
+{
+	const size_t sizeClass = SizeClass(bytes);
+	const size_t blockBytes = size_t{1} << sizeClass;
+	m_UsedBytes += blockBytes;
+
+	if (FreeBlock* block = m_FreeLists[sizeClass])
+	{
+		m_FreeLists[sizeClass] = block->Next;
+		return block;
+	}
+
+	// Blocks larger than a chunk get a chunk of their own, the current one
+	// keeps serving small requests.
+	if (blockBytes > m_ChunkBytes)
+		return NewChunk(blockBytes);
+
+	// Every block is a multiple of the alignment, so the cursor stays
+	// aligned. The tail of a full chunk is abandoned.
+	if (static_cast<size_t>(m_End - m_Cursor) < blockBytes)
+	{
+		m_Cursor = NewChunk(m_ChunkBytes);
+		m_End = m_Cursor + m_ChunkBytes;
+	}
+	std::byte* block = m_Cursor;
+	m_Cursor += blockBytes;
+	return block;
+}
+
+void MT::DSP::MemoryArena::Release(void* block, const size_t bytes)
+{
+	if (!block)
+		return;
+
+	const size_t sizeClass = SizeClass(bytes);
+	m_UsedBytes -= size_t{1} << sizeClass;
+	auto* freeBlock = static_cast<FreeBlock*>(block);
+	freeBlock->Next = m_FreeLists[sizeClass];
+	m_FreeLists[sizeClass] = freeBlock;
+}
+
+size_t MT::DSP::MemoryArena::SizeClass(const size_t bytes)
+{
+	return static_cast<size_t>(std::bit_width(
+		std::max(bytes, BlockAlignment) - 1));
+}
+
+std::byte* MT::DSP::MemoryArena::NewChunk(const size_t bytes)
+{
+	auto* memory = static_cast<std::byte*>(::operator new(
+		bytes, std::align_val_t{BlockAlignment}));
+	m_Chunks.emplace_back(memory);
+	m_ReservedBytes += bytes;
+	return memory;
+}
@@ -0,0 +1,169 @@
+﻿#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace MT::DSP
+{
+/**
+ * @brief Pool that node state, delay lines and scratch buffers are carved
+ * out of.
+ *
+ * Memory is reserved in large chunks and handed out in power-of-two blocks
+ * aligned to a cache line. Released blocks go onto a free list per size and
+ * are reused by the next allocation of that size; chunks are only given back
+ * when the arena is destroyed. All allocation happens on the control thread
+ * while nodes are prepared, so the audio thread only ever touches memory it
+ * was given up front and never reaches the system allocator.
+ *
+ * Not thread safe: allocate and release from the control thread only.
+ */
+class MemoryArena
+{
+public:
+	static constexpr size_t DefaultChunkBytes = size_t{4} << 20;
+	/** @brief Smallest block, also the alignment of every block. */
+	static constexpr size_t BlockAlignment = 64;
+
+	explicit MemoryArena(size_t chunkBytes = DefaultChunkBytes);
+	~MemoryArena();
+
+	MemoryArena(const MemoryArena&) = delete;
+	MemoryArena& operator=(const MemoryArena&) = delete;
+
+	/** @brief Returns at least @p bytes, aligned to BlockAlignment. */
+	void* Allocate(size_t bytes);
+	/** @brief Hands back a block; @p bytes must match the allocation. */
+	void Release(void* block, size_t bytes);
+
+	/** @brief Bytes reserved from the system. */
+	[[nodiscard]] size_t GetReservedBytes() const { return m_ReservedBytes; }
+	/** @brief Bytes in blocks currently handed out, rounded to block sizes. */
+	[[nodiscard]] size_t GetUsedBytes() const { return m_UsedBytes; }
+
+private:
+	struct FreeBlock
+	{
+		FreeBlock* Next;
+	};
+
+	struct ChunkDeleter
+	{
+		void operator()(std::byte* chunk) const
+		{
+			::operator delete(chunk, std::align_val_t{BlockAlignment});
+		}
+	};
+	using Chunk = std::unique_ptr<std::byte[], ChunkDeleter>;
+
+	static size_t SizeClass(size_t bytes);
+	std::byte* NewChunk(size_t bytes);
+
+private:
+	size_t m_ChunkBytes;
+	std::vector<Chunk> m_Chunks;
+	std::byte* m_Cursor = nullptr;
+	std::byte* m_End = nullptr;
+	std::array<FreeBlock*, 64> m_FreeLists{};
+
+	size_t m_ReservedBytes = 0;
+	size_t m_UsedBytes = 0;
+};
+
+
+/**
+ * @brief Fixed-size array living in a @ref MemoryArena.
+ *
+ * Sized on the control thread with Allocate() and then used like a plain
+ * array on the audio thread. Without an arena it falls back to the heap,
+ * so nodes also work outside an engine.
+ */
+template<typename T>
+class ArenaArray
+{
+	static_assert(alignof(T) <= MemoryArena::BlockAlignment);
+
+public:
+	ArenaArray() = default;
+	~ArenaArray() { Reset(); }
+
+	ArenaArray(ArenaArray&& other) noexcept :
+		m_Data(std::exchange(other.m_Data, nullptr)),
+		m_Size(std::exchange(other.m_Size, 0)),
+		m_Arena(std::exchange(other.m_Arena, nullptr)) {}
+
+	ArenaArray& operator=(ArenaArray&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Reset();
+			m_Data = std::exchange(other.m_Data, nullptr);
+			m_Size = std::exchange(other.m_Size, 0);
+			m_Arena = std::exchange(other.m_Arena, nullptr);
+		}
+		return *this;
+	}
+
+	/**
+	 * @brief Replaces the contents with @p count value-initialized elements
+	 * taken from @p arena, or from the heap if @p arena is nullptr.
+	 */
+	void Allocate(MemoryArena* arena, const size_t count)
+	{
+		Reset();
+		if (count == 0)
+			return;
+
+		const size_t bytes = count * sizeof(T);
+		void* memory = arena
+			? arena->Allocate(bytes)
+			: ::operator new(bytes,
+							 std::align_val_t{MemoryArena::BlockAlignment});
+		m_Data = static_cast<T*>(memory);
+		m_Size = count;
+		m_Arena = arena;
+		for (size_t i = 0; i < count; i++)
+			new (m_Data + i) T();
+	}
+
+	/** @brief Destroys the elements and gives the memory back. */
+	void Reset()
+	{
+		if (!m_Data)
+			return;
+
+		std::destroy_n(m_Data, m_Size);
+		if (m_Arena)
+			m_Arena->Release(m_Data, m_Size * sizeof(T));
+		else
+		{
+			::operator delete(m_Data,
+							  std::align_val_t{MemoryArena::BlockAlignment});
+		}
+		m_Data = nullptr;
+		m_Size = 0;
+		m_Arena = nullptr;
+	}
+
+	void Fill(const T& value) { std::fill_n(m_Data, m_Size, value); }
+
+	[[nodiscard]] T* Data() const { return m_Data; }
+	[[nodiscard]] size_t Size() const { return m_Size; }
+	[[nodiscard]] bool Empty() const { return m_Size == 0; }
+	[[nodiscard]] std::span<T> Span() const { return {m_Data, m_Size}; }
+
+	T& operator[](const size_t index) const { return m_Data[index]; }
+	T* begin() const { return m_Data; }
+	T* end() const { return m_Data + m_Size; }
+
+private:
+	T* m_Data = nullptr;
+	size_t m_Size = 0;
+	MemoryArena* m_Arena = nullptr;
+};
+}
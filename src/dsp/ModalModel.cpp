@@ -0,0 +1,445 @@
+﻿#include "ModalModel.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+#include <Eigen/Eigenvalues>
+
+#include "Simd.hpp"
+
+
+namespace
+{
+constexpr uint32_t CacheMagic = 0x4D4D4150; // "PAMM"
+constexpr uint32_t CacheVersion = 1;
+
+struct CacheHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t ModelCount;
+	uint32_t Width;
+	uint64_t Key;
+};
+
+struct ModelHeader
+{
+	uint32_t ModeCount;
+	uint32_t StrikeCount;
+	uint32_t NameLength;
+	uint32_t Reserved;
+};
+
+/** @brief FNV-1a over the packet width and everything Build() reads. */
+uint64_t HashObjects(const std::vector<MT::DSP::ModalObject>& objects)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	const auto mix = [&hash](const void* data, const size_t bytes)
+	{
+		const auto* bytesIn = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < bytes; i++)
+		{
+			hash ^= bytesIn[i];
+			hash *= 0x100000001b3ull;
+		}
+	};
+	const auto mixVector = [&mix](const auto& values)
+	{
+		const auto size = static_cast<uint64_t>(values.size());
+		mix(&size, sizeof(size));
+		mix(values.data(), values.size() * sizeof(values[0]));
+	};
+
+	const uint32_t width = MT::DSP::Simd::Width;
+	mix(&width, sizeof(width));
+	for (const MT::DSP::ModalObject& object : objects)
+	{
+		mixVector(object.Name);
+		mixVector(object.Masses);
+		const int64_t size[] = {object.Stiffness.rows(),
+								object.Stiffness.cols()};
+		mix(size, sizeof(size));
+		for (Eigen::Index outer = 0; outer < object.Stiffness.outerSize();
+			 outer++)
+		{
+			for (Eigen::SparseMatrix<double>::InnerIterator it(
+					 object.Stiffness, outer); it; ++it)
+			{
+				const int64_t position[] = {it.row(), it.col()};
+				const double value = it.value();
+				mix(position, sizeof(position));
+				mix(&value, sizeof(value));
+			}
+		}
+		const double damping[] = {object.MassDamping,
+								  object.StiffnessDamping};
+		mix(damping, sizeof(damping));
+		mixVector(object.StrikePoints);
+		mixVector(object.Pickups);
+		mix(&object.MaxModes, sizeof(object.MaxModes));
+	}
+	return hash;
+}
+
+uint32_t PadToPackets(const uint32_t count)
+{
+	return (count + MT::DSP::Simd::Width - 1) / MT::DSP::Simd::Width *
+		MT::DSP::Simd::Width;
+}
+}
+
+
+MT::DSP::ModalObject MT::DSP::ModalObject::MakeBar(uint32_t points)
+{
+	points = std::max(points, 8u);
+	ModalObject bar;
+	bar.Name = "Bar";
+	bar.Masses = Eigen::VectorXd::Ones(points);
+	bar.MassDamping = 0.002;
+	bar.StiffnessDamping = 0.0002;
+
+	// Bending energy of each second difference x[i] - 2 x[i + 1] + x[i + 2];
+	// no term holds the ends, so the bar is free.
+	std::vector<Eigen::Triplet<double>> entries;
+	const double weights[] = {1.0, -2.0, 1.0};
+	for (uint32_t i = 0; i + 2 < points; i++)
+	{
+		for (uint32_t a = 0; a < 3; a++)
+		{
+			for (uint32_t b = 0; b < 3; b++)
+				entries.emplace_back(i + a, i + b, weights[a] * weights[b]);
+		}
+	}
+	bar.Stiffness.resize(points, points);
+	bar.Stiffness.setFromTriplets(entries.begin(), entries.end());
+
+	// From the middle, which only excites the symmetric modes, to one end.
+	const uint32_t middle = points / 2;
+	for (uint32_t step = 0; step < 8; step++)
+		bar.StrikePoints.push_back(middle - middle * step / 7);
+	// Two fifths along, clear of the nodes of the lowest modes.
+	bar.Pickups = {points * 2 / 5};
+	return bar;
+}
+
+MT::DSP::ModalObject MT::DSP::ModalObject::MakePlate(uint32_t width,
+													 uint32_t height)
+{
+	width = std::max(width, 4u);
+	height = std::max(height, 4u);
+	const uint32_t count = width * height;
+	ModalObject plate;
+	plate.Name = "Plate";
+	plate.Masses = Eigen::VectorXd::Ones(count);
+	plate.MassDamping = 0.0003;
+	plate.StiffnessDamping = 0.000003;
+
+	// Squared Laplacian with the edges held at zero: a thin plate whose
+	// modes follow (m / width)^2 + (n / height)^2.
+	std::vector<Eigen::Triplet<double>> entries;
+	for (uint32_t y = 0; y < height; y++)
+	{
+		for (uint32_t x = 0; x < width; x++)
+		{
+			const uint32_t node = y * width + x;
+			entries.emplace_back(node, node, -4.0);
+			if (x > 0)
+				entries.emplace_back(node, node - 1, 1.0);
+			if (x + 1 < width)
+				entries.emplace_back(node, node + 1, 1.0);
+			if (y > 0)
+				entries.emplace_back(node, node - width, 1.0);
+			if (y + 1 < height)
+				entries.emplace_back(node, node + width, 1.0);
+		}
+	}
+	Eigen::SparseMatrix<double> laplacian(count, count);
+	laplacian.setFromTriplets(entries.begin(), entries.end());
+	plate.Stiffness = laplacian.transpose() * laplacian;
+
+	// From the centre towards a corner.
+	for (uint32_t step = 0; step < 8; step++)
+	{
+		const uint32_t x = width / 2 - (width / 2 - 1) * step / 7;
+		const uint32_t y = height / 2 - (height / 2 - 1) * step / 7;
+		plate.StrikePoints.push_back(y * width + x);
+	}
+	plate.Pickups = {height / 4 * width + width / 3,
+					 height * 2 / 3 * width + width * 3 / 4};
+	return plate;
+}
+
+MT::DSP::ModalObject MT::DSP::ModalObject::MakeMembrane(uint32_t radius)
+{
+	radius = std::max(radius, 4u);
+	const auto r = static_cast<int32_t>(radius);
+	const int32_t side = 2 * r + 1;
+	ModalObject membrane;
+	membrane.Name = "Membrane";
+	membrane.MassDamping = 0.003;
+	membrane.StiffnessDamping = 0.00005;
+
+	// Grid nodes inside the rim; the rim itself is fixed.
+	std::vector<int32_t> index(static_cast<size_t>(side) * side, -1);
+	const auto at = [&](const int32_t x, const int32_t y) -> int32_t&
+	{
+		return index[static_cast<size_t>(y + r) * side + (x + r)];
+	};
+	int32_t count = 0;
+	for (int32_t y = -r; y <= r; y++)
+	{
+		for (int32_t x = -r; x <= r; x++)
+		{
+			if (x * x + y * y < r * r)
+				at(x, y) = count++;
+		}
+	}
+
+	std::vector<Eigen::Triplet<double>> entries;
+	for (int32_t y = -r; y <= r; y++)
+	{
+		for (int32_t x = -r; x <= r; x++)
+		{
+			const int32_t node = at(x, y);
+			if (node < 0)
+				continue;
+			entries.emplace_back(node, node, 4.0);
+			const int32_t neighbours[][2] = {{x - 1, y}, {x + 1, y},
+											 {x, y - 1}, {x, y + 1}};
+			for (const auto& [nx, ny] : neighbours)
+			{
+				if (nx >= -r && nx <= r && ny >= -r && ny <= r &&
+					at(nx, ny) >= 0)
+					entries.emplace_back(node, at(nx, ny), -1.0);
+			}
+		}
+	}
+	membrane.Masses = Eigen::VectorXd::Ones(count);
+	membrane.Stiffness.resize(count, count);
+	membrane.Stiffness.setFromTriplets(entries.begin(), entries.end());
+
+	// From the centre out to the rim.
+	for (int32_t step = 0; step < 8; step++)
+		membrane.StrikePoints.push_back(at((r - 1) * step / 7, 0));
+	membrane.Pickups = {static_cast<uint32_t>(at(-r / 3, r / 4)),
+						static_cast<uint32_t>(at(r / 2, -r / 3))};
+	return membrane;
+}
+
+std::vector<MT::DSP::ModalObject> MT::DSP::ModalObject::MakePresets()
+{
+	return {MakeBar(), MakePlate(), MakeMembrane()};
+}
+
+MT::DSP::ModalModel::ModalModel(std::string name, const uint32_t modeCount,
+								const uint32_t strikeCount) :
+	m_Name(std::move(name)),
+	m_ModeCount(modeCount),
+	m_StrikeCount(strikeCount),
+	m_Ratios(PadToPackets(modeCount), 0.0f),
+	m_Decays(PadToPackets(modeCount), 0.0f),
+	m_Gains(static_cast<size_t>(PadToPackets(modeCount)) * strikeCount,
+			0.0f) {}
+
+std::shared_ptr<const MT::DSP::ModalModel> MT::DSP::ModalModel::Build(
+	const ModalObject& object, std::string* error)
+{
+	const auto fail = [error](const char* message)
+	{
+		if (error)
+			*error = message;
+		return nullptr;
+	};
+
+	const Eigen::Index nodes = object.Masses.size();
+	if (nodes < 2 || nodes > MaxNodes || object.Stiffness.rows() != nodes ||
+		object.Stiffness.cols() != nodes)
+		return fail("A modal object needs 2 to 4096 nodes and a matching "
+					"stiffness matrix.");
+	if (object.StrikePoints.empty() || object.Pickups.empty() ||
+		object.MaxModes == 0)
+		return fail("A modal object needs strike points, pickups and at "
+					"least one mode.");
+	for (const std::vector<uint32_t>* points : {&object.StrikePoints,
+												&object.Pickups})
+	{
+		for (const uint32_t node : *points)
+		{
+			if (node >= nodes)
+				return fail("A strike point or pickup is not a node of the "
+							"object.");
+		}
+	}
+	if (!object.Masses.allFinite() || object.Masses.minCoeff() <= 0.0)
+		return fail("Every mass must be positive and finite.");
+
+	Eigen::MatrixXd stiffness(object.Stiffness);
+	if (!stiffness.allFinite() || !std::isfinite(object.MassDamping) ||
+		!std::isfinite(object.StiffnessDamping) || object.MassDamping < 0.0 ||
+		object.StiffnessDamping < 0.0)
+		return fail("The stiffness and damping must be finite, the damping "
+					"not negative.");
+	const double largestEntry = stiffness.cwiseAbs().maxCoeff();
+	if ((stiffness - stiffness.transpose()).cwiseAbs().maxCoeff() >
+		1e-9 * largestEntry)
+		return fail("The stiffness matrix must be symmetric.");
+
+	const Eigen::VectorXd scale = object.Masses.cwiseSqrt().cwiseInverse();
+	stiffness = scale.asDiagonal() * stiffness * scale.asDiagonal();
+	const Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> solver(stiffness);
+	if (solver.info() != Eigen::Success)
+		return fail("The eigensolver did not converge.");
+
+	// Eigenvalues come out ascending; those near zero are rigid motions.
+	const Eigen::VectorXd& values = solver.eigenvalues();
+	const double largest = values.cwiseAbs().maxCoeff();
+	if (values(0) < -1e-9 * largest)
+		return fail("The stiffness matrix must be positive semidefinite.");
+	Eigen::Index first = 0;
+	while (first < nodes && values(first) <= 1e-9 * largest)
+		first++;
+	if (first == nodes)
+		return fail("The object has no vibrating mode.");
+
+	const auto modes = static_cast<uint32_t>(std::min<Eigen::Index>(
+		nodes - first, object.MaxModes));
+	const auto strikes = static_cast<uint32_t>(object.StrikePoints.size());
+	auto model = std::shared_ptr<ModalModel>(
+		new ModalModel(object.Name, modes, strikes));
+	const uint32_t stride = model->GetPaddedModeCount();
+
+	const double fundamental = std::sqrt(values(first));
+	const Eigen::MatrixXd& vectors = solver.eigenvectors();
+	for (uint32_t mode = 0; mode < modes; mode++)
+	{
+		const Eigen::Index column = first + mode;
+		const double ratio = std::sqrt(values(column)) / fundamental;
+		model->m_Ratios[mode] = static_cast<float>(ratio);
+		model->m_Decays[mode] = static_cast<float>(object.MassDamping +
+			object.StiffnessDamping * ratio * ratio);
+
+		double pickup = 0.0;
+		for (const uint32_t node : object.Pickups)
+			pickup += vectors(node, column) * scale(node);
+		for (uint32_t strike = 0; strike < strikes; strike++)
+		{
+			const uint32_t node = object.StrikePoints[strike];
+			model->m_Gains[static_cast<size_t>(strike) * stride + mode] =
+				static_cast<float>(vectors(node, column) * scale(node) *
+					pickup);
+		}
+	}
+
+	float loudest = 0.0f;
+	for (uint32_t strike = 0; strike < strikes; strike++)
+	{
+		const auto gains = Eigen::Map<const Eigen::VectorXf>(
+			model->GetGains(strike), modes);
+		loudest = std::max(loudest, gains.norm());
+	}
+	if (!(loudest > 1e-20f))
+		return fail("No mode reaches the pickups from a strike point.");
+	for (float& gain : model->m_Gains)
+		gain /= loudest;
+	return model;
+}
+
+std::vector<std::shared_ptr<const MT::DSP::ModalModel>>
+MT::DSP::ModalModel::LoadOrBuild(const std::string& cachePath,
+								 const std::vector<ModalObject>& objects,
+								 std::string* error)
+{
+	const uint64_t key = HashObjects(objects);
+	const auto count = static_cast<uint32_t>(objects.size());
+	auto models = Load(cachePath, key, count);
+	if (!models.empty())
+		return models;
+
+	for (const ModalObject& object : objects)
+	{
+		auto model = Build(object, error);
+		if (!model)
+			return {};
+		models.push_back(std::move(model));
+	}
+	// A missing cache only costs the next start the decompositions.
+	Save(cachePath, key, models);
+	return models;
+}
+
+bool MT::DSP::ModalModel::Save(
+	const std::string& path, const uint64_t key,
+	const std::vector<std::shared_ptr<const ModalModel>>& models)
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	const CacheHeader header{CacheMagic, CacheVersion,
+							 static_cast<uint32_t>(models.size()),
+							 Simd::Width, key};
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	for (const std::shared_ptr<const ModalModel>& model : models)
+	{
+		const ModelHeader entry{model->m_ModeCount, model->m_StrikeCount,
+								static_cast<uint32_t>(model->m_Name.size()),
+								0};
+		file.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+		file.write(model->m_Name.data(),
+				   static_cast<std::streamsize>(model->m_Name.size()));
+		for (const std::vector<float>* values : {&model->m_Ratios,
+												 &model->m_Decays,
+												 &model->m_Gains})
+		{
+			file.write(reinterpret_cast<const char*>(values->data()),
+					   static_cast<std::streamsize>(values->size() *
+						   sizeof(float)));
+		}
+	}
+	return file.good();
+}
+
+std::vector<std::shared_ptr<const MT::DSP::ModalModel>>
+MT::DSP::ModalModel::Load(const std::string& path, const uint64_t key,
+						  const uint32_t modelCount)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+		return {};
+
+	CacheHeader header{};
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || header.Magic != CacheMagic ||
+		header.Version != CacheVersion || header.ModelCount != modelCount ||
+		header.Width != Simd::Width || header.Key != key)
+		return {};
+
+	std::vector<std::shared_ptr<const ModalModel>> models;
+	for (uint32_t index = 0; index < modelCount; index++)
+	{
+		ModelHeader entry{};
+		file.read(reinterpret_cast<char*>(&entry), sizeof(entry));
+		if (!file || entry.ModeCount == 0 || entry.ModeCount > MaxNodes ||
+			entry.StrikeCount == 0 || entry.StrikeCount > MaxNodes ||
+			entry.NameLength > 4096)
+			return {};
+
+		std::string name(entry.NameLength, '\0');
+		file.read(name.data(), entry.NameLength);
+		auto model = std::shared_ptr<ModalModel>(new ModalModel(
+			std::move(name), entry.ModeCount, entry.StrikeCount));
+		for (std::vector<float>* values : {&model->m_Ratios,
+										   &model->m_Decays,
+										   &model->m_Gains})
+		{
+			file.read(reinterpret_cast<char*>(values->data()),
+					  static_cast<std::streamsize>(values->size() *
+						  sizeof(float)));
+		}
+		if (!file)
+			return {};
+		models.push_back(std::move(model));
+	}
+	return models;
+}
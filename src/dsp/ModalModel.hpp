@@ -0,0 +1,127 @@
+﻿#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+
+namespace MT::DSP
+{
+/**
+ * @brief A vibrating object as a lumped mass-spring system, the input of
+ * @ref ModalModel::Build().
+ *
+ * Node i of the object has mass Masses(i); Stiffness is the symmetric,
+ * positive semidefinite matrix K of the restoring forces, f = -K x. Units
+ * are arbitrary, only the ratios between the mode frequencies survive.
+ * Rigid body modes of a free object are dropped.
+ */
+struct ModalObject
+{
+	std::string Name;
+	Eigen::SparseMatrix<double> Stiffness;
+	Eigen::VectorXd Masses;
+	/**
+	 * @brief Rayleigh damping relative to the fundamental: mode k decays at
+	 * MassDamping + StiffnessDamping * ratio_k^2 nepers per radian of the
+	 * fundamental, so higher modes die faster.
+	 */
+	double MassDamping = 0.001;
+	double StiffnessDamping = 0.0001;
+	/** @brief Nodes a strike can hit, in the order Position sweeps them. */
+	std::vector<uint32_t> StrikePoints;
+	/** @brief Nodes whose velocities are summed into the output. */
+	std::vector<uint32_t> Pickups;
+	/** @brief Lowest modes kept. */
+	uint32_t MaxModes = 256;
+
+	/** @brief Free bar of @p points nodes, xylophone style. */
+	static ModalObject MakeBar(uint32_t points = 128);
+	/** @brief Simply supported rectangular plate of @p width x @p height. */
+	static ModalObject MakePlate(uint32_t width = 20, uint32_t height = 14);
+	/** @brief Circular membrane fixed at its rim, @p radius nodes across. */
+	static ModalObject MakeMembrane(uint32_t radius = 12);
+
+	/** @brief Wooden bar, metal plate and drum head. */
+	static std::vector<ModalObject> MakePresets();
+};
+
+/**
+ * @brief Modes of a @ref ModalObject: frequency, decay and gain of each,
+ * immutable.
+ *
+ * With M the diagonal mass matrix, Build() solves K v = w^2 M v as the
+ * symmetric problem M^-1/2 K M^-1/2 u = w^2 u with Eigen's self-adjoint
+ * eigensolver, which takes a fraction of a second for a few hundred nodes
+ * and grows with the cube of the node count. LoadOrBuild() therefore keeps
+ * the results in a cache file keyed by a hash of the objects.
+ *
+ * The gain of mode k for a strike at node s is u_k(s) times the sum of
+ * u_k over the pickups, with u mass normalized: the velocity response to
+ * a unit impulse. Gains are scaled so the loudest strike point has an RMS
+ * sum of 1. Ratios are ascending; every array is zero padded to a whole
+ * number of SIMD packets, so readers can load past GetModeCount().
+ */
+class ModalModel
+{
+public:
+	/** @brief Largest object Build() accepts; the solver is dense. */
+	static constexpr uint32_t MaxNodes = 4096;
+
+	/**
+	 * @param error Receives a description of the problem on failure.
+	 * @return nullptr if the sizes disagree, a value is not finite, the
+	 * stiffness is not symmetric positive semidefinite, or no mode reaches
+	 * the pickups from a strike point.
+	 */
+	static std::shared_ptr<const ModalModel> Build(
+		const ModalObject& object, std::string* error = nullptr);
+
+	/**
+	 * @brief Loads @p cachePath if it was written for exactly @p objects,
+	 * otherwise builds every model and tries to write the cache.
+	 * @return Empty if any object fails to build.
+	 */
+	static std::vector<std::shared_ptr<const ModalModel>> LoadOrBuild(
+		const std::string& cachePath, const std::vector<ModalObject>& objects,
+		std::string* error = nullptr);
+
+	[[nodiscard]] const std::string& GetName() const { return m_Name; }
+	[[nodiscard]] uint32_t GetModeCount() const { return m_ModeCount; }
+	/** @brief GetModeCount() rounded up to a whole number of packets. */
+	[[nodiscard]] uint32_t GetPaddedModeCount() const
+	{
+		return static_cast<uint32_t>(m_Ratios.size());
+	}
+	[[nodiscard]] uint32_t GetStrikeCount() const { return m_StrikeCount; }
+	/** @brief Frequency of each mode over the lowest, ascending. */
+	[[nodiscard]] const float* GetRatios() const { return m_Ratios.data(); }
+	/** @brief Decay of each mode in nepers per radian of the lowest. */
+	[[nodiscard]] const float* GetDecays() const { return m_Decays.data(); }
+	/** @brief Gain of each mode for a strike at strike point @p strike. */
+	[[nodiscard]] const float* GetGains(const uint32_t strike) const
+	{
+		return m_Gains.data() + static_cast<size_t>(strike) * m_Ratios.size();
+	}
+
+private:
+	ModalModel(std::string name, uint32_t modeCount, uint32_t strikeCount);
+
+	static bool Save(const std::string& path, uint64_t key,
+					 const std::vector<std::shared_ptr<const ModalModel>>&
+						 models);
+	static std::vector<std::shared_ptr<const ModalModel>> Load(
+		const std::string& path, uint64_t key, uint32_t modelCount);
+
+private:
+	std::string m_Name;
+	uint32_t m_ModeCount;
+	uint32_t m_StrikeCount;
+	std::vector<float> m_Ratios;
+	std::vector<float> m_Decays;
+	// Strike point major, GetPaddedModeCount() floats per strike point.
+	std::vector<float> m_Gains;
+};
+}
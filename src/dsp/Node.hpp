@@ -0,0 +1,159 @@
+﻿#pragma once
+#include <cstdint>
+#include <span>
+
+namespace MT::DSP
+{
+class MemoryArena;
+class ParallelExecutor;
+
+/** @brief Index of a node inside its @ref Graph. */
+using NodeId = uint32_t;
+inline constexpr NodeId InvalidNode = 0xFFFFFFFF;
+
+/**
+ * @brief Floats per alignment unit of graph buffers.
+ *
+ * Every channel starts on a 64-byte boundary and the stride is a multiple
+ * of this, so block kernels may round the frame count up to a whole packet.
+ */
+inline constexpr uint32_t BufferAlignmentFloats = 16;
+
+/**
+ * @brief Non-owning view of a planar multichannel block.
+ *
+ * Channel @c c starts at @c Data + c * Stride. Every buffer in a compiled
+ * graph has the same channel count and stride.
+ */
+struct BufferView
+{
+	float* Data = nullptr;
+	uint32_t Channels = 0;
+	uint32_t Stride = 0;
+
+	[[nodiscard]] float* Channel(const uint32_t channel) const
+	{
+		return Data + static_cast<size_t>(channel) * Stride;
+	}
+};
+
+/** @brief Stream settings a node is prepared for, fixed per compiled graph. */
+struct PrepareContext
+{
+	float SampleRate = 48000.0f;
+	uint32_t MaxBlockFrames = 512;
+	uint32_t Channels = 2;
+	/**
+	 * @brief Where nodes should take their state and buffers from, see
+	 * @ref ArenaArray. nullptr outside an engine.
+	 */
+	MemoryArena* Memory = nullptr;
+	/**
+	 * @brief Pool a node may split its own work across with
+	 * ParallelExecutor::ParallelFor(), nullptr to stay on the calling thread.
+	 */
+	ParallelExecutor* Executor = nullptr;
+	/**
+	 * @brief Frames the device asks for per wakeup, at most MaxBlockFrames,
+	 * 0 when unknown. Blocks may still be shorter.
+	 */
+	uint32_t PeriodFrames = 0;
+
+	bool operator==(const PrepareContext&) const = default;
+};
+
+/** @brief Everything a node sees while processing one block. */
+struct ProcessContext
+{
+	uint32_t Frames = 0;
+	std::span<const BufferView> Inputs;
+	BufferView Output;
+};
+
+
+/**
+ * @brief Base class of every DSP processor in a @ref Graph.
+ *
+ * Nodes are prepared once on the control thread when their graph is
+ * compiled and afterwards only touched by the audio thread: Process(),
+ * SetParameter() and OnNote() must not allocate or lock.
+ *
+ * A node keeps its state when the graph around it is recompiled, so an edit
+ * does not reset oscillators or filters that stay in the patch.
+ */
+class Node
+{
+public:
+	virtual ~Node() = default;
+
+	/**
+	 * @brief Calls Prepare() unless the node is already prepared for
+	 * @p context.
+	 *
+	 * Re-preparing a node for different settings must only happen while no
+	 * graph containing it is being rendered.
+	 */
+	void EnsurePrepared(const PrepareContext& context)
+	{
+		if (m_IsPrepared && m_PreparedFor == context)
+			return;
+		Prepare(context);
+		m_PreparedFor = context;
+		m_IsPrepared = true;
+	}
+
+	/** @brief Allocates state for the given stream settings. */
+	virtual void Prepare(const PrepareContext& /*context*/) {}
+	/** @brief Renders @c context.Frames frames into @c context.Output. */
+	virtual void Process(const ProcessContext& context) = 0;
+
+	/** @brief Applies a node-specific parameter, ids are defined per node. */
+	virtual void SetParameter(uint32_t /*id*/, float /*value*/) {}
+	/** @brief Receives note events; a velocity of 0 releases the note. */
+	virtual void OnNote(uint32_t /*note*/, float /*velocity*/) {}
+	/** @brief Whether OnNote() should be called for every note event. */
+	[[nodiscard]] virtual bool WantsNotes() const { return false; }
+
+	/**
+	 * @brief Frames the output lags the input by. Reported for display,
+	 * graphs do not compensate for it.
+	 */
+	[[nodiscard]] virtual uint32_t GetLatency() const { return 0; }
+
+	/** @brief Maximum number of connected inputs, 0 for generators. */
+	[[nodiscard]] virtual uint32_t GetMaxInputs() const { return 0; }
+	[[nodiscard]] virtual const char* GetName() const = 0;
+
+protected:
+	/**
+	 * @brief Writes frames [@p first, @p first + @p count) of the mono
+	 * downmix of the inputs to @p out: the average of every channel of
+	 * every input, times @p gain. Silence without inputs.
+	 */
+	static void MixInputsToMono(const ProcessContext& context,
+								const float gain, float* out,
+								const uint32_t first, const uint32_t count)
+	{
+		uint32_t channels = 0;
+		for (const BufferView& input : context.Inputs)
+			channels += input.Channels;
+		const float scale = channels ? gain / static_cast<float>(channels)
+									 : 0.0f;
+		for (uint32_t i = 0; i < count; i++)
+			out[i] = 0.0f;
+		for (const BufferView& input : context.Inputs)
+		{
+			for (uint32_t channel = 0; channel < input.Channels; channel++)
+			{
+				const float* in = input.Channel(channel) + first;
+				for (uint32_t i = 0; i < count; i++)
+					out[i] += scale * in[i];
+			}
+		}
+	}
+
+private:
+	PrepareContext m_PreparedFor;
+	bool m_IsPrepared = false;
+};
+}
@@ -0,0 +1,71 @@
+﻿#include "NodeProfiler.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+
+MT::DSP::NodeProfiler::NodeProfiler(const uint32_t threadCount)
+{
+	m_Threads.reserve(threadCount);
+	for (uint32_t thread = 0; thread < threadCount; thread++)
+		m_Threads.push_back(std::make_unique<ThreadQueue>());
+}
+
+void MT::DSP::NodeProfiler::Collect()
+{
+	for (const auto& thread : m_Threads)
+	{
+		Sample sample{};
+		while (thread->Samples.TryPop(sample))
+		{
+			if (sample.Node >= m_Windows.size())
+				m_Windows.resize(sample.Node + 1);
+
+			Window& window = m_Windows[sample.Node];
+			if (window.Ns.size() < WindowBlocks)
+				window.Ns.push_back(sample.Ns);
+			else
+				window.Ns[window.Next] = sample.Ns;
+			window.Next = (window.Next + 1) % WindowBlocks;
+		}
+	}
+
+	m_Timings.clear();
+	for (NodeId id = 0; id < m_Windows.size(); id++)
+	{
+		const std::vector<uint32_t>& ns = m_Windows[id].Ns;
+		if (ns.empty())
+			continue;
+
+		m_Sorted.assign(ns.begin(), ns.end());
+		std::sort(m_Sorted.begin(), m_Sorted.end());
+		const size_t count = m_Sorted.size();
+
+		NodeTiming timing;
+		timing.Id = id;
+		timing.Blocks = static_cast<uint32_t>(count);
+		timing.MinNs = m_Sorted.front();
+		timing.MaxNs = m_Sorted.back();
+		timing.MeanNs = std::accumulate(m_Sorted.begin(), m_Sorted.end(),
+										0.0) / static_cast<double>(count);
+		timing.P99Ns = m_Sorted[std::min(count - 1, count * 99 / 100)];
+		m_Timings.push_back(timing);
+	}
+}
+
+void MT::DSP::NodeProfiler::Reset()
+{
+	Collect();
+	m_Windows.clear();
+	m_Timings.clear();
+	for (const auto& thread : m_Threads)
+		thread->Dropped.store(0, std::memory_order_relaxed);
+}
+
+uint64_t MT::DSP::NodeProfiler::GetDroppedSamples() const
+{
+	uint64_t dropped = 0;
+	for (const auto& thread : m_Threads)
+		dropped += thread->Dropped.load(std::memory_order_relaxed);
+	return dropped;
+}
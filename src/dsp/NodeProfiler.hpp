@@ -0,0 +1,106 @@
+﻿#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "../audio/Instrumentation.hpp"
+#include "../audio/SpscQueue.hpp"
+#include "Node.hpp"
+
+/**
+ * @brief Whether compiled graphs time every node they process, by default
+ * PAE_DEBUG_INSTRUMENTATION. When 0 the render path contains no profiling
+ * code at all.
+ */
+#ifndef PAE_ENABLE_PROFILING
+#define PAE_ENABLE_PROFILING PAE_DEBUG_INSTRUMENTATION
+#endif
+
+namespace MT::DSP
+{
+/** @brief Per-block processing time of one node over the recent window. */
+struct NodeTiming
+{
+	NodeId Id = InvalidNode;
+	uint32_t Blocks = 0;
+	double MinNs = 0.0;
+	double MeanNs = 0.0;
+	double P99Ns = 0.0;
+	double MaxNs = 0.0;
+};
+
+/**
+ * @brief Collects how long each node takes per block.
+ *
+ * Every render thread (the audio thread is thread 0, pool workers follow)
+ * pushes its measurements into its own wait-free queue, so recording never
+ * contends. The control thread drains the queues in Collect() and keeps a
+ * sliding window of the last WindowBlocks measurements per node, from
+ * which the statistics are computed.
+ */
+class NodeProfiler
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	static constexpr size_t QueueCapacity = 4096;
+	static constexpr uint32_t WindowBlocks = 1024;
+
+	explicit NodeProfiler(uint32_t threadCount);
+
+	NodeProfiler(const NodeProfiler&) = delete;
+	NodeProfiler& operator=(const NodeProfiler&) = delete;
+
+	/** @brief Render thread @p thread side. Never blocks or allocates. */
+	void Record(const uint32_t thread, const NodeId node,
+				const Clock::duration elapsed)
+	{
+		const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			elapsed).count();
+		ThreadQueue& queue = *m_Threads[thread];
+		if (!queue.Samples.TryPush({node, static_cast<uint32_t>(ns)}))
+			queue.Dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/** @brief Control thread. Drains the thread queues and updates the stats. */
+	void Collect();
+	/** @brief Forgets every measurement collected so far. */
+	void Reset();
+
+	/** @brief Statistics as of the last Collect(), ordered by node id. */
+	[[nodiscard]] const std::vector<NodeTiming>& GetTimings() const
+	{
+		return m_Timings;
+	}
+	/** @brief Measurements lost because a queue was full. */
+	[[nodiscard]] uint64_t GetDroppedSamples() const;
+
+private:
+	struct Sample
+	{
+		NodeId Node;
+		uint32_t Ns;
+	};
+
+	struct alignas(Audio::CacheLineSize) ThreadQueue
+	{
+		Audio::SpscQueue<Sample, QueueCapacity> Samples;
+		std::atomic<uint64_t> Dropped{0};
+	};
+
+	struct Window
+	{
+		std::vector<uint32_t> Ns;
+		uint32_t Next = 0;
+	};
+
+	std::vector<std::unique_ptr<ThreadQueue>> m_Threads;
+
+	// Control thread only.
+	std::vector<Window> m_Windows;
+	std::vector<NodeTiming> m_Timings;
+	std::vector<uint32_t> m_Sorted;
+};
+}
@@ -0,0 +1,162 @@
+﻿#include "ParallelExecutor.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#include "../audio/RealtimeGuard.hpp"
+#include "../audio/ThreadPriority.hpp"
+#include "CompiledGraph.hpp"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define PAE_CPU_RELAX() _mm_pause()
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PAE_CPU_RELAX() _mm_pause()
+#else
+#define PAE_CPU_RELAX() ((void)0)
+#endif
+
+
+MT::DSP::AudioThreadEnvironment::EnvThread::EnvThread(
+		std::function<void()> f) :
+	m_Thread([f = std::move(f)]
+	{
+		Audio::PromoteToAudioPriority();
+		f();
+	}) {}
+
+
+MT::DSP::ParallelExecutor::ParallelExecutor(const uint32_t workerCount) :
+	m_WorkerCount(workerCount
+		? workerCount
+		: std::max(1u, std::thread::hardware_concurrency()) - 1)
+{
+	if (m_WorkerCount > 0)
+		m_Pool = std::make_unique<ThreadPool>(static_cast<int>(m_WorkerCount),
+											  true);
+}
+
+MT::DSP::ParallelExecutor::~ParallelExecutor() = default;
+
+void MT::DSP::ParallelExecutor::Process(CompiledGraph& graph,
+										const uint32_t frames)
+{
+	const auto count = static_cast<uint32_t>(graph.m_Schedule.size());
+	for (uint32_t index = 0; index < count; index++)
+	{
+		graph.m_PendingInputs[index].store(graph.m_DependencyCounts[index],
+										   std::memory_order_relaxed);
+	}
+	m_Graph = &graph;
+	m_Frames = frames;
+	m_Remaining.store(count, std::memory_order_relaxed);
+
+	// The pool queues publish the state above to the workers. Keep the
+	// first root for this thread.
+	const std::vector<uint32_t>& roots = graph.m_Roots;
+	for (size_t i = 1; i < roots.size(); i++)
+		m_Pool->Schedule([this, index = roots[i]] { RunFrom(index); });
+	if (!roots.empty())
+		RunFrom(roots.front());
+
+	// Wait for the branches still running on the workers.
+	uint32_t spins = 0;
+	while (m_Remaining.load(std::memory_order_acquire) != 0)
+	{
+		if (++spins < 4096)
+			PAE_CPU_RELAX();
+		else
+			std::this_thread::yield();
+	}
+}
+
+void MT::DSP::ParallelExecutor::RunFrom(uint32_t index)
+{
+	const Audio::RealtimeScope realtime;
+	CompiledGraph& graph = *m_Graph;
+	// Pool workers are 0-based, the calling audio thread reports -1.
+	const auto thread = static_cast<uint32_t>(m_Pool->CurrentThreadId() + 1);
+	while (true)
+	{
+		graph.ProcessNode(index, m_Frames, thread);
+
+		// Continue with the first node this one completed, share the rest.
+		uint32_t next = CompiledGraph::Unscheduled;
+		const uint32_t first = graph.m_SuccessorOffsets[index];
+		const uint32_t last = graph.m_SuccessorOffsets[index + 1];
+		for (uint32_t edge = first; edge < last; edge++)
+		{
+			const uint32_t successor = graph.m_Successors[edge];
+			if (graph.m_PendingInputs[successor].fetch_sub(
+				1, std::memory_order_acq_rel) != 1)
+				continue;
+
+			if (next == CompiledGraph::Unscheduled)
+				next = successor;
+			else
+				m_Pool->Schedule([this, successor] { RunFrom(successor); });
+		}
+
+		m_Remaining.fetch_sub(1, std::memory_order_acq_rel);
+		if (next == CompiledGraph::Unscheduled)
+			return;
+		index = next;
+	}
+}
+
+void MT::DSP::ParallelExecutor::ParallelFor(const uint32_t count,
+											const TaskFunction function,
+											void* context)
+{
+	if (count <= 1 || !m_Pool ||
+		m_ForBusy.test_and_set(std::memory_order_acquire))
+	{
+		for (uint32_t task = 0; task < count; task++)
+			function(context, task);
+		return;
+	}
+
+	const uint32_t epoch = ++m_ForEpoch;
+	m_ForFunction = function;
+	m_ForContext = context;
+	m_ForDone.store(0, std::memory_order_relaxed);
+	m_ForNext.store(static_cast<uint64_t>(epoch) << 32,
+					std::memory_order_release);
+
+	const uint32_t helpers = std::min(count - 1, m_WorkerCount);
+	for (uint32_t i = 0; i < helpers; i++)
+		m_Pool->Schedule([this, epoch, count] { RunTasks(epoch, count); });
+	RunTasks(epoch, count);
+
+	uint32_t spins = 0;
+	while (m_ForDone.load(std::memory_order_acquire) != count)
+	{
+		if (++spins < 4096)
+			PAE_CPU_RELAX();
+		else
+			std::this_thread::yield();
+	}
+	m_ForBusy.clear(std::memory_order_release);
+}
+
+void MT::DSP::ParallelExecutor::RunTasks(const uint32_t epoch,
+										 const uint32_t count)
+{
+	const Audio::RealtimeScope realtime;
+	uint64_t next = m_ForNext.load(std::memory_order_acquire);
+	while (true)
+	{
+		const auto task = static_cast<uint32_t>(next);
+		if (next >> 32 != epoch || task >= count)
+			return;
+		if (!m_ForNext.compare_exchange_weak(next, next + 1,
+											 std::memory_order_acq_rel,
+											 std::memory_order_acquire))
+			continue;
+
+		m_ForFunction(m_ForContext, task);
+		m_ForDone.fetch_add(1, std::memory_order_acq_rel);
+		next = m_ForNext.load(std::memory_order_acquire);
+	}
+}
@@ -0,0 +1,133 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include <Eigen/ThreadPool>
+
+namespace MT::DSP
+{
+class CompiledGraph;
+
+/**
+ * @brief Eigen thread environment whose workers run at audio priority.
+ *
+ * Identical to Eigen::StlThreadEnvironment except that every worker raises
+ * its scheduling priority before entering the pool loop, since it renders
+ * inside the audio deadline.
+ */
+struct AudioThreadEnvironment
+{
+	struct Task
+	{
+		std::function<void()> f;
+	};
+
+	class EnvThread
+	{
+	public:
+		explicit EnvThread(std::function<void()> f);
+		~EnvThread() { m_Thread.join(); }
+		void OnCancel() {}
+
+	private:
+		std::thread m_Thread;
+	};
+
+	EnvThread* CreateThread(std::function<void()> f)
+	{
+		return new EnvThread(std::move(f));
+	}
+	Task CreateTask(std::function<void()> f) { return Task{std::move(f)}; }
+	void ExecuteTask(const Task& t) { t.f(); }
+};
+
+
+/**
+ * @brief Runs independent branches of a compiled graph on a fixed pool.
+ *
+ * Built on Eigen's NonBlockingThreadPool: workers spin briefly when they run
+ * out of work, then park on an EventCount. Each block, every node starts
+ * with a counter of unfinished inputs; the thread finishing the last input
+ * of a node continues with it directly and hands any other node it
+ * unblocked to the pool. The audio thread takes part in the walk and then
+ * waits for the remaining branches.
+ *
+ * One executor may be shared by several graphs, but only one graph may be
+ * processed at a time.
+ */
+class ParallelExecutor
+{
+public:
+	/**
+	 * @param workerCount Pool threads in addition to the audio thread, 0
+	 * picks one less than the number of hardware threads.
+	 */
+	explicit ParallelExecutor(uint32_t workerCount = 0);
+	~ParallelExecutor();
+
+	ParallelExecutor(const ParallelExecutor&) = delete;
+	ParallelExecutor& operator=(const ParallelExecutor&) = delete;
+
+	/** @brief Processes one block of @p graph; returns when all nodes ran. */
+	void Process(CompiledGraph& graph, uint32_t frames);
+
+	/** @brief Threads that can render at once, including the audio thread. */
+	[[nodiscard]] uint32_t GetConcurrency() const { return m_WorkerCount + 1; }
+
+	/** @brief Work item of ParallelFor(), @p task is in [0, count). */
+	using TaskFunction = void (*)(void* context, uint32_t task);
+
+	/**
+	 * @brief Calls @p function for every task in [0, @p count), spread over
+	 * the pool, and returns once all of them finished.
+	 *
+	 * Meant for a node splitting its own work; callable from the audio
+	 * thread and from inside Process(). The caller claims tasks as well and
+	 * never waits on a task nobody started, so it finishes even when every
+	 * worker is busy. One call runs at a time: a call made while another is
+	 * in flight runs its tasks on the calling thread.
+	 */
+	void ParallelFor(uint32_t count, TaskFunction function, void* context);
+
+	/** @brief ParallelFor() over a callable taking the task index. */
+	template<typename F>
+	void ParallelFor(const uint32_t count, F& body)
+	{
+		ParallelFor(count, [](void* context, const uint32_t task)
+		{
+			(*static_cast<F*>(context))(task);
+		}, &body);
+	}
+
+private:
+	/** @brief Runs node @p index, then every node it alone unblocks. */
+	void RunFrom(uint32_t index);
+	/** @brief Claims and runs ParallelFor() tasks while @p epoch is current. */
+	void RunTasks(uint32_t epoch, uint32_t count);
+
+private:
+	using ThreadPool = Eigen::ThreadPoolTempl<AudioThreadEnvironment>;
+
+	uint32_t m_WorkerCount;
+
+	// ParallelFor() state. Declared before the pool, so it outlives helper
+	// tasks still queued when the executor is destroyed. m_ForNext holds the
+	// call's epoch in the upper half and the next unclaimed task below, a
+	// helper left over from an earlier call fails to claim anything.
+	std::atomic_flag m_ForBusy;
+	std::atomic<uint64_t> m_ForNext{0};
+	std::atomic<uint32_t> m_ForDone{0};
+	uint32_t m_ForEpoch = 0;
+	TaskFunction m_ForFunction = nullptr;
+	void* m_ForContext = nullptr;
+
+	std::unique_ptr<ThreadPool> m_Pool;
+
+	// Per-block state, published to workers through the pool queues.
+	CompiledGraph* m_Graph = nullptr;
+	uint32_t m_Frames = 0;
+	std::atomic<uint32_t> m_Remaining{0};
+};
+}
@@ -0,0 +1,149 @@
+﻿#pragma once
+#include <memory>
+
+#include "Graph.hpp"
+#include "ModalModel.hpp"
+#include "WavetableBank.hpp"
+#include "nodes/AdditiveSynthNode.hpp"
+#include "nodes/FdtdPlateNode.hpp"
+#include "nodes/FmSynthNode.hpp"
+#include "nodes/GranularNode.hpp"
+#include "nodes/ImpactNode.hpp"
+#include "nodes/MixerNode.hpp"
+#include "nodes/ModalNode.hpp"
+#include "nodes/NoiseNode.hpp"
+#include "nodes/OnePoleFilterNode.hpp"
+#include "nodes/PolySynthNode.hpp"
+#include "nodes/VirtualAnalogNode.hpp"
+#include "nodes/WaveguideNode.hpp"
+#include "nodes/WavetableSynthNode.hpp"
+
+namespace MT::DSP
+{
+/** @brief Voice engines the default patch can play. */
+enum class SynthEngine
+{
+	/** @brief @ref PolySynthNode. */
+	Subtractive,
+	/** @brief @ref WavetableSynthNode, needs PatchSettings::Wavetables. */
+	Wavetable,
+	/** @brief @ref VirtualAnalogNode. */
+	Analog,
+	/** @brief @ref AdditiveSynthNode. */
+	Additive,
+	/** @brief @ref FmSynthNode with the FmPatch presets. */
+	Fm,
+	/**
+	 * @brief @ref GranularNode, fed the filtered noise for its Live source;
+	 * PatchSettings::Wavetables feeds its Wavetable source.
+	 */
+	Granular,
+	/** @brief @ref WaveguideNode, the filtered noise can excite it. */
+	Waveguide,
+	/**
+	 * @brief @ref ModalNode with PatchSettings::ModalModels, the filtered
+	 * noise can rub the objects.
+	 */
+	Modal,
+	/**
+	 * @brief @ref FdtdPlateNode of PatchSettings::GridWidth x GridHeight
+	 * cells, the filtered noise can drive it.
+	 */
+	Fdtd,
+	/** @brief @ref ImpactNode, rain without the keyboard. */
+	Impacts
+};
+
+/** @brief Choices for BuildDefaultPatch(). */
+struct PatchSettings
+{
+	SynthEngine Engine = SynthEngine::Subtractive;
+	/** @brief Size of the synth's voice pool. */
+	uint32_t Voices = 256;
+	/** @brief Partial capacity of the additive engine. */
+	uint32_t Partials = 4096;
+	/** @brief Grain pool of the granular engine. */
+	uint32_t Grains = 8192;
+	/** @brief Bank of the wavetable and granular engines. */
+	std::shared_ptr<const WavetableBank> Wavetables;
+	/** @brief Objects of the modal engine, the presets if empty. */
+	std::vector<std::shared_ptr<const ModalModel>> ModalModels;
+	/** @brief Resolution of the FDTD engine's grid in cells. */
+	uint32_t GridWidth = 64;
+	uint32_t GridHeight = 48;
+};
+
+/** @brief Node ids of the patch built by BuildDefaultPatch(). */
+struct DefaultPatch
+{
+	NodeId Noise = InvalidNode;
+	NodeId Filter = InvalidNode;
+	NodeId Synth = InvalidNode;
+	NodeId Output = InvalidNode;
+};
+
+/**
+ * @brief Filtered white noise mixed with a polyphonic synth played from the
+ * keyboard.
+ */
+inline DefaultPatch BuildDefaultPatch(Graph& graph,
+									  const PatchSettings& settings = {})
+{
+	DefaultPatch patch;
+	patch.Noise = graph.Add<NoiseNode>();
+	patch.Filter = graph.Add<OnePoleFilterNode>(20000.0f);
+	if (settings.Engine == SynthEngine::Wavetable && settings.Wavetables)
+	{
+		patch.Synth = graph.Add<WavetableSynthNode>(settings.Wavetables,
+													settings.Voices);
+	}
+	else if (settings.Engine == SynthEngine::Analog)
+		patch.Synth = graph.Add<VirtualAnalogNode>(settings.Voices);
+	else if (settings.Engine == SynthEngine::Additive)
+		patch.Synth = graph.Add<AdditiveSynthNode>(settings.Partials);
+	else if (settings.Engine == SynthEngine::Fm)
+	{
+		patch.Synth = graph.Add<FmSynthNode>(FmSynthNode::CompilePresets(),
+											 settings.Voices);
+	}
+	else if (settings.Engine == SynthEngine::Granular)
+	{
+		patch.Synth = graph.Add<GranularNode>(settings.Grains,
+											  settings.Wavetables);
+	}
+	else if (settings.Engine == SynthEngine::Waveguide)
+		patch.Synth = graph.Add<WaveguideNode>(settings.Voices);
+	else if (settings.Engine == SynthEngine::Modal)
+	{
+		patch.Synth = graph.Add<ModalNode>(settings.ModalModels.empty()
+											   ? ModalNode::BuildPresets()
+											   : settings.ModalModels,
+										   settings.Voices);
+	}
+	else if (settings.Engine == SynthEngine::Fdtd)
+	{
+		patch.Synth = graph.Add<FdtdPlateNode>(settings.GridWidth,
+											   settings.GridHeight);
+	}
+	else if (settings.Engine == SynthEngine::Impacts)
+		patch.Synth = graph.Add<ImpactNode>();
+	else
+		patch.Synth = graph.Add<PolySynthNode>(settings.Voices);
+	patch.Output = graph.Add<MixerNode>();
+
+	graph.Connect(patch.Noise, patch.Filter);
+	graph.Connect(patch.Filter, patch.Output);
+	graph.Connect(patch.Synth, patch.Output);
+	if (settings.Engine == SynthEngine::Granular ||
+		settings.Engine == SynthEngine::Waveguide ||
+		settings.Engine == SynthEngine::Modal ||
+		settings.Engine == SynthEngine::Fdtd)
+		graph.Connect(patch.Filter, patch.Synth);
+	graph.SetOutput(patch.Output);
+
+	// Keep the sum of both sources within full scale.
+	graph.GetNode(patch.Output)->SetParameter(MixerNode::InputGain, 0.5f);
+	graph.GetNode(patch.Output)->SetParameter(MixerNode::InputGain + 1, 0.5f);
+	return patch;
+}
+}
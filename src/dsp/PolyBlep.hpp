@@ -0,0 +1,53 @@
+﻿#pragma once
+#include "Simd.hpp"
+
+/**
+ * @brief Two-sample polynomial corrections for band-limiting naive
+ * waveforms, written against Simd so they run on packets or plain floats.
+ *
+ * A discontinuity is located by its distance x in samples from the
+ * current sample, negative before it. The step residual fixes a jump in
+ * value and the ramp residual (BLAMP) a jump in slope; both are zero for
+ * |x| >= 1, which is reached with a max instead of a branch, so every lane
+ * evaluates the same instructions whether it is near an edge or not.
+ */
+namespace MT::DSP::PolyBlep
+{
+/**
+ * @brief Signed distance in samples from @p phase to an edge at phase
+ * @p edge, wrapped to half a cycle either side.
+ */
+template<typename P>
+P EdgeDistance(const P& phase, const P& edge, const P& inverseIncrement)
+{
+	P distance = Simd::Sub(phase, edge);
+	distance = Simd::Sub(distance, Simd::Floor(
+		Simd::Add(distance, Simd::Set<P>(0.5f))));
+	return Simd::Mul(distance, inverseIncrement);
+}
+
+/**
+ * @brief Band-limited minus ideal unit step: (1 + x)^2 / 2 before the
+ * edge, -(1 - x)^2 / 2 after it.
+ */
+template<typename P>
+P StepResidual(const P& x)
+{
+	const P zero = Simd::Set<P>(0.0f);
+	const P near = Simd::Max(Simd::Sub(Simd::Set<P>(1.0f), Simd::Abs(x)),
+							 zero);
+	const P residual = Simd::Mul(Simd::Mul(near, near), Simd::Set<P>(0.5f));
+	return Simd::Select(Simd::Less(x, zero), residual,
+						Simd::Sub(zero, residual));
+}
+
+/** @brief Band-limited minus ideal unit ramp: (1 - |x|)^3 / 6. */
+template<typename P>
+P RampResidual(const P& x)
+{
+	const P near = Simd::Max(Simd::Sub(Simd::Set<P>(1.0f), Simd::Abs(x)),
+							 Simd::Set<P>(0.0f));
+	return Simd::Mul(Simd::Mul(Simd::Mul(near, near), near),
+					 Simd::Set<P>(1.0f / 6.0f));
+}
+}
@@ -0,0 +1,128 @@
+﻿#include "PolyphonicNode.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+MT::DSP::PolyphonicNode::PolyphonicNode(const uint32_t voices,
+										const VoiceStealPolicy policy) :
+	m_Capacity((std::max(voices, 1u) + Simd::Width - 1) / Simd::Width *
+			   Simd::Width),
+	m_Policy(policy) {}
+
+float MT::DSP::PolyphonicNode::NoteFrequency(const uint32_t note)
+{
+	return 440.0f * std::exp2((static_cast<float>(note) - 69.0f) / 12.0f);
+}
+
+void MT::DSP::PolyphonicNode::Prepare(const PrepareContext& context)
+{
+	m_SampleRate = context.SampleRate;
+	m_Allocator.Prepare(context.Memory, m_Capacity);
+	m_Envelopes.Prepare(context.Memory, m_Capacity, m_SampleRate);
+	m_Sums.Allocate(context.Memory, ControlFrames * Simd::Width);
+	m_FramesToControl = 0;
+	m_ActiveVoices.store(0, std::memory_order_relaxed);
+	PrepareVoices(context);
+}
+
+void MT::DSP::PolyphonicNode::Process(const ProcessContext& context)
+{
+	BeginBlock(context);
+	float* first = context.Output.Channel(0);
+	const uint32_t groups = m_Capacity / Simd::Width;
+	for (uint32_t frame = 0; frame < context.Frames;)
+	{
+		if (m_FramesToControl == 0)
+		{
+			m_Envelopes.Advance([this](const uint32_t voice)
+			{
+				FinishVoice(voice);
+				m_Allocator.Free(voice);
+			});
+			UpdateControl();
+			m_FramesToControl = ControlFrames;
+		}
+		const uint32_t frames = std::min(context.Frames - frame,
+										 m_FramesToControl);
+
+		m_ChunkStart = frame;
+		float* sums = m_Sums.Data();
+		std::fill_n(sums, frames * Simd::Width, 0.0f);
+		for (uint32_t group = 0; group < groups; group++)
+		{
+			if (m_Allocator.IsGroupActive(group))
+				RenderGroup(group, frames, sums);
+		}
+		for (uint32_t i = 0; i < frames; i++)
+		{
+			first[frame + i] = m_Gain * Simd::Sum(
+				Simd::LoadAligned(sums + i * Simd::Width));
+		}
+
+		frame += frames;
+		m_FramesToControl -= frames;
+	}
+
+	for (uint32_t channel = 1; channel < context.Output.Channels; channel++)
+		std::copy_n(first, context.Frames, context.Output.Channel(channel));
+
+	m_ActiveVoices.store(m_Allocator.GetActiveCount(),
+						 std::memory_order_relaxed);
+}
+
+void MT::DSP::PolyphonicNode::SetParameter(const uint32_t id,
+										   const float value)
+{
+	switch (id)
+	{
+		case Gain:
+			m_Gain = value;
+			break;
+		case StealPolicy:
+			m_Policy = static_cast<VoiceStealPolicy>(std::min(
+				static_cast<uint32_t>(std::max(value, 0.0f)),
+				static_cast<uint32_t>(VoiceStealPolicy::Count) - 1));
+			break;
+		case NotePriority:
+			m_NotePriority = value;
+			break;
+		case Attack:
+			m_Envelopes.SetAttack(value);
+			break;
+		case Decay:
+			m_Envelopes.SetDecay(value);
+			break;
+		case Sustain:
+			m_Envelopes.SetSustain(value);
+			break;
+		case Release:
+			m_Envelopes.SetRelease(value);
+			break;
+		default:
+			SetVoiceParameter(id, value);
+			break;
+	}
+}
+
+void MT::DSP::PolyphonicNode::OnNote(const uint32_t note, const float velocity)
+{
+	if (velocity <= 0.0f)
+	{
+		m_Allocator.Release(note, [this](const uint32_t voice)
+		{
+			m_Envelopes.Release(voice);
+		});
+		return;
+	}
+
+	bool stolen = false;
+	const uint32_t voice = m_Allocator.Allocate(
+		note, m_NotePriority, m_Policy, m_Envelopes.GetLevels(), stolen);
+	if (voice == VoiceAllocator::NoVoice)
+		return;
+
+	// A stolen voice attacks from its current level, which avoids a click.
+	m_Envelopes.Trigger(voice, !stolen);
+	StartVoice(voice, note, velocity, stolen);
+}
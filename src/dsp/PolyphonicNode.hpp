@@ -0,0 +1,122 @@
+﻿#pragma once
+#include <atomic>
+#include <cstdint>
+
+#include "EnvelopeBank.hpp"
+#include "MemoryArena.hpp"
+#include "Node.hpp"
+#include "VoiceAllocator.hpp"
+
+namespace MT::DSP
+{
+/**
+ * @brief Base of the voice engines: allocation, stealing, envelopes and the
+ * control grid, with per-voice DSP left to the subclass.
+ *
+ * Voices are rendered Simd::Width at a time. Each block is cut into chunks
+ * that end on the ControlFrames grid; for every chunk, RenderGroup() is
+ * called for each SIMD group with a playing voice and adds its lanes into
+ * a per-frame partial sum, which is summed across lanes once per frame.
+ * Subclasses keep their voice state as arrays indexed by voice and step
+ * the shared envelopes with EnvelopeBank::Step() inside their loop.
+ */
+class PolyphonicNode : public Node
+{
+public:
+	static constexpr uint32_t ControlFrames = 32;
+
+	/**
+	 * @brief Parameters of every voice engine, subclass parameters start at
+	 * ParameterCount.
+	 */
+	enum Parameter : uint32_t
+	{
+		Gain,
+		/** @brief A @ref VoiceStealPolicy, passed as a float. */
+		StealPolicy,
+		/**
+		 * @brief Priority given to the notes that follow, for the
+		 * LowestPriority policy.
+		 */
+		NotePriority,
+		/** @brief Seconds. */
+		Attack,
+		/** @brief Seconds to fall about 60 dB toward the sustain level. */
+		Decay,
+		/** @brief Level 0-1. */
+		Sustain,
+		/** @brief Seconds to fall about 60 dB after note off. */
+		Release,
+		ParameterCount
+	};
+
+	void Prepare(const PrepareContext& context) final;
+	void Process(const ProcessContext& context) final;
+	void SetParameter(uint32_t id, float value) final;
+	void OnNote(uint32_t note, float velocity) final;
+
+	[[nodiscard]] bool WantsNotes() const override { return true; }
+
+	/** @brief Voices sounding at the end of the last block, any thread. */
+	[[nodiscard]] uint32_t GetActiveVoiceCount() const
+	{
+		return m_ActiveVoices.load(std::memory_order_relaxed);
+	}
+	[[nodiscard]] uint32_t GetVoiceCapacity() const { return m_Capacity; }
+
+	/** @brief Equal-tempered frequency of a MIDI note, A4 = 440 Hz. */
+	static float NoteFrequency(uint32_t note);
+
+protected:
+	/** @param voices Pool size, rounded up to a multiple of Simd::Width. */
+	PolyphonicNode(uint32_t voices, VoiceStealPolicy policy);
+
+	/** @brief Allocates the subclass's per-voice arrays, m_Capacity long. */
+	virtual void PrepareVoices(const PrepareContext& context) = 0;
+	/**
+	 * @brief Sets up @p voice for a new note. The envelope is already
+	 * triggered; a @p stolen voice may keep its state to avoid a click.
+	 */
+	virtual void StartVoice(uint32_t voice, uint32_t note, float velocity,
+							bool stolen) = 0;
+	/** @brief Called once a released voice has faded out. */
+	virtual void FinishVoice(uint32_t /*voice*/) {}
+	/** @brief Called on every control grid point, before rendering. */
+	virtual void UpdateControl() {}
+	/** @brief Called once per block before anything is rendered. */
+	virtual void BeginBlock(const ProcessContext& /*context*/) {}
+	/**
+	 * @brief Adds @p frames frames of voices [group * Width, (group + 1) *
+	 * Width) to @p sums, Simd::Width floats per frame, aligned.
+	 */
+	virtual void RenderGroup(uint32_t group, uint32_t frames,
+							 float* sums) = 0;
+	/** @brief Parameters from ParameterCount on. */
+	virtual void SetVoiceParameter(uint32_t /*id*/, float /*value*/) {}
+
+	[[nodiscard]] bool IsVoiceActive(const uint32_t voice) const
+	{
+		return m_Allocator.IsActive(voice);
+	}
+	/** @brief Block frame the chunk being rendered starts at. */
+	[[nodiscard]] uint32_t GetChunkStart() const { return m_ChunkStart; }
+
+protected:
+	const uint32_t m_Capacity;
+	float m_SampleRate = 48000.0f;
+	EnvelopeBank m_Envelopes;
+
+private:
+	VoiceAllocator m_Allocator;
+	VoiceStealPolicy m_Policy;
+	float m_Gain = 0.25f;
+	float m_NotePriority = 0.0f;
+
+	// Per frame partial sums, Simd::Width lanes each.
+	ArenaArray<float> m_Sums;
+	uint32_t m_FramesToControl = 0;
+	uint32_t m_ChunkStart = 0;
+
+	std::atomic<uint32_t> m_ActiveVoices{0};
+};
+}
@@ -0,0 +1,95 @@
+﻿#pragma once
+#include <bit>
+#include <cstdint>
+
+#include "Simd.hpp"
+
+namespace MT::DSP
+{
+/**
+ * @brief Scrambles a small seed (a channel or voice index) into a nonzero
+ * xorshift state, so neighbouring seeds give unrelated streams.
+ */
+constexpr uint32_t HashSeed(uint32_t x)
+{
+	x ^= x >> 16;
+	x *= 0x7FEB352Du;
+	x ^= x >> 15;
+	x *= 0x846CA68Bu;
+	x ^= x >> 16;
+	return x ? x : 0x9E3779B9u;
+}
+
+/**
+ * @brief Marsaglia's xorshift32, for control-rate and sparse decisions.
+ *
+ * Three shifts and three xors per number; far from cryptographic, but its
+ * period of 2^32 - 1 is ample for audio noise.
+ */
+struct Xorshift32
+{
+	uint32_t State;
+
+	explicit constexpr Xorshift32(const uint32_t seed = 1) :
+		State(HashSeed(seed)) {}
+
+	constexpr uint32_t Next()
+	{
+		State ^= State << 13;
+		State ^= State >> 17;
+		State ^= State << 5;
+		return State;
+	}
+
+	/** @brief Uniform in [0, 1). */
+	float NextUnipolar()
+	{
+		return std::bit_cast<float>((Next() >> 9) | 0x3F800000u) - 1.0f;
+	}
+	/** @brief Uniform in [-1, 1). */
+	float NextBipolar()
+	{
+		return std::bit_cast<float>((Next() >> 9) | 0x40000000u) - 3.0f;
+	}
+};
+
+/**
+ * @brief One independent xorshift32 stream per SIMD lane.
+ *
+ * Each call advances every lane once and yields Simd::Width numbers, so a
+ * block of noise costs a handful of integer instructions per packet.
+ */
+class XorshiftLanes
+{
+public:
+	explicit XorshiftLanes(const uint32_t seed = 1) { Seed(seed); }
+
+	void Seed(const uint32_t seed)
+	{
+		alignas(Simd::Alignment) uint32_t states[Simd::Width];
+		for (uint32_t lane = 0; lane < Simd::Width; lane++)
+			states[lane] = HashSeed(seed * Simd::Width + lane + 1);
+		m_State = Simd::LoadInt(states);
+	}
+
+	Simd::Int Next()
+	{
+		m_State = Simd::Xor(m_State, Simd::ShiftLeft<13>(m_State));
+		m_State = Simd::Xor(m_State, Simd::ShiftRight<17>(m_State));
+		m_State = Simd::Xor(m_State, Simd::ShiftLeft<5>(m_State));
+		return m_State;
+	}
+
+	/** @brief Uniform in [-1, 1) per lane. */
+	Simd::Float NextBipolar()
+	{
+		// 23 random mantissa bits under the exponent of 2 give [2, 4).
+		const Simd::Int bits = Simd::Or(Simd::ShiftRight<9>(Next()),
+										Simd::SetInt(0x40000000u));
+		return Simd::Sub(Simd::AsFloat(bits), Simd::Set(3.0f));
+	}
+
+private:
+	Simd::Int m_State;
+};
+}
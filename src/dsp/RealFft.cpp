@@ -0,0 +1,374 @@
+﻿#include "RealFft.hpp"
+
+#include <bit>
+#include <cmath>
+#include <numbers>
+#include <utility>
+
+
+namespace
+{
+namespace Simd = MT::DSP::Simd;
+constexpr uint32_t Width = Simd::Width;
+
+/** @brief Reverses the low log2(Width) bits of @p index. */
+constexpr uint32_t ReverseLaneBits(const uint32_t index)
+{
+	uint32_t reversed = 0;
+	for (uint32_t bit = 1; bit < Width; bit <<= 1)
+	{
+		reversed <<= 1;
+		if (index & bit)
+			reversed |= 1;
+	}
+	return reversed;
+}
+
+/** @brief Fills @p real and @p imaginary with exp(-2 pi i k / n). */
+void FillTwiddles(float* real, float* imaginary, const uint32_t count,
+				  const uint32_t n, const uint32_t step = 1)
+{
+	for (uint32_t k = 0; k < count; k++)
+	{
+		// Double precision, so the large tables stay exact to a float ulp.
+		const double angle = -2.0 * std::numbers::pi *
+			static_cast<double>(static_cast<uint64_t>(k) * step % n) / n;
+		real[k] = static_cast<float>(std::cos(angle));
+		imaginary[k] = static_cast<float>(std::sin(angle));
+	}
+}
+}
+
+
+void MT::DSP::RealFft::Prepare(MemoryArena* memory, const uint32_t size)
+{
+	m_Size = std::max(std::bit_ceil(size), MinSize);
+	m_Points = m_Size / 2;
+	m_Columns = m_Points / Width;
+
+	for (uint32_t span = 1; span < Width; span <<= 1)
+	{
+		FillTwiddles(m_PacketTwiddles + span, m_PacketTwiddles + Width + span,
+					 span, 2 * span);
+	}
+	m_SplitTwiddles.Allocate(memory, 2 * static_cast<size_t>(m_Points));
+	for (uint32_t k = 0; k < Width; k++)
+	{
+		FillTwiddles(m_SplitTwiddles.Data() + k * m_Columns,
+					 m_SplitTwiddles.Data() + m_Points + k * m_Columns,
+					 m_Columns, m_Points, k);
+	}
+	m_StageTwiddles.Allocate(memory, 2 * static_cast<size_t>(m_Columns));
+	FillTwiddles(m_StageTwiddles.Data(), m_StageTwiddles.Data() + m_Columns,
+				 m_Columns, m_Columns);
+	m_RealTwiddles.Allocate(memory, 2 * static_cast<size_t>(m_Points));
+	FillTwiddles(m_RealTwiddles.Data(), m_RealTwiddles.Data() + m_Points,
+				 m_Points, m_Size);
+	m_Scratch.Allocate(memory, 4 * static_cast<size_t>(m_Points));
+}
+
+void MT::DSP::RealFft::Forward(const float* time, float* real,
+							   float* imaginary)
+{
+	const uint32_t points = m_Points;
+	float* even = m_Scratch.Data();
+	float* odd = even + points;
+	for (uint32_t n = 0; n < points; n += Width)
+	{
+		Simd::Float evens;
+		Simd::Float odds;
+		Simd::Deinterleave(time + 2 * n, evens, odds);
+		Simd::StoreAligned(even + n, evens);
+		Simd::StoreAligned(odd + n, odds);
+	}
+	const float* z = Transform(even, odd);
+	const float* zReal = z;
+	const float* zImaginary = z + points;
+	const float* wReal = m_RealTwiddles.Data();
+	const float* wImaginary = wReal + points;
+
+	// Z[k] and Z[L - k] hold the even and odd spectra mixed:
+	// X[k] = E - i w^k O with E, O the conjugate symmetric and antisymmetric
+	// halves. Bin 0 gets the sum and difference of Z[0]'s parts.
+	real[0] = zReal[0] + zImaginary[0];
+	imaginary[0] = zReal[0] - zImaginary[0];
+	for (uint32_t k = 1; k < Width; k++)
+	{
+		const float cReal = zReal[points - k];
+		const float cImaginary = zImaginary[points - k];
+		const float eReal = 0.5f * (zReal[k] + cReal);
+		const float eImaginary = 0.5f * (zImaginary[k] - cImaginary);
+		const float oReal = 0.5f * (zReal[k] - cReal);
+		const float oImaginary = 0.5f * (zImaginary[k] + cImaginary);
+		real[k] = eReal + wReal[k] * oImaginary + wImaginary[k] * oReal;
+		imaginary[k] = eImaginary - wReal[k] * oReal +
+			wImaginary[k] * oImaginary;
+	}
+	const Simd::Float half = Simd::Set(0.5f);
+	for (uint32_t k = Width; k < points; k += Width)
+	{
+		const Simd::Float r = Simd::LoadAligned(zReal + k);
+		const Simd::Float i = Simd::LoadAligned(zImaginary + k);
+		const Simd::Float cr = Simd::Reverse(Simd::Load(
+			zReal + points - k - Width + 1));
+		const Simd::Float ci = Simd::Reverse(Simd::Load(
+			zImaginary + points - k - Width + 1));
+		const Simd::Float er = Simd::Mul(half, Simd::Add(r, cr));
+		const Simd::Float ei = Simd::Mul(half, Simd::Sub(i, ci));
+		const Simd::Float orr = Simd::Mul(half, Simd::Sub(r, cr));
+		const Simd::Float oi = Simd::Mul(half, Simd::Add(i, ci));
+		const Simd::Float wr = Simd::LoadAligned(wReal + k);
+		const Simd::Float wi = Simd::LoadAligned(wImaginary + k);
+		Simd::StoreAligned(real + k, Simd::MulAdd(wr, oi, Simd::MulAdd(
+			wi, orr, er)));
+		Simd::StoreAligned(imaginary + k, Simd::MulAdd(wi, oi, Simd::Sub(
+			ei, Simd::Mul(wr, orr))));
+	}
+}
+
+void MT::DSP::RealFft::Inverse(const float* real, const float* imaginary,
+							   float* time)
+{
+	const uint32_t points = m_Points;
+	float* zReal = m_Scratch.Data();
+	float* zImaginary = zReal + points;
+	const float* wReal = m_RealTwiddles.Data();
+	const float* wImaginary = wReal + points;
+
+	// Undoes Forward()'s split: Z[k] = E + i conj(w^k) D with E the sum of
+	// X[k] and conj(X[L - k]) and D their difference, twice the true value
+	// so the complex inverse leaves exactly a factor N.
+	zReal[0] = real[0] + imaginary[0];
+	zImaginary[0] = real[0] - imaginary[0];
+	for (uint32_t k = 1; k < Width; k++)
+	{
+		const float cReal = real[points - k];
+		const float cImaginary = imaginary[points - k];
+		const float dReal = real[k] - cReal;
+		const float dImaginary = imaginary[k] + cImaginary;
+		zReal[k] = real[k] + cReal - dImaginary * wReal[k] +
+			dReal * wImaginary[k];
+		zImaginary[k] = imaginary[k] - cImaginary + dReal * wReal[k] +
+			dImaginary * wImaginary[k];
+	}
+	for (uint32_t k = Width; k < points; k += Width)
+	{
+		const Simd::Float r = Simd::LoadAligned(real + k);
+		const Simd::Float i = Simd::LoadAligned(imaginary + k);
+		const Simd::Float cr = Simd::Reverse(Simd::Load(
+			real + points - k - Width + 1));
+		const Simd::Float ci = Simd::Reverse(Simd::Load(
+			imaginary + points - k - Width + 1));
+		const Simd::Float dr = Simd::Sub(r, cr);
+		const Simd::Float di = Simd::Add(i, ci);
+		const Simd::Float wr = Simd::LoadAligned(wReal + k);
+		const Simd::Float wi = Simd::LoadAligned(wImaginary + k);
+		Simd::StoreAligned(zReal + k, Simd::MulAdd(dr, wi, Simd::Sub(
+			Simd::Add(r, cr), Simd::Mul(di, wr))));
+		Simd::StoreAligned(zImaginary + k, Simd::MulAdd(di, wi, Simd::MulAdd(
+			dr, wr, Simd::Sub(i, ci))));
+	}
+
+	// With the parts swapped on the way in and out, the forward transform
+	// computes the inverse one.
+	const float* z = Transform(zImaginary, zReal);
+	const float* swappedReal = z + points;
+	const float* swappedImaginary = z;
+	for (uint32_t n = 0; n < points; n += Width)
+	{
+		Simd::Interleave(time + 2 * n, Simd::LoadAligned(swappedReal + n),
+						 Simd::LoadAligned(swappedImaginary + n));
+	}
+}
+
+void MT::DSP::RealFft::MultiplyAdd(
+	const float* aReal, const float* aImaginary, const float* bReal,
+	const float* bImaginary, float* real, float* imaginary,
+	const uint32_t first, const uint32_t count)
+{
+	// Bin 0 packs two real bins, which multiply separately.
+	const bool packed = first == 0 && count > 0;
+	const float dc = real[0] + aReal[0] * bReal[0];
+	const float nyquist = packed
+		? imaginary[0] + aImaginary[0] * bImaginary[0]
+		: 0.0f;
+	for (uint32_t k = first; k < first + count; k += Width)
+	{
+		const Simd::Float ar = Simd::LoadAligned(aReal + k);
+		const Simd::Float ai = Simd::LoadAligned(aImaginary + k);
+		const Simd::Float br = Simd::LoadAligned(bReal + k);
+		const Simd::Float bi = Simd::LoadAligned(bImaginary + k);
+		Simd::StoreAligned(real + k, Simd::MulAdd(ar, br, Simd::Sub(
+			Simd::LoadAligned(real + k), Simd::Mul(ai, bi))));
+		Simd::StoreAligned(imaginary + k, Simd::MulAdd(ar, bi, Simd::MulAdd(
+			ai, br, Simd::LoadAligned(imaginary + k))));
+	}
+	if (packed)
+	{
+		real[0] = dc;
+		imaginary[0] = nyquist;
+	}
+}
+
+float* MT::DSP::RealFft::Transform(const float* real, const float* imaginary)
+{
+	const uint32_t points = m_Points;
+	const uint32_t columns = m_Columns;
+	float* first = m_Scratch.Data();
+	float* second = first + 2 * static_cast<size_t>(points);
+
+	// Width point DFTs over n2 of x[n1 + M n2], a packet of n1 at a time,
+	// times w_L^(n1 k2), transposed so that point n1 of DFT k2 lands at
+	// n1 * Width + k2: a Width point DFT of each column follows.
+	const float* splitReal = m_SplitTwiddles.Data();
+	const float* splitImaginary = splitReal + points;
+	for (uint32_t n1 = 0; n1 < columns; n1 += Width)
+	{
+		Simd::Float r[Width];
+		Simd::Float i[Width];
+		for (uint32_t n2 = 0; n2 < Width; n2++)
+		{
+			r[n2] = Simd::LoadAligned(real + n1 + n2 * columns);
+			i[n2] = Simd::LoadAligned(imaginary + n1 + n2 * columns);
+		}
+		for (uint32_t span = Width / 2; span >= 1; span /= 2)
+		{
+			for (uint32_t start = 0; start < Width; start += 2 * span)
+			{
+				for (uint32_t k = 0; k < span; k++)
+				{
+					const uint32_t a = start + k;
+					const uint32_t b = a + span;
+					const Simd::Float dr = Simd::Sub(r[a], r[b]);
+					const Simd::Float di = Simd::Sub(i[a], i[b]);
+					r[a] = Simd::Add(r[a], r[b]);
+					i[a] = Simd::Add(i[a], i[b]);
+					const Simd::Float wr = Simd::Set(
+						m_PacketTwiddles[span + k]);
+					const Simd::Float wi = Simd::Set(
+						m_PacketTwiddles[Width + span + k]);
+					r[b] = Simd::Sub(Simd::Mul(dr, wr), Simd::Mul(di, wi));
+					i[b] = Simd::MulAdd(dr, wi, Simd::Mul(di, wr));
+				}
+			}
+		}
+
+		// The DFT leaves bin k2 at the bit reversed slot.
+		Simd::Float outReal[Width];
+		Simd::Float outImaginary[Width];
+		outReal[0] = r[0];
+		outImaginary[0] = i[0];
+		for (uint32_t k2 = 1; k2 < Width; k2++)
+		{
+			const uint32_t slot = ReverseLaneBits(k2);
+			const size_t at = static_cast<size_t>(k2) * columns + n1;
+			const Simd::Float wr = Simd::LoadAligned(splitReal + at);
+			const Simd::Float wi = Simd::LoadAligned(splitImaginary + at);
+			outReal[k2] = Simd::Sub(Simd::Mul(r[slot], wr),
+									Simd::Mul(i[slot], wi));
+			outImaginary[k2] = Simd::MulAdd(r[slot], wi,
+											Simd::Mul(i[slot], wr));
+		}
+		Simd::Transpose(outReal);
+		Simd::Transpose(outImaginary);
+		for (uint32_t row = 0; row < Width; row++)
+		{
+			const size_t at = static_cast<size_t>(n1 + row) * Width;
+			Simd::StoreAligned(second + at, outReal[row]);
+			Simd::StoreAligned(second + points + at, outImaginary[row]);
+		}
+	}
+
+	// Stockham over n1 for all Width columns at once, radix 4 while it
+	// divides: a stage of length n and stride s sends x[q + s (p + j n / 4)]
+	// to y[q + s (4 p + k)], so output bin k1 of column k2 lands at
+	// k2 + Width k1, the natural order.
+	const float* stageReal = m_StageTwiddles.Data();
+	const float* stageImaginary = stageReal + columns;
+	float* x = second;
+	float* y = first;
+	uint32_t n = columns;
+	uint32_t stride = Width;
+	for (; n >= 4; n /= 4, stride *= 4)
+	{
+		const uint32_t quarter = n / 4;
+		const uint32_t step = columns / n;
+		const float* xi = x + points;
+		float* yi = y + points;
+		for (uint32_t p = 0; p < quarter; p++)
+		{
+			const Simd::Float w1r = Simd::Set(stageReal[p * step]);
+			const Simd::Float w1i = Simd::Set(stageImaginary[p * step]);
+			const Simd::Float w2r = Simd::Set(stageReal[2 * p * step]);
+			const Simd::Float w2i = Simd::Set(stageImaginary[2 * p * step]);
+			const Simd::Float w3r = Simd::Set(stageReal[3 * p * step]);
+			const Simd::Float w3i = Simd::Set(stageImaginary[3 * p * step]);
+			const size_t in = static_cast<size_t>(stride) * p;
+			const size_t apart = static_cast<size_t>(stride) * quarter;
+			const size_t out = static_cast<size_t>(stride) * 4 * p;
+			for (uint32_t q = 0; q < stride; q += Width)
+			{
+				const size_t a = in + q;
+				const Simd::Float ar = Simd::LoadAligned(x + a);
+				const Simd::Float ai = Simd::LoadAligned(xi + a);
+				const Simd::Float br = Simd::LoadAligned(x + a + apart);
+				const Simd::Float bi = Simd::LoadAligned(xi + a + apart);
+				const Simd::Float cr = Simd::LoadAligned(x + a + 2 * apart);
+				const Simd::Float ci = Simd::LoadAligned(xi + a + 2 * apart);
+				const Simd::Float dr = Simd::LoadAligned(x + a + 3 * apart);
+				const Simd::Float di = Simd::LoadAligned(xi + a + 3 * apart);
+				const Simd::Float sumR = Simd::Add(ar, cr);
+				const Simd::Float sumI = Simd::Add(ai, ci);
+				const Simd::Float differenceR = Simd::Sub(ar, cr);
+				const Simd::Float differenceI = Simd::Sub(ai, ci);
+				const Simd::Float pairR = Simd::Add(br, dr);
+				const Simd::Float pairI = Simd::Add(bi, di);
+				// -i (b - d)
+				const Simd::Float turnR = Simd::Sub(bi, di);
+				const Simd::Float turnI = Simd::Sub(dr, br);
+
+				const size_t b = out + q;
+				Simd::StoreAligned(y + b, Simd::Add(sumR, pairR));
+				Simd::StoreAligned(yi + b, Simd::Add(sumI, pairI));
+				Simd::Float r = Simd::Add(differenceR, turnR);
+				Simd::Float i = Simd::Add(differenceI, turnI);
+				Simd::StoreAligned(y + b + stride, Simd::Sub(
+					Simd::Mul(r, w1r), Simd::Mul(i, w1i)));
+				Simd::StoreAligned(yi + b + stride, Simd::MulAdd(
+					r, w1i, Simd::Mul(i, w1r)));
+				r = Simd::Sub(sumR, pairR);
+				i = Simd::Sub(sumI, pairI);
+				Simd::StoreAligned(y + b + 2 * stride, Simd::Sub(
+					Simd::Mul(r, w2r), Simd::Mul(i, w2i)));
+				Simd::StoreAligned(yi + b + 2 * stride, Simd::MulAdd(
+					r, w2i, Simd::Mul(i, w2r)));
+				r = Simd::Sub(differenceR, turnR);
+				i = Simd::Sub(differenceI, turnI);
+				Simd::StoreAligned(y + b + 3 * stride, Simd::Sub(
+					Simd::Mul(r, w3r), Simd::Mul(i, w3i)));
+				Simd::StoreAligned(yi + b + 3 * stride, Simd::MulAdd(
+					r, w3i, Simd::Mul(i, w3r)));
+			}
+		}
+		std::swap(x, y);
+	}
+	// An odd power of two leaves a last radix-2 stage without twiddles.
+	if (n == 2)
+	{
+		const float* xi = x + points;
+		float* yi = y + points;
+		for (uint32_t q = 0; q < stride; q += Width)
+		{
+			const Simd::Float ar = Simd::LoadAligned(x + q);
+			const Simd::Float ai = Simd::LoadAligned(xi + q);
+			const Simd::Float br = Simd::LoadAligned(x + stride + q);
+			const Simd::Float bi = Simd::LoadAligned(xi + stride + q);
+			Simd::StoreAligned(y + q, Simd::Add(ar, br));
+			Simd::StoreAligned(yi + q, Simd::Add(ai, bi));
+			Simd::StoreAligned(y + stride + q, Simd::Sub(ar, br));
+			Simd::StoreAligned(yi + stride + q, Simd::Sub(ai, bi));
+		}
+		std::swap(x, y);
+	}
+	return x;
+}
@@ -0,0 +1,87 @@
+﻿#pragma once
+#include <cstdint>
+
+#include "MemoryArena.hpp"
+#include "Simd.hpp"
+
+namespace MT::DSP
+{
+/**
+ * @brief Power-of-two FFT of real signals, written for SIMD packets.
+ *
+ * A real signal of N samples is transformed as a complex one of L = N / 2
+ * points, even samples in the real part and odd ones in the imaginary part,
+ * and the two interleaved half spectra are pulled apart in a last pass.
+ * The complex transform is split four-step style as L = Width * M: Width
+ * point DFTs across packets of M-strided points, a twiddle, a transpose in
+ * registers, then a Stockham radix-4 transform of M points whose every
+ * butterfly works on whole packets. No stage runs lane by lane and the
+ * output comes out in natural order without a bit reversal.
+ *
+ * Spectra are split into real and imaginary arrays of N / 2 floats each.
+ * Bins 0 and N / 2 are both real, so the imaginary slot of bin 0 carries
+ * bin N / 2, as in most real FFT libraries; MultiplyAdd() knows about it.
+ *
+ * Twiddles and scratch space are set up by Prepare() on the control thread.
+ * A transform then neither allocates nor locks, but uses the instance's
+ * scratch space, so one instance serves one thread at a time.
+ */
+class RealFft
+{
+public:
+	/** @brief Smallest size: the complex points must fill Width packets. */
+	static constexpr uint32_t MinSize = 2 * Simd::Width * Simd::Width;
+
+	/** @param size Power of two, at least MinSize. */
+	void Prepare(MemoryArena* memory, uint32_t size);
+
+	[[nodiscard]] uint32_t GetSize() const { return m_Size; }
+
+	/**
+	 * @brief Spectrum of @p time, GetSize() samples, into @p real and
+	 * @p imaginary, GetSize() / 2 floats each and packet aligned.
+	 */
+	void Forward(const float* time, float* real, float* imaginary);
+	/**
+	 * @brief Signal of a spectrum laid out like Forward()'s output, scaled
+	 * by GetSize(): Inverse() of Forward() multiplies by the size.
+	 */
+	void Inverse(const float* real, const float* imaginary, float* time);
+
+	/**
+	 * @brief Adds the product of two spectra, bins @p first up to
+	 * @p first + @p count, to an accumulated one. Both bounds must be
+	 * multiples of Simd::Width.
+	 */
+	static void MultiplyAdd(const float* aReal, const float* aImaginary,
+							const float* bReal, const float* bImaginary,
+							float* real, float* imaginary, uint32_t first,
+							uint32_t count);
+
+private:
+	/**
+	 * @brief Complex transform of the L points at @p real, @p imaginary.
+	 * Returns where the result went, real parts first and the imaginary
+	 * parts L floats on; the input may be clobbered.
+	 */
+	float* Transform(const float* real, const float* imaginary);
+
+private:
+	uint32_t m_Size = 0;
+	/** @brief Complex points, L. */
+	uint32_t m_Points = 0;
+	/** @brief Points of the Stockham stage, M = L / Width. */
+	uint32_t m_Columns = 0;
+
+	/** @brief Width point DFT twiddles, those of span s at s to 2s - 1. */
+	float m_PacketTwiddles[2 * Simd::Width] = {};
+	/** @brief w_L^(n k) for k < Width and n < M, row k at k * M. */
+	ArenaArray<float> m_SplitTwiddles;
+	/** @brief w_M^k for k < M, real parts then imaginary. */
+	ArenaArray<float> m_StageTwiddles;
+	/** @brief w_N^k for k < L, real parts then imaginary. */
+	ArenaArray<float> m_RealTwiddles;
+	/** @brief Two complex buffers of L points, split like spectra. */
+	ArenaArray<float> m_Scratch;
+};
+}
@@ -0,0 +1,421 @@
+﻿#pragma once
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+#include <Eigen/Core>
+
+#if defined(EIGEN_VECTORIZE_AVX2) || defined(EIGEN_VECTORIZE_AVX512)
+#include <immintrin.h>
+#endif
+
+namespace MT::DSP::Simd
+{
+/**
+ * @brief Thin wrapper over Eigen's packet math.
+ *
+ * Eigen already picks the widest float packet the build targets (SSE, AVX,
+ * AVX-512, NEON) and falls back to plain scalars when vectorization is off,
+ * so DSP kernels written against these helpers compile everywhere. Integer
+ * packets have the same lane count as float packets and are treated as
+ * unsigned: shifts are logical.
+ *
+ * The float helpers are templates over the packet type, Float by default.
+ * Instantiated with plain float they turn into scalar code, so a kernel
+ * written once also yields a one-lane reference version.
+ */
+using Float = Eigen::internal::packet_traits<float>::type;
+using Int = Eigen::internal::packet_traits<int32_t>::type;
+
+/** @brief Lanes per packet. */
+inline constexpr uint32_t Width = Eigen::internal::packet_traits<float>::size;
+static_assert(Eigen::internal::packet_traits<int32_t>::size == Width,
+			  "Float and integer packets must have the same lane count");
+
+/** @brief Alignment in bytes that LoadAligned()/StoreAligned() require. */
+inline constexpr size_t Alignment = sizeof(Float);
+
+template<typename P = Float>
+P Set(const float value)
+{
+	return Eigen::internal::pset1<P>(value);
+}
+/** @brief {start, start + 1, ..., start + Width - 1}. */
+inline Float Ramp(const float start)
+{
+	return Eigen::internal::plset<Float>(start);
+}
+template<typename P = Float>
+P Load(const float* source)
+{
+	return Eigen::internal::ploadu<P>(source);
+}
+template<typename P = Float>
+P LoadAligned(const float* source)
+{
+	return Eigen::internal::pload<P>(source);
+}
+template<typename P>
+void Store(float* destination, const P& value)
+{
+	Eigen::internal::pstoreu(destination, value);
+}
+template<typename P>
+void StoreAligned(float* destination, const P& value)
+{
+	Eigen::internal::pstore(destination, value);
+}
+
+template<typename P>
+P Add(const P& a, const P& b)
+{
+	return Eigen::internal::padd(a, b);
+}
+template<typename P>
+P Sub(const P& a, const P& b)
+{
+	return Eigen::internal::psub(a, b);
+}
+template<typename P>
+P Mul(const P& a, const P& b)
+{
+	return Eigen::internal::pmul(a, b);
+}
+template<typename P>
+P Div(const P& a, const P& b)
+{
+	return Eigen::internal::pdiv(a, b);
+}
+/** @brief a * b + c, fused where the target supports it. */
+template<typename P>
+P MulAdd(const P& a, const P& b, const P& c)
+{
+	return Eigen::internal::pmadd(a, b, c);
+}
+template<typename P>
+P Min(const P& a, const P& b)
+{
+	return Eigen::internal::pmin(a, b);
+}
+template<typename P>
+P Max(const P& a, const P& b)
+{
+	return Eigen::internal::pmax(a, b);
+}
+template<typename P>
+P Abs(const P& a)
+{
+	return Eigen::internal::pabs(a);
+}
+template<typename P>
+P Floor(const P& a)
+{
+	return Eigen::internal::pfloor(a);
+}
+/** @brief Sine of radians, within a few ulp for moderate arguments. */
+template<typename P>
+P Sin(const P& a)
+{
+	return Eigen::internal::psin(a);
+}
+template<typename P>
+P Cos(const P& a)
+{
+	return Eigen::internal::pcos(a);
+}
+template<typename P>
+P Exp(const P& a)
+{
+	return Eigen::internal::pexp(a);
+}
+/** @brief The lanes of @p a in reverse order. */
+template<typename P>
+P Reverse(const P& a)
+{
+	return Eigen::internal::preverse(a);
+}
+/** @brief Horizontal sum of all lanes. */
+template<typename P>
+float Sum(const P& a)
+{
+	return Eigen::internal::predux(a);
+}
+
+/** @brief All-ones lanes where a < b. */
+template<typename P>
+P Less(const P& a, const P& b)
+{
+	return Eigen::internal::pcmp_lt(a, b);
+}
+/** @brief Lanes of @p a where @p mask is set, of @p b elsewhere. */
+template<typename P>
+P Select(const P& mask, const P& a, const P& b)
+{
+	return Eigen::internal::pselect(mask, a, b);
+}
+
+/**
+ * @brief sin(2 pi a) for an angle in cycles, accurate to about 1e-6.
+ *
+ * Much cheaper than Sin(): the angle is wrapped to [-0.5, 0.5) and folded
+ * into a quarter cycle, where a Taylor polynomial up to degree 11 suffices.
+ */
+template<typename P>
+P SinCycles(const P& a)
+{
+	const P wrapped = Sub(a, Floor(Add(a, Set<P>(0.5f))));
+	const P magnitude = Abs(wrapped);
+	const P x = Mul(Min(magnitude, Sub(Set<P>(0.5f), magnitude)),
+					Set<P>(6.28318531f));
+	const P x2 = Mul(x, x);
+	P poly = MulAdd(x2, Set<P>(-2.50521084e-8f), Set<P>(2.75573192e-6f));
+	poly = MulAdd(x2, poly, Set<P>(-1.98412698e-4f));
+	poly = MulAdd(x2, poly, Set<P>(8.33333333e-3f));
+	poly = MulAdd(x2, poly, Set<P>(-1.66666667e-1f));
+	poly = MulAdd(x2, poly, Set<P>(1.0f));
+	const P sine = Mul(x, poly);
+	return Select(Less(wrapped, Set<P>(0.0f)), Sub(Set<P>(0.0f), sine), sine);
+}
+
+/**
+ * @brief tan(pi a) for a in [0, 0.5), as @p numerator / @p denominator so
+ * a caller dividing by an expression of it anyway can fold the divisions.
+ *
+ * Below a quarter cycle a degree 13 odd polynomial (Cephes' tanf) is
+ * accurate to about 1e-7 relative; above it the complement's tangent is
+ * inverted, which only swaps the two halves. Rounding of the complement
+ * leaves a few 1e-6 at a = 0.49.
+ */
+template<typename P>
+void TanPiRatio(const P& a, P& numerator, P& denominator)
+{
+	const P x = Mul(a, Set<P>(3.14159265f));
+	const P complement = Sub(Set<P>(1.57079633f), x);
+	const P upper = Less(complement, x);
+	const P y = Min(x, complement);
+	const P z = Mul(y, y);
+	P poly = MulAdd(z, Set<P>(9.38540185543e-3f), Set<P>(3.11992232697e-3f));
+	poly = MulAdd(z, poly, Set<P>(2.44301354525e-2f));
+	poly = MulAdd(z, poly, Set<P>(5.34112807005e-2f));
+	poly = MulAdd(z, poly, Set<P>(1.33387994085e-1f));
+	poly = MulAdd(z, poly, Set<P>(3.33331568548e-1f));
+	const P tangent = MulAdd(Mul(z, y), poly, y);
+	const P one = Set<P>(1.0f);
+	numerator = Select(upper, one, tangent);
+	denominator = Select(upper, tangent, one);
+}
+
+/** @brief tan(pi a) for a in [0, 0.5), see TanPiRatio(). */
+template<typename P>
+P TanPi(const P& a)
+{
+	P numerator;
+	P denominator;
+	TanPiRatio(a, numerator, denominator);
+	return Div(numerator, denominator);
+}
+
+inline Int SetInt(const uint32_t value)
+{
+	return Eigen::internal::pset1<Int>(static_cast<int32_t>(value));
+}
+inline Int LoadInt(const uint32_t* source)
+{
+	return Eigen::internal::ploadu<Int>(
+		reinterpret_cast<const int32_t*>(source));
+}
+inline void StoreInt(uint32_t* destination, const Int& value)
+{
+	Eigen::internal::pstoreu(reinterpret_cast<int32_t*>(destination), value);
+}
+inline Int AddInt(const Int& a, const Int& b)
+{
+	return Eigen::internal::padd(a, b);
+}
+inline Int Xor(const Int& a, const Int& b)
+{
+	return Eigen::internal::pxor(a, b);
+}
+inline Int Or(const Int& a, const Int& b)
+{
+	return Eigen::internal::por(a, b);
+}
+template<int N>
+Int ShiftLeft(const Int& a)
+{
+	return Eigen::internal::plogical_shift_left<N>(a);
+}
+template<int N>
+Int ShiftRight(const Int& a)
+{
+	return Eigen::internal::plogical_shift_right<N>(a);
+}
+/** @brief Reinterprets the bits of integer lanes as floats. */
+inline Float AsFloat(const Int& a)
+{
+	return Eigen::internal::preinterpret<Float>(a);
+}
+/** @brief Converts to integers, rounding toward zero. */
+inline Int TruncateToInt(const Float& a)
+{
+	return Eigen::internal::pcast<Float, Int>(a);
+}
+inline Float ToFloat(const Int& a)
+{
+	return Eigen::internal::pcast<Int, Float>(a);
+}
+
+/**
+ * @brief 2^a, accurate to about 6e-6 relative.
+ *
+ * Cheaper than Exp(): the integer part goes straight into the exponent
+ * bits and a degree 6 Taylor polynomial covers the fraction. @p a is
+ * clamped to [-126, 126] first so the exponent cannot wrap, which makes
+ * far out of range arguments saturate instead of returning garbage.
+ * Plain floats use std::exp2().
+ */
+template<typename P = Float>
+P Exp2(const P& a)
+{
+	if constexpr (std::is_same_v<P, float>)
+	{
+		return std::exp2(a);
+	}
+	else
+	{
+		const P clamped = Min(Max(a, Set<P>(-126.0f)), Set<P>(126.0f));
+		const P whole = Floor(clamped);
+		const P x = Sub(clamped, whole);
+		P poly = MulAdd(x, Set<P>(1.53534e-4f), Set<P>(1.33989e-3f));
+		poly = MulAdd(x, poly, Set<P>(9.61844e-3f));
+		poly = MulAdd(x, poly, Set<P>(5.55033e-2f));
+		poly = MulAdd(x, poly, Set<P>(2.40227e-1f));
+		poly = MulAdd(x, poly, Set<P>(6.93147e-1f));
+		poly = MulAdd(x, poly, Set<P>(1.0f));
+		const Int exponent = ShiftLeft<23>(AddInt(TruncateToInt(whole),
+												  SetInt(127)));
+		return Mul(poly, AsFloat(exponent));
+	}
+}
+
+/**
+ * @brief Transposes a square block of packets in registers: afterwards
+ * lane j of @p rows[i] holds what lane i of @p rows[j] held. Forced
+ * inline, as an out of line call would pass the block through memory.
+ */
+template<typename P, int Count>
+EIGEN_ALWAYS_INLINE void Transpose(P (&rows)[Count])
+{
+	static_assert(Count == Width, "The block must be square");
+	if constexpr (Count > 1)
+	{
+		Eigen::internal::PacketBlock<P, Count> block;
+		for (int i = 0; i < Count; i++)
+			block.packet[i] = rows[i];
+		Eigen::internal::ptranspose(block);
+		for (int i = 0; i < Count; i++)
+			rows[i] = block.packet[i];
+	}
+}
+
+/**
+ * @brief Splits the 2 * Width floats at @p source, which need no alignment,
+ * into the even and the odd numbered ones.
+ */
+inline void Deinterleave(const float* source, Float& even, Float& odd)
+{
+#if defined(EIGEN_VECTORIZE_AVX512)
+	if constexpr (Width == 16)
+	{
+		const __m512 a = _mm512_loadu_ps(source);
+		const __m512 b = _mm512_loadu_ps(source + 16);
+		const __m512i evens = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16,
+												18, 20, 22, 24, 26, 28, 30);
+		even = _mm512_permutex2var_ps(a, evens, b);
+		odd = _mm512_permutex2var_ps(
+			a, _mm512_add_epi32(evens, _mm512_set1_epi32(1)), b);
+		return;
+	}
+#endif
+#if defined(EIGEN_VECTORIZE_AVX2)
+	if constexpr (Width == 8)
+	{
+		// Shuffles work within 128-bit halves, the permute joins them.
+		const __m256 a = _mm256_loadu_ps(source);
+		const __m256 b = _mm256_loadu_ps(source + 8);
+		const __m256 evens = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+		const __m256 odds = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+		even = _mm256_castpd_ps(_mm256_permute4x64_pd(
+			_mm256_castps_pd(evens), _MM_SHUFFLE(3, 1, 2, 0)));
+		odd = _mm256_castpd_ps(_mm256_permute4x64_pd(
+			_mm256_castps_pd(odds), _MM_SHUFFLE(3, 1, 2, 0)));
+		return;
+	}
+#endif
+	alignas(Alignment) float evens[Width];
+	alignas(Alignment) float odds[Width];
+	for (uint32_t lane = 0; lane < Width; lane++)
+	{
+		evens[lane] = source[2 * lane];
+		odds[lane] = source[2 * lane + 1];
+	}
+	even = Eigen::internal::pload<Float>(evens);
+	odd = Eigen::internal::pload<Float>(odds);
+}
+
+/** @brief Undoes Deinterleave(): 2 * Width floats to @p destination. */
+inline void Interleave(float* destination, const Float& even, const Float& odd)
+{
+#if defined(EIGEN_VECTORIZE_AVX512)
+	if constexpr (Width == 16)
+	{
+		const __m512i low = _mm512_setr_epi32(0, 16, 1, 17, 2, 18, 3, 19, 4,
+											  20, 5, 21, 6, 22, 7, 23);
+		_mm512_storeu_ps(destination, _mm512_permutex2var_ps(even, low, odd));
+		_mm512_storeu_ps(destination + 16, _mm512_permutex2var_ps(
+			even, _mm512_add_epi32(low, _mm512_set1_epi32(8)), odd));
+		return;
+	}
+#endif
+#if defined(EIGEN_VECTORIZE_AVX2)
+	if constexpr (Width == 8)
+	{
+		const __m256 evens = _mm256_castpd_ps(_mm256_permute4x64_pd(
+			_mm256_castps_pd(even), _MM_SHUFFLE(3, 1, 2, 0)));
+		const __m256 odds = _mm256_castpd_ps(_mm256_permute4x64_pd(
+			_mm256_castps_pd(odd), _MM_SHUFFLE(3, 1, 2, 0)));
+		_mm256_storeu_ps(destination, _mm256_unpacklo_ps(evens, odds));
+		_mm256_storeu_ps(destination + 8, _mm256_unpackhi_ps(evens, odds));
+		return;
+	}
+#endif
+	alignas(Alignment) float evens[Width];
+	alignas(Alignment) float odds[Width];
+	Eigen::internal::pstore(evens, even);
+	Eigen::internal::pstore(odds, odd);
+	for (uint32_t lane = 0; lane < Width; lane++)
+	{
+		destination[2 * lane] = evens[lane];
+		destination[2 * lane + 1] = odds[lane];
+	}
+}
+
+/** @brief {base[index[0]], base[index[1]], ...}, indices must be in range. */
+inline Float Gather(const float* base, const Int& index)
+{
+#if defined(EIGEN_VECTORIZE_AVX512)
+	if constexpr (Width == 16)
+		return _mm512_i32gather_ps(index, base, 4);
+#endif
+#if defined(EIGEN_VECTORIZE_AVX2)
+	if constexpr (Width == 8)
+		return _mm256_i32gather_ps(base, index, 4);
+#endif
+	alignas(Alignment) int32_t indices[Width];
+	alignas(Alignment) float values[Width];
+	Eigen::internal::pstore(indices, index);
+	for (uint32_t lane = 0; lane < Width; lane++)
+		values[lane] = base[indices[lane]];
+	return Eigen::internal::pload<Float>(values);
+}
+}
@@ -0,0 +1,77 @@
+﻿#pragma once
+#include "Simd.hpp"
+
+/**
+ * @brief The trapezoidal (topology-preserving, zero-delay feedback) state
+ * variable filter, written against Simd so it runs on packets or plain
+ * floats.
+ *
+ * The two integrators are discretized with the trapezoidal rule and the
+ * feedback loop is solved per sample rather than delayed, so the response
+ * matches the analog prototype up to the tangent frequency warp and stays
+ * stable however fast the cutoff moves. That makes it the filter to sweep
+ * at audio rate: Design() is a tangent and one division, cheap enough to
+ * run every sample, and Tick() yields all four responses at once.
+ */
+namespace MT::DSP::Svf
+{
+template<typename P>
+struct Coefficients
+{
+	P A1;
+	P A2;
+	P A3;
+	/** @brief Damping, 1 / Q. */
+	P K;
+};
+
+template<typename P>
+struct Outputs
+{
+	P LowPass;
+	P BandPass;
+	P HighPass;
+	/** @brief LowPass + HighPass. */
+	P Notch;
+};
+
+/**
+ * @brief Coefficients for a cutoff of @p normalized times the sample rate,
+ * in (0, 0.5), and @p damping, 1 / Q.
+ *
+ * With g = tan(pi normalized) = n / d, a1 = 1 / (1 + g (g + k)) expands to
+ * d^2 / (d^2 + n^2 + k n d), and a2 = g a1, a3 = g a2 share the same
+ * denominator, so the tangent costs no division of its own.
+ */
+template<typename P>
+Coefficients<P> Design(const P& normalized, const P& damping)
+{
+	P numerator;
+	P denominator;
+	Simd::TanPiRatio(normalized, numerator, denominator);
+	const P cross = Simd::Mul(numerator, denominator);
+	const P inverse = Simd::Div(Simd::Set<P>(1.0f), Simd::MulAdd(
+		damping, cross, Simd::MulAdd(numerator, numerator,
+									 Simd::Mul(denominator, denominator))));
+	return {Simd::Mul(Simd::Mul(denominator, denominator), inverse),
+			Simd::Mul(cross, inverse),
+			Simd::Mul(Simd::Mul(numerator, numerator), inverse), damping};
+}
+
+/**
+ * @brief Filters one sample @p x. @p band and @p low are the integrator
+ * states, zero for a filter at rest.
+ */
+template<typename P>
+Outputs<P> Tick(const Coefficients<P>& c, P& band, P& low, const P& x)
+{
+	const P v3 = Simd::Sub(x, low);
+	const P v1 = Simd::MulAdd(c.A1, band, Simd::Mul(c.A2, v3));
+	const P v2 = Simd::Add(low, Simd::MulAdd(c.A2, band,
+											  Simd::Mul(c.A3, v3)));
+	band = Simd::Sub(Simd::Add(v1, v1), band);
+	low = Simd::Sub(Simd::Add(v2, v2), low);
+	const P notch = Simd::Sub(x, Simd::Mul(c.K, v1));
+	return {v2, v1, Simd::Sub(notch, v2), notch};
+}
+}
@@ -0,0 +1,92 @@
+﻿#include "VoiceAllocator.hpp"
+
+
+void MT::DSP::VoiceAllocator::Prepare(MemoryArena* memory,
+									  const uint32_t capacity)
+{
+	m_Capacity = capacity;
+	m_States.Allocate(memory, capacity);
+	m_Notes.Allocate(memory, capacity);
+	m_Priorities.Allocate(memory, capacity);
+	m_StartTimes.Allocate(memory, capacity);
+	m_FreeStack.Allocate(memory, capacity);
+	m_GroupCounts.Allocate(memory, (capacity + Simd::Width - 1) /
+						   Simd::Width);
+	m_Clock = 0;
+
+	// Lowest voice index on top, so light use keeps to the first groups.
+	m_FreeCount = capacity;
+	for (uint32_t i = 0; i < capacity; i++)
+		m_FreeStack[i] = capacity - 1 - i;
+}
+
+uint32_t MT::DSP::VoiceAllocator::Allocate(const uint32_t note,
+										   const float priority,
+										   const VoiceStealPolicy policy,
+										   const float* levels, bool& stolen)
+{
+	uint32_t voice = NoVoice;
+	stolen = false;
+	if (m_FreeCount > 0)
+	{
+		voice = m_FreeStack[--m_FreeCount];
+		m_GroupCounts[voice / Simd::Width]++;
+	}
+	else
+	{
+		voice = FindVictim(policy, levels);
+		if (voice == NoVoice)
+			return NoVoice;
+		if (policy == VoiceStealPolicy::LowestPriority &&
+			m_States[voice] == State::Held && m_Priorities[voice] > priority)
+			return NoVoice;
+		stolen = true;
+	}
+
+	m_States[voice] = State::Held;
+	m_Notes[voice] = note;
+	m_Priorities[voice] = priority;
+	m_StartTimes[voice] = ++m_Clock;
+	return voice;
+}
+
+void MT::DSP::VoiceAllocator::Free(const uint32_t voice)
+{
+	if (m_States[voice] == State::Free)
+		return;
+	m_States[voice] = State::Free;
+	m_FreeStack[m_FreeCount++] = voice;
+	m_GroupCounts[voice / Simd::Width]--;
+}
+
+uint32_t MT::DSP::VoiceAllocator::FindVictim(const VoiceStealPolicy policy,
+											 const float* levels) const
+{
+	// Lexicographic: released before held, then the policy's key, then age.
+	uint32_t best = NoVoice;
+	const auto isBetter = [&](const uint32_t candidate)
+	{
+		if (best == NoVoice)
+			return true;
+
+		const bool candidateReleased = m_States[candidate] == State::Released;
+		const bool bestReleased = m_States[best] == State::Released;
+		if (candidateReleased != bestReleased)
+			return candidateReleased;
+
+		if (policy == VoiceStealPolicy::Quietest && levels &&
+			levels[candidate] != levels[best])
+			return levels[candidate] < levels[best];
+		if (policy == VoiceStealPolicy::LowestPriority &&
+			m_Priorities[candidate] != m_Priorities[best])
+			return m_Priorities[candidate] < m_Priorities[best];
+		return m_StartTimes[candidate] < m_StartTimes[best];
+	};
+
+	for (uint32_t voice = 0; voice < m_Capacity; voice++)
+	{
+		if (m_States[voice] != State::Free && isBetter(voice))
+			best = voice;
+	}
+	return best;
+}
@@ -0,0 +1,122 @@
+﻿#pragma once
+#include <cstdint>
+
+#include "MemoryArena.hpp"
+#include "Simd.hpp"
+
+namespace MT::DSP
+{
+/** @brief Which playing voice a note takes when every voice is busy. */
+enum class VoiceStealPolicy : uint32_t
+{
+	/** @brief The voice that started first. */
+	Oldest,
+	/** @brief The voice with the lowest current output level. */
+	Quietest,
+	/**
+	 * @brief The voice with the lowest priority, oldest first among equals.
+	 * A note is dropped rather than steal a voice of higher priority.
+	 */
+	LowestPriority,
+	Count
+};
+
+/**
+ * @brief Bookkeeping for a fixed set of voices: which are free, which note
+ * each plays, and which one to steal.
+ *
+ * Voice state is kept as parallel arrays indexed by voice, so an engine can
+ * keep its own per-voice DSP state the same way and process voices in SIMD
+ * groups; the number of busy voices in every group of Simd::Width is
+ * tracked so idle groups can be skipped. Released voices are always stolen
+ * before held ones. Free voices sit on a stack, so allocation never
+ * searches unless it has to steal, and nothing allocates after Prepare().
+ */
+class VoiceAllocator
+{
+public:
+	static constexpr uint32_t NoVoice = 0xFFFFFFFF;
+
+	/** @brief Control thread. Sizes the pool; every voice starts free. */
+	void Prepare(MemoryArena* memory, uint32_t capacity);
+
+	/**
+	 * @brief Assigns a voice to a new note.
+	 *
+	 * @param levels Current output level of every voice, for the Quietest
+	 * policy; may be null for the other policies.
+	 * @param stolen Set when the voice was still playing another note.
+	 * @return NoVoice if the policy refused to steal.
+	 */
+	uint32_t Allocate(uint32_t note, float priority, VoiceStealPolicy policy,
+					  const float* levels, bool& stolen);
+
+	/**
+	 * @brief Marks every held voice playing @p note as released and calls
+	 * @p onRelease with each of them.
+	 */
+	template<typename Callback>
+	void Release(const uint32_t note, Callback&& onRelease)
+	{
+		for (uint32_t voice = 0; voice < m_Capacity; voice++)
+		{
+			if (m_States[voice] != State::Held || m_Notes[voice] != note)
+				continue;
+			m_States[voice] = State::Released;
+			onRelease(voice);
+		}
+	}
+
+	/** @brief Returns a voice whose sound has finished to the free stack. */
+	void Free(uint32_t voice);
+
+	[[nodiscard]] bool IsActive(const uint32_t voice) const
+	{
+		return m_States[voice] != State::Free;
+	}
+	[[nodiscard]] bool IsReleased(const uint32_t voice) const
+	{
+		return m_States[voice] == State::Released;
+	}
+	[[nodiscard]] uint32_t GetNote(const uint32_t voice) const
+	{
+		return m_Notes[voice];
+	}
+	[[nodiscard]] uint32_t GetActiveCount() const
+	{
+		return m_Capacity - m_FreeCount;
+	}
+	[[nodiscard]] uint32_t GetCapacity() const { return m_Capacity; }
+	/** @brief Whether voices [group * Width, (group + 1) * Width) are idle. */
+	[[nodiscard]] bool IsGroupActive(const uint32_t group) const
+	{
+		return m_GroupCounts[group] != 0;
+	}
+
+private:
+	enum class State : uint8_t
+	{
+		Free,
+		Held,
+		Released
+	};
+
+	/** @brief Busy voice the policy would give up first. */
+	[[nodiscard]] uint32_t FindVictim(VoiceStealPolicy policy,
+									  const float* levels) const;
+
+private:
+	uint32_t m_Capacity = 0;
+	ArenaArray<State> m_States;
+	ArenaArray<uint32_t> m_Notes;
+	ArenaArray<float> m_Priorities;
+	// Start order of every voice, larger is newer.
+	ArenaArray<uint64_t> m_StartTimes;
+	uint64_t m_Clock = 0;
+
+	ArenaArray<uint32_t> m_FreeStack;
+	uint32_t m_FreeCount = 0;
+	// Busy voices per SIMD group.
+	ArenaArray<uint32_t> m_GroupCounts;
+};
+}
@@ -0,0 +1,234 @@
+﻿#include "WavetableBank.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numbers>
+
+
+namespace
+{
+constexpr uint32_t CacheMagic = 0x54574150; // "PAWT"
+constexpr uint32_t CacheVersion = 1;
+
+struct CacheHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t TableSize;
+	uint32_t LevelCount;
+	uint32_t FrameCount;
+	uint32_t Reserved;
+	uint64_t Key;
+};
+
+/** @brief FNV-1a over the table layout and every harmonic. */
+uint64_t HashSpectra(const std::vector<MT::DSP::WavetableBank::Spectrum>& frames)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	const auto mix = [&hash](const void* data, const size_t bytes)
+	{
+		const auto* bytesIn = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < bytes; i++)
+		{
+			hash ^= bytesIn[i];
+			hash *= 0x100000001b3ull;
+		}
+	};
+
+	const uint32_t layout[] = {MT::DSP::WavetableBank::TableSize,
+							   MT::DSP::WavetableBank::LevelCount};
+	mix(layout, sizeof(layout));
+	for (const MT::DSP::WavetableBank::Spectrum& spectrum : frames)
+	{
+		const auto size = static_cast<uint64_t>(spectrum.size());
+		mix(&size, sizeof(size));
+		mix(spectrum.data(), spectrum.size() * sizeof(spectrum[0]));
+	}
+	return hash;
+}
+}
+
+
+MT::DSP::WavetableBank::WavetableBank(const uint32_t frameCount,
+									  const uint64_t key) :
+	m_FrameCount(frameCount),
+	m_Key(key),
+	m_Samples(static_cast<size_t>(frameCount) * FrameStride) {}
+
+std::shared_ptr<const MT::DSP::WavetableBank> MT::DSP::WavetableBank::Build(
+	const std::vector<Spectrum>& frames)
+{
+	const auto count = static_cast<uint32_t>(frames.size());
+	std::shared_ptr<WavetableBank> bank(
+		new WavetableBank(count, HashSpectra(frames)));
+
+	// Every harmonic lands on a whole table index, so one sine table covers
+	// all of them without accumulating phase error.
+	std::vector<double> sine(TableSize);
+	for (uint32_t n = 0; n < TableSize; n++)
+		sine[n] = std::sin(2.0 * std::numbers::pi * n / TableSize);
+
+	std::vector<double> cycle(TableSize);
+	for (uint32_t frame = 0; frame < count; frame++)
+	{
+		const Spectrum& spectrum = frames[frame];
+		std::fill(cycle.begin(), cycle.end(), 0.0);
+
+		// Each level adds the octave of harmonics the next one lacks, so
+		// build from the sine level down to the full-band level.
+		uint32_t built = 0;
+		for (uint32_t level = LevelCount; level-- > 0;)
+		{
+			const uint32_t limit = std::min<uint32_t>(
+				(TableSize / 2) >> level,
+				static_cast<uint32_t>(spectrum.size()));
+			for (uint32_t harmonic = built + 1; harmonic <= limit; harmonic++)
+			{
+				const double sineGain = spectrum[harmonic - 1].real();
+				const double cosineGain = spectrum[harmonic - 1].imag();
+				for (uint32_t n = 0; n < TableSize; n++)
+				{
+					const uint32_t index = harmonic * n % TableSize;
+					cycle[n] += sineGain * sine[index] + cosineGain *
+						sine[(index + TableSize / 4) % TableSize];
+				}
+			}
+			built = std::max(built, limit);
+
+			float* table = bank->m_Samples.data() +
+				static_cast<size_t>(frame) * FrameStride +
+				static_cast<size_t>(level) * LevelStride;
+			for (uint32_t n = 0; n < TableSize; n++)
+				table[n] = static_cast<float>(cycle[n]);
+			table[TableSize] = table[0];
+		}
+
+		float* first = bank->m_Samples.data() +
+			static_cast<size_t>(frame) * FrameStride;
+		float peak = 0.0f;
+		for (uint32_t n = 0; n < TableSize; n++)
+			peak = std::max(peak, std::abs(first[n]));
+		if (peak > 0.0f)
+		{
+			for (uint32_t n = 0; n < FrameStride; n++)
+				first[n] /= peak;
+		}
+	}
+	return bank;
+}
+
+std::shared_ptr<const MT::DSP::WavetableBank>
+MT::DSP::WavetableBank::LoadOrBuild(const std::string& cachePath,
+									const std::vector<Spectrum>& frames)
+{
+	const auto count = static_cast<uint32_t>(frames.size());
+	if (auto bank = Load(cachePath, HashSpectra(frames), count))
+		return bank;
+
+	auto bank = Build(frames);
+	// A missing cache only costs the next start the build time.
+	bank->Save(cachePath);
+	return bank;
+}
+
+MT::DSP::WavetableBank::Spectrum MT::DSP::WavetableBank::AnalyzeCycle(
+	const float* cycle, const uint32_t length)
+{
+	const uint32_t count = std::min(length / 2, TableSize / 2);
+	Spectrum spectrum(count);
+	for (uint32_t harmonic = 1; harmonic <= count; harmonic++)
+	{
+		std::complex<double> sum;
+		for (uint32_t n = 0; n < length; n++)
+		{
+			const double angle = -2.0 * std::numbers::pi *
+				static_cast<double>(static_cast<uint64_t>(harmonic) * n %
+					length) / length;
+			sum += static_cast<double>(cycle[n]) *
+				std::complex<double>(std::cos(angle), std::sin(angle));
+		}
+		// x = sum Re(X e^it) = sum Im(iX e^it); Nyquist has no mirror bin.
+		const double scale = 2 * harmonic == length ? 1.0 / length
+													: 2.0 / length;
+		const std::complex<double> amplitude = sum * scale *
+			std::complex<double>(0.0, 1.0);
+		spectrum[harmonic - 1] = std::complex<float>(amplitude);
+	}
+	return spectrum;
+}
+
+std::vector<MT::DSP::WavetableBank::Spectrum>
+MT::DSP::WavetableBank::MakeBasicShapes()
+{
+	constexpr uint32_t count = TableSize / 2;
+	constexpr float pi = std::numbers::pi_v<float>;
+	Spectrum sine{1.0f};
+	Spectrum triangle(count);
+	Spectrum saw(count);
+	Spectrum square(count);
+	for (uint32_t harmonic = 1; harmonic <= count; harmonic++)
+	{
+		const auto h = static_cast<float>(harmonic);
+		// Rising ramp from -1 to 1.
+		saw[harmonic - 1] = -2.0f / (pi * h);
+		if (harmonic % 2 == 0)
+			continue;
+		const float sign = (harmonic / 2) % 2 ? -1.0f : 1.0f;
+		triangle[harmonic - 1] = sign * 8.0f / (pi * pi * h * h);
+		square[harmonic - 1] = 4.0f / (pi * h);
+	}
+	return {sine, triangle, saw, square};
+}
+
+uint32_t MT::DSP::WavetableBank::SelectLevel(const float increment)
+{
+	// Smallest level k with 2^k >= increment * TableSize.
+	const float span = std::abs(increment) * TableSize;
+	if (span <= 1.0f)
+		return 0;
+	int exponent = 0;
+	const float mantissa = std::frexp(span, &exponent);
+	const int level = mantissa == 0.5f ? exponent - 1 : exponent;
+	return static_cast<uint32_t>(std::min(level,
+										  static_cast<int>(LevelCount) - 1));
+}
+
+bool MT::DSP::WavetableBank::Save(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	const CacheHeader header{CacheMagic, CacheVersion, TableSize, LevelCount,
+							 m_FrameCount, 0, m_Key};
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(m_Samples.data()),
+			   static_cast<std::streamsize>(m_Samples.size() *
+				   sizeof(float)));
+	return file.good();
+}
+
+std::shared_ptr<const MT::DSP::WavetableBank> MT::DSP::WavetableBank::Load(
+	const std::string& path, const uint64_t key, const uint32_t frameCount)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open())
+		return nullptr;
+
+	CacheHeader header{};
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || header.Magic != CacheMagic ||
+		header.Version != CacheVersion || header.TableSize != TableSize ||
+		header.LevelCount != LevelCount || header.FrameCount != frameCount ||
+		header.Key != key)
+		return nullptr;
+
+	std::shared_ptr<WavetableBank> bank(new WavetableBank(frameCount, key));
+	file.read(reinterpret_cast<char*>(bank->m_Samples.data()),
+			  static_cast<std::streamsize>(bank->m_Samples.size() *
+				  sizeof(float)));
+	if (!file)
+		return nullptr;
+	return bank;
+}
@@ -0,0 +1,86 @@
+﻿#pragma once
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace MT::DSP
+{
+/**
+ * @brief Band-limited wavetables, one mip level per octave, immutable.
+ *
+ * Each frame of the bank is a single cycle described by its harmonics.
+ * Level k of a frame holds harmonics 1 to (TableSize / 2) >> k, so an
+ * oscillator whose phase advances by increment cycles per sample reads
+ * SelectLevel(increment) and never produces a partial above Nyquist.
+ * Neighbouring frames can be crossfaded to morph between shapes.
+ *
+ * Banks are built (or loaded from a cache file) on the control thread and
+ * only ever read afterwards, so any number of voices and nodes share one
+ * through a shared_ptr to const.
+ */
+class WavetableBank
+{
+public:
+	static constexpr uint32_t TableSize = 2048;
+	/** @brief Level 0 holds TableSize / 2 harmonics, the last a sine. */
+	static constexpr uint32_t LevelCount = 11;
+	/** @brief Floats per level: one guard sample repeats the first. */
+	static constexpr uint32_t LevelStride = TableSize + 1;
+	static constexpr uint32_t FrameStride = LevelCount * LevelStride;
+
+	/**
+	 * @brief Element h - 1 is the complex amplitude c of harmonic h; the
+	 * cycle is the sum of Im(c * exp(2 pi i h t)), so a real c is a sine.
+	 */
+	using Spectrum = std::vector<std::complex<float>>;
+
+	/**
+	 * @brief Renders every frame at every level. Each frame is normalized to
+	 * a peak of 1 at level 0, the same gain applies to all its levels.
+	 */
+	static std::shared_ptr<const WavetableBank> Build(
+		const std::vector<Spectrum>& frames);
+
+	/**
+	 * @brief Loads @p cachePath if it was written for exactly @p frames,
+	 * otherwise builds the bank and tries to write the cache.
+	 */
+	static std::shared_ptr<const WavetableBank> LoadOrBuild(
+		const std::string& cachePath, const std::vector<Spectrum>& frames);
+
+	/** @brief Harmonics of one sampled cycle of @p length samples. */
+	static Spectrum AnalyzeCycle(const float* cycle, uint32_t length);
+
+	/** @brief Sine, triangle, saw and square, in that morph order. */
+	static std::vector<Spectrum> MakeBasicShapes();
+
+	/** @brief Level to read for a phase increment in cycles per sample. */
+	static uint32_t SelectLevel(float increment);
+
+	[[nodiscard]] uint32_t GetFrameCount() const { return m_FrameCount; }
+	/** @brief Frame 0, level 0; frames are FrameStride floats apart. */
+	[[nodiscard]] const float* GetData() const { return m_Samples.data(); }
+	[[nodiscard]] const float* GetTable(const uint32_t frame,
+										const uint32_t level) const
+	{
+		return m_Samples.data() + static_cast<size_t>(frame) * FrameStride +
+			static_cast<size_t>(level) * LevelStride;
+	}
+
+private:
+	WavetableBank(uint32_t frameCount, uint64_t key);
+
+	bool Save(const std::string& path) const;
+	static std::shared_ptr<const WavetableBank> Load(const std::string& path,
+													 uint64_t key,
+													 uint32_t frameCount);
+
+private:
+	uint32_t m_FrameCount;
+	// Hash of the spectra the bank was built from, checked by Load().
+	uint64_t m_Key;
+	std::vector<float> m_Samples;
+};
+}
@@ -0,0 +1,627 @@
+﻿#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+
+#include "../MemoryArena.hpp"
+#include "../Node.hpp"
+#include "../ParallelExecutor.hpp"
+#include "../Random.hpp"
+#include "../Simd.hpp"
+
+namespace MT::DSP
+{
+/**
+ * @brief Texture of thousands of sine partials: a swarm of detuned copies
+ * around every harmonic of one pitch.
+ *
+ * Each partial is a recursive oscillator, a unit phasor rotated by a fixed
+ * step every sample, so a sine costs one complex multiply instead of a
+ * table lookup or a sin() call. Partials live in arrays indexed by partial
+ * and run a SIMD group at a time.
+ *
+ * Amplitudes and frequencies are retargeted every ControlFrames and ramp
+ * linearly in between: the amplitude by a per-sample step, the frequency by
+ * turning the rotation step itself through a small chirp rotation. Groups
+ * whose frequency holds skip that second multiply.
+ *
+ * On every control point, partials above MaxOmega or whose level stays
+ * below the Threshold are culled. Partials are ordered by harmonic, so
+ * culling mostly empties whole groups, which are then skipped. With
+ * Partitioned set and an executor in the PrepareContext, the groups are
+ * dealt round robin to ParallelFor() tasks, each summing into its own
+ * buffer.
+ */
+class AdditiveSynthNode : public Node
+{
+public:
+	static constexpr uint32_t ControlFrames = 32;
+	/** @brief Highest partial frequency rendered, radians per sample. */
+	static constexpr float MaxOmega = 0.96f * std::numbers::pi_v<float>;
+
+	enum Parameter : uint32_t
+	{
+		Gain,
+		/** @brief Hz, the pitch while FollowNotes is off. */
+		Fundamental,
+		/** @brief Whether the latest held note sets the pitch and level. */
+		FollowNotes,
+		/** @brief Partials in use, 1 up to the capacity. */
+		Partials,
+		/** @brief Detuned copies of each harmonic. */
+		Density,
+		/** @brief Spread of the copies around their harmonic, in cents. */
+		Detune,
+		/** @brief Level slope over the harmonics, dB per octave. */
+		Brightness,
+		/** @brief Inharmonicity B, harmonic h sits at h * sqrt(1 + B h^2). */
+		Stretch,
+		/** @brief 0-1, depth of every partial's slow level modulation. */
+		Shimmer,
+		/** @brief Cents of every partial's slow pitch drift. */
+		Drift,
+		/** @brief Average rate of the shimmer and drift LFOs in Hz. */
+		ModulationRate,
+		/** @brief Seconds for the pitch to settle on a new note. */
+		Glide,
+		/** @brief Seconds for the level to follow note on and off. */
+		Fade,
+		/** @brief dBFS below which a partial is culled. */
+		Threshold,
+		/** @brief Nonzero to split the partials across the executor. */
+		Partitioned
+	};
+
+	/** @param partials Capacity, rounded up to a multiple of Simd::Width. */
+	explicit AdditiveSynthNode(const uint32_t partials = 4096,
+							   const bool followNotes = true) :
+		m_Capacity((std::max(partials, 1u) + Simd::Width - 1) / Simd::Width *
+				   Simd::Width),
+		m_PartialCount(m_Capacity),
+		m_FollowNotes(followNotes) {}
+
+	void Prepare(const PrepareContext& context) override
+	{
+		m_SampleRate = context.SampleRate;
+		m_Executor = context.Executor;
+		m_TaskSlots = m_Executor ? m_Executor->GetConcurrency() : 1;
+
+		for (ArenaArray<float>* array : {&m_Ratio, &m_Base, &m_Real, &m_Imag,
+										 &m_StepReal, &m_StepImag,
+										 &m_ChirpReal, &m_ChirpImag,
+										 &m_Omega, &m_Amplitude,
+										 &m_AmplitudeStep, &m_Spread,
+										 &m_LfoPhase, &m_LfoRate})
+			array->Allocate(context.Memory, m_Capacity);
+		m_GroupLanes.Allocate(context.Memory, m_Capacity / Simd::Width);
+		m_GroupChirp.Allocate(context.Memory, m_Capacity / Simd::Width);
+
+		// Random start phases keep the sum from peaking like a pulse.
+		Xorshift32 random(0xADD);
+		for (uint32_t i = 0; i < m_Capacity; i++)
+		{
+			const float phase = 2.0f * std::numbers::pi_v<float> *
+				random.NextUnipolar();
+			m_Real[i] = std::cos(phase);
+			m_Imag[i] = std::sin(phase);
+			m_Spread[i] = random.NextBipolar();
+			m_LfoPhase[i] = random.NextUnipolar();
+			m_LfoRate[i] = 0.5f + random.NextUnipolar();
+		}
+
+		m_TaskStride = (context.MaxBlockFrames + BufferAlignmentFloats - 1) /
+			BufferAlignmentFloats * BufferAlignmentFloats;
+		m_TaskOutput.Allocate(context.Memory,
+							  static_cast<size_t>(m_TaskStride) * m_TaskSlots);
+		m_TaskSums.Allocate(context.Memory,
+							ControlFrames * Simd::Width * m_TaskSlots);
+		m_Chunks.Allocate(context.Memory,
+						  context.MaxBlockFrames / ControlFrames + 2);
+
+		m_FramesToControl = 0;
+		m_Level = 0.0f;
+		m_LogOmega = std::log(TargetOmega());
+		m_RatiosDirty = true;
+		m_AmplitudesDirty = true;
+		m_ActivePartials.store(0, std::memory_order_relaxed);
+	}
+
+	void Process(const ProcessContext& context) override
+	{
+		if (m_RatiosDirty)
+			UpdateRatios();
+		if (m_AmplitudesDirty)
+			UpdateAmplitudes();
+		const bool updated = PlanChunks(context.Frames);
+
+		const uint32_t groups = GetUsedGroups();
+		m_TaskCount = 1;
+		if (m_Partitioned && m_Executor)
+		{
+			m_TaskCount = std::clamp(groups / MinGroupsPerTask, 1u,
+									 m_TaskSlots);
+		}
+		if (m_TaskCount > 1)
+		{
+			auto body = [this](const uint32_t task) { RenderTask(task); };
+			m_Executor->ParallelFor(m_TaskCount, body);
+		}
+		else
+			RenderTask(0);
+
+		float* first = context.Output.Channel(0);
+		std::copy_n(m_TaskOutput.Data(), context.Frames, first);
+		for (uint32_t task = 1; task < m_TaskCount; task++)
+		{
+			const float* partial = m_TaskOutput.Data() +
+				static_cast<size_t>(task) * m_TaskStride;
+			for (uint32_t i = 0; i < context.Frames; i++)
+				first[i] += partial[i];
+		}
+		for (uint32_t channel = 1; channel < context.Output.Channels; channel++)
+			std::copy_n(first, context.Frames, context.Output.Channel(channel));
+
+		if (updated)
+		{
+			uint32_t active = 0;
+			for (uint32_t group = 0; group < groups; group++)
+				active += m_GroupLanes[group];
+			m_ActivePartials.store(active, std::memory_order_relaxed);
+		}
+	}
+
+	void SetParameter(const uint32_t id, const float value) override
+	{
+		switch (id)
+		{
+			case Gain:
+				m_Gain = value;
+				break;
+			case Fundamental:
+				m_Fundamental = std::max(value, 1.0f);
+				break;
+			case FollowNotes:
+				m_FollowNotes = value >= 0.5f;
+				break;
+			case Partials:
+				m_PartialCount = std::clamp(static_cast<uint32_t>(
+					std::max(value, 1.0f)), 1u, m_Capacity);
+				m_AmplitudesDirty = true;
+				break;
+			case Density:
+				m_Density = std::clamp(static_cast<uint32_t>(
+					std::max(value, 1.0f)), 1u, m_Capacity);
+				m_RatiosDirty = true;
+				m_AmplitudesDirty = true;
+				break;
+			case Detune:
+				m_Detune = std::max(value, 0.0f);
+				m_RatiosDirty = true;
+				break;
+			case Brightness:
+				m_Brightness = value;
+				m_AmplitudesDirty = true;
+				break;
+			case Stretch:
+				m_Stretch = std::max(value, 0.0f);
+				m_RatiosDirty = true;
+				break;
+			case Shimmer:
+				m_Shimmer = std::clamp(value, 0.0f, 1.0f);
+				break;
+			case Drift:
+				m_Drift = std::max(value, 0.0f);
+				break;
+			case ModulationRate:
+				m_ModulationRate = std::max(value, 0.0f);
+				break;
+			case Glide:
+				m_Glide = std::max(value, 0.0f);
+				break;
+			case Fade:
+				m_Fade = std::max(value, 0.0f);
+				break;
+			case Threshold:
+				m_Threshold = std::pow(10.0f, value / 20.0f);
+				break;
+			case Partitioned:
+				m_Partitioned = value >= 0.5f;
+				break;
+			default:
+				break;
+		}
+	}
+
+	void OnNote(const uint32_t note, const float velocity) override
+	{
+		if (velocity > 0.0f)
+		{
+			m_Note = note;
+			m_NoteVelocity = velocity;
+			m_NoteFrequency = 440.0f * std::exp2(
+				(static_cast<float>(note) - 69.0f) / 12.0f);
+		}
+		else if (note == m_Note)
+			m_NoteVelocity = 0.0f;
+	}
+
+	[[nodiscard]] bool WantsNotes() const override { return true; }
+	[[nodiscard]] const char* GetName() const override { return "Additive"; }
+
+	/** @brief Partials rendered at the last control point, any thread. */
+	[[nodiscard]] uint32_t GetActivePartialCount() const
+	{
+		return m_ActivePartials.load(std::memory_order_relaxed);
+	}
+	[[nodiscard]] uint32_t GetPartialCapacity() const { return m_Capacity; }
+
+private:
+	/** @brief Fewer groups than this per task are not worth a thread. */
+	static constexpr uint32_t MinGroupsPerTask = 64;
+	/** @brief Level below which the pitch jumps instead of gliding. */
+	static constexpr float SilenceLevel = 1e-4f;
+
+	/** @brief Shared targets of one control point. */
+	struct ControlPoint
+	{
+		/** @brief Fundamental, radians per sample. */
+		float Omega;
+		float Level;
+		/** @brief LFO phase advance at the average rate. */
+		float LfoStep;
+	};
+
+	/** @brief Stretch of a block between control points. */
+	struct Chunk
+	{
+		uint32_t Frames;
+		bool Update;
+		ControlPoint Point;
+	};
+
+	[[nodiscard]] uint32_t GetUsedGroups() const
+	{
+		return (m_PartialCount + Simd::Width - 1) / Simd::Width;
+	}
+
+	[[nodiscard]] float TargetOmega() const
+	{
+		const float frequency = m_FollowNotes ? m_NoteFrequency
+											  : m_Fundamental;
+		return std::min(2.0f * std::numbers::pi_v<float> * frequency /
+			m_SampleRate, std::numbers::pi_v<float>);
+	}
+
+	void UpdateRatios()
+	{
+		const float cents = m_Detune / 1200.0f;
+		for (uint32_t i = 0; i < m_Capacity; i++)
+		{
+			const auto harmonic = static_cast<float>(i / m_Density + 1);
+			m_Ratio[i] = harmonic * std::sqrt(
+				1.0f + m_Stretch * harmonic * harmonic) *
+				std::exp2(m_Spread[i] * cents);
+		}
+		m_RatiosDirty = false;
+	}
+
+	void UpdateAmplitudes()
+	{
+		// Normalized to a constant RMS whatever the count and slope.
+		const float exponent = m_Brightness / (20.0f * std::log10(2.0f));
+		double power = 0.0;
+		for (uint32_t i = 0; i < m_Capacity; i++)
+		{
+			const auto harmonic = static_cast<float>(i / m_Density + 1);
+			const float level = i < m_PartialCount
+				? std::pow(harmonic, exponent)
+				: 0.0f;
+			m_Base[i] = level;
+			power += static_cast<double>(level) * level;
+		}
+		const auto normalize = static_cast<float>(1.0 / std::sqrt(power));
+		for (uint32_t i = 0; i < m_Capacity; i++)
+			m_Base[i] *= normalize;
+
+		// Groups that fall out of use stop counting as active, and restart
+		// silent and culled if they come back.
+		const uint32_t used = GetUsedGroups();
+		for (uint32_t i = used * Simd::Width; i < m_Capacity; i++)
+			m_Amplitude[i] = 0.0f;
+		for (uint32_t group = used; group < m_Capacity / Simd::Width; group++)
+			m_GroupLanes[group] = 0;
+		m_AmplitudesDirty = false;
+	}
+
+	/**
+	 * @brief Cuts the block at the control grid and advances the shared
+	 * targets once per control point.
+	 * @return Whether the block holds a control point.
+	 */
+	bool PlanChunks(const uint32_t frames)
+	{
+		const float omega = TargetOmega();
+		const float level = m_FollowNotes ? m_NoteVelocity : 1.0f;
+		const float glide = m_Glide > 0.0f
+			? 1.0f - std::exp(-static_cast<float>(ControlFrames) /
+				(m_Glide * m_SampleRate))
+			: 1.0f;
+		const float fade = m_Fade > 0.0f
+			? 1.0f - std::exp(-static_cast<float>(ControlFrames) /
+				(m_Fade * m_SampleRate))
+			: 1.0f;
+
+		bool updated = false;
+		m_ChunkCount = 0;
+		for (uint32_t frame = 0; frame < frames;)
+		{
+			Chunk& chunk = m_Chunks[m_ChunkCount++];
+			chunk.Update = m_FramesToControl == 0;
+			if (chunk.Update)
+			{
+				// A silent texture takes the new pitch at once.
+				if (m_Level < SilenceLevel)
+					m_LogOmega = std::log(omega);
+				m_LogOmega += (std::log(omega) - m_LogOmega) * glide;
+				m_Level += (level - m_Level) * fade;
+				chunk.Point = {std::exp(m_LogOmega), m_Level * m_Gain,
+							   m_ModulationRate * ControlFrames / m_SampleRate};
+				m_FramesToControl = ControlFrames;
+				updated = true;
+			}
+			chunk.Frames = std::min(frames - frame, m_FramesToControl);
+			frame += chunk.Frames;
+			m_FramesToControl -= chunk.Frames;
+		}
+		return updated;
+	}
+
+	/** @brief Renders the groups of @p task into its own output buffer. */
+	void RenderTask(const uint32_t task)
+	{
+		float* out = m_TaskOutput.Data() +
+			static_cast<size_t>(task) * m_TaskStride;
+		float* sums = m_TaskSums.Data() + task * ControlFrames * Simd::Width;
+		const uint32_t groups = GetUsedGroups();
+
+		uint32_t frame = 0;
+		for (uint32_t index = 0; index < m_ChunkCount; index++)
+		{
+			const Chunk& chunk = m_Chunks[index];
+			if (chunk.Update)
+			{
+				for (uint32_t group = task; group < groups;
+					 group += m_TaskCount)
+					UpdateGroup(group, chunk.Point);
+			}
+
+			std::fill_n(sums, chunk.Frames * Simd::Width, 0.0f);
+			for (uint32_t group = task; group < groups; group += m_TaskCount)
+			{
+				if (m_GroupLanes[group] == 0)
+					continue;
+				if (m_GroupChirp[group])
+					RenderGroup<true>(group, chunk.Frames, sums);
+				else
+					RenderGroup<false>(group, chunk.Frames, sums);
+			}
+			for (uint32_t i = 0; i < chunk.Frames; i++)
+			{
+				out[frame + i] = Simd::Sum(
+					Simd::LoadAligned(sums + i * Simd::Width));
+			}
+			frame += chunk.Frames;
+		}
+	}
+
+	/** @brief Retargets one group, culls it, and sets up its ramps. */
+	void UpdateGroup(const uint32_t group, const ControlPoint& point)
+	{
+		const uint32_t base = group * Simd::Width;
+		const Simd::Float zero = Simd::Set(0.0f);
+		const Simd::Float one = Simd::Set(1.0f);
+
+		Simd::Float lfo = Simd::MulAdd(
+			Simd::LoadAligned(m_LfoRate.Data() + base),
+			Simd::Set(point.LfoStep),
+			Simd::LoadAligned(m_LfoPhase.Data() + base));
+		lfo = Simd::Sub(lfo, Simd::Floor(lfo));
+		Simd::StoreAligned(m_LfoPhase.Data() + base, lfo);
+
+		Simd::Float level = Simd::Mul(Simd::LoadAligned(m_Base.Data() + base),
+									  Simd::Set(point.Level));
+		Simd::Float omegaTarget = Simd::Mul(
+			Simd::LoadAligned(m_Ratio.Data() + base), Simd::Set(point.Omega));
+		if (m_Shimmer > 0.0f || m_Drift > 0.0f)
+		{
+			const Simd::Float angle = Simd::Mul(
+				lfo, Simd::Set(2.0f * std::numbers::pi_v<float>));
+			if (m_Shimmer > 0.0f)
+			{
+				level = Simd::Mul(level, Simd::MulAdd(
+					Simd::Sin(angle), Simd::Set(-0.5f * m_Shimmer),
+					Simd::Set(1.0f - 0.5f * m_Shimmer)));
+			}
+			if (m_Drift > 0.0f)
+			{
+				omegaTarget = Simd::Mul(omegaTarget, Simd::Exp(Simd::Mul(
+					Simd::Cos(angle), Simd::Set(m_Drift *
+						std::numbers::ln2_v<float> / 1200.0f))));
+			}
+		}
+
+		const Simd::Float target = Simd::Select(
+			Simd::Less(omegaTarget, Simd::Set(MaxOmega)), level, zero);
+		const Simd::Float current = Simd::LoadAligned(
+			m_Amplitude.Data() + base);
+		const Simd::Float keep = Simd::Less(Simd::Set(m_Threshold),
+											Simd::Max(target, current));
+		const auto lanes = static_cast<uint32_t>(
+			Simd::Sum(Simd::Select(keep, one, zero)));
+
+		const bool wasActive = m_GroupLanes[group] != 0;
+		// A group coming back from being culled starts on its target
+		// pitch instead of sweeping up from wherever it was left.
+		const Simd::Float omega = wasActive
+			? Simd::LoadAligned(m_Omega.Data() + base)
+			: omegaTarget;
+		Simd::StoreAligned(m_Omega.Data() + base, omegaTarget);
+		const Simd::Float inverseFrames = Simd::Set(1.0f / ControlFrames);
+		const Simd::Float amplitude = Simd::Select(keep, current, zero);
+		Simd::StoreAligned(m_Amplitude.Data() + base, amplitude);
+		Simd::StoreAligned(m_AmplitudeStep.Data() + base, Simd::Select(
+			keep, Simd::Mul(Simd::Sub(target, amplitude), inverseFrames),
+			zero));
+
+		m_GroupLanes[group] = static_cast<uint8_t>(lanes);
+		if (lanes == 0)
+			return;
+
+		// The step phasor only drifts while it is being chirped; refresh
+		// it after a chirp and when the group comes back from being culled.
+		const Simd::Float delta = Simd::Sub(omegaTarget, omega);
+		const bool chirp = Simd::Sum(Simd::Abs(delta)) > 0.0f;
+		if (chirp || m_GroupChirp[group] || !wasActive)
+		{
+			Simd::StoreAligned(m_StepReal.Data() + base, Simd::Cos(omega));
+			Simd::StoreAligned(m_StepImag.Data() + base, Simd::Sin(omega));
+		}
+		if (chirp)
+		{
+			const Simd::Float chirpAngle = Simd::Mul(delta, inverseFrames);
+			Simd::StoreAligned(m_ChirpReal.Data() + base,
+							   Simd::Cos(chirpAngle));
+			Simd::StoreAligned(m_ChirpImag.Data() + base,
+							   Simd::Sin(chirpAngle));
+		}
+		m_GroupChirp[group] = chirp;
+
+		// One Newton step back onto the unit circle, rounding in the
+		// rotations would otherwise slowly change the level.
+		Simd::Float real = Simd::LoadAligned(m_Real.Data() + base);
+		Simd::Float imag = Simd::LoadAligned(m_Imag.Data() + base);
+		const Simd::Float magnitude = Simd::MulAdd(real, real,
+												   Simd::Mul(imag, imag));
+		const Simd::Float correction = Simd::MulAdd(
+			magnitude, Simd::Set(-0.5f), Simd::Set(1.5f));
+		Simd::StoreAligned(m_Real.Data() + base, Simd::Mul(real, correction));
+		Simd::StoreAligned(m_Imag.Data() + base, Simd::Mul(imag, correction));
+	}
+
+	/** @brief Adds @p frames frames of one group to @p sums. */
+	template<bool Chirping>
+	void RenderGroup(const uint32_t group, const uint32_t frames, float* sums)
+	{
+		const uint32_t base = group * Simd::Width;
+		Simd::Float real = Simd::LoadAligned(m_Real.Data() + base);
+		Simd::Float imag = Simd::LoadAligned(m_Imag.Data() + base);
+		Simd::Float stepReal = Simd::LoadAligned(m_StepReal.Data() + base);
+		Simd::Float stepImag = Simd::LoadAligned(m_StepImag.Data() + base);
+		Simd::Float amplitude = Simd::LoadAligned(m_Amplitude.Data() + base);
+		const Simd::Float amplitudeStep = Simd::LoadAligned(
+			m_AmplitudeStep.Data() + base);
+		Simd::Float chirpReal = Simd::Set(1.0f);
+		Simd::Float chirpImag = Simd::Set(0.0f);
+		if constexpr (Chirping)
+		{
+			chirpReal = Simd::LoadAligned(m_ChirpReal.Data() + base);
+			chirpImag = Simd::LoadAligned(m_ChirpImag.Data() + base);
+		}
+
+		for (uint32_t i = 0; i < frames; i++)
+		{
+			float* sum = sums + i * Simd::Width;
+			Simd::StoreAligned(sum, Simd::MulAdd(amplitude, imag,
+												 Simd::LoadAligned(sum)));
+
+			const Simd::Float nextReal = Simd::Sub(
+				Simd::Mul(real, stepReal), Simd::Mul(imag, stepImag));
+			imag = Simd::MulAdd(real, stepImag, Simd::Mul(imag, stepReal));
+			real = nextReal;
+			if constexpr (Chirping)
+			{
+				const Simd::Float nextStepReal = Simd::Sub(
+					Simd::Mul(stepReal, chirpReal),
+					Simd::Mul(stepImag, chirpImag));
+				stepImag = Simd::MulAdd(stepReal, chirpImag,
+										Simd::Mul(stepImag, chirpReal));
+				stepReal = nextStepReal;
+			}
+			amplitude = Simd::Add(amplitude, amplitudeStep);
+		}
+
+		Simd::StoreAligned(m_Real.Data() + base, real);
+		Simd::StoreAligned(m_Imag.Data() + base, imag);
+		Simd::StoreAligned(m_Amplitude.Data() + base, amplitude);
+		if constexpr (Chirping)
+		{
+			Simd::StoreAligned(m_StepReal.Data() + base, stepReal);
+			Simd::StoreAligned(m_StepImag.Data() + base, stepImag);
+		}
+	}
+
+private:
+	const uint32_t m_Capacity;
+	uint32_t m_PartialCount;
+	uint32_t m_Density = 16;
+	bool m_FollowNotes;
+	bool m_Partitioned = false;
+	float m_Gain = 0.25f;
+	float m_Fundamental = 55.0f;
+	float m_Detune = 15.0f;
+	float m_Brightness = -6.0f;
+	float m_Stretch = 0.0f;
+	float m_Shimmer = 0.0f;
+	float m_Drift = 0.0f;
+	float m_ModulationRate = 0.2f;
+	float m_Glide = 0.05f;
+	float m_Fade = 0.05f;
+	float m_Threshold = 1.5849e-5f; // -96 dBFS
+
+	uint32_t m_Note = 0;
+	float m_NoteVelocity = 0.0f;
+	float m_NoteFrequency = 220.0f;
+
+	float m_SampleRate = 48000.0f;
+	ParallelExecutor* m_Executor = nullptr;
+	uint32_t m_TaskSlots = 1;
+	uint32_t m_TaskCount = 1;
+	bool m_RatiosDirty = true;
+	bool m_AmplitudesDirty = true;
+
+	// Shared control state, advanced once per control point.
+	uint32_t m_FramesToControl = 0;
+	float m_LogOmega = 0.0f;
+	float m_Level = 0.0f;
+	ArenaArray<Chunk> m_Chunks;
+	uint32_t m_ChunkCount = 0;
+
+	// Structure of arrays, one element per partial.
+	ArenaArray<float> m_Ratio;
+	ArenaArray<float> m_Base;
+	ArenaArray<float> m_Real;
+	ArenaArray<float> m_Imag;
+	ArenaArray<float> m_StepReal;
+	ArenaArray<float> m_StepImag;
+	ArenaArray<float> m_ChirpReal;
+	ArenaArray<float> m_ChirpImag;
+	ArenaArray<float> m_Omega;
+	ArenaArray<float> m_Amplitude;
+	ArenaArray<float> m_AmplitudeStep;
+	ArenaArray<float> m_Spread;
+	ArenaArray<float> m_LfoPhase;
+	ArenaArray<float> m_LfoRate;
+	// One element per SIMD group.
+	ArenaArray<uint8_t> m_GroupLanes;
+	ArenaArray<uint8_t> m_GroupChirp;
+
+	// Per ParallelFor() task: a block of output and the lane sums.
+	uint32_t m_TaskStride = 0;
+	ArenaArray<float> m_TaskOutput;
+	ArenaArray<float> m_TaskSums;
+
+	std::atomic<uint32_t> m_ActivePartials{0};
+};
+}
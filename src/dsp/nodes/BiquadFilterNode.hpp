@@ -0,0 +1,199 @@
+﻿#pragma once
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+#include "../BiquadBank.hpp"
+#include "../MemoryArena.hpp"
+#include "../Node.hpp"
+#include "../Simd.hpp"
+
+namespace MT::DSP
+{
+/**
+ * @brief Up to @ref MaxSections biquads in series, for every channel.
+ *
+ * Inputs are summed before filtering. Channels are spread across the SIMD
+ * lanes of a @ref BiquadBank, so a stereo cascade runs its channels side
+ * by side and a multichannel one costs little more, and the sections are
+ * pipelined with BiquadBank::ProcessSeries(). Low- and high-pass cascades
+ * get the Butterworth pole spread, flat at a Q of 0.7071 and resonant
+ * above through the last section; the other types repeat one section,
+ * with Peak and shelf gain split between the sections.
+ *
+ * Parameter changes glide to the new response over the next block.
+ */
+class BiquadFilterNode : public Node
+{
+public:
+	static constexpr uint32_t MaxSections = 8;
+
+	enum Parameter : uint32_t
+	{
+		/** @brief A @ref BiquadType, passed as a float. */
+		Type,
+		/** @brief Cutoff or centre in Hz. */
+		Frequency,
+		Q,
+		/** @brief Decibels, for Peak and the shelves. */
+		Gain,
+		/** @brief 1 to @ref MaxSections sections in series. */
+		Sections
+	};
+
+	void Prepare(const PrepareContext& context) override
+	{
+		m_SampleRate = context.SampleRate;
+		m_Channels = context.Channels;
+		m_ChannelPackets = (m_Channels + Simd::Width - 1) / Simd::Width;
+		m_Bank.Prepare(context.Memory,
+					   MaxSections * m_ChannelPackets * Simd::Width);
+		m_Lanes.Allocate(context.Memory,
+						 static_cast<size_t>(m_ChannelPackets) *
+							 context.MaxBlockFrames * Simd::Width);
+		Retune();
+		m_Bank.Snap();
+	}
+
+	void Process(const ProcessContext& context) override
+	{
+		if (m_Dirty)
+			Retune();
+
+		const uint32_t frames = context.Frames;
+		const uint32_t channels = std::min(context.Output.Channels, m_Channels);
+		for (uint32_t channel = 0; channel < channels; channel++)
+		{
+			float* lanes = m_Lanes.Data() + static_cast<size_t>(
+				channel / Simd::Width) * frames * Simd::Width +
+				channel % Simd::Width;
+			if (context.Inputs.empty())
+			{
+				for (uint32_t i = 0; i < frames; i++)
+					lanes[i * Simd::Width] = 0.0f;
+				continue;
+			}
+			const float* first = context.Inputs[0].Channel(channel);
+			for (uint32_t i = 0; i < frames; i++)
+				lanes[i * Simd::Width] = first[i];
+			for (size_t input = 1; input < context.Inputs.size(); input++)
+			{
+				const float* in = context.Inputs[input].Channel(channel);
+				for (uint32_t i = 0; i < frames; i++)
+					lanes[i * Simd::Width] += in[i];
+			}
+		}
+
+		for (uint32_t packet = 0; packet < m_ChannelPackets; packet++)
+		{
+			m_Bank.ProcessSeries(packet * MaxSections, m_Sections,
+								 m_Lanes.Data() + static_cast<size_t>(packet) *
+									 frames * Simd::Width,
+								 frames);
+		}
+
+		for (uint32_t channel = 0; channel < channels; channel++)
+		{
+			const float* lanes = m_Lanes.Data() + static_cast<size_t>(
+				channel / Simd::Width) * frames * Simd::Width +
+				channel % Simd::Width;
+			float* out = context.Output.Channel(channel);
+			for (uint32_t i = 0; i < frames; i++)
+				out[i] = lanes[i * Simd::Width];
+		}
+	}
+
+	void SetParameter(const uint32_t id, const float value) override
+	{
+		switch (id)
+		{
+			case Type:
+				m_Type = static_cast<BiquadType>(std::min(
+					static_cast<uint32_t>(std::max(value, 0.0f)),
+					static_cast<uint32_t>(BiquadType::Count) - 1));
+				break;
+			case Frequency:
+				m_Frequency = std::max(value, 1.0f);
+				break;
+			case Q:
+				m_Q = std::clamp(value, 0.1f, 40.0f);
+				break;
+			case Gain:
+				m_Gain = std::clamp(value, -48.0f, 48.0f);
+				break;
+			case Sections:
+			{
+				const uint32_t sections = std::clamp(
+					static_cast<uint32_t>(std::max(value, 1.0f)), 1u,
+					MaxSections);
+				// Sections coming back in start from silence rather than
+				// from whatever they held when they were dropped.
+				for (uint32_t packet = 0;
+					 sections > m_Sections && packet < m_ChannelPackets;
+					 packet++)
+				{
+					m_Bank.Reset(packet * MaxSections + m_Sections,
+								 sections - m_Sections);
+				}
+				m_Sections = sections;
+				break;
+			}
+			default:
+				return;
+		}
+		m_Dirty = true;
+	}
+
+	[[nodiscard]] uint32_t GetMaxInputs() const override { return 8; }
+	[[nodiscard]] const char* GetName() const override { return "Biquad filter"; }
+
+private:
+	void Retune()
+	{
+		m_Dirty = false;
+		const bool butterworth = m_Type == BiquadType::LowPass ||
+			m_Type == BiquadType::HighPass;
+		for (uint32_t section = 0; section < m_Sections; section++)
+		{
+			float q = m_Q;
+			if (butterworth)
+			{
+				// Pole pair k of an order 2N Butterworth. Only the sharpest
+				// pair takes the resonance, scaled so the default Q of
+				// 1/sqrt(2) gives the maximally flat response.
+				const float angle = std::numbers::pi_v<float> *
+					static_cast<float>(2 * section + 1) /
+					static_cast<float>(4 * m_Sections);
+				q = 0.5f / std::cos(angle);
+				if (section + 1 == m_Sections)
+					q *= m_Q * std::numbers::sqrt2_v<float>;
+			}
+			const BiquadCoefficients coefficients = BiquadCoefficients::Design(
+				m_Type, m_Frequency, q,
+				m_Gain / static_cast<float>(m_Sections), m_SampleRate);
+			for (uint32_t packet = 0; packet < m_ChannelPackets; packet++)
+			{
+				const uint32_t first = (packet * MaxSections + section) *
+					Simd::Width;
+				for (uint32_t lane = 0; lane < Simd::Width; lane++)
+					m_Bank.SetTarget(first + lane, coefficients);
+			}
+		}
+	}
+
+private:
+	float m_SampleRate = 48000.0f;
+	uint32_t m_Channels = 0;
+	uint32_t m_ChannelPackets = 0;
+	BiquadType m_Type = BiquadType::LowPass;
+	float m_Frequency = 1000.0f;
+	float m_Q = 0.70710678f;
+	float m_Gain = 0.0f;
+	uint32_t m_Sections = 2;
+	bool m_Dirty = true;
+
+	BiquadBank m_Bank;
+	/** @brief Channel packets of the block, frame major within each. */
+	ArenaArray<float> m_Lanes;
+};
+}
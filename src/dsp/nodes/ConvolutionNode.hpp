@@ -0,0 +1,121 @@
+﻿#pragma once
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+#include "../Convolver.hpp"
+#include "../ImpulseResponse.hpp"
+#include "../MemoryArena.hpp"
+#include "../Node.hpp"
+
+namespace MT::DSP
+{
+/**
+ * @brief Convolution reverb: the summed inputs played through an
+ * @ref ImpulseResponse by a @ref Convolver.
+ *
+ * The output lags the input by one head partition, dry signal included so
+ * the two stay aligned; see GetLatency(). Unless given, the partition is
+ * the device period, so the head's transforms land evenly in every
+ * callback and the reverb adds one period of latency; without a known
+ * period it falls back to the largest block, 512 frames by default.
+ * By default everything past the first 16 partitions of the response is
+ * computed on the convolver's worker thread; GetStats() reports that
+ * thread's cost per job next to the audio thread's cost per block.
+ */
+class ConvolutionNode : public Node
+{
+public:
+	enum Parameter : uint32_t
+	{
+		Dry,
+		Wet
+	};
+
+	/**
+	 * @param partition Head partition in frames, and so the latency the
+	 * node adds; 0 for the device period.
+	 * @param tail Where the rest of the response is convolved.
+	 */
+	explicit ConvolutionNode(
+		std::shared_ptr<const ImpulseResponse> impulse,
+		const uint32_t partition = 0,
+		const ConvolutionTail tail = ConvolutionTail::Worker) :
+		m_Impulse(std::move(impulse)), m_Partition(partition), m_Tail(tail) {}
+
+	void Prepare(const PrepareContext& context) override
+	{
+		m_Channels = context.Channels;
+		uint32_t partition = m_Partition;
+		if (!partition)
+			partition = context.PeriodFrames ? context.PeriodFrames
+											 : context.MaxBlockFrames;
+		m_Convolver.Prepare(context.Memory, *m_Impulse, context.SampleRate,
+							m_Channels, partition, m_Tail);
+		m_Sums.Allocate(context.Memory, static_cast<size_t>(m_Channels) *
+						context.MaxBlockFrames);
+		m_Inputs.Allocate(context.Memory, m_Channels);
+		m_Outputs.Allocate(context.Memory, m_Channels);
+	}
+
+	void Process(const ProcessContext& context) override
+	{
+		const uint32_t frames = context.Frames;
+		const uint32_t channels = std::min(context.Output.Channels, m_Channels);
+		for (uint32_t channel = 0; channel < channels; channel++)
+		{
+			m_Outputs[channel] = context.Output.Channel(channel);
+			if (context.Inputs.size() == 1)
+			{
+				m_Inputs[channel] = context.Inputs[0].Channel(channel);
+				continue;
+			}
+			float* sum = m_Sums.Data() + static_cast<size_t>(channel) * frames;
+			std::fill_n(sum, frames, 0.0f);
+			for (const BufferView& input : context.Inputs)
+			{
+				const float* source = input.Channel(channel);
+				for (uint32_t i = 0; i < frames; i++)
+					sum[i] += source[i];
+			}
+			m_Inputs[channel] = sum;
+		}
+		m_Convolver.Process(m_Inputs.Data(), m_Outputs.Data(), channels,
+							frames, m_Dry, m_Wet);
+	}
+
+	void SetParameter(const uint32_t id, const float value) override
+	{
+		if (id == Dry)
+			m_Dry = value;
+		else if (id == Wet)
+			m_Wet = value;
+	}
+
+	[[nodiscard]] uint32_t GetLatency() const override
+	{
+		return m_Convolver.GetLatency();
+	}
+	[[nodiscard]] Convolver::Stats GetStats() const
+	{
+		return m_Convolver.GetStats();
+	}
+
+	[[nodiscard]] uint32_t GetMaxInputs() const override { return 8; }
+	[[nodiscard]] const char* GetName() const override { return "Convolution reverb"; }
+
+private:
+	std::shared_ptr<const ImpulseResponse> m_Impulse;
+	uint32_t m_Partition;
+	ConvolutionTail m_Tail;
+	uint32_t m_Channels = 0;
+	float m_Dry = 0.0f;
+	float m_Wet = 1.0f;
+
+	Convolver m_Convolver;
+	/** @brief Summed inputs per channel when more than one is connected. */
+	ArenaArray<float> m_Sums;
+	ArenaArray<const float*> m_Inputs;
+	ArenaArray<float*> m_Outputs;
+};
+}
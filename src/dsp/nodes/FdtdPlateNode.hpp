@@ -0,0 +1,532 @@
+﻿#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <numbers>
+#include <utility>
+
+#include "../MemoryArena.hpp"
+#include "../Node.hpp"
+#include "../ParallelExecutor.hpp"
+#include "../Simd.hpp"
+
+namespace MT::DSP
+{
+/**
+ * @brief Finite-difference time-domain model of a struck membrane or stiff
+ * plate on a rectangular grid, simply supported at the rim.
+ *
+ * The grid solves u_tt = c^2 Lap u - kappa^2 Lap Lap u - 2 s0 u_t +
+ * 2 s1 Lap u_t with the explicit scheme of Bilbao's Numerical Sound
+ * Synthesis: a 5-point Laplacian, applied twice for the stiffness term.
+ * Stiffness 0 is a drum head, 1 a metal sheet. c and kappa are solved so
+ * the lowest mode of the discrete grid lands exactly on Frequency. The
+ * scheme is only stable while lambda^2 + 8 mu^2 + 4 s1 k / h^2 <= 1/2, so
+ * each grid resolution carries frequencies up to a limit; higher settings
+ * are clamped to it, see GetEffectiveFrequency(). A plate's limit falls
+ * with the square of the resolution, a membrane's linearly.
+ *
+ * Rows run a SIMD packet at a time. Each row is padded so its cells start
+ * on a packet boundary, the zero padding being the rim. Only two grids are
+ * kept, the next step overwrites the one before last in place, plus the
+ * last step's Laplacian for the loss term. The second Laplacian reads
+ * three rows of the first, which every strip keeps in a ring of scratch
+ * rows, so the first never makes a trip through memory.
+ *
+ * With an executor in the PrepareContext, each time step is split into row
+ * strips run through ParallelFor(). Every step costs one fork and join,
+ * so only grids of at least MinCellsPerTask per strip are split.
+ *
+ * Notes strike the grid at StrikeX, StrikeY with a raised cosine velocity
+ * profile, wider for soft mallets. The summed node inputs push the strike
+ * point continuously. Two pickups read the surface velocity, left and
+ * right.
+ */
+class FdtdPlateNode : public Node
+{
+public:
+	/** @brief Fewer cells than this per strip are not worth a fork. */
+	static constexpr uint32_t MinCellsPerTask = 4096;
+	/** @brief Most cells across or down a grid. */
+	static constexpr uint32_t MaxSize = 1024;
+
+	enum Parameter : uint32_t
+	{
+		Gain,
+		/** @brief Hz of the lowest mode. */
+		Frequency,
+		/** @brief Whether notes also set Frequency. */
+		FollowNotes,
+		/** @brief 0-1, share of the lowest mode's stiffness from bending. */
+		Stiffness,
+		/** @brief Seconds for the lowest mode to fall 60 dB. */
+		Decay,
+		/** @brief 0-1, less loss at high frequencies. */
+		Brightness,
+		/** @brief 0-1 across the grid. */
+		StrikeX,
+		/** @brief 0-1 across the grid. */
+		StrikeY,
+		/** @brief 0-1, narrower strikes exciting higher modes. */
+		Hardness,
+		/** @brief Scale of the summed node inputs pushing the strike point. */
+		InputGain
+	};
+
+	/**
+	 * @param width Cells across, 4 to MaxSize.
+	 * @param height Cells down, 4 to MaxSize. The grid spacing is the same
+	 * both ways, so the surface is height / width as tall as it is wide.
+	 */
+	explicit FdtdPlateNode(const uint32_t width = 64,
+						   const uint32_t height = 64) :
+		m_Width(std::clamp(width, 4u, MaxSize)),
+		m_Height(std::clamp(height, 4u, MaxSize)),
+		m_Packets((m_Width + Simd::Width - 1) / Simd::Width),
+		// One packet of padding each side, the rim cells sit in them.
+		m_Stride((m_Packets + 2) * Simd::Width) {}
+
+	void Prepare(const PrepareContext& context) override
+	{
+		m_SampleRate = context.SampleRate;
+		m_Executor = context.Executor;
+		m_Strips = 1;
+		if (m_Executor)
+		{
+			m_Strips = std::clamp(m_Width * m_Height / MinCellsPerTask, 1u,
+								  std::min(m_Executor->GetConcurrency(),
+										   m_Height));
+		}
+
+		const size_t cells = static_cast<size_t>(m_Stride) * (m_Height + 2);
+		m_Current.Allocate(context.Memory, cells);
+		m_Previous.Allocate(context.Memory, cells);
+		m_LastLaplacian.Allocate(context.Memory, cells);
+		m_Scratch.Allocate(context.Memory, static_cast<size_t>(m_Stride) *
+			RingRows * m_Strips);
+		m_Mask.Allocate(context.Memory, Simd::Width);
+		for (uint32_t lane = 0; lane < Simd::Width; lane++)
+		{
+			const uint32_t x = (m_Packets - 1) * Simd::Width + lane;
+			m_Mask[lane] = x < m_Width ? 1.0f : 0.0f;
+		}
+		m_Input.Allocate(context.Memory, context.MaxBlockFrames);
+		m_TuningDirty = true;
+	}
+
+	void Process(const ProcessContext& context) override
+	{
+		if (m_TuningDirty)
+			Retune();
+
+		const bool driven = !context.Inputs.empty() && m_InputGain != 0.0f;
+		if (driven)
+		{
+			std::fill_n(m_Input.Data(), context.Frames, 0.0f);
+			// A force on one cell, as a density like the strikes.
+			const float cells = static_cast<float>(m_Width + 1);
+			const float scale = m_InputGain * cells * cells / m_SampleRate;
+			for (const BufferView& input : context.Inputs)
+			{
+				for (uint32_t channel = 0; channel < input.Channels; channel++)
+				{
+					const float* in = input.Channel(channel);
+					for (uint32_t i = 0; i < context.Frames; i++)
+						m_Input[i] += scale * in[i];
+				}
+			}
+		}
+
+		const size_t left = Cell(PickupLeftX, PickupLeftY);
+		const size_t right = Cell(1.0f - PickupLeftX, 1.0f - PickupLeftY);
+		const size_t strike = Cell(m_StrikeX, m_StrikeY);
+		const float scale = m_Gain * OutputScale * m_SampleRate;
+		float* first = context.Output.Channel(0);
+		float* second = context.Output.Channels > 1
+			? context.Output.Channel(1)
+			: nullptr;
+		for (uint32_t i = 0; i < context.Frames; i++)
+		{
+			if (driven)
+				m_Current[strike] += m_Input[i];
+			Step();
+			first[i] = scale * (m_Current[left] - m_Previous[left]);
+			if (second)
+				second[i] = scale * (m_Current[right] - m_Previous[right]);
+		}
+		for (uint32_t channel = 2; channel < context.Output.Channels; channel++)
+		{
+			std::copy_n(context.Output.Channel(channel % 2), context.Frames,
+						context.Output.Channel(channel));
+		}
+	}
+
+	void SetParameter(const uint32_t id, const float value) override
+	{
+		switch (id)
+		{
+			case Gain:
+				m_Gain = value;
+				break;
+			case Frequency:
+				m_Frequency = std::max(value, 1.0f);
+				m_TuningDirty = true;
+				break;
+			case FollowNotes:
+				m_FollowNotes = value >= 0.5f;
+				break;
+			case Stiffness:
+				m_Stiffness = std::clamp(value, 0.0f, 1.0f);
+				m_TuningDirty = true;
+				break;
+			case Decay:
+				m_Decay = std::max(value, 0.01f);
+				m_TuningDirty = true;
+				break;
+			case Brightness:
+				m_Brightness = std::clamp(value, 0.0f, 1.0f);
+				m_TuningDirty = true;
+				break;
+			case StrikeX:
+				m_StrikeX = std::clamp(value, 0.0f, 1.0f);
+				break;
+			case StrikeY:
+				m_StrikeY = std::clamp(value, 0.0f, 1.0f);
+				break;
+			case Hardness:
+				m_Hardness = std::clamp(value, 0.0f, 1.0f);
+				break;
+			case InputGain:
+				m_InputGain = value;
+				break;
+			default:
+				break;
+		}
+	}
+
+	/** @brief Strikes the surface; the grid keeps ringing underneath. */
+	void OnNote(const uint32_t note, const float velocity) override
+	{
+		if (velocity <= 0.0f || m_Current.Size() == 0)
+			return;
+		if (m_FollowNotes)
+		{
+			m_Frequency = 440.0f * std::exp2(
+				(static_cast<float>(note) - 69.0f) / 12.0f);
+			m_TuningDirty = true;
+		}
+
+		// Raised cosine of the mallet's radius. The weights integrate to one
+		// over the surface, so the grid resolution leaves the level alone.
+		const float radius = std::max(static_cast<float>(m_Width) *
+			SoftRadius * std::pow(HardRadius / SoftRadius, m_Hardness), 1.0f);
+		const float centreX = m_StrikeX * static_cast<float>(m_Width - 1);
+		const float centreY = m_StrikeY * static_cast<float>(m_Height - 1);
+		const auto reach = static_cast<int32_t>(radius);
+		const auto cx = static_cast<int32_t>(std::lround(centreX));
+		const auto cy = static_cast<int32_t>(std::lround(centreY));
+		float total = 0.0f;
+		for (uint32_t pass = 0; pass < 2; pass++)
+		{
+			const float cells = static_cast<float>(m_Width + 1);
+			const float amplitude = pass
+				? velocity * cells * cells / (total * m_SampleRate)
+				: 0.0f;
+			for (int32_t y = std::max(cy - reach, 0);
+				 y <= std::min(cy + reach, static_cast<int32_t>(m_Height) - 1);
+				 y++)
+			{
+				for (int32_t x = std::max(cx - reach, 0);
+					 x <= std::min(cx + reach,
+								   static_cast<int32_t>(m_Width) - 1);
+					 x++)
+				{
+					const float distance = std::hypot(
+						static_cast<float>(x) - centreX,
+						static_cast<float>(y) - centreY) / radius;
+					if (distance >= 1.0f)
+						continue;
+					const float weight = 0.5f + 0.5f * std::cos(
+						std::numbers::pi_v<float> * distance);
+					if (pass)
+						m_Current[Cell(x, y)] += amplitude * weight;
+					else
+						total += weight;
+				}
+			}
+			if (total <= 0.0f)
+				return;
+		}
+	}
+
+	[[nodiscard]] bool WantsNotes() const override { return true; }
+	[[nodiscard]] uint32_t GetMaxInputs() const override { return 8; }
+	[[nodiscard]] const char* GetName() const override { return "FDTD plate"; }
+
+	[[nodiscard]] uint32_t GetWidth() const { return m_Width; }
+	[[nodiscard]] uint32_t GetHeight() const { return m_Height; }
+	/** @brief Frequency after the stability clamp, any thread. */
+	[[nodiscard]] float GetEffectiveFrequency() const
+	{
+		return m_EffectiveFrequency.load(std::memory_order_relaxed);
+	}
+	/** @brief Strips each time step is split into. */
+	[[nodiscard]] uint32_t GetStripCount() const { return m_Strips; }
+
+private:
+	/** @brief Scratch rows of the first Laplacian each strip cycles. */
+	static constexpr uint32_t RingRows = 3;
+	/** @brief Fraction of the stability limit actually used. */
+	static constexpr float Headroom = 0.95f;
+	/** @brief Strike radius of the softest and hardest mallet, in widths. */
+	static constexpr float SoftRadius = 0.08f;
+	static constexpr float HardRadius = 0.01f;
+	/** @brief s1 at Brightness 0, in widths squared per second. */
+	static constexpr float MaxHighLoss = 0.0005f;
+	static constexpr float PickupLeftX = 0.31f;
+	static constexpr float PickupLeftY = 0.27f;
+	static constexpr float OutputScale = 0.005f;
+
+	/** @brief Scheme weights, each divided by 1 + s0 k. */
+	struct Coefficients
+	{
+		float Current;
+		float Previous;
+		float Laplacian;
+		float LastLaplacian;
+		float Bending;
+	};
+
+	[[nodiscard]] size_t Cell(const int32_t x, const int32_t y) const
+	{
+		return static_cast<size_t>(y + 1) * m_Stride + Simd::Width + x;
+	}
+	[[nodiscard]] size_t Cell(const float x, const float y) const
+	{
+		return Cell(static_cast<int32_t>(std::lround(
+						x * static_cast<float>(m_Width - 1))),
+					static_cast<int32_t>(std::lround(
+						y * static_cast<float>(m_Height - 1))));
+	}
+
+	/** @brief Solves c, kappa and the losses for the current settings. */
+	void Retune()
+	{
+		m_TuningDirty = false;
+		const double k = 1.0 / m_SampleRate;
+		const double h = 1.0 / (m_Width + 1);
+		const double width = 1.0;
+		const double height = h * (m_Height + 1);
+
+		// Lowest eigenvalue of the discrete Laplacian, so the grid rather
+		// than the continuous surface is in tune.
+		const double q = 4.0 / (h * h) *
+			(std::pow(std::sin(std::numbers::pi * h / (2.0 * width)), 2.0) +
+			 std::pow(std::sin(std::numbers::pi * h / (2.0 * height)), 2.0));
+		const double s0 = 6.91 / m_Decay;
+		const double s1 = MaxHighLoss * (1.0 - m_Brightness);
+		const double loss = 2.0 * s1 * k / (h * h);
+
+		// Frame-exact: k^2 (c^2 q + kappa^2 q^2) = 2 - 2 cos(w k).
+		const double tension = (1.0 - m_Stiffness) / q;
+		const double bending = m_Stiffness / (q * q);
+		const double perOmega = k * k * (tension / (h * h) +
+			8.0 * bending / (h * h * h * h));
+		const double limit = std::max(0.5 * Headroom - 2.0 * loss, 0.0) /
+			perOmega;
+		double omega = 2.0 * std::numbers::pi * m_Frequency * k;
+		double squared = 2.0 - 2.0 * std::cos(std::min(omega,
+													   std::numbers::pi));
+		if (squared / (k * k) > limit)
+		{
+			squared = limit * k * k;
+			omega = std::acos(std::max(1.0 - 0.5 * squared, -1.0));
+		}
+		const double lambda2 = squared * tension / (h * h);
+		const double mu2 = squared * bending / (h * h * h * h);
+		const double inverse = 1.0 / (1.0 + s0 * k);
+		m_Coefficients = {static_cast<float>(2.0 * inverse),
+						  static_cast<float>(-(1.0 - s0 * k) * inverse),
+						  static_cast<float>((lambda2 + loss) * inverse),
+						  static_cast<float>(-loss * inverse),
+						  static_cast<float>(-mu2 * inverse)};
+		m_Stiff = mu2 > 0.0;
+		m_EffectiveFrequency.store(static_cast<float>(
+			omega / (2.0 * std::numbers::pi * k)), std::memory_order_relaxed);
+	}
+
+	/** @brief Advances the grid one sample, then swaps the two grids. */
+	void Step()
+	{
+		if (m_Strips > 1)
+		{
+			auto body = [this](const uint32_t strip) { RunStrip(strip); };
+			m_Executor->ParallelFor(m_Strips, body);
+		}
+		else
+			RunStrip(0);
+		std::swap(m_Current, m_Previous);
+	}
+
+	void RunStrip(const uint32_t strip)
+	{
+		const uint32_t first = m_Height * strip / m_Strips;
+		const uint32_t last = m_Height * (strip + 1) / m_Strips;
+		if (m_Stiff)
+			StepRows<true>(strip, first, last);
+		else
+			StepRows<false>(strip, first, last);
+	}
+
+	/** @brief Unscaled 5-point Laplacian of row @p y of u into @p out. */
+	void Laplacian(const int32_t y, float* out) const
+	{
+		if (y < 0 || y >= static_cast<int32_t>(m_Height))
+		{
+			std::fill_n(out, m_Stride, 0.0f);
+			return;
+		}
+		const float* row = m_Current.Data() + Cell(0, y);
+		const Simd::Float four = Simd::Set(4.0f);
+		for (uint32_t packet = 0; packet < m_Packets; packet++)
+		{
+			const float* u = row + packet * Simd::Width;
+			Simd::Float sum = Simd::Add(
+				Simd::Add(Simd::Load(u - 1), Simd::Load(u + 1)),
+				Simd::Add(Simd::LoadAligned(u - m_Stride),
+						  Simd::LoadAligned(u + m_Stride)));
+			sum = Simd::Sub(sum, Simd::Mul(four, Simd::LoadAligned(u)));
+			if (packet + 1 == m_Packets)
+				sum = Simd::Mul(sum, Simd::LoadAligned(m_Mask.Data()));
+			Simd::StoreAligned(out + Simd::Width + packet * Simd::Width, sum);
+		}
+	}
+
+	/** @brief Rows [@p first, @p last) of the next step. */
+	template<bool Stiff>
+	void StepRows(const uint32_t strip, const uint32_t first,
+				  const uint32_t last)
+	{
+		// Ring rows keep their zero padding, so the rim reads as 0 too.
+		float* ring = m_Scratch.Data() + static_cast<size_t>(strip) *
+			RingRows * m_Stride;
+		const auto rowOf = [&](const int32_t y)
+		{
+			return ring + static_cast<size_t>((y + RingRows) % RingRows) *
+				m_Stride;
+		};
+		if constexpr (Stiff)
+		{
+			Laplacian(static_cast<int32_t>(first) - 1,
+					  rowOf(static_cast<int32_t>(first) - 1));
+			Laplacian(static_cast<int32_t>(first),
+					  rowOf(static_cast<int32_t>(first)));
+		}
+
+		const Simd::Float current = Simd::Set(m_Coefficients.Current);
+		const Simd::Float previous = Simd::Set(m_Coefficients.Previous);
+		const Simd::Float laplacian = Simd::Set(m_Coefficients.Laplacian);
+		const Simd::Float lastLaplacian = Simd::Set(
+			m_Coefficients.LastLaplacian);
+		const Simd::Float bending = Simd::Set(m_Coefficients.Bending);
+		const Simd::Float four = Simd::Set(4.0f);
+		const Simd::Float mask = Simd::LoadAligned(m_Mask.Data());
+
+		for (uint32_t y = first; y < last; y++)
+		{
+			const auto row = static_cast<int32_t>(y);
+			float* above = nullptr;
+			float* centre = nullptr;
+			float* below = nullptr;
+			if constexpr (Stiff)
+			{
+				Laplacian(row + 1, rowOf(row + 1));
+				above = rowOf(row - 1) + Simd::Width;
+				centre = rowOf(row) + Simd::Width;
+				below = rowOf(row + 1) + Simd::Width;
+			}
+
+			const size_t base = Cell(0, row);
+			const float* u = m_Current.Data() + base;
+			float* next = m_Previous.Data() + base;
+			float* lastL = m_LastLaplacian.Data() + base;
+			for (uint32_t packet = 0; packet < m_Packets; packet++)
+			{
+				const uint32_t x = packet * Simd::Width;
+				const Simd::Float here = Simd::LoadAligned(u + x);
+				Simd::Float l;
+				if constexpr (Stiff)
+					l = Simd::LoadAligned(centre + x);
+				else
+				{
+					l = Simd::Add(
+						Simd::Add(Simd::Load(u + x - 1), Simd::Load(u + x + 1)),
+						Simd::Add(Simd::LoadAligned(u + x - m_Stride),
+								  Simd::LoadAligned(u + x + m_Stride)));
+					l = Simd::Sub(l, Simd::Mul(four, here));
+				}
+
+				Simd::Float value = Simd::MulAdd(current, here, Simd::Mul(
+					previous, Simd::LoadAligned(next + x)));
+				value = Simd::MulAdd(laplacian, l, value);
+				value = Simd::MulAdd(lastLaplacian,
+									 Simd::LoadAligned(lastL + x), value);
+				if constexpr (Stiff)
+				{
+					Simd::Float bend = Simd::Add(
+						Simd::Add(Simd::Load(centre + x - 1),
+								  Simd::Load(centre + x + 1)),
+						Simd::Add(Simd::LoadAligned(above + x),
+								  Simd::LoadAligned(below + x)));
+					bend = Simd::Sub(bend, Simd::Mul(four, l));
+					value = Simd::MulAdd(bending, bend, value);
+				}
+				if (packet + 1 == m_Packets)
+				{
+					value = Simd::Mul(value, mask);
+					l = Simd::Mul(l, mask);
+				}
+				Simd::StoreAligned(next + x, value);
+				Simd::StoreAligned(lastL + x, l);
+			}
+		}
+	}
+
+private:
+	const uint32_t m_Width;
+	const uint32_t m_Height;
+	/** @brief Packets per row. */
+	const uint32_t m_Packets;
+	/** @brief Floats per row: the packets plus one of padding each side. */
+	const uint32_t m_Stride;
+
+	float m_SampleRate = 48000.0f;
+	ParallelExecutor* m_Executor = nullptr;
+	uint32_t m_Strips = 1;
+
+	float m_Gain = 1.0f;
+	float m_Frequency = 80.0f;
+	bool m_FollowNotes = true;
+	float m_Stiffness = 0.0f;
+	float m_Decay = 2.0f;
+	float m_Brightness = 0.5f;
+	float m_StrikeX = 0.4f;
+	float m_StrikeY = 0.45f;
+	float m_Hardness = 0.5f;
+	float m_InputGain = 0.0f;
+	bool m_TuningDirty = true;
+	bool m_Stiff = false;
+	Coefficients m_Coefficients{};
+	std::atomic<float> m_EffectiveFrequency{0.0f};
+
+	// Rows of (m_Height + 2) * m_Stride floats, the outer ones the rim.
+	ArenaArray<float> m_Current;
+	ArenaArray<float> m_Previous;
+	ArenaArray<float> m_LastLaplacian;
+	/** @brief RingRows rows per strip. */
+	ArenaArray<float> m_Scratch;
+	/** @brief 1 for the lanes of the last packet inside the grid. */
+	ArenaArray<float> m_Mask;
+	ArenaArray<float> m_Input;
+};
+}
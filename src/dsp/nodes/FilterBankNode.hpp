@@ -0,0 +1,170 @@
+﻿#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "../BiquadBank.hpp"
+#include "../MemoryArena.hpp"
+#include "../Node.hpp"
+#include "../Simd.hpp"
+
+namespace MT::DSP
+{
+/**
+ * @brief Parallel band-pass filters spaced evenly in pitch, each with its
+ * own gain, for vocoder style resonances and graphic equalizers.
+ *
+ * Inputs are summed before filtering. Every channel feeds its own row of
+ * a @ref BiquadBank; the bands of a channel fill the SIMD lanes and their
+ * outputs are summed across the lanes once per frame. Band gains are
+ * folded into the coefficients, so they cost nothing per sample.
+ *
+ * Parameter @c BandGain + n sets the gain of band n, counted from the
+ * lowest, in decibels.
+ */
+class FilterBankNode : public Node
+{
+public:
+	static constexpr uint32_t MaxBands = 128;
+
+	enum Parameter : uint32_t
+	{
+		Gain,
+		/** @brief Centre of the lowest band in Hz. */
+		LowFrequency,
+		/** @brief Centre of the highest band in Hz. */
+		HighFrequency,
+		Q,
+		BandGain
+	};
+
+	explicit FilterBankNode(const uint32_t bands = 32) :
+		m_Bands(std::clamp(bands, 1u, MaxBands))
+	{
+		m_BandGains.fill(0.0f);
+	}
+
+	void Prepare(const PrepareContext& context) override
+	{
+		m_SampleRate = context.SampleRate;
+		m_Channels = context.Channels;
+		m_BandPackets = (m_Bands + Simd::Width - 1) / Simd::Width;
+		m_Bank.Prepare(context.Memory,
+					   m_Channels * m_BandPackets * Simd::Width);
+		m_Input.Allocate(context.Memory, context.MaxBlockFrames);
+		m_Sums.Allocate(context.Memory, static_cast<size_t>(
+			context.MaxBlockFrames) * Simd::Width);
+		Retune();
+		m_Bank.Snap();
+	}
+
+	void Process(const ProcessContext& context) override
+	{
+		if (m_Dirty)
+			Retune();
+
+		const uint32_t frames = context.Frames;
+		const uint32_t channels = std::min(context.Output.Channels, m_Channels);
+		for (uint32_t channel = 0; channel < channels; channel++)
+		{
+			float* in = m_Input.Data();
+			std::fill_n(in, frames, 0.0f);
+			for (const BufferView& input : context.Inputs)
+			{
+				const float* source = input.Channel(channel);
+				for (uint32_t i = 0; i < frames; i++)
+					in[i] += source[i];
+			}
+
+			float* sums = m_Sums.Data();
+			std::fill_n(sums, static_cast<size_t>(frames) * Simd::Width, 0.0f);
+			m_Bank.ProcessSum(channel * m_BandPackets, m_BandPackets, in, sums,
+							  frames);
+
+			float* out = context.Output.Channel(channel);
+			for (uint32_t i = 0; i < frames; i++)
+			{
+				out[i] = m_Gain * Simd::Sum(Simd::LoadAligned(
+					sums + static_cast<size_t>(i) * Simd::Width));
+			}
+		}
+	}
+
+	void SetParameter(const uint32_t id, const float value) override
+	{
+		if (id == Gain)
+		{
+			m_Gain = value;
+			return;
+		}
+		if (id == LowFrequency)
+			m_LowFrequency = std::max(value, 1.0f);
+		else if (id == HighFrequency)
+			m_HighFrequency = std::max(value, 1.0f);
+		else if (id == Q)
+			m_Q = std::clamp(value, 0.1f, 200.0f);
+		else if (id >= BandGain && id < BandGain + m_Bands)
+			m_BandGains[id - BandGain] = std::clamp(value, -96.0f, 48.0f);
+		else
+			return;
+		m_Dirty = true;
+	}
+
+	[[nodiscard]] uint32_t GetBandCount() const { return m_Bands; }
+
+	[[nodiscard]] uint32_t GetMaxInputs() const override { return 8; }
+	[[nodiscard]] const char* GetName() const override { return "Filter bank"; }
+
+private:
+	void Retune()
+	{
+		m_Dirty = false;
+		const float ratio = m_Bands > 1
+			? std::pow(m_HighFrequency / m_LowFrequency,
+					   1.0f / static_cast<float>(m_Bands - 1))
+			: 1.0f;
+		float frequency = m_LowFrequency;
+		for (uint32_t band = 0; band < m_Bands; band++, frequency *= ratio)
+		{
+			BiquadCoefficients coefficients = BiquadCoefficients::Design(
+				BiquadType::BandPass, frequency, m_Q, 0.0f, m_SampleRate);
+			const float gain = std::pow(10.0f, m_BandGains[band] / 20.0f);
+			coefficients.B0 *= gain;
+			coefficients.B1 *= gain;
+			coefficients.B2 *= gain;
+			for (uint32_t channel = 0; channel < m_Channels; channel++)
+			{
+				m_Bank.SetTarget(channel * m_BandPackets * Simd::Width + band,
+								 coefficients);
+			}
+		}
+		// The lanes past the last band would otherwise pass the input.
+		for (uint32_t band = m_Bands; band < m_BandPackets * Simd::Width;
+			 band++)
+		{
+			for (uint32_t channel = 0; channel < m_Channels; channel++)
+			{
+				m_Bank.SetTarget(channel * m_BandPackets * Simd::Width + band,
+								 {0.0f, 0.0f, 0.0f, 0.0f, 0.0f});
+			}
+		}
+	}
+
+private:
+	uint32_t m_Bands;
+	uint32_t m_BandPackets = 0;
+	uint32_t m_Channels = 0;
+	float m_SampleRate = 48000.0f;
+	float m_Gain = 1.0f;
+	float m_LowFrequency = 100.0f;
+	float m_HighFrequency = 8000.0f;
+	float m_Q = 8.0f;
+	std::array<float, MaxBands> m_BandGains{};
+	bool m_Dirty = true;
+
+	BiquadBank m_Bank;
+	ArenaArray<float> m_Input;
+	/** @brief Per frame, the band outputs summed within each lane. */
+	ArenaArray<float> m_Sums;
+};
+}
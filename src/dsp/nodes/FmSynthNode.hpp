@@ -0,0 +1,336 @@
+﻿#pragma once
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "../FmAlgorithm.hpp"
+#include "../MemoryArena.hpp"
+#include "../PolyphonicNode.hpp"
+#include "../Simd.hpp"
+
+namespace MT::DSP
+{
+/**
+ * @brief Polyphonic phase-modulation synth whose operators are wired by a
+ * compiled @ref FmAlgorithm.
+ *
+ * A SIMD group of voices runs the algorithm's steps in order. Operators
+ * outside a loop render the whole control chunk into a small per-operator
+ * buffer before the next step reads it, so their inner loop only touches
+ * the inputs the routing actually has. Loops render frame by frame. The
+ * carriers are mixed last and shaped by the shared envelope.
+ *
+ * Phases are wrapped once per chunk, each frame's phase is computed from
+ * the chunk start, so no floor() sits on a dependency chain through the
+ * frames; SinCycles() wraps the angle it is given anyway.
+ *
+ * Every algorithm given to the constructor is compiled beforehand, and the
+ * Algorithm parameter switches between them without touching the heap.
+ */
+class FmSynthNode : public PolyphonicNode
+{
+public:
+	enum Parameter : uint32_t
+	{
+		/** @brief Index into the algorithms given at construction. */
+		Algorithm = PolyphonicNode::ParameterCount,
+		/** @brief Scale of every modulation depth. */
+		ModulationIndex,
+		/** @brief Scale of every operator's self feedback. */
+		Feedback,
+		/** @brief 0-1, how much a soft note lowers the modulation. */
+		VelocitySensitivity
+	};
+
+	/** @brief The compiled FmPatch::MakePresets(). */
+	static std::vector<std::shared_ptr<const FmAlgorithm>> CompilePresets()
+	{
+		std::vector<std::shared_ptr<const FmAlgorithm>> algorithms;
+		for (const FmPatch& patch : FmPatch::MakePresets())
+			algorithms.push_back(FmAlgorithm::Compile(patch));
+		return algorithms;
+	}
+
+	/** @param algorithms At least one, none null. */
+	explicit FmSynthNode(std::vector<std::shared_ptr<const FmAlgorithm>>
+							 algorithms = CompilePresets(),
+						 const uint32_t voices = 256,
+						 const VoiceStealPolicy policy =
+								 VoiceStealPolicy::Oldest) :
+		PolyphonicNode(voices, policy),
+		m_Algorithms(std::move(algorithms)) {}
+
+	[[nodiscard]] const char* GetName() const override { return "FM"; }
+
+	[[nodiscard]] const std::vector<std::shared_ptr<const FmAlgorithm>>&
+	GetAlgorithms() const
+	{
+		return m_Algorithms;
+	}
+
+private:
+	static constexpr uint32_t MaxOperators = FmPatch::MaxOperators;
+
+	void PrepareVoices(const PrepareContext& context) override
+	{
+		m_Phase.Allocate(context.Memory, MaxOperators * m_Capacity);
+		m_Last.Allocate(context.Memory, MaxOperators * m_Capacity);
+		m_BeforeLast.Allocate(context.Memory, MaxOperators * m_Capacity);
+		m_Increment.Allocate(context.Memory, m_Capacity);
+		m_Amplitude.Allocate(context.Memory, m_Capacity);
+		m_VelocityScale.Allocate(context.Memory, m_Capacity);
+		m_Buffer.Allocate(context.Memory,
+						  MaxOperators * ControlFrames * Simd::Width);
+	}
+
+	void StartVoice(const uint32_t voice, const uint32_t note,
+					const float velocity, const bool stolen) override
+	{
+		if (!stolen)
+		{
+			for (uint32_t op = 0; op < MaxOperators; op++)
+			{
+				const size_t index = op * m_Capacity + voice;
+				m_Phase[index] = 0.0f;
+				m_Last[index] = 0.0f;
+				m_BeforeLast[index] = 0.0f;
+			}
+		}
+		m_Increment[voice] = NoteFrequency(note) / m_SampleRate;
+		m_Amplitude[voice] = velocity;
+		m_VelocityScale[voice] = 1.0f - m_VelocitySensitivity *
+			(1.0f - velocity);
+	}
+
+	void RenderGroup(const uint32_t group, const uint32_t frames,
+					 float* sums) override
+	{
+		const FmAlgorithm& algorithm = *m_Algorithms[m_Algorithm];
+		const uint32_t base = group * Simd::Width;
+		const std::vector<FmAlgorithm::Operator>& operators =
+			algorithm.GetOperators();
+		for (const FmAlgorithm::Step& step : algorithm.GetSteps())
+		{
+			if (step.Count > 1)
+			{
+				RenderLoop(algorithm, step, base, frames);
+				continue;
+			}
+			const uint32_t op = algorithm.GetOrder()[step.First];
+			if (operators[op].Feedback != 0.0f)
+				RenderOperator<true>(algorithm, op, base, frames);
+			else
+				RenderOperator<false>(algorithm, op, base, frames);
+		}
+
+		float* levels = m_Envelopes.GetLevels() + base;
+		Simd::Float envelope = Simd::LoadAligned(levels);
+		const Simd::Float scale = Simd::LoadAligned(
+			m_Envelopes.GetScales() + base);
+		const Simd::Float offset = Simd::LoadAligned(
+			m_Envelopes.GetOffsets() + base);
+		const Simd::Float amplitude = Simd::LoadAligned(
+			m_Amplitude.Data() + base);
+		for (uint32_t i = 0; i < frames; i++)
+		{
+			envelope = EnvelopeBank::Step(envelope, scale, offset);
+			Simd::Float mix = Simd::Set(0.0f);
+			for (const uint32_t op : algorithm.GetCarriers())
+			{
+				mix = Simd::MulAdd(Simd::Set(operators[op].Output),
+								   Simd::LoadAligned(Output(op, i)), mix);
+			}
+			float* sum = sums + i * Simd::Width;
+			Simd::StoreAligned(sum, Simd::MulAdd(
+				Simd::Mul(mix, envelope), amplitude, Simd::LoadAligned(sum)));
+		}
+		Simd::StoreAligned(levels, envelope);
+	}
+
+	/** @brief Frame @p frame of operator @p op in the chunk buffer. */
+	float* Output(const uint32_t op, const uint32_t frame)
+	{
+		return m_Buffer.Data() + (op * ControlFrames + frame) * Simd::Width;
+	}
+
+	[[nodiscard]] Simd::Float LoadIndex(const uint32_t base) const
+	{
+		return Simd::Mul(Simd::Set(m_ModulationIndex),
+						 Simd::LoadAligned(m_VelocityScale.Data() + base));
+	}
+
+	/**
+	 * @brief Renders one operator outside any loop for the whole chunk; its
+	 * inputs were all rendered by earlier steps.
+	 */
+	template<bool SelfFeedback>
+	void RenderOperator(const FmAlgorithm& algorithm, const uint32_t op,
+						const uint32_t base, const uint32_t frames)
+	{
+		const FmAlgorithm::Operator& entry = algorithm.GetOperators()[op];
+		const FmAlgorithm::Term* terms = algorithm.GetTerms().data() +
+			entry.FirstTerm;
+		const size_t state = op * m_Capacity + base;
+
+		Simd::Float phase = Simd::LoadAligned(m_Phase.Data() + state);
+		Simd::Float last = Simd::LoadAligned(m_Last.Data() + state);
+		Simd::Float beforeLast = Simd::LoadAligned(m_BeforeLast.Data() + state);
+		const Simd::Float increment = Simd::Mul(Simd::Set(entry.Ratio),
+			Simd::LoadAligned(m_Increment.Data() + base));
+		const Simd::Float index = LoadIndex(base);
+		const Simd::Float feedback = Simd::Set(0.5f * entry.Feedback *
+			m_FeedbackAmount);
+
+		for (uint32_t i = 0; i < frames; i++)
+		{
+			Simd::Float modulation = Simd::Set(0.0f);
+			for (uint32_t term = 0; term < entry.TermCount; term++)
+			{
+				modulation = Simd::MulAdd(
+					Simd::Set(terms[term].Depth),
+					Simd::LoadAligned(Output(terms[term].Source, i)),
+					modulation);
+			}
+			if constexpr (SelfFeedback)
+			{
+				modulation = Simd::MulAdd(feedback, Simd::Add(last, beforeLast),
+										  modulation);
+			}
+
+			const Simd::Float position = Simd::MulAdd(
+				Simd::Set(static_cast<float>(i + 1)), increment, phase);
+			const Simd::Float value = Simd::SinCycles(
+				Simd::MulAdd(modulation, index, position));
+			Simd::StoreAligned(Output(op, i), value);
+			if constexpr (SelfFeedback)
+			{
+				beforeLast = last;
+				last = value;
+			}
+		}
+
+		phase = Simd::MulAdd(Simd::Set(static_cast<float>(frames)), increment,
+							 phase);
+		Simd::StoreAligned(m_Phase.Data() + state,
+						   Simd::Sub(phase, Simd::Floor(phase)));
+		if constexpr (SelfFeedback)
+		{
+			Simd::StoreAligned(m_Last.Data() + state, last);
+			Simd::StoreAligned(m_BeforeLast.Data() + state, beforeLast);
+		}
+	}
+
+	/**
+	 * @brief Renders the operators of a loop frame by frame. Inputs from
+	 * the loop itself read the previous frame, so within a frame the
+	 * operators do not depend on each other.
+	 */
+	void RenderLoop(const FmAlgorithm& algorithm, const FmAlgorithm::Step& step,
+					const uint32_t base, const uint32_t frames)
+	{
+		const uint32_t* order = algorithm.GetOrder().data() + step.First;
+		const std::vector<FmAlgorithm::Term>& terms = algorithm.GetTerms();
+		const Simd::Float increment = Simd::LoadAligned(
+			m_Increment.Data() + base);
+		const Simd::Float index = LoadIndex(base);
+
+		Simd::Float phase[MaxOperators];
+		Simd::Float last[MaxOperators];
+		Simd::Float beforeLast[MaxOperators];
+		for (uint32_t k = 0; k < step.Count; k++)
+		{
+			const size_t state = order[k] * m_Capacity + base;
+			phase[k] = Simd::LoadAligned(m_Phase.Data() + state);
+			last[k] = Simd::LoadAligned(m_Last.Data() + state);
+			beforeLast[k] = Simd::LoadAligned(m_BeforeLast.Data() + state);
+		}
+
+		for (uint32_t i = 0; i < frames; i++)
+		{
+			for (uint32_t k = 0; k < step.Count; k++)
+			{
+				const uint32_t op = order[k];
+				const FmAlgorithm::Operator& entry =
+					algorithm.GetOperators()[op];
+				Simd::Float modulation = Simd::Set(0.0f);
+				for (uint32_t t = 0; t < entry.TermCount; t++)
+				{
+					const FmAlgorithm::Term& term = terms[entry.FirstTerm + t];
+					const float* input = !term.Delayed
+						? Output(term.Source, i)
+						: i > 0
+						? Output(term.Source, i - 1)
+						: m_Last.Data() + term.Source * m_Capacity + base;
+					modulation = Simd::MulAdd(Simd::Set(term.Depth),
+											  Simd::LoadAligned(input),
+											  modulation);
+				}
+				modulation = Simd::MulAdd(
+					Simd::Set(0.5f * entry.Feedback * m_FeedbackAmount),
+					Simd::Add(last[k], beforeLast[k]), modulation);
+
+				const Simd::Float position = Simd::MulAdd(
+					Simd::Set(static_cast<float>(i + 1) * entry.Ratio),
+					increment, phase[k]);
+				const Simd::Float value = Simd::SinCycles(
+					Simd::MulAdd(modulation, index, position));
+				Simd::StoreAligned(Output(op, i), value);
+				beforeLast[k] = last[k];
+				last[k] = value;
+			}
+		}
+
+		for (uint32_t k = 0; k < step.Count; k++)
+		{
+			const size_t state = order[k] * m_Capacity + base;
+			phase[k] = Simd::MulAdd(Simd::Set(static_cast<float>(frames) *
+				algorithm.GetOperators()[order[k]].Ratio), increment, phase[k]);
+			Simd::StoreAligned(m_Phase.Data() + state,
+							   Simd::Sub(phase[k], Simd::Floor(phase[k])));
+			Simd::StoreAligned(m_Last.Data() + state, last[k]);
+			Simd::StoreAligned(m_BeforeLast.Data() + state, beforeLast[k]);
+		}
+	}
+
+	void SetVoiceParameter(const uint32_t id, const float value) override
+	{
+		switch (id)
+		{
+			case Algorithm:
+				m_Algorithm = std::min(static_cast<uint32_t>(
+					std::max(value, 0.0f)),
+					static_cast<uint32_t>(m_Algorithms.size()) - 1);
+				break;
+			case ModulationIndex:
+				m_ModulationIndex = std::max(value, 0.0f);
+				break;
+			case Feedback:
+				m_FeedbackAmount = std::max(value, 0.0f);
+				break;
+			case VelocitySensitivity:
+				m_VelocitySensitivity = std::clamp(value, 0.0f, 1.0f);
+				break;
+			default:
+				break;
+		}
+	}
+
+private:
+	std::vector<std::shared_ptr<const FmAlgorithm>> m_Algorithms;
+	uint32_t m_Algorithm = 0;
+	float m_ModulationIndex = 1.0f;
+	float m_FeedbackAmount = 1.0f;
+	float m_VelocitySensitivity = 0.5f;
+
+	// Structure of arrays: per voice, and per operator then voice.
+	ArenaArray<float> m_Phase;
+	ArenaArray<float> m_Last;
+	ArenaArray<float> m_BeforeLast;
+	ArenaArray<float> m_Increment;
+	ArenaArray<float> m_Amplitude;
+	ArenaArray<float> m_VelocityScale;
+	// One chunk of every operator of the group being rendered.
+	ArenaArray<float> m_Buffer;
+};
+}
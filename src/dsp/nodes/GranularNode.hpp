@@ -0,0 +1,666 @@
+﻿#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <numbers>
+#include <utility>
+
+#include "../GrainSample.hpp"
+#include "../MemoryArena.hpp"
+#include "../Node.hpp"
+#include "../Random.hpp"
+#include "../Simd.hpp"
+#include "../WavetableBank.hpp"
+
+namespace MT::DSP
+{
+/** @brief What the grains of a @ref GranularNode read. */
+enum class GrainSource : uint32_t
+{
+	/** @brief One frame of the node's WavetableBank, looped at a pitch. */
+	Wavetable,
+	/** @brief The node's GrainSample. */
+	Sample,
+	/** @brief The last seconds of the node's inputs. */
+	Live,
+	Count
+};
+
+/** @brief Amplitude envelopes of a grain, all zero at both ends. */
+enum class GrainWindow : uint32_t
+{
+	Hann,
+	/** @brief Gaussian, lowered to reach zero at the edges. */
+	Gaussian,
+	/** @brief Flat top with cosine tapers over a quarter at each end. */
+	Tukey,
+	/** @brief Short attack, then an exponential decay. */
+	Decay,
+	Count
+};
+
+/**
+ * @brief Cloud of thousands of short, windowed grains.
+ *
+ * Grains live in a fixed pool, kept as one array per field with the active
+ * grains packed at the front, so a SIMD group renders Simd::Width grains
+ * with gathers from the source and from a precomputed window table. Spare
+ * lanes of the last group are parked on a silent window position.
+ *
+ * Scheduling runs once per block: the grains due in the block are drawn
+ * from the density, scattered at random frames inside it (a Poisson
+ * process), and written to the pool with a window position that stays at
+ * zero until their onset frame. Grains whose window has run out are
+ * swapped out at the end of the block. A full pool drops new grains rather
+ * than allocating.
+ *
+ * Each grain tracks an integer start in the source and a small fractional
+ * offset, which is folded into the start every block so the interpolation
+ * keeps full precision on long sources.
+ */
+class GranularNode : public Node
+{
+public:
+	/** @brief Window table resolution. */
+	static constexpr uint32_t WindowSize = 1024;
+	/** @brief Seconds of input kept for the Live source. */
+	static constexpr float LiveSeconds = 6.0f;
+	/** @brief Longest reach back into the Live source, in seconds. */
+	static constexpr float MaxLiveDelay = 2.0f;
+
+	enum Parameter : uint32_t
+	{
+		Gain,
+		/** @brief A @ref GrainSource, passed as a float; drops all grains. */
+		Source,
+		/** @brief A @ref GrainWindow, passed as a float. */
+		Window,
+		/** @brief Grains started per second. */
+		Density,
+		/** @brief Length of a grain in seconds, 0.001-1. */
+		Duration,
+		/**
+		 * @brief 0-1, where grains start: a fraction of the sample, or of
+		 * MaxLiveDelay back from now.
+		 */
+		Position,
+		/** @brief 0-1, random offset added to Position. */
+		PositionSpread,
+		/** @brief Transposition in semitones. */
+		Pitch,
+		/** @brief Random transposition of each grain, in semitones. */
+		PitchSpread,
+		/** @brief Hz, the pitch of Wavetable grains before transposition. */
+		Frequency,
+		/** @brief Wavetable frame the grains read. */
+		Frame,
+		/** @brief 0-1, how far grains are panned apart. */
+		Stereo,
+		/**
+		 * @brief Whether the latest held note sets the pitch and gates the
+		 * cloud; middle C plays Pitch unchanged.
+		 */
+		FollowNotes
+	};
+
+	/**
+	 * @param grains Pool capacity, rounded up to a multiple of Simd::Width.
+	 * @param wavetables Needed by the Wavetable source, which is silent
+	 * without.
+	 * @param sample Read by the Sample source; nullptr renders
+	 * GrainSample::MakeDroplets() at the stream rate.
+	 */
+	explicit GranularNode(const uint32_t grains = 8192,
+						  std::shared_ptr<const WavetableBank> wavetables =
+							  nullptr,
+						  std::shared_ptr<const GrainSample> sample = nullptr) :
+		m_Capacity((std::max(grains, 1u) + Simd::Width - 1) / Simd::Width *
+				   Simd::Width),
+		m_Wavetables(std::move(wavetables)),
+		m_Sample(std::move(sample)) {}
+
+	void Prepare(const PrepareContext& context) override
+	{
+		m_SampleRate = context.SampleRate;
+		if (!m_Sample)
+			m_Sample = GrainSample::MakeDroplets(context.SampleRate);
+
+		for (ArenaArray<float>* array : {&m_Start, &m_Offset, &m_Fraction,
+										 &m_Rate, &m_WindowPhase,
+										 &m_WindowStep, &m_Left, &m_Right})
+			array->Allocate(context.Memory, m_Capacity);
+		for (uint32_t grain = 0; grain < m_Capacity; grain++)
+			Park(grain);
+		m_ActiveGrains = 0;
+
+		m_Windows.Allocate(context.Memory,
+			static_cast<size_t>(GrainWindow::Count) * WindowStride);
+		BuildWindows();
+
+		m_RingLength = static_cast<uint32_t>(LiveSeconds * m_SampleRate);
+		m_Ring.Allocate(context.Memory, m_RingLength + 1);
+		m_WriteHead = 0;
+
+		m_Sums.Allocate(context.Memory, 2 * RenderFrames * Simd::Width);
+		m_Mix.Allocate(context.Memory, 2 * static_cast<size_t>(
+			context.MaxBlockFrames));
+		m_SpawnDebt = 0.0f;
+		m_ActiveCount.store(0, std::memory_order_relaxed);
+	}
+
+	void Process(const ProcessContext& context) override
+	{
+		if (m_SourceChanged)
+		{
+			for (uint32_t grain = 0; grain < m_ActiveGrains; grain++)
+				Park(grain);
+			m_ActiveGrains = 0;
+			m_SourceChanged = false;
+		}
+		const uint32_t writeHead = m_WriteHead;
+		CaptureInputs(context);
+		Schedule(context.Frames, writeHead);
+
+		float* left = m_Mix.Data();
+		float* right = left + context.Frames;
+		const SourceView source = GetSource();
+		const uint32_t groups = (m_ActiveGrains + Simd::Width - 1) /
+			Simd::Width;
+		for (uint32_t frame = 0; frame < context.Frames;
+			 frame += RenderFrames)
+		{
+			const uint32_t frames = std::min(RenderFrames,
+											 context.Frames - frame);
+			float* sumsLeft = m_Sums.Data();
+			float* sumsRight = sumsLeft + RenderFrames * Simd::Width;
+			std::fill_n(sumsLeft, 2 * RenderFrames * Simd::Width, 0.0f);
+			if (source.Data)
+			{
+				for (uint32_t group = 0; group < groups; group++)
+					RenderGroup(group, frames, source, sumsLeft, sumsRight);
+			}
+			for (uint32_t i = 0; i < frames; i++)
+			{
+				left[frame + i] = Simd::Sum(
+					Simd::LoadAligned(sumsLeft + i * Simd::Width));
+				right[frame + i] = Simd::Sum(
+					Simd::LoadAligned(sumsRight + i * Simd::Width));
+			}
+		}
+		Retire(source.Length);
+
+		const BufferView& out = context.Output;
+		if (out.Channels == 1)
+		{
+			float* mono = out.Channel(0);
+			for (uint32_t i = 0; i < context.Frames; i++)
+				mono[i] = std::numbers::sqrt2_v<float> * 0.5f *
+					(left[i] + right[i]);
+		}
+		else
+		{
+			for (uint32_t channel = 0; channel < out.Channels; channel++)
+			{
+				std::copy_n(channel % 2 ? right : left, context.Frames,
+							out.Channel(channel));
+			}
+		}
+		m_ActiveCount.store(m_ActiveGrains, std::memory_order_relaxed);
+	}
+
+	void SetParameter(const uint32_t id, const float value) override
+	{
+		switch (id)
+		{
+			case Gain:
+				m_Gain = value;
+				break;
+			case Source:
+			{
+				const auto source = static_cast<GrainSource>(std::clamp(
+					static_cast<uint32_t>(std::max(value, 0.0f)), 0u,
+					static_cast<uint32_t>(GrainSource::Count) - 1));
+				m_SourceChanged |= source != m_Source;
+				m_Source = source;
+				break;
+			}
+			case Window:
+				m_Window = static_cast<GrainWindow>(std::clamp(
+					static_cast<uint32_t>(std::max(value, 0.0f)), 0u,
+					static_cast<uint32_t>(GrainWindow::Count) - 1));
+				break;
+			case Density:
+				m_Density = std::max(value, 0.0f);
+				break;
+			case Duration:
+				m_Duration = std::clamp(value, 0.001f, 1.0f);
+				break;
+			case Position:
+				m_Position = std::clamp(value, 0.0f, 1.0f);
+				break;
+			case PositionSpread:
+				m_PositionSpread = std::clamp(value, 0.0f, 1.0f);
+				break;
+			case Pitch:
+				m_Pitch = std::clamp(value, -48.0f, 24.0f);
+				break;
+			case PitchSpread:
+				m_PitchSpread = std::clamp(value, 0.0f, 24.0f);
+				break;
+			case Frequency:
+				m_Frequency = std::max(value, 1.0f);
+				break;
+			case Frame:
+				m_Frame = static_cast<uint32_t>(std::max(value, 0.0f) + 0.5f);
+				break;
+			case Stereo:
+				m_Stereo = std::clamp(value, 0.0f, 1.0f);
+				break;
+			case FollowNotes:
+				m_FollowNotes = value >= 0.5f;
+				break;
+			default:
+				break;
+		}
+	}
+
+	void OnNote(const uint32_t note, const float velocity) override
+	{
+		if (velocity > 0.0f)
+		{
+			m_Note = note;
+			m_NoteVelocity = velocity;
+		}
+		else if (note == m_Note)
+			m_NoteVelocity = 0.0f;
+	}
+
+	[[nodiscard]] bool WantsNotes() const override { return true; }
+	[[nodiscard]] uint32_t GetMaxInputs() const override { return 8; }
+	[[nodiscard]] const char* GetName() const override { return "Granular"; }
+
+	/** @brief Grains sounding at the end of the last block, any thread. */
+	[[nodiscard]] uint32_t GetActiveGrainCount() const
+	{
+		return m_ActiveCount.load(std::memory_order_relaxed);
+	}
+	[[nodiscard]] uint32_t GetGrainCapacity() const { return m_Capacity; }
+	/** @brief Grains dropped because the pool was full, any thread. */
+	[[nodiscard]] uint64_t GetDroppedGrainCount() const
+	{
+		return m_Dropped.load(std::memory_order_relaxed);
+	}
+
+private:
+	/** @brief Frames rendered per pass over the pool, keeps the sums in L1. */
+	static constexpr uint32_t RenderFrames = 64;
+	/** @brief Two zero guards after each window: the end and its neighbour. */
+	static constexpr uint32_t WindowStride = WindowSize + 2;
+	/** @brief Highest pitch a grain may play a source at. */
+	static constexpr float MaxRate = 16.0f;
+
+	/** @brief Samples the grains currently read. */
+	struct SourceView
+	{
+		const float* Data;
+		/** @brief Loop length; one guard sample follows each loop. */
+		uint32_t Length;
+	};
+
+	[[nodiscard]] SourceView GetSource() const
+	{
+		switch (m_Source)
+		{
+			case GrainSource::Wavetable:
+				return {m_Wavetables ? m_Wavetables->GetData() : nullptr,
+						WavetableBank::TableSize};
+			case GrainSource::Live:
+				return {m_Ring.Data(), m_RingLength};
+			default:
+				return {m_Sample->GetData(), m_Sample->GetLength()};
+		}
+	}
+
+	/** @brief A silent spare lane: past the window end, nothing to read. */
+	void Park(const uint32_t grain)
+	{
+		m_Start[grain] = 0.0f;
+		m_Offset[grain] = 0.0f;
+		m_Fraction[grain] = 0.0f;
+		m_Rate[grain] = 0.0f;
+		m_WindowPhase[grain] = static_cast<float>(WindowSize);
+		m_WindowStep[grain] = 0.0f;
+		m_Left[grain] = 0.0f;
+		m_Right[grain] = 0.0f;
+	}
+
+	void BuildWindows()
+	{
+		constexpr float Pi = std::numbers::pi_v<float>;
+		for (uint32_t shape = 0;
+			 shape < static_cast<uint32_t>(GrainWindow::Count); shape++)
+		{
+			float* table = m_Windows.Data() + shape * WindowStride;
+			const float edge = std::exp(-0.5f * 3.0f * 3.0f);
+			for (uint32_t i = 0; i <= WindowSize; i++)
+			{
+				const float x = static_cast<float>(i) / WindowSize;
+				float value = 0.0f;
+				switch (static_cast<GrainWindow>(shape))
+				{
+					case GrainWindow::Hann:
+						value = 0.5f - 0.5f * std::cos(2.0f * Pi * x);
+						break;
+					case GrainWindow::Gaussian:
+					{
+						// Three standard deviations to each edge.
+						const float t = 6.0f * (x - 0.5f);
+						value = (std::exp(-0.5f * t * t) - edge) /
+							(1.0f - edge);
+						break;
+					}
+					case GrainWindow::Tukey:
+					{
+						const float taper = std::min(x, 1.0f - x) / 0.25f;
+						value = taper < 1.0f
+							? 0.5f - 0.5f * std::cos(Pi * taper)
+							: 1.0f;
+						break;
+					}
+					case GrainWindow::Decay:
+					{
+						constexpr float Attack = 0.05f;
+						const float end = std::exp(-5.0f);
+						value = x < Attack
+							? std::sin(0.5f * Pi * x / Attack)
+							: (std::exp(-5.0f * (x - Attack) /
+								(1.0f - Attack)) - end) / (1.0f - end);
+						break;
+					}
+					default:
+						break;
+				}
+				table[i] = std::max(value, 0.0f);
+			}
+			table[0] = 0.0f;
+			table[WindowSize] = 0.0f;
+			table[WindowSize + 1] = 0.0f;
+		}
+	}
+
+	/** @brief Appends the mono mix of the inputs to the live ring. */
+	void CaptureInputs(const ProcessContext& context)
+	{
+		if (m_Source != GrainSource::Live)
+			return;
+		// At most two pieces, the second from the start of the ring.
+		const uint32_t first = std::min(context.Frames,
+										m_RingLength - m_WriteHead);
+		MixInputsToMono(context, 1.0f, m_Ring.Data() + m_WriteHead, 0, first);
+		MixInputsToMono(context, 1.0f, m_Ring.Data(), first,
+						context.Frames - first);
+		m_Ring[m_RingLength] = m_Ring[0];
+		m_WriteHead = (m_WriteHead + context.Frames) % m_RingLength;
+	}
+
+	/**
+	 * @brief Starts the grains due in this block at random frames inside
+	 * it. @p writeHead is where the block's input went into the ring.
+	 */
+	void Schedule(const uint32_t frames, const uint32_t writeHead)
+	{
+		const float gate = m_FollowNotes ? m_NoteVelocity : 1.0f;
+		if (gate <= 0.0f || m_Density <= 0.0f || !GetSource().Data)
+		{
+			m_SpawnDebt = 0.0f;
+			return;
+		}
+		m_SpawnDebt += m_Density * static_cast<float>(frames) / m_SampleRate;
+		const auto due = static_cast<uint32_t>(m_SpawnDebt);
+		m_SpawnDebt -= static_cast<float>(due);
+
+		// Roughly constant loudness however many grains overlap.
+		const float overlap = std::max(m_Density * m_Duration, 1.0f);
+		const float level = m_Gain * gate / std::sqrt(overlap);
+		const float transpose = m_Pitch + (m_FollowNotes
+			? static_cast<float>(m_Note) - 60.0f
+			: 0.0f);
+		const float durationFrames = m_Duration * m_SampleRate;
+		for (uint32_t n = 0; n < due; n++)
+		{
+			if (m_ActiveGrains == m_Capacity)
+			{
+				m_Dropped.fetch_add(due - n, std::memory_order_relaxed);
+				break;
+			}
+			const float onset = m_Random.NextUnipolar() *
+				static_cast<float>(frames);
+			const float pitch = transpose +
+				m_PitchSpread * m_Random.NextBipolar();
+			const float pan = 0.25f * std::numbers::pi_v<float> *
+				(1.0f + m_Stereo * m_Random.NextBipolar());
+			const uint32_t grain = m_ActiveGrains++;
+			Spawn(grain, onset, std::exp2(pitch / 12.0f), durationFrames,
+				  writeHead);
+			m_Left[grain] = level * std::cos(pan);
+			m_Right[grain] = level * std::sin(pan);
+		}
+	}
+
+	/**
+	 * @brief Places a grain starting @p onset frames into the block; before
+	 * that its window position is negative, which reads as silence.
+	 */
+	void Spawn(const uint32_t grain, const float onset, const float ratio,
+			   const float durationFrames, const uint32_t writeHead)
+	{
+		float rate = ratio;
+		float offset = 0.0f;
+		float length = 0.0f;
+		float start = 0.0f;
+		switch (m_Source)
+		{
+			case GrainSource::Wavetable:
+			{
+				const float increment = std::min(
+					m_Frequency * ratio / m_SampleRate, 0.5f);
+				const uint32_t frame = m_Wavetables
+					? std::min(m_Frame, m_Wavetables->GetFrameCount() - 1)
+					: 0;
+				offset = static_cast<float>(
+					frame * WavetableBank::FrameStride +
+					WavetableBank::SelectLevel(increment) *
+						WavetableBank::LevelStride);
+				rate = increment * WavetableBank::TableSize;
+				length = static_cast<float>(WavetableBank::TableSize);
+				start = m_Random.NextUnipolar() * length;
+				break;
+			}
+			case GrainSource::Live:
+			{
+				// Stay behind the write head for the whole grain, even when
+				// reading faster than it moves, and start no further back
+				// than the ring reaches, so the grain never crosses it.
+				length = static_cast<float>(m_RingLength);
+				const float reach = length - MaxLiveDelay * m_SampleRate -
+					4.0f;
+				rate = std::min({rate, MaxRate,
+								 1.0f + reach / (durationFrames + onset)});
+				const float delay = MaxLiveDelay * m_SampleRate * std::clamp(
+					m_Position + m_PositionSpread * m_Random.NextUnipolar(),
+					0.0f, 1.0f);
+				start = static_cast<float>(writeHead) + onset - 2.0f - delay -
+					std::max(rate - 1.0f, 0.0f) * durationFrames;
+				break;
+			}
+			default:
+				rate = std::min(rate * m_Sample->GetSampleRate() /
+					m_SampleRate, MaxRate);
+				length = static_cast<float>(m_Sample->GetLength());
+				start = length * (m_Position + m_PositionSpread *
+					m_Random.NextBipolar());
+				break;
+		}
+
+		// Back up to the block start so every grain advances all block long.
+		start -= onset * rate;
+		start -= std::floor(start / length) * length;
+		const float whole = std::floor(start);
+		m_Start[grain] = whole < length ? whole : 0.0f;
+		m_Offset[grain] = offset;
+		m_Fraction[grain] = start - whole;
+		m_Rate[grain] = rate;
+		m_WindowStep[grain] = static_cast<float>(WindowSize) /
+			std::max(durationFrames, 1.0f);
+		m_WindowPhase[grain] = -onset * m_WindowStep[grain];
+	}
+
+	void RenderGroup(const uint32_t group, const uint32_t frames,
+					 const SourceView& source, float* sumsLeft,
+					 float* sumsRight)
+	{
+		const uint32_t base = group * Simd::Width;
+		const float* window = m_Windows.Data() +
+			static_cast<uint32_t>(m_Window) * WindowStride;
+		const Simd::Float zero = Simd::Set(0.0f);
+		const Simd::Float length = Simd::Set(
+			static_cast<float>(source.Length));
+		const Simd::Float windowEnd = Simd::Set(
+			static_cast<float>(WindowSize));
+
+		const Simd::Float start = Simd::LoadAligned(m_Start.Data() + base);
+		const Simd::Float offset = Simd::LoadAligned(m_Offset.Data() + base);
+		const Simd::Float rate = Simd::LoadAligned(m_Rate.Data() + base);
+		const Simd::Float step = Simd::LoadAligned(m_WindowStep.Data() + base);
+		const Simd::Float gainLeft = Simd::LoadAligned(m_Left.Data() + base);
+		const Simd::Float gainRight = Simd::LoadAligned(m_Right.Data() + base);
+		Simd::Float fraction = Simd::LoadAligned(m_Fraction.Data() + base);
+		Simd::Float phase = Simd::LoadAligned(m_WindowPhase.Data() + base);
+
+		for (uint32_t i = 0; i < frames; i++)
+		{
+			// Integer part of the read position, wrapped into the loop.
+			const Simd::Float whole = Simd::Floor(fraction);
+			Simd::Float at = Simd::Add(start, whole);
+			at = Simd::Sub(at, Simd::Select(Simd::Less(at, length), zero,
+											length));
+			const Simd::Int index = Simd::TruncateToInt(Simd::Add(at, offset));
+			const Simd::Float a = Simd::Gather(source.Data, index);
+			const Simd::Float b = Simd::Gather(source.Data + 1, index);
+			const Simd::Float sample = Simd::MulAdd(
+				Simd::Sub(fraction, whole), Simd::Sub(b, a), a);
+
+			const Simd::Float clamped = Simd::Min(Simd::Max(phase, zero),
+												  windowEnd);
+			const Simd::Int slot = Simd::TruncateToInt(clamped);
+			const Simd::Float wa = Simd::Gather(window, slot);
+			const Simd::Float wb = Simd::Gather(window + 1, slot);
+			const Simd::Float level = Simd::MulAdd(
+				Simd::Sub(clamped, Simd::ToFloat(slot)), Simd::Sub(wb, wa), wa);
+
+			const Simd::Float value = Simd::Mul(sample, level);
+			float* left = sumsLeft + i * Simd::Width;
+			float* right = sumsRight + i * Simd::Width;
+			Simd::StoreAligned(left, Simd::MulAdd(value, gainLeft,
+												  Simd::LoadAligned(left)));
+			Simd::StoreAligned(right, Simd::MulAdd(value, gainRight,
+												   Simd::LoadAligned(right)));
+
+			fraction = Simd::Add(fraction, rate);
+			fraction = Simd::Sub(fraction, Simd::Select(
+				Simd::Less(fraction, length), zero, length));
+			phase = Simd::Add(phase, step);
+		}
+		Simd::StoreAligned(m_Fraction.Data() + base, fraction);
+		Simd::StoreAligned(m_WindowPhase.Data() + base, phase);
+	}
+
+	/**
+	 * @brief Swaps finished grains out of the pool and folds the whole
+	 * samples every grain advanced into its start.
+	 */
+	void Retire(const uint32_t sourceLength)
+	{
+		const auto length = static_cast<float>(sourceLength);
+		for (uint32_t grain = 0; grain < m_ActiveGrains;)
+		{
+			if (m_WindowPhase[grain] >= static_cast<float>(WindowSize))
+			{
+				const uint32_t last = --m_ActiveGrains;
+				if (grain != last)
+				{
+					m_Start[grain] = m_Start[last];
+					m_Offset[grain] = m_Offset[last];
+					m_Fraction[grain] = m_Fraction[last];
+					m_Rate[grain] = m_Rate[last];
+					m_WindowPhase[grain] = m_WindowPhase[last];
+					m_WindowStep[grain] = m_WindowStep[last];
+					m_Left[grain] = m_Left[last];
+					m_Right[grain] = m_Right[last];
+				}
+				Park(last);
+				continue;
+			}
+
+			const float whole = std::floor(m_Fraction[grain]);
+			float start = m_Start[grain] + whole;
+			if (start >= length)
+				start -= length;
+			m_Start[grain] = start;
+			m_Fraction[grain] -= whole;
+			grain++;
+		}
+	}
+
+private:
+	uint32_t m_Capacity;
+	std::shared_ptr<const WavetableBank> m_Wavetables;
+	std::shared_ptr<const GrainSample> m_Sample;
+	float m_SampleRate = 48000.0f;
+
+	float m_Gain = 1.0f;
+	GrainSource m_Source = GrainSource::Sample;
+	bool m_SourceChanged = false;
+	GrainWindow m_Window = GrainWindow::Hann;
+	float m_Density = 200.0f;
+	float m_Duration = 0.1f;
+	float m_Position = 0.5f;
+	float m_PositionSpread = 0.5f;
+	float m_Pitch = 0.0f;
+	float m_PitchSpread = 0.0f;
+	float m_Frequency = 220.0f;
+	uint32_t m_Frame = 0;
+	float m_Stereo = 0.5f;
+	bool m_FollowNotes = false;
+	uint32_t m_Note = 60;
+	float m_NoteVelocity = 0.0f;
+
+	// The grain pool, packed: [0, m_ActiveGrains) are sounding.
+	/** @brief Whole source sample the grain's read position counts from. */
+	ArenaArray<float> m_Start;
+	/** @brief Where the grain's loop starts in the source data. */
+	ArenaArray<float> m_Offset;
+	/** @brief Read position past m_Start, below one after Retire(). */
+	ArenaArray<float> m_Fraction;
+	ArenaArray<float> m_Rate;
+	ArenaArray<float> m_WindowPhase;
+	ArenaArray<float> m_WindowStep;
+	ArenaArray<float> m_Left;
+	ArenaArray<float> m_Right;
+	uint32_t m_ActiveGrains = 0;
+
+	ArenaArray<float> m_Windows;
+	ArenaArray<float> m_Ring;
+	uint32_t m_RingLength = 0;
+	uint32_t m_WriteHead = 0;
+
+	ArenaArray<float> m_Sums;
+	ArenaArray<float> m_Mix;
+	float m_SpawnDebt = 0.0f;
+	Xorshift32 m_Random{0x6A41};
+	std::atomic<uint32_t> m_ActiveCount{0};
+	std::atomic<uint64_t> m_Dropped{0};
+};
+}
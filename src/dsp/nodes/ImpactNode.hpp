@@ -0,0 +1,596 @@
+﻿#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <span>
+
+#include "../MemoryArena.hpp"
+#include "../Node.hpp"
+#include "../Random.hpp"
+#include "../Simd.hpp"
+
+namespace MT::DSP
+{
+/** @brief Surfaces an @ref ImpactNode can sound like. */
+enum class ImpactMaterial : uint32_t
+{
+	/** @brief Bubble resonances of drops on water, soft ticks. */
+	Rain,
+	/** @brief Short, low knocks and strong clicks of stones. */
+	Gravel,
+	/** @brief Ringing, bright hits on a hard surface. */
+	Hail,
+	Count
+};
+
+/** @brief One impact of an @ref ImpactScheduler. */
+struct ImpactEvent
+{
+	/** @brief Frame of the block it lands on. */
+	uint32_t Frame;
+	/** @brief 0 the smallest particle, 1 the largest. */
+	float Size;
+	/** @brief 0-1, most impacts are quiet. */
+	float Amplitude;
+	/** @brief -1 left to 1 right. */
+	float Pan;
+};
+
+/**
+ * @brief Draws impacts as a Poisson process whose rate may change at any
+ * block.
+ *
+ * The time to the next impact is kept in units of expected impacts, an
+ * exponential draw, and used up at the current rate, so rate changes take
+ * effect immediately and the onsets come out sorted. Gusts slowly swing
+ * the rate up to two octaves either way along a smoothed random walk.
+ */
+class ImpactScheduler
+{
+public:
+	/** @brief Highest rate Schedule() honours, impacts per second. */
+	static constexpr float MaxRate = 200000.0f;
+
+	/** @brief Impacts per second before gusts. */
+	float Rate = 2000.0f;
+	/** @brief 0-1, depth of the slow rate swings. */
+	float Gusts = 0.0f;
+	/** @brief 0-1, mean particle size. */
+	float Size = 0.5f;
+	/** @brief 0-1, spread of sizes around it. */
+	float Spread = 0.3f;
+
+	explicit ImpactScheduler(const uint32_t seed = 1) : m_Random(seed) {}
+
+	/** @brief Upper bound of Schedule()'s count for @p frames frames. */
+	[[nodiscard]] static uint32_t GetCapacity(const float sampleRate,
+											  const uint32_t frames)
+	{
+		// Twice the highest mean; Poisson counts that large barely occur.
+		return static_cast<uint32_t>(2.0f * MaxRate *
+			static_cast<float>(frames) / sampleRate) + 16;
+	}
+
+	/**
+	 * @brief Writes the impacts landing in the next @p frames frames to
+	 * @p events in frame order.
+	 * @return How many were written; any beyond events.size() are dropped.
+	 */
+	uint32_t Schedule(const uint32_t frames, const float sampleRate,
+					  const std::span<ImpactEvent> events)
+	{
+		const float seconds = static_cast<float>(frames) / sampleRate;
+		// Retarget about twice a second, glide there over a second.
+		if (m_Random.NextUnipolar() < 2.0f * seconds)
+			m_GustTarget = m_Random.NextBipolar();
+		m_Gust += std::min(seconds, 1.0f) * (m_GustTarget - m_Gust);
+
+		const float rate = std::min(Rate * std::exp2(2.0f * Gusts * m_Gust),
+									MaxRate);
+		const float perFrame = std::max(rate, 0.0f) / sampleRate;
+		uint32_t count = 0;
+		float position = 0.0f;
+		while (true)
+		{
+			const float remaining = static_cast<float>(frames) - position;
+			if (m_Gap >= remaining * perFrame)
+			{
+				m_Gap -= remaining * perFrame;
+				break;
+			}
+			position += m_Gap / perFrame;
+			m_Gap = -std::log(1.0f - m_Random.NextUnipolar());
+			if (count == events.size())
+				continue;
+
+			const float loudness = m_Random.NextUnipolar();
+			ImpactEvent& event = events[count++];
+			event.Frame = std::min(static_cast<uint32_t>(position),
+								   frames - 1);
+			// Triangular around the mean size.
+			event.Size = std::clamp(Size + Spread * (m_Random.NextUnipolar() +
+				m_Random.NextUnipolar() - 1.0f), 0.0f, 1.0f);
+			event.Amplitude = loudness * loudness * (0.3f + 0.7f * event.Size);
+			event.Pan = m_Random.NextBipolar();
+		}
+		return count;
+	}
+
+private:
+	Xorshift32 m_Random;
+	float m_Gap = 0.0f;
+	float m_Gust = 0.0f;
+	float m_GustTarget = 0.0f;
+};
+
+/**
+ * @brief Rain, gravel and hail from thousands of impacts per second.
+ *
+ * Impacts do not get voices. The node keeps one shared bank of two-pole
+ * resonators, log spaced with a little jitter across the material's range,
+ * and each impact only adds an impulse to the resonator its size maps to,
+ * bigger particles sounding lower. The resonators are linear, so an impact
+ * on a resonator that is still ringing sums exactly with what is there.
+ * A shared band-pass per channel adds the broadband click of each impact.
+ * An impact costs a few scalar writes; the render costs one resonator
+ * update per sounding resonator and frame, however many impacts there are.
+ *
+ * The bank runs vectorized across resonators in chunks of ChunkFrames.
+ * Each chunk's impacts are written into a small excitation buffer per
+ * packet of resonators, which only packets that were hit read. Packets
+ * whose resonators all fell below CullLevel are skipped until hit again.
+ *
+ * Each resonator has a fixed place in the stereo field, the clicks are
+ * panned per impact.
+ */
+class ImpactNode : public Node
+{
+public:
+	/** @brief Frames rendered between impact injections. */
+	static constexpr uint32_t ChunkFrames = 64;
+	/** @brief Resonators below this are silenced and skipped. */
+	static constexpr float CullLevel = 1e-6f;
+	/** @brief Click filter outputs below this are flushed to zero. */
+	static constexpr float FlushLevel = 1e-20f;
+
+	enum Parameter : uint32_t
+	{
+		Gain,
+		/** @brief An @ref ImpactMaterial, passed as a float. */
+		Material,
+		/** @brief Impacts per second. */
+		Rate,
+		/** @brief 0-1, slow swings of the rate. */
+		Gusts,
+		/** @brief 0-1, mean particle size. */
+		Size,
+		/** @brief 0-1, spread of particle sizes. */
+		Spread,
+		/** @brief Multiplier of the material's ring time. */
+		Decay,
+		/** @brief Multiplier of the material's click level. */
+		Click,
+		/** @brief 0-1, width of the stereo field. */
+		Stereo
+	};
+
+	/** @brief What an @ref ImpactMaterial sets. */
+	struct MaterialSetting
+	{
+		/** @brief Range of the resonator bank in Hz. */
+		float LowFrequency;
+		float HighFrequency;
+		/** @brief Ring time of the lowest resonator, seconds to -60 dB. */
+		float Decay;
+		/** @brief Click level relative to the resonators. */
+		float Click;
+		/** @brief Centre and Q of the click band-pass. */
+		float ClickFrequency;
+		float ClickQ;
+	};
+
+	/** @brief Indexed by @ref ImpactMaterial. */
+	static constexpr MaterialSetting Materials[] = {
+		{700.0f, 4500.0f, 0.02f, 0.15f, 5000.0f, 0.7f},
+		{250.0f, 5000.0f, 0.006f, 0.6f, 2500.0f, 0.5f},
+		{1500.0f, 9000.0f, 0.08f, 0.3f, 8000.0f, 1.0f}};
+
+	/** @param resonators Size of the shared bank, rounded up to packets. */
+	explicit ImpactNode(const uint32_t resonators = 128) :
+		m_Resonators((std::max(resonators, 1u) + Simd::Width - 1) /
+			Simd::Width * Simd::Width) {}
+
+	void Prepare(const PrepareContext& context) override
+	{
+		m_SampleRate = context.SampleRate;
+		const uint32_t packets = m_Resonators / Simd::Width;
+		m_Events.Allocate(context.Memory, ImpactScheduler::GetCapacity(
+			m_SampleRate, context.MaxBlockFrames));
+		for (ArenaArray<float>* array : {&m_State1, &m_State2, &m_Feedback1,
+										 &m_Feedback2, &m_InputScale,
+										 &m_LeftGain, &m_RightGain,
+										 &m_Detune, &m_Place})
+			array->Allocate(context.Memory, m_Resonators);
+		m_Excite.Allocate(context.Memory,
+						  static_cast<size_t>(m_Resonators) * ChunkFrames);
+		m_Sounding.Allocate(context.Memory, packets);
+		m_Hit.Allocate(context.Memory, packets);
+		m_Live.Allocate(context.Memory, packets);
+		m_SumLeft.Allocate(context.Memory, ChunkFrames * Simd::Width);
+		m_SumRight.Allocate(context.Memory, ChunkFrames * Simd::Width);
+		m_ClickLeft.Allocate(context.Memory, context.MaxBlockFrames);
+		m_ClickRight.Allocate(context.Memory, context.MaxBlockFrames);
+		m_Left.Allocate(context.Memory, context.MaxBlockFrames);
+		m_Right.Allocate(context.Memory, context.MaxBlockFrames);
+
+		// Fixed per resonator, so the bank keeps its character across
+		// materials: a third of a step of detune and a place in the field.
+		Xorshift32 random(m_Resonators);
+		for (uint32_t i = 0; i < m_Resonators; i++)
+		{
+			m_Detune[i] = 0.33f * random.NextBipolar();
+			m_Place[i] = random.NextBipolar();
+		}
+		m_Dirty = true;
+	}
+
+	void Process(const ProcessContext& context) override
+	{
+		if (m_Dirty)
+			Retune();
+
+		const uint32_t frames = context.Frames;
+		const uint32_t count = m_Scheduler.Schedule(frames, m_SampleRate,
+													m_Events.Span());
+		m_Scheduled.fetch_add(count, std::memory_order_relaxed);
+
+		// Roughly constant loudness however many impacts overlap.
+		const MaterialSetting& setting = Materials[m_Material];
+		const float ring = setting.Decay * m_Decay;
+		const float level = m_Gain / std::sqrt(std::max(
+			m_Scheduler.Rate * ring / 6.91f, 1.0f));
+		const float click = level * setting.Click * m_Click;
+		const float top = static_cast<float>(m_Resonators - 1);
+
+		uint32_t event = 0;
+		uint32_t sounding = 0;
+		for (uint32_t start = 0; start < frames; start += ChunkFrames)
+		{
+			const uint32_t chunk = std::min(ChunkFrames, frames - start);
+			for (; event < count && m_Events[event].Frame < start + chunk;
+				 event++)
+			{
+				const ImpactEvent& impact = m_Events[event];
+				const auto resonator = static_cast<uint32_t>(
+					(1.0f - impact.Size) * top + 0.5f);
+				const uint32_t packet = resonator / Simd::Width;
+				const uint32_t frame = impact.Frame - start;
+				m_Excite[(static_cast<size_t>(packet) * ChunkFrames + frame) *
+					Simd::Width + resonator % Simd::Width] +=
+					level * impact.Amplitude * m_InputScale[resonator];
+				m_Hit[packet] = 1;
+
+				const float pan = 0.25f * std::numbers::pi_v<float> *
+					(1.0f + m_Stereo * impact.Pan);
+				m_ClickLeft[impact.Frame] += click * impact.Amplitude *
+					std::cos(pan);
+				m_ClickRight[impact.Frame] += click * impact.Amplitude *
+					std::sin(pan);
+			}
+			sounding = RenderChunk(chunk);
+			for (uint32_t i = 0; i < chunk; i++)
+			{
+				m_Left[start + i] = Simd::Sum(
+					Simd::LoadAligned(m_SumLeft.Data() + i * Simd::Width));
+				m_Right[start + i] = Simd::Sum(
+					Simd::LoadAligned(m_SumRight.Data() + i * Simd::Width));
+			}
+		}
+		m_SoundingCount.store(sounding * Simd::Width,
+							  std::memory_order_relaxed);
+
+		FilterClicks(m_ClickLeft.Data(), m_Left.Data(), frames,
+					 m_ClickState[0]);
+		FilterClicks(m_ClickRight.Data(), m_Right.Data(), frames,
+					 m_ClickState[1]);
+
+		const BufferView& out = context.Output;
+		if (out.Channels == 1)
+		{
+			float* mono = out.Channel(0);
+			for (uint32_t i = 0; i < frames; i++)
+				mono[i] = std::numbers::sqrt2_v<float> * 0.5f *
+					(m_Left[i] + m_Right[i]);
+		}
+		else
+		{
+			for (uint32_t channel = 0; channel < out.Channels; channel++)
+			{
+				std::copy_n(channel % 2 ? m_Right.Data() : m_Left.Data(),
+							frames, out.Channel(channel));
+			}
+		}
+	}
+
+	void SetParameter(const uint32_t id, const float value) override
+	{
+		switch (id)
+		{
+			case Gain:
+				m_Gain = value;
+				break;
+			case Material:
+				m_Material = std::min(
+					static_cast<uint32_t>(std::max(value, 0.0f)),
+					static_cast<uint32_t>(ImpactMaterial::Count) - 1);
+				m_Dirty = true;
+				break;
+			case Rate:
+				m_Scheduler.Rate = std::clamp(value, 0.0f,
+											  ImpactScheduler::MaxRate);
+				break;
+			case Gusts:
+				m_Scheduler.Gusts = std::clamp(value, 0.0f, 1.0f);
+				break;
+			case Size:
+				m_Scheduler.Size = std::clamp(value, 0.0f, 1.0f);
+				break;
+			case Spread:
+				m_Scheduler.Spread = std::clamp(value, 0.0f, 1.0f);
+				break;
+			case Decay:
+				m_Decay = std::clamp(value, 0.1f, 10.0f);
+				m_Dirty = true;
+				break;
+			case Click:
+				m_Click = std::max(value, 0.0f);
+				break;
+			case Stereo:
+				m_Stereo = std::clamp(value, 0.0f, 1.0f);
+				m_Dirty = true;
+				break;
+			default:
+				break;
+		}
+	}
+
+	[[nodiscard]] const char* GetName() const override { return "Impacts"; }
+
+	[[nodiscard]] uint32_t GetResonatorCount() const { return m_Resonators; }
+	/** @brief Resonators rendered in the last chunk, any thread. */
+	[[nodiscard]] uint32_t GetSoundingCount() const
+	{
+		return m_SoundingCount.load(std::memory_order_relaxed);
+	}
+	/** @brief Impacts so far, any thread. */
+	[[nodiscard]] uint64_t GetImpactCount() const
+	{
+		return m_Scheduled.load(std::memory_order_relaxed);
+	}
+
+private:
+	/** @brief Coefficients of the bank and the click filters. */
+	void Retune()
+	{
+		m_Dirty = false;
+		const MaterialSetting& setting = Materials[m_Material];
+		const float nyquist = 0.45f * m_SampleRate;
+		const float octaves = std::log2(setting.HighFrequency /
+										setting.LowFrequency);
+		const float step = octaves / static_cast<float>(
+			std::max(m_Resonators - 1, 1u));
+		for (uint32_t i = 0; i < m_Resonators; i++)
+		{
+			const float frequency = std::min(setting.LowFrequency * std::exp2(
+				(static_cast<float>(i) + m_Detune[i]) * step), nyquist);
+			// Higher resonators ring shorter, by the square root.
+			const float ring = setting.Decay * m_Decay * std::sqrt(
+				setting.LowFrequency / frequency);
+			const float radius = std::exp(-6.91f / (ring * m_SampleRate));
+			const float omega = 2.0f * std::numbers::pi_v<float> * frequency /
+				m_SampleRate;
+			m_Feedback1[i] = 2.0f * radius * std::cos(omega);
+			m_Feedback2[i] = -radius * radius;
+			// A unit impulse then rings at unit amplitude.
+			m_InputScale[i] = std::sin(omega);
+			const float pan = 0.25f * std::numbers::pi_v<float> *
+				(1.0f + m_Stereo * m_Place[i]);
+			m_LeftGain[i] = std::cos(pan);
+			m_RightGain[i] = std::sin(pan);
+		}
+
+		// RBJ band-pass with 0 dB peak gain.
+		const float omega = 2.0f * std::numbers::pi_v<float> *
+			std::min(setting.ClickFrequency, nyquist) / m_SampleRate;
+		const float alpha = std::sin(omega) / (2.0f * setting.ClickQ);
+		const float norm = 1.0f / (1.0f + alpha);
+		m_ClickGain = alpha * norm;
+		m_ClickFeedback1 = 2.0f * std::cos(omega) * norm;
+		m_ClickFeedback2 = -(1.0f - alpha) * norm;
+	}
+
+	/**
+	 * @brief Renders the sounding packets for @p frames frames into the
+	 * sums, clearing the excitation they read.
+	 * @return How many packets were rendered.
+	 */
+	uint32_t RenderChunk(const uint32_t frames)
+	{
+		std::fill_n(m_SumLeft.Data(), frames * Simd::Width, 0.0f);
+		std::fill_n(m_SumRight.Data(), frames * Simd::Width, 0.0f);
+
+		const uint32_t packets = m_Resonators / Simd::Width;
+		uint32_t live = 0;
+		for (uint32_t packet = 0; packet < packets; packet++)
+		{
+			if (m_Sounding[packet] || m_Hit[packet])
+				m_Live[live++] = packet;
+		}
+
+		// Pairs keep two independent recurrences in flight.
+		uint32_t index = 0;
+		for (; index + 2 <= live; index += 2)
+		{
+			const uint32_t* pair = m_Live.Data() + index;
+			if (m_Hit[pair[0]] || m_Hit[pair[1]])
+				RenderPackets<2, true>(pair, frames);
+			else
+				RenderPackets<2, false>(pair, frames);
+		}
+		if (index < live)
+		{
+			const uint32_t* last = m_Live.Data() + index;
+			if (m_Hit[*last])
+				RenderPackets<1, true>(last, frames);
+			else
+				RenderPackets<1, false>(last, frames);
+		}
+		return live;
+	}
+
+	/** @brief @p Count packets of resonators, listed in @p packets. */
+	template<uint32_t Count, bool Hit>
+	void RenderPackets(const uint32_t* packets, const uint32_t frames)
+	{
+		Simd::Float state1[Count];
+		Simd::Float state2[Count];
+		Simd::Float feedback1[Count];
+		Simd::Float feedback2[Count];
+		Simd::Float left[Count];
+		Simd::Float right[Count];
+		float* excite[Count];
+		for (uint32_t k = 0; k < Count; k++)
+		{
+			const size_t at = static_cast<size_t>(packets[k]) * Simd::Width;
+			state1[k] = Simd::LoadAligned(m_State1.Data() + at);
+			state2[k] = Simd::LoadAligned(m_State2.Data() + at);
+			feedback1[k] = Simd::LoadAligned(m_Feedback1.Data() + at);
+			feedback2[k] = Simd::LoadAligned(m_Feedback2.Data() + at);
+			left[k] = Simd::LoadAligned(m_LeftGain.Data() + at);
+			right[k] = Simd::LoadAligned(m_RightGain.Data() + at);
+			excite[k] = m_Excite.Data() + at * ChunkFrames;
+		}
+
+		float* sumLeft = m_SumLeft.Data();
+		float* sumRight = m_SumRight.Data();
+		for (uint32_t i = 0; i < frames; i++)
+		{
+			Simd::Float mixLeft = Simd::LoadAligned(sumLeft + i * Simd::Width);
+			Simd::Float mixRight = Simd::LoadAligned(
+				sumRight + i * Simd::Width);
+			for (uint32_t k = 0; k < Count; k++)
+			{
+				Simd::Float y = Simd::MulAdd(feedback1[k], state1[k],
+					Simd::Mul(feedback2[k], state2[k]));
+				if constexpr (Hit)
+				{
+					y = Simd::Add(y, Simd::LoadAligned(
+						excite[k] + i * Simd::Width));
+				}
+				state2[k] = state1[k];
+				state1[k] = y;
+				mixLeft = Simd::MulAdd(left[k], y, mixLeft);
+				mixRight = Simd::MulAdd(right[k], y, mixRight);
+			}
+			Simd::StoreAligned(sumLeft + i * Simd::Width, mixLeft);
+			Simd::StoreAligned(sumRight + i * Simd::Width, mixRight);
+		}
+
+		const Simd::Float floor = Simd::Set(CullLevel);
+		const Simd::Float zero = Simd::Set(0.0f);
+		alignas(Simd::Alignment) float peak[Simd::Width];
+		for (uint32_t k = 0; k < Count; k++)
+		{
+			const size_t at = static_cast<size_t>(packets[k]) * Simd::Width;
+			state1[k] = Simd::Select(Simd::Less(Simd::Abs(state1[k]), floor),
+									 zero, state1[k]);
+			state2[k] = Simd::Select(Simd::Less(Simd::Abs(state2[k]), floor),
+									 zero, state2[k]);
+			Simd::StoreAligned(m_State1.Data() + at, state1[k]);
+			Simd::StoreAligned(m_State2.Data() + at, state2[k]);
+			Simd::StoreAligned(peak, Simd::Max(Simd::Abs(state1[k]),
+											   Simd::Abs(state2[k])));
+			m_Sounding[packets[k]] = *std::max_element(peak,
+				peak + Simd::Width) > 0.0f;
+			if constexpr (Hit)
+			{
+				if (m_Hit[packets[k]])
+					std::fill_n(excite[k], frames * Simd::Width, 0.0f);
+				m_Hit[packets[k]] = 0;
+			}
+		}
+	}
+
+	/** @brief Band-passes @p clicks into @p out, clearing @p clicks. */
+	void FilterClicks(float* clicks, float* out, const uint32_t frames,
+					  float (&state)[4]) const
+	{
+		auto& [x1, x2, y1, y2] = state;
+		for (uint32_t i = 0; i < frames; i++)
+		{
+			const float x = clicks[i];
+			float y = m_ClickGain * (x - x2) + m_ClickFeedback1 * y1 +
+				m_ClickFeedback2 * y2;
+			// A click is gone within a few hundred samples; flushing keeps
+			// the tail from turning denormal.
+			y = std::abs(y) < FlushLevel ? 0.0f : y;
+			x2 = x1;
+			x1 = x;
+			y2 = y1;
+			y1 = y;
+			out[i] += y;
+			clicks[i] = 0.0f;
+		}
+	}
+
+private:
+	const uint32_t m_Resonators;
+	float m_SampleRate = 48000.0f;
+	ImpactScheduler m_Scheduler;
+
+	float m_Gain = 1.0f;
+	uint32_t m_Material = 0;
+	float m_Decay = 1.0f;
+	float m_Click = 1.0f;
+	float m_Stereo = 0.7f;
+	bool m_Dirty = true;
+
+	float m_ClickGain = 0.0f;
+	float m_ClickFeedback1 = 0.0f;
+	float m_ClickFeedback2 = 0.0f;
+	/** @brief x1, x2, y1, y2 of the left and right click filter. */
+	float m_ClickState[2][4] = {};
+
+	std::atomic<uint32_t> m_SoundingCount{0};
+	std::atomic<uint64_t> m_Scheduled{0};
+
+	ArenaArray<ImpactEvent> m_Events;
+	// One entry per resonator.
+	ArenaArray<float> m_State1;
+	ArenaArray<float> m_State2;
+	ArenaArray<float> m_Feedback1;
+	ArenaArray<float> m_Feedback2;
+	ArenaArray<float> m_InputScale;
+	ArenaArray<float> m_LeftGain;
+	ArenaArray<float> m_RightGain;
+	/** @brief Offset from the log grid, in steps. */
+	ArenaArray<float> m_Detune;
+	/** @brief -1 to 1 across the stereo field. */
+	ArenaArray<float> m_Place;
+	/** @brief ChunkFrames frames of Simd::Width lanes per packet. */
+	ArenaArray<float> m_Excite;
+	// One entry per packet.
+	ArenaArray<uint8_t> m_Sounding;
+	ArenaArray<uint8_t> m_Hit;
+	/** @brief Packets to render in the current chunk. */
+	ArenaArray<uint32_t> m_Live;
+	ArenaArray<float> m_SumLeft;
+	ArenaArray<float> m_SumRight;
+	ArenaArray<float> m_ClickLeft;
+	ArenaArray<float> m_ClickRight;
+	ArenaArray<float> m_Left;
+	ArenaArray<float> m_Right;
+};
+}
@@ -0,0 +1,59 @@
+﻿#pragma once
+#include <algorithm>
+#include <array>
+
+#include "../Node.hpp"
+
+namespace MT::DSP
+{
+/**
+ * @brief Sums up to @ref MaxInputs inputs, each with its own gain.
+ *
+ * Parameter @c InputGain + n sets the gain of input n, @c Gain the gain
+ * applied to the sum. A mixer with a single input doubles as a gain stage.
+ */
+class MixerNode : public Node
+{
+public:
+	static constexpr uint32_t MaxInputs = 32;
+
+	enum Parameter : uint32_t
+	{
+		Gain,
+		InputGain
+	};
+
+	MixerNode() { m_InputGains.fill(1.0f); }
+
+	void Process(const ProcessContext& context) override
+	{
+		for (uint32_t channel = 0; channel < context.Output.Channels; channel++)
+		{
+			float* out = context.Output.Channel(channel);
+			std::fill_n(out, context.Frames, 0.0f);
+			for (size_t input = 0; input < context.Inputs.size(); input++)
+			{
+				const float gain = m_InputGains[input] * m_Gain;
+				const float* in = context.Inputs[input].Channel(channel);
+				for (uint32_t i = 0; i < context.Frames; i++)
+					out[i] += gain * in[i];
+			}
+		}
+	}
+
+	void SetParameter(const uint32_t id, const float value) override
+	{
+		if (id == Gain)
+			m_Gain = value;
+		else if (id >= InputGain && id < InputGain + MaxInputs)
+			m_InputGains[id - InputGain] = value;
+	}
+
+	[[nodiscard]] uint32_t GetMaxInputs() const override { return MaxInputs; }
+	[[nodiscard]] const char* GetName() const override { return "Mixer"; }
+
+private:
+	float m_Gain = 1.0f;
+	std::array<float, MaxInputs> m_InputGains{};
+};
+}
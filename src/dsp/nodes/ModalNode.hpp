@@ -0,0 +1,387 @@
+﻿#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <numbers>
+#include <utility>
+#include <vector>
+
+#include "../MemoryArena.hpp"
+#include "../ModalModel.hpp"
+#include "../PolyphonicNode.hpp"
+#include "../Simd.hpp"
+
+namespace MT::DSP
+{
+/**
+ * @brief Struck and rubbed objects rendered as banks of two-pole
+ * resonators, one bank per voice, built from @ref ModalModel modes.
+ *
+ * A note strikes an instance of the current model tuned so its lowest mode
+ * sits on the note. Every mode is a resonator y[n] = a1 y[n - 1] +
+ * a2 y[n - 2]; the strike adds an impulse response straight into the two
+ * state values, so hitting an object that still rings adds to the ringing
+ * instead of restarting it. The strike spectrum follows a half-sine contact
+ * force whose duration shrinks with Hardness and velocity, which is what
+ * keeps a soft mallet from exciting the high modes. The node's inputs,
+ * mixed to mono, drive every resonator continuously, for scraping and
+ * rolling.
+ *
+ * Modes run a SIMD packet at a time, several packets interleaved so their
+ * recurrences overlap. Modes above MaxOmega at the note are culled when
+ * the voice starts; since ratios ascend that only shortens the bank.
+ * Packets are summed straight into the frame sums, the lanes are added up
+ * once per frame by the base class anyway. Resonator states below 1e-20
+ * are flushed to zero every chunk, so decayed modes never turn denormal.
+ *
+ * Model, Position, Hardness and Damping are read when an object is struck;
+ * an object keeps its modes until the next strike.
+ */
+class ModalNode : public PolyphonicNode
+{
+public:
+	/** @brief Highest mode frequency rendered, radians per sample. */
+	static constexpr float MaxOmega = 0.95f * std::numbers::pi_v<float>;
+
+	enum Parameter : uint32_t
+	{
+		/** @brief Index into the models given at construction. */
+		Model = PolyphonicNode::ParameterCount,
+		/** @brief 0-1, from the model's first strike point to its last. */
+		Position,
+		/** @brief 0-1, from a felt mallet to a steel one. */
+		Hardness,
+		/** @brief Scale of every mode's decay rate. */
+		Damping,
+		/** @brief Scale of the mixed node inputs driving every object. */
+		InputGain
+	};
+
+	/** @brief ModalObject::MakePresets(), built without a cache. */
+	static std::vector<std::shared_ptr<const ModalModel>> BuildPresets()
+	{
+		std::vector<std::shared_ptr<const ModalModel>> models;
+		for (const ModalObject& object : ModalObject::MakePresets())
+			models.push_back(ModalModel::Build(object));
+		return models;
+	}
+
+	/** @param models At least one, none null. */
+	explicit ModalNode(std::vector<std::shared_ptr<const ModalModel>> models =
+						   BuildPresets(),
+					   const uint32_t voices = 64,
+					   const VoiceStealPolicy policy =
+							   VoiceStealPolicy::Quietest) :
+		PolyphonicNode(voices, policy),
+		m_Models(std::move(models))
+	{
+		for (const std::shared_ptr<const ModalModel>& model : m_Models)
+			m_ModeStride = std::max(m_ModeStride, model->GetPaddedModeCount());
+		// The modes shape the decay; the envelope only damps on release.
+		SetParameter(Attack, 0.0f);
+		SetParameter(PolyphonicNode::Sustain, 1.0f);
+		SetParameter(Release, 1.5f);
+	}
+
+	[[nodiscard]] uint32_t GetMaxInputs() const override { return 8; }
+	[[nodiscard]] const char* GetName() const override { return "Modal"; }
+
+	[[nodiscard]] const std::vector<std::shared_ptr<const ModalModel>>&
+	GetModels() const
+	{
+		return m_Models;
+	}
+
+	/** @brief Resonators rendered in the last block, any thread. */
+	[[nodiscard]] uint32_t GetActiveModeCount() const
+	{
+		return m_ActiveModes.load(std::memory_order_relaxed);
+	}
+
+private:
+	/** @brief Contact time of the softest and the hardest strike, seconds. */
+	static constexpr float SoftContact = 0.002f;
+	static constexpr float HardContact = 0.00005f;
+	static constexpr float FlushLevel = 1e-20f;
+	/** @brief Packets whose recurrences are interleaved. */
+	static constexpr uint32_t Interleave = 2;
+
+	void PrepareVoices(const PrepareContext& context) override
+	{
+		const size_t modes = static_cast<size_t>(m_ModeStride) * m_Capacity;
+		for (ArenaArray<float>* array : {&m_State1, &m_State2, &m_Feedback1,
+										 &m_Feedback2, &m_Drive})
+			array->Allocate(context.Memory, modes);
+		m_Packets.Allocate(context.Memory, m_Capacity);
+		m_EnvelopeBuffer.Allocate(context.Memory,
+								  ControlFrames * Simd::Width);
+		m_VoiceBuffer.Allocate(context.Memory, ControlFrames * Simd::Width);
+		m_Input.Allocate(context.Memory, context.MaxBlockFrames);
+		m_HasInput = false;
+	}
+
+	void StartVoice(const uint32_t voice, const uint32_t note,
+					const float velocity, const bool stolen) override
+	{
+		const ModalModel& model = *m_Models[m_Model];
+		const float omegaNote = 2.0f * std::numbers::pi_v<float> *
+			NoteFrequency(note) / m_SampleRate;
+		const float* ratios = model.GetRatios();
+		const auto audible = static_cast<uint32_t>(std::lower_bound(
+			ratios, ratios + model.GetModeCount(), MaxOmega / omegaNote) -
+			ratios);
+		const uint32_t packets = (audible + Simd::Width - 1) / Simd::Width;
+
+		// A stolen voice keeps ringing in the modes both notes render.
+		const size_t offset = static_cast<size_t>(voice) * m_ModeStride;
+		const uint32_t kept = stolen ? std::min(m_Packets[voice], packets) : 0;
+		std::fill(m_State1.Data() + offset + kept * Simd::Width,
+				  m_State1.Data() + offset + packets * Simd::Width, 0.0f);
+		std::fill(m_State2.Data() + offset + kept * Simd::Width,
+				  m_State2.Data() + offset + packets * Simd::Width, 0.0f);
+		m_Packets[voice] = packets;
+
+		const float place = m_Position *
+			static_cast<float>(model.GetStrikeCount() - 1);
+		const auto strike = std::min(static_cast<uint32_t>(place),
+									 model.GetStrikeCount() - 1);
+		const float* near = model.GetGains(strike);
+		const float* far = model.GetGains(std::min(
+			strike + 1, model.GetStrikeCount() - 1));
+		const Simd::Float blend = Simd::Set(place -
+			static_cast<float>(strike));
+
+		// Half-sine contact of tau samples: its spectrum at 2 f tau = x is
+		// cos(pi x / 2) / (1 - x^2), normalized to 1 at DC.
+		const float tau = SoftContact * std::pow(HardContact / SoftContact,
+			m_Hardness) * (1.5f - velocity) * m_SampleRate;
+		const Simd::Float halfTau = Simd::Set(0.5f * tau);
+		const Simd::Float tauOverPi = Simd::Set(tau /
+			std::numbers::pi_v<float>);
+		const Simd::Float one = Simd::Set(1.0f);
+		const Simd::Float zero = Simd::Set(0.0f);
+		const Simd::Float omegaScale = Simd::Set(omegaNote);
+		const Simd::Float decayScale = Simd::Set(-omegaNote * m_Damping);
+		const Simd::Float amplitude = Simd::Set(velocity);
+
+		for (uint32_t packet = 0; packet < packets; packet++)
+		{
+			const uint32_t mode = packet * Simd::Width;
+			const size_t index = offset + mode;
+			const Simd::Float unclamped = Simd::Mul(
+				Simd::Load(ratios + mode), omegaScale);
+			const Simd::Float omega = Simd::Min(unclamped,
+												Simd::Set(MaxOmega));
+			const Simd::Float radius = Simd::Exp(Simd::Mul(
+				Simd::Load(model.GetDecays() + mode), decayScale));
+			const Simd::Float sine = Simd::Sin(omega);
+			const Simd::Float cosine = Simd::Cos(omega);
+
+			const Simd::Float x = Simd::Mul(omega, tauOverPi);
+			const Simd::Float denominator = Simd::Sub(one, Simd::Mul(x, x));
+			const Simd::Float pulse = Simd::Select(
+				Simd::Less(Simd::Abs(denominator), Simd::Set(1e-3f)),
+				Simd::Set(0.25f * std::numbers::pi_v<float>),
+				Simd::Abs(Simd::Div(Simd::Cos(Simd::Mul(omega, halfTau)),
+									denominator)));
+			const Simd::Float shape = Simd::Load(near + mode);
+			const Simd::Float gain = Simd::Select(
+				Simd::Less(unclamped, Simd::Set(MaxOmega)),
+				Simd::Mul(Simd::Mul(amplitude, pulse), Simd::MulAdd(
+					blend, Simd::Sub(Simd::Load(far + mode), shape), shape)),
+				zero);
+
+			// y[n] = gain r^n sin(n w) from the next frame on.
+			const Simd::Float inverse = Simd::Div(one, radius);
+			const Simd::Float impulse = Simd::Mul(Simd::Mul(gain, sine),
+												  inverse);
+			Simd::StoreAligned(m_State1.Data() + index, Simd::Sub(
+				Simd::LoadAligned(m_State1.Data() + index), impulse));
+			Simd::StoreAligned(m_State2.Data() + index, Simd::Sub(
+				Simd::LoadAligned(m_State2.Data() + index),
+				Simd::Mul(Simd::Mul(impulse, Simd::Add(cosine, cosine)),
+						  inverse)));
+			Simd::StoreAligned(m_Feedback1.Data() + index,
+							   Simd::Mul(Simd::Add(radius, radius), cosine));
+			Simd::StoreAligned(m_Feedback2.Data() + index,
+							   Simd::Sub(zero, Simd::Mul(radius, radius)));
+			Simd::StoreAligned(m_Drive.Data() + index, Simd::Mul(gain, sine));
+		}
+	}
+
+	void BeginBlock(const ProcessContext& context) override
+	{
+		uint32_t modes = 0;
+		for (uint32_t voice = 0; voice < m_Capacity; voice++)
+		{
+			if (IsVoiceActive(voice))
+				modes += m_Packets[voice] * Simd::Width;
+		}
+		m_ActiveModes.store(modes, std::memory_order_relaxed);
+
+		m_HasInput = !context.Inputs.empty() && m_InputGain != 0.0f;
+		if (m_HasInput)
+			MixInputsToMono(context, m_InputGain, m_Input.Data(), 0,
+							context.Frames);
+	}
+
+	void RenderGroup(const uint32_t group, const uint32_t frames,
+					 float* sums) override
+	{
+		const uint32_t base = group * Simd::Width;
+		float* levels = m_Envelopes.GetLevels() + base;
+		Simd::Float envelope = Simd::LoadAligned(levels);
+		const Simd::Float scale = Simd::LoadAligned(
+			m_Envelopes.GetScales() + base);
+		const Simd::Float offset = Simd::LoadAligned(
+			m_Envelopes.GetOffsets() + base);
+		for (uint32_t i = 0; i < frames; i++)
+		{
+			envelope = EnvelopeBank::Step(envelope, scale, offset);
+			Simd::StoreAligned(m_EnvelopeBuffer.Data() + i * Simd::Width,
+							   envelope);
+		}
+		Simd::StoreAligned(levels, envelope);
+
+		for (uint32_t lane = 0; lane < Simd::Width; lane++)
+		{
+			const uint32_t voice = base + lane;
+			if (!IsVoiceActive(voice) || m_Packets[voice] == 0)
+				continue;
+			if (m_HasInput)
+				RenderVoice<true>(voice, frames);
+			else
+				RenderVoice<false>(voice, frames);
+
+			const float* levelsOut = m_EnvelopeBuffer.Data() + lane;
+			for (uint32_t i = 0; i < frames; i++)
+			{
+				float* sum = sums + i * Simd::Width;
+				Simd::StoreAligned(sum, Simd::MulAdd(
+					Simd::LoadAligned(m_VoiceBuffer.Data() + i * Simd::Width),
+					Simd::Set(levelsOut[i * Simd::Width]),
+					Simd::LoadAligned(sum)));
+			}
+		}
+	}
+
+	/** @brief Sums the modes of @p voice into m_VoiceBuffer, lane-wise. */
+	template<bool Driven>
+	void RenderVoice(const uint32_t voice, const uint32_t frames)
+	{
+		std::fill_n(m_VoiceBuffer.Data(), frames * Simd::Width, 0.0f);
+		const size_t offset = static_cast<size_t>(voice) * m_ModeStride;
+		const uint32_t packets = m_Packets[voice];
+		uint32_t packet = 0;
+		for (; packet + Interleave <= packets; packet += Interleave)
+		{
+			RenderModes<Interleave, Driven>(
+				offset + packet * Simd::Width, frames);
+		}
+		for (; packet < packets; packet++)
+			RenderModes<1, Driven>(offset + packet * Simd::Width, frames);
+	}
+
+	/** @brief @p Count packets of resonators from mode @p index on. */
+	template<uint32_t Count, bool Driven>
+	void RenderModes(const size_t index, const uint32_t frames)
+	{
+		Simd::Float state1[Count];
+		Simd::Float state2[Count];
+		Simd::Float feedback1[Count];
+		Simd::Float feedback2[Count];
+		Simd::Float drive[Count];
+		for (uint32_t k = 0; k < Count; k++)
+		{
+			const size_t at = index + k * Simd::Width;
+			state1[k] = Simd::LoadAligned(m_State1.Data() + at);
+			state2[k] = Simd::LoadAligned(m_State2.Data() + at);
+			feedback1[k] = Simd::LoadAligned(m_Feedback1.Data() + at);
+			feedback2[k] = Simd::LoadAligned(m_Feedback2.Data() + at);
+			if constexpr (Driven)
+				drive[k] = Simd::LoadAligned(m_Drive.Data() + at);
+		}
+
+		const float* input = m_Input.Data() + GetChunkStart();
+		float* out = m_VoiceBuffer.Data();
+		for (uint32_t i = 0; i < frames; i++)
+		{
+			Simd::Float mix = Simd::LoadAligned(out + i * Simd::Width);
+			for (uint32_t k = 0; k < Count; k++)
+			{
+				Simd::Float y = Simd::MulAdd(feedback1[k], state1[k],
+					Simd::Mul(feedback2[k], state2[k]));
+				if constexpr (Driven)
+					y = Simd::MulAdd(drive[k], Simd::Set(input[i]), y);
+				state2[k] = state1[k];
+				state1[k] = y;
+				mix = Simd::Add(mix, y);
+			}
+			Simd::StoreAligned(out + i * Simd::Width, mix);
+		}
+
+		const Simd::Float floor = Simd::Set(FlushLevel);
+		const Simd::Float zero = Simd::Set(0.0f);
+		for (uint32_t k = 0; k < Count; k++)
+		{
+			const size_t at = index + k * Simd::Width;
+			Simd::StoreAligned(m_State1.Data() + at, Simd::Select(
+				Simd::Less(Simd::Abs(state1[k]), floor), zero, state1[k]));
+			Simd::StoreAligned(m_State2.Data() + at, Simd::Select(
+				Simd::Less(Simd::Abs(state2[k]), floor), zero, state2[k]));
+		}
+	}
+
+	void SetVoiceParameter(const uint32_t id, const float value) override
+	{
+		switch (id)
+		{
+			case Model:
+				m_Model = std::min(static_cast<uint32_t>(std::max(value, 0.0f)),
+								   static_cast<uint32_t>(m_Models.size()) - 1);
+				break;
+			case Position:
+				m_Position = std::clamp(value, 0.0f, 1.0f);
+				break;
+			case Hardness:
+				m_Hardness = std::clamp(value, 0.0f, 1.0f);
+				break;
+			case Damping:
+				m_Damping = std::max(value, 0.0f);
+				break;
+			case InputGain:
+				m_InputGain = value;
+				break;
+			default:
+				break;
+		}
+	}
+
+private:
+	std::vector<std::shared_ptr<const ModalModel>> m_Models;
+	/** @brief Largest padded mode count of the models, floats per voice. */
+	uint32_t m_ModeStride = 0;
+	uint32_t m_Model = 0;
+	float m_Position = 0.0f;
+	float m_Hardness = 0.5f;
+	float m_Damping = 1.0f;
+	float m_InputGain = 0.0f;
+	bool m_HasInput = false;
+	std::atomic<uint32_t> m_ActiveModes{0};
+
+	// Resonators of each voice, m_ModeStride apart.
+	ArenaArray<float> m_State1;
+	ArenaArray<float> m_State2;
+	ArenaArray<float> m_Feedback1;
+	ArenaArray<float> m_Feedback2;
+	ArenaArray<float> m_Drive;
+	/** @brief Packets of modes below MaxOmega, per voice. */
+	ArenaArray<uint32_t> m_Packets;
+
+	// Per chunk: the group's envelopes and one voice's partial sums.
+	ArenaArray<float> m_EnvelopeBuffer;
+	ArenaArray<float> m_VoiceBuffer;
+	ArenaArray<float> m_Input;
+};
+}
@@ -0,0 +1,229 @@
+﻿#pragma once
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <numbers>
+
+#include "../MemoryArena.hpp"
+#include "../Node.hpp"
+#include "../Random.hpp"
+#include "../Simd.hpp"
+
+namespace MT::DSP
+{
+/** @brief Spectral shapes a @ref NoiseNode can produce. */
+enum class NoiseColor : uint32_t
+{
+	/** @brief Flat spectrum, uniform in [-1, 1). */
+	White,
+	/** @brief -3 dB/octave, Voss-McCartney row sum. */
+	Pink,
+	/** @brief -6 dB/octave, leaky integrated white noise. */
+	Brown,
+	/** @brief Sparse +-1 impulses, one at a random spot per grid period. */
+	Velvet,
+	Count
+};
+
+/**
+ * @brief Block noise generator, every channel an independent stream.
+ *
+ * White noise comes straight from one xorshift32 stream per SIMD lane, a
+ * packet of samples per step. The other colors are shaped from that: pink
+ * and brown run a cheap scalar recursion over the vectorized white block,
+ * velvet only touches the samples that carry an impulse.
+ */
+class NoiseNode : public Node
+{
+public:
+	enum Parameter : uint32_t
+	{
+		Gain,
+		/** @brief A @ref NoiseColor, passed as a float. */
+		Color,
+		/** @brief Velvet impulses per second. */
+		Density
+	};
+
+	explicit NoiseNode(const NoiseColor color = NoiseColor::White) :
+		m_Color(color) {}
+
+	void Prepare(const PrepareContext& context) override
+	{
+		m_SampleRate = context.SampleRate;
+		m_Channels.Allocate(context.Memory, context.Channels);
+		for (uint32_t channel = 0; channel < context.Channels; channel++)
+			m_Channels[channel].Seed(channel);
+		m_Scratch.Allocate(context.Memory,
+						   PaddedFrames(context.MaxBlockFrames));
+
+		// A 20 Hz leak keeps brown noise from drifting off; the step is
+		// chosen for an RMS level of about 0.25.
+		m_BrownLeak = std::exp(-2.0f * std::numbers::pi_v<float> * 20.0f /
+			m_SampleRate);
+		m_BrownStep = 0.25f * std::sqrt(3.0f * (1.0f - m_BrownLeak *
+			m_BrownLeak));
+	}
+
+	void Process(const ProcessContext& context) override
+	{
+		for (uint32_t channel = 0; channel < context.Output.Channels; channel++)
+		{
+			float* out = context.Output.Channel(channel);
+			ChannelState& state = m_Channels[channel];
+			switch (m_Color)
+			{
+			case NoiseColor::White:
+				FillWhite(state.White, out, context.Frames, m_Gain);
+				break;
+			case NoiseColor::Pink:
+				ProcessPink(state, out, context.Frames);
+				break;
+			case NoiseColor::Brown:
+				ProcessBrown(state, out, context.Frames);
+				break;
+			case NoiseColor::Velvet:
+			case NoiseColor::Count:
+				ProcessVelvet(state, out, context.Frames);
+				break;
+			}
+		}
+	}
+
+	void SetParameter(const uint32_t id, const float value) override
+	{
+		if (id == Gain)
+			m_Gain = value;
+		else if (id == Color)
+		{
+			m_Color = static_cast<NoiseColor>(std::clamp(
+				static_cast<uint32_t>(std::max(value, 0.0f)), 0u,
+				static_cast<uint32_t>(NoiseColor::Count) - 1));
+		}
+		else if (id == Density)
+			m_Density = std::max(value, 1.0f);
+	}
+
+	[[nodiscard]] const char* GetName() const override { return "Noise"; }
+
+private:
+	static constexpr uint32_t PinkRows = 15;
+
+	static_assert(BufferAlignmentFloats % Simd::Width == 0,
+				  "Graph buffers must hold whole packets");
+
+	struct ChannelState
+	{
+		XorshiftLanes White;
+		Xorshift32 Sparse;
+
+		uint32_t PinkCounter = 0;
+		float PinkRowValues[PinkRows] = {};
+		float PinkSum = 0.0f;
+
+		float Brown = 0.0f;
+
+		// Velvet grid, in samples relative to the start of the next block.
+		float VelvetPeriodStart = 0.0f;
+		float VelvetNextImpulse = -1.0f;
+
+		void Seed(const uint32_t channel)
+		{
+			White.Seed(channel * 2);
+			Sparse = Xorshift32(channel * 2 + 1);
+		}
+	};
+
+	static uint32_t PaddedFrames(const uint32_t frames)
+	{
+		return (frames + Simd::Width - 1) / Simd::Width * Simd::Width;
+	}
+
+	/** @brief Writes whole packets, up to @p frames rounded up to Width. */
+	static void FillWhite(XorshiftLanes& generator, float* out,
+						  const uint32_t frames, const float gain)
+	{
+		const Simd::Float scale = Simd::Set(gain);
+		for (uint32_t i = 0; i < frames; i += Simd::Width)
+			Simd::Store(out + i, Simd::Mul(generator.NextBipolar(), scale));
+	}
+
+	void ProcessPink(ChannelState& state, float* out, const uint32_t frames)
+	{
+		// Row k is redrawn every 2^(k+1) samples, the row that changes is
+		// the number of trailing zeros of the counter. Adding a fresh white
+		// sample fills in the top octave.
+		float* rowDraws = m_Scratch.Data();
+		FillWhite(state.White, rowDraws, frames, 1.0f);
+		FillWhite(state.White, out, frames, 1.0f);
+
+		const float scale = m_Gain / (PinkRows + 1);
+		float sum = state.PinkSum;
+		uint32_t counter = state.PinkCounter;
+		for (uint32_t i = 0; i < frames; i++)
+		{
+			const auto row = static_cast<uint32_t>(std::countr_zero(++counter));
+			if (row < PinkRows)
+			{
+				sum += rowDraws[i] - state.PinkRowValues[row];
+				state.PinkRowValues[row] = rowDraws[i];
+			}
+			out[i] = (sum + out[i]) * scale;
+		}
+		state.PinkSum = sum;
+		state.PinkCounter = counter;
+	}
+
+	void ProcessBrown(ChannelState& state, float* out, const uint32_t frames)
+	{
+		FillWhite(state.White, out, frames, m_BrownStep);
+
+		float brown = state.Brown;
+		for (uint32_t i = 0; i < frames; i++)
+		{
+			brown = brown * m_BrownLeak + out[i];
+			out[i] = brown * m_Gain;
+		}
+		state.Brown = brown;
+	}
+
+	void ProcessVelvet(ChannelState& state, float* out, const uint32_t frames)
+	{
+		const Simd::Float zero = Simd::Set(0.0f);
+		for (uint32_t i = 0; i < frames; i += Simd::Width)
+			Simd::Store(out + i, zero);
+
+		const float period = m_SampleRate / m_Density;
+		const auto end = static_cast<float>(frames);
+		if (state.VelvetNextImpulse < 0.0f)
+		{
+			state.VelvetNextImpulse = state.VelvetPeriodStart +
+				state.Sparse.NextUnipolar() * period;
+		}
+		while (state.VelvetNextImpulse < end)
+		{
+			const uint32_t bits = state.Sparse.Next();
+			out[static_cast<uint32_t>(state.VelvetNextImpulse)] =
+				bits & 1 ? m_Gain : -m_Gain;
+
+			state.VelvetPeriodStart += period;
+			state.VelvetNextImpulse = state.VelvetPeriodStart +
+				static_cast<float>(bits >> 8) * 0x1p-24f * period;
+		}
+		state.VelvetPeriodStart -= end;
+		state.VelvetNextImpulse -= end;
+	}
+
+private:
+	NoiseColor m_Color;
+	float m_Gain = 1.0f;
+	float m_Density = 2000.0f;
+
+	float m_SampleRate = 48000.0f;
+	float m_BrownLeak = 0.0f;
+	float m_BrownStep = 0.0f;
+
+	ArenaArray<ChannelState> m_Channels;
+	ArenaArray<float> m_Scratch;
+};
+}
@@ -0,0 +1,82 @@
+﻿#pragma once
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+#include "../MemoryArena.hpp"
+#include "../Node.hpp"
+
+namespace MT::DSP
+{
+/**
+ * @brief One-pole low-pass filter, a cheap 6 dB/octave tone control.
+ *
+ * Inputs are summed before filtering.
+ */
+class OnePoleFilterNode : public Node
+{
+public:
+	enum Parameter : uint32_t
+	{
+		Cutoff
+	};
+
+	explicit OnePoleFilterNode(const float cutoff = 1000.0f) :
+		m_Cutoff(cutoff) {}
+
+	void Prepare(const PrepareContext& context) override
+	{
+		m_SampleRate = context.SampleRate;
+		m_State.Allocate(context.Memory, context.Channels);
+		UpdateCoefficient();
+	}
+
+	void Process(const ProcessContext& context) override
+	{
+		for (uint32_t channel = 0; channel < context.Output.Channels; channel++)
+		{
+			float* out = context.Output.Channel(channel);
+			std::fill_n(out, context.Frames, 0.0f);
+			for (const BufferView& input : context.Inputs)
+			{
+				const float* in = input.Channel(channel);
+				for (uint32_t i = 0; i < context.Frames; i++)
+					out[i] += in[i];
+			}
+
+			float state = m_State[channel];
+			for (uint32_t i = 0; i < context.Frames; i++)
+			{
+				state += m_Coefficient * (out[i] - state);
+				out[i] = state;
+			}
+			m_State[channel] = state;
+		}
+	}
+
+	void SetParameter(const uint32_t id, const float value) override
+	{
+		if (id != Cutoff)
+			return;
+		m_Cutoff = value;
+		UpdateCoefficient();
+	}
+
+	[[nodiscard]] uint32_t GetMaxInputs() const override { return 8; }
+	[[nodiscard]] const char* GetName() const override { return "One-pole filter"; }
+
+private:
+	void UpdateCoefficient()
+	{
+		const float cutoff = std::clamp(m_Cutoff, 1.0f, 0.49f * m_SampleRate);
+		m_Coefficient = 1.0f - std::exp(-2.0f * std::numbers::pi_v<float> *
+			cutoff / m_SampleRate);
+	}
+
+private:
+	float m_SampleRate = 48000.0f;
+	float m_Cutoff;
+	float m_Coefficient = 1.0f;
+	ArenaArray<float> m_State;
+};
+}
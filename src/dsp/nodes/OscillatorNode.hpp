@@ -0,0 +1,102 @@
+﻿#pragma once
+#include <cmath>
+#include <numbers>
+
+#include "../Node.hpp"
+
+namespace MT::DSP
+{
+/**
+ * @brief Sine oscillator that can follow the most recent note.
+ *
+ * With note following enabled the oscillator is silent until a note is
+ * held and jumps to the pitch of the latest one.
+ */
+class OscillatorNode : public Node
+{
+public:
+	enum Parameter : uint32_t
+	{
+		Frequency,
+		Gain,
+		FollowNotes
+	};
+
+	explicit OscillatorNode(const float frequency = 440.0f,
+							const bool followNotes = false) :
+		m_Frequency(frequency),
+		m_FollowNotes(followNotes) {}
+
+	void Prepare(const PrepareContext& context) override
+	{
+		m_SampleRate = context.SampleRate;
+	}
+
+	void Process(const ProcessContext& context) override
+	{
+		const float gain = m_FollowNotes ? m_Gain * m_NoteVelocity : m_Gain;
+		const double increment = m_Frequency / m_SampleRate;
+
+		float* first = context.Output.Channel(0);
+		for (uint32_t i = 0; i < context.Frames; i++)
+		{
+			first[i] = gain * static_cast<float>(
+				std::sin(2.0 * std::numbers::pi * m_Phase));
+			m_Phase += increment;
+			m_Phase -= std::floor(m_Phase);
+		}
+
+		for (uint32_t channel = 1; channel < context.Output.Channels; channel++)
+		{
+			float* out = context.Output.Channel(channel);
+			for (uint32_t i = 0; i < context.Frames; i++)
+				out[i] = first[i];
+		}
+	}
+
+	void SetParameter(const uint32_t id, const float value) override
+	{
+		switch (id)
+		{
+			case Frequency:
+				m_Frequency = value;
+				break;
+			case Gain:
+				m_Gain = value;
+				break;
+			case FollowNotes:
+				m_FollowNotes = value >= 0.5f;
+				break;
+			default:
+				break;
+		}
+	}
+
+	void OnNote(const uint32_t note, const float velocity) override
+	{
+		if (velocity > 0.0f)
+		{
+			m_Note = note;
+			m_NoteVelocity = velocity;
+			m_Frequency = 440.0f * std::exp2((static_cast<float>(note) - 69.0f) /
+				12.0f);
+		}
+		else if (note == m_Note)
+			m_NoteVelocity = 0.0f;
+	}
+
+	// Notes are tracked even when not followed, so enabling it mid-note works.
+	[[nodiscard]] bool WantsNotes() const override { return true; }
+	[[nodiscard]] const char* GetName() const override { return "Oscillator"; }
+
+private:
+	float m_SampleRate = 48000.0f;
+	float m_Frequency;
+	float m_Gain = 1.0f;
+	bool m_FollowNotes;
+
+	double m_Phase = 0.0;
+	uint32_t m_Note = 0;
+	float m_NoteVelocity = 0.0f;
+};
+}
@@ -0,0 +1,130 @@
+﻿#pragma once
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+#include "../MemoryArena.hpp"
+#include "../PolyphonicNode.hpp"
+#include "../Simd.hpp"
+
+namespace MT::DSP
+{
+/**
+ * @brief Polyphonic subtractive voice bank: saw, one-pole low-pass, ADSR.
+ *
+ * Phase, filter state and level of every voice live in their own arrays,
+ * so a SIMD group of voices advances through the block together with a
+ * branch-free inner loop. Notes arrive through OnNote(); when all voices
+ * are busy one is stolen according to the StealPolicy parameter.
+ */
+class PolySynthNode : public PolyphonicNode
+{
+public:
+	enum Parameter : uint32_t
+	{
+		/** @brief Low-pass cutoff in Hz. */
+		Cutoff = PolyphonicNode::ParameterCount
+	};
+
+	explicit PolySynthNode(const uint32_t voices = 256,
+						   const VoiceStealPolicy policy =
+								   VoiceStealPolicy::Oldest) :
+		PolyphonicNode(voices, policy) {}
+
+	[[nodiscard]] const char* GetName() const override { return "Poly synth"; }
+
+private:
+	void PrepareVoices(const PrepareContext& context) override
+	{
+		m_Phase.Allocate(context.Memory, m_Capacity);
+		m_Increment.Allocate(context.Memory, m_Capacity);
+		m_Amplitude.Allocate(context.Memory, m_Capacity);
+		m_Filter.Allocate(context.Memory, m_Capacity);
+		UpdateFilter();
+	}
+
+	void StartVoice(const uint32_t voice, const uint32_t note,
+					const float velocity, const bool stolen) override
+	{
+		if (!stolen)
+		{
+			m_Phase[voice] = 0.0f;
+			m_Filter[voice] = 0.0f;
+		}
+		m_Increment[voice] = NoteFrequency(note) / m_SampleRate;
+		m_Amplitude[voice] = velocity;
+	}
+
+	void FinishVoice(const uint32_t voice) override
+	{
+		m_Filter[voice] = 0.0f;
+	}
+
+	void RenderGroup(const uint32_t group, const uint32_t frames,
+					 float* sums) override
+	{
+		const uint32_t base = group * Simd::Width;
+		float* levels = m_Envelopes.GetLevels() + base;
+		Simd::Float phase = Simd::LoadAligned(m_Phase.Data() + base);
+		Simd::Float envelope = Simd::LoadAligned(levels);
+		Simd::Float filter = Simd::LoadAligned(m_Filter.Data() + base);
+		const Simd::Float increment = Simd::LoadAligned(
+			m_Increment.Data() + base);
+		const Simd::Float amplitude = Simd::LoadAligned(
+			m_Amplitude.Data() + base);
+		const Simd::Float scale = Simd::LoadAligned(
+			m_Envelopes.GetScales() + base);
+		const Simd::Float offset = Simd::LoadAligned(
+			m_Envelopes.GetOffsets() + base);
+
+		const Simd::Float coefficient = Simd::Set(m_FilterCoefficient);
+		const Simd::Float one = Simd::Set(1.0f);
+		const Simd::Float two = Simd::Set(2.0f);
+		for (uint32_t i = 0; i < frames; i++)
+		{
+			phase = Simd::Add(phase, increment);
+			phase = Simd::Sub(phase, Simd::Floor(phase));
+			envelope = EnvelopeBank::Step(envelope, scale, offset);
+
+			const Simd::Float saw = Simd::Sub(Simd::Mul(phase, two), one);
+			const Simd::Float voice = Simd::Mul(Simd::Mul(saw, envelope),
+												amplitude);
+			filter = Simd::MulAdd(Simd::Sub(voice, filter), coefficient,
+								  filter);
+
+			float* sum = sums + i * Simd::Width;
+			Simd::StoreAligned(sum, Simd::Add(Simd::LoadAligned(sum), filter));
+		}
+
+		Simd::StoreAligned(m_Phase.Data() + base, phase);
+		Simd::StoreAligned(levels, envelope);
+		Simd::StoreAligned(m_Filter.Data() + base, filter);
+	}
+
+	void SetVoiceParameter(const uint32_t id, const float value) override
+	{
+		if (id == Cutoff)
+		{
+			m_Cutoff = value;
+			UpdateFilter();
+		}
+	}
+
+	void UpdateFilter()
+	{
+		const float cutoff = std::clamp(m_Cutoff, 1.0f, 0.49f * m_SampleRate);
+		m_FilterCoefficient = 1.0f - std::exp(
+			-2.0f * std::numbers::pi_v<float> * cutoff / m_SampleRate);
+	}
+
+private:
+	float m_Cutoff = 4000.0f;
+	float m_FilterCoefficient = 0.0f;
+
+	// Structure of arrays, one element per voice.
+	ArenaArray<float> m_Phase;
+	ArenaArray<float> m_Increment;
+	ArenaArray<float> m_Amplitude;
+	ArenaArray<float> m_Filter;
+};
+}
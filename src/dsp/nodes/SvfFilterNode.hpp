@@ -0,0 +1,230 @@
+﻿#pragma once
+#include <algorithm>
+#include <cmath>
+
+#include "../MemoryArena.hpp"
+#include "../Node.hpp"
+#include "../Simd.hpp"
+#include "../StateVariableFilter.hpp"
+
+namespace MT::DSP
+{
+/**
+ * @brief Zero-delay feedback state variable filter with an audio-rate
+ * cutoff input, see @ref Svf.
+ *
+ * Input 0 is filtered. Input 1, when connected, moves the cutoff by
+ * @c Modulation octaves per unit, sample by sample, so an oscillator or
+ * envelope on it gives FM-style filter sweeps. The output mixes the low-,
+ * band-, high-pass and notch responses, all from the same pass, by their
+ * levels.
+ *
+ * Channels are spread across SIMD lanes, so the per-sample tangent and
+ * division are shared by up to Simd::Width channels. Without modulation
+ * the coefficients are only recomputed per sample while a cutoff change
+ * glides over the block.
+ */
+class SvfFilterNode : public Node
+{
+public:
+	enum Parameter : uint32_t
+	{
+		/** @brief Hz, before modulation. */
+		Cutoff,
+		/** @brief Q, 0.5 to 50. */
+		Resonance,
+		/** @brief Octaves per unit of input 1. */
+		Modulation,
+		LowPass,
+		BandPass,
+		HighPass,
+		Notch
+	};
+
+	/** @brief Highest cutoff reached, as a fraction of the sample rate. */
+	static constexpr float MaxCutoff = 0.49f;
+	/** @brief States below this are flushed at the end of every block. */
+	static constexpr float FlushLevel = 1e-20f;
+
+	void Prepare(const PrepareContext& context) override
+	{
+		m_SampleRate = context.SampleRate;
+		m_Channels = context.Channels;
+		m_Packets = (m_Channels + Simd::Width - 1) / Simd::Width;
+		const size_t lanes = static_cast<size_t>(m_Packets) *
+			context.MaxBlockFrames * Simd::Width;
+		m_Lanes.Allocate(context.Memory, lanes);
+		m_ModulationLanes.Allocate(context.Memory, lanes);
+		m_Band.Allocate(context.Memory, m_Packets * Simd::Width);
+		m_Low.Allocate(context.Memory, m_Packets * Simd::Width);
+		m_Pitch = GetTargetPitch();
+	}
+
+	void Process(const ProcessContext& context) override
+	{
+		const uint32_t frames = context.Frames;
+		const uint32_t channels = std::min(context.Output.Channels, m_Channels);
+		const bool modulated = context.Inputs.size() > 1 &&
+			m_Modulation != 0.0f;
+		for (uint32_t channel = 0; channel < channels; channel++)
+		{
+			const size_t offset = static_cast<size_t>(channel / Simd::Width) *
+				frames * Simd::Width + channel % Simd::Width;
+			ToLanes(context.Inputs.empty() ? nullptr
+						: context.Inputs[0].Channel(channel),
+					m_Lanes.Data() + offset, frames);
+			if (modulated)
+			{
+				ToLanes(context.Inputs[1].Channel(channel),
+						m_ModulationLanes.Data() + offset, frames);
+			}
+		}
+
+		const float target = GetTargetPitch();
+		const float step = frames ? (target - m_Pitch) /
+			static_cast<float>(frames) : 0.0f;
+		for (uint32_t packet = 0; packet < m_Packets; packet++)
+		{
+			if (modulated)
+				Render<true>(packet, frames, step);
+			else if (step != 0.0f)
+				Render<false, true>(packet, frames, step);
+			else
+				Render<false, false>(packet, frames, step);
+		}
+		m_Pitch = target;
+
+		for (uint32_t channel = 0; channel < channels; channel++)
+		{
+			const float* lanes = m_Lanes.Data() + static_cast<size_t>(
+				channel / Simd::Width) * frames * Simd::Width +
+				channel % Simd::Width;
+			float* out = context.Output.Channel(channel);
+			for (uint32_t i = 0; i < frames; i++)
+				out[i] = lanes[i * Simd::Width];
+		}
+	}
+
+	void SetParameter(const uint32_t id, const float value) override
+	{
+		switch (id)
+		{
+			case Cutoff:
+				m_Cutoff = std::max(value, 1.0f);
+				break;
+			case Resonance:
+				m_Resonance = std::clamp(value, 0.5f, 50.0f);
+				break;
+			case Modulation:
+				m_Modulation = value;
+				break;
+			case LowPass:
+				m_Levels[0] = value;
+				break;
+			case BandPass:
+				m_Levels[1] = value;
+				break;
+			case HighPass:
+				m_Levels[2] = value;
+				break;
+			case Notch:
+				m_Levels[3] = value;
+				break;
+			default:
+				break;
+		}
+	}
+
+	[[nodiscard]] uint32_t GetMaxInputs() const override { return 2; }
+	[[nodiscard]] const char* GetName() const override { return "State variable filter"; }
+
+private:
+	/** @brief Cutoff as log2 of the fraction of the sample rate. */
+	[[nodiscard]] float GetTargetPitch() const
+	{
+		return std::log2(std::min(m_Cutoff / m_SampleRate, MaxCutoff));
+	}
+
+	static void ToLanes(const float* in, float* lanes, const uint32_t frames)
+	{
+		for (uint32_t i = 0; i < frames; i++)
+			lanes[i * Simd::Width] = in ? in[i] : 0.0f;
+	}
+
+	/**
+	 * @brief Filters channel packet @p packet in place. The cutoff glides
+	 * by @p step octaves per sample; PerSample recomputes the coefficients
+	 * every sample, needed for a glide or modulation.
+	 */
+	template<bool Modulated, bool PerSample = true>
+	void Render(const uint32_t packet, const uint32_t frames,
+				const float step)
+	{
+		const size_t at = static_cast<size_t>(packet) * Simd::Width;
+		float* data = m_Lanes.Data() + at * frames;
+		const float* modulation = m_ModulationLanes.Data() + at * frames;
+		Simd::Float band = Simd::LoadAligned(m_Band.Data() + at);
+		Simd::Float low = Simd::LoadAligned(m_Low.Data() + at);
+
+		const Simd::Float damping = Simd::Set(1.0f / m_Resonance);
+		const Simd::Float depth = Simd::Set(m_Modulation);
+		const Simd::Float lowest = Simd::Set(1e-5f);
+		const Simd::Float highest = Simd::Set(MaxCutoff);
+		const Simd::Float lowPass = Simd::Set(m_Levels[0]);
+		const Simd::Float bandPass = Simd::Set(m_Levels[1]);
+		const Simd::Float highPass = Simd::Set(m_Levels[2]);
+		const Simd::Float notch = Simd::Set(m_Levels[3]);
+
+		auto coefficients = Svf::Design(Simd::Set(std::exp2(m_Pitch)),
+										damping);
+		float pitch = m_Pitch;
+		for (uint32_t i = 0; i < frames; i++)
+		{
+			if constexpr (PerSample)
+			{
+				pitch += step;
+				Simd::Float modulated = Simd::Set(pitch);
+				if constexpr (Modulated)
+				{
+					modulated = Simd::MulAdd(depth, Simd::LoadAligned(
+						modulation + i * Simd::Width), modulated);
+				}
+				coefficients = Svf::Design(Simd::Min(Simd::Max(
+					Simd::Exp2(modulated), lowest), highest), damping);
+			}
+			float* frame = data + i * Simd::Width;
+			const auto y = Svf::Tick(
+				coefficients, band, low, Simd::LoadAligned(frame));
+			Simd::StoreAligned(frame, Simd::MulAdd(
+				notch, y.Notch, Simd::MulAdd(highPass, y.HighPass,
+				Simd::MulAdd(bandPass, y.BandPass,
+							 Simd::Mul(lowPass, y.LowPass)))));
+		}
+
+		const Simd::Float flush = Simd::Set(FlushLevel);
+		const Simd::Float zero = Simd::Set(0.0f);
+		Simd::StoreAligned(m_Band.Data() + at, Simd::Select(
+			Simd::Less(Simd::Abs(band), flush), zero, band));
+		Simd::StoreAligned(m_Low.Data() + at, Simd::Select(
+			Simd::Less(Simd::Abs(low), flush), zero, low));
+	}
+
+private:
+	float m_SampleRate = 48000.0f;
+	uint32_t m_Channels = 0;
+	uint32_t m_Packets = 0;
+	float m_Cutoff = 1000.0f;
+	float m_Resonance = 0.70710678f;
+	float m_Modulation = 1.0f;
+	/** @brief Low-, band-, high-pass and notch levels. */
+	float m_Levels[4] = {1.0f, 0.0f, 0.0f, 0.0f};
+	/** @brief Cutoff the last block ended on, see GetTargetPitch(). */
+	float m_Pitch = 0.0f;
+
+	/** @brief Channel packets of the block, frame major within each. */
+	ArenaArray<float> m_Lanes;
+	ArenaArray<float> m_ModulationLanes;
+	ArenaArray<float> m_Band;
+	ArenaArray<float> m_Low;
+};
+}
@@ -0,0 +1,509 @@
+﻿#pragma once
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+#include "../MemoryArena.hpp"
+#include "../PolyBlep.hpp"
+#include "../PolyphonicNode.hpp"
+#include "../Simd.hpp"
+#include "../StateVariableFilter.hpp"
+
+namespace MT::DSP
+{
+/** @brief Shapes a @ref VirtualAnalogNode can play. */
+enum class AnalogWaveform : uint32_t
+{
+	/** @brief Rising ramp, PolyBLEP corrected. */
+	Saw,
+	/** @brief Pulse with a fixed 50% width. */
+	Square,
+	/** @brief PolyBLAMP corrected. */
+	Triangle,
+	/** @brief Pulse whose width follows PulseWidth and the PWM LFO. */
+	Pulse,
+	Count
+};
+
+/** @brief Responses of the per-voice filter of a @ref VirtualAnalogNode. */
+enum class AnalogFilter : uint32_t
+{
+	Off,
+	LowPass,
+	BandPass,
+	HighPass,
+	Notch,
+	Count
+};
+
+/**
+ * @brief Polyphonic anti-aliased saw, square, triangle and pulse
+ * oscillators with hard sync and pulse width modulation.
+ *
+ * Naive waveforms are band-limited with the branch-free corrections of
+ * @ref PolyBlep, so a SIMD group of voices (8 per AVX register) runs one
+ * instruction stream regardless of which lanes are near an edge.
+ *
+ * With Sync on, every voice has a master phase at the note pitch that
+ * restarts an oscillator running SyncRatio times faster. A restart falls
+ * between two samples, so the output is delayed by one sample to correct
+ * both sides of the jump. Each voice has its own triangle LFO for PWM,
+ * spread in phase across voices.
+ *
+ * Each voice can run through a zero-delay feedback state variable filter,
+ * see @ref Svf, whose cutoff follows the note by FilterKeyTrack and opens
+ * by FilterEnvelope octaves at full envelope level. The cutoff moves with
+ * the envelope every sample, so its coefficients are recomputed every
+ * sample too, a SIMD group of voices at a time.
+ */
+class VirtualAnalogNode : public PolyphonicNode
+{
+public:
+	enum Parameter : uint32_t
+	{
+		/** @brief An @ref AnalogWaveform, passed as a float. */
+		Waveform = PolyphonicNode::ParameterCount,
+		/** @brief Fraction of the cycle the pulse is high, 0.02-0.98. */
+		PulseWidth,
+		/** @brief Width swing of the PWM LFO, 0-0.48. */
+		PwmDepth,
+		/** @brief PWM LFO rate in Hz. */
+		PwmRate,
+		/** @brief Hard sync on when >= 0.5. */
+		Sync,
+		/** @brief Synced oscillator pitch over note pitch, 1-16. */
+		SyncRatio,
+		/** @brief An @ref AnalogFilter, passed as a float. */
+		FilterType,
+		/** @brief Hz at middle C and a closed envelope. */
+		FilterCutoff,
+		/** @brief Q, 0.5-50. */
+		FilterResonance,
+		/** @brief Octaves the cutoff opens by at full envelope level. */
+		FilterEnvelope,
+		/** @brief 0-1, how far the cutoff follows the note pitch. */
+		FilterKeyTrack
+	};
+
+	/**
+	 * @param vectorized Render a SIMD group at a time; false runs the same
+	 * kernel one voice at a time, kept to measure what vectorizing gains.
+	 */
+	explicit VirtualAnalogNode(const uint32_t voices = 256,
+							   const VoiceStealPolicy policy =
+									   VoiceStealPolicy::Oldest,
+							   const bool vectorized = true) :
+		PolyphonicNode(voices, policy),
+		m_Vectorized(vectorized) {}
+
+	[[nodiscard]] const char* GetName() const override
+	{
+		return "Virtual analog";
+	}
+
+private:
+	static constexpr float MinPulseWidth = 0.02f;
+	static constexpr float MaxPulseWidth = 0.98f;
+	/** @brief Highest filter cutoff, as a fraction of the sample rate. */
+	static constexpr float MaxFilterCutoff = 0.49f;
+
+	void PrepareVoices(const PrepareContext& context) override
+	{
+		m_Phase.Allocate(context.Memory, m_Capacity);
+		m_MasterPhase.Allocate(context.Memory, m_Capacity);
+		m_Increment.Allocate(context.Memory, m_Capacity);
+		m_Amplitude.Allocate(context.Memory, m_Capacity);
+		m_Delayed.Allocate(context.Memory, m_Capacity);
+		m_LfoPhase.Allocate(context.Memory, m_Capacity);
+		m_FilterBand.Allocate(context.Memory, m_Capacity);
+		m_FilterLow.Allocate(context.Memory, m_Capacity);
+		m_FilterTrack.Allocate(context.Memory, m_Capacity);
+		for (uint32_t voice = 0; voice < m_Capacity; voice++)
+		{
+			const float spread = static_cast<float>(voice) *
+				(std::numbers::phi_v<float> - 1.0f);
+			m_LfoPhase[voice] = spread - static_cast<float>(
+				static_cast<uint32_t>(spread));
+		}
+	}
+
+	void StartVoice(const uint32_t voice, const uint32_t note,
+					const float velocity, const bool stolen) override
+	{
+		if (!stolen)
+		{
+			m_Phase[voice] = 0.0f;
+			m_MasterPhase[voice] = 0.0f;
+			m_Delayed[voice] = 0.0f;
+			m_FilterBand[voice] = 0.0f;
+			m_FilterLow[voice] = 0.0f;
+		}
+		m_Increment[voice] = NoteFrequency(note) / m_SampleRate;
+		m_FilterTrack[voice] = (static_cast<float>(note) - 60.0f) / 12.0f;
+		m_Amplitude[voice] = velocity;
+	}
+
+	void RenderGroup(const uint32_t group, const uint32_t frames,
+					 float* sums) override
+	{
+		const uint32_t first = group * Simd::Width;
+		if (m_Vectorized)
+		{
+			RenderWaveform<Simd::Float>(first, frames, sums);
+			return;
+		}
+		for (uint32_t lane = 0; lane < Simd::Width; lane++)
+			RenderWaveform<float>(first + lane, frames, sums + lane);
+	}
+
+	template<typename P>
+	void RenderWaveform(const uint32_t first, const uint32_t frames,
+						float* sums)
+	{
+		switch (m_Waveform)
+		{
+			case AnalogWaveform::Saw:
+				RenderShape<P, AnalogWaveform::Saw>(first, frames, sums);
+				break;
+			case AnalogWaveform::Square:
+				RenderShape<P, AnalogWaveform::Square>(first, frames, sums);
+				break;
+			case AnalogWaveform::Triangle:
+				RenderShape<P, AnalogWaveform::Triangle>(first, frames, sums);
+				break;
+			case AnalogWaveform::Pulse:
+			case AnalogWaveform::Count:
+				RenderShape<P, AnalogWaveform::Pulse>(first, frames, sums);
+				break;
+		}
+	}
+
+	template<typename P, AnalogWaveform Shape>
+	void RenderShape(const uint32_t first, const uint32_t frames, float* sums)
+	{
+		if (m_Filter == AnalogFilter::Off)
+			RenderSync<P, Shape, false>(first, frames, sums);
+		else
+			RenderSync<P, Shape, true>(first, frames, sums);
+	}
+
+	template<typename P, AnalogWaveform Shape, bool Filtered>
+	void RenderSync(const uint32_t first, const uint32_t frames, float* sums)
+	{
+		if (m_Sync)
+			RenderVoices<P, Shape, true, Filtered>(first, frames, sums);
+		else
+			RenderVoices<P, Shape, false, Filtered>(first, frames, sums);
+	}
+
+	/**
+	 * @brief Renders voices [first, first + lanes of P) into @p sums, which
+	 * holds Simd::Width floats per frame.
+	 */
+	template<typename P, AnalogWaveform Shape, bool Synced, bool Filtered>
+	void RenderVoices(const uint32_t first, const uint32_t frames,
+					  float* sums)
+	{
+		float* levels = m_Envelopes.GetLevels() + first;
+		P phase = Simd::LoadAligned<P>(m_Phase.Data() + first);
+		P master = Simd::LoadAligned<P>(m_MasterPhase.Data() + first);
+		P lfo = Simd::LoadAligned<P>(m_LfoPhase.Data() + first);
+		P envelope = Simd::LoadAligned<P>(levels);
+		P delayed = Simd::LoadAligned<P>(m_Delayed.Data() + first);
+		const P increment = Simd::LoadAligned<P>(m_Increment.Data() + first);
+		const P amplitude = Simd::LoadAligned<P>(m_Amplitude.Data() + first);
+		const P scale = Simd::LoadAligned<P>(m_Envelopes.GetScales() + first);
+		const P offset = Simd::LoadAligned<P>(
+			m_Envelopes.GetOffsets() + first);
+
+		const P zero = Simd::Set<P>(0.0f);
+		const P one = Simd::Set<P>(1.0f);
+		const P two = Simd::Set<P>(2.0f);
+		const P slaveIncrement = Synced
+			? Simd::Mul(increment, Simd::Set<P>(m_SyncRatio))
+			: increment;
+		// Idle lanes have no increment, keep their corrections finite.
+		const P minimum = Simd::Set<P>(1e-9f);
+		const P inverseIncrement = Simd::Div(one, Simd::Max(slaveIncrement,
+															minimum));
+		const P inverseMaster = Simd::Div(one, Simd::Max(increment, minimum));
+		const P lfoIncrement = Simd::Set<P>(m_PwmRate / m_SampleRate);
+		const P pulseWidth = Simd::Set<P>(
+			Shape == AnalogWaveform::Square ? 0.5f : m_PulseWidth);
+		const P pwmDepth = Simd::Set<P>(m_PwmDepth);
+		const P startValue = Simd::Set<P>(StartValue<Shape>());
+		const P endValue = Simd::Set<P>(EndValue<Shape>());
+		// Keeps the time since a restart below one sample after rounding.
+		const P belowOne = Simd::Set<P>(0.99999994f);
+
+		P band = zero;
+		P low = zero;
+		if constexpr (Filtered)
+		{
+			band = Simd::LoadAligned<P>(m_FilterBand.Data() + first);
+			low = Simd::LoadAligned<P>(m_FilterLow.Data() + first);
+		}
+		// Filter cutoff as log2 of the fraction of the sample rate, before
+		// the envelope term added every sample.
+		const P pitch = Simd::MulAdd(
+			Simd::Set<P>(m_FilterKeyTrack),
+			Simd::LoadAligned<P>(m_FilterTrack.Data() + first),
+			Simd::Set<P>(std::log2(m_FilterCutoff / m_SampleRate)));
+		const P filterEnvelope = Simd::Set<P>(m_FilterEnvelope);
+		const P lowestCutoff = Simd::Set<P>(1e-5f);
+		const P highestCutoff = Simd::Set<P>(MaxFilterCutoff);
+		const P damping = Simd::Set<P>(1.0f / m_FilterResonance);
+		const P lowPass = Simd::Set<P>(
+			m_Filter == AnalogFilter::LowPass ? 1.0f : 0.0f);
+		const P bandPass = Simd::Set<P>(
+			m_Filter == AnalogFilter::BandPass ? 1.0f : 0.0f);
+		const P highPass = Simd::Set<P>(
+			m_Filter == AnalogFilter::HighPass ? 1.0f : 0.0f);
+		const P notch = Simd::Set<P>(
+			m_Filter == AnalogFilter::Notch ? 1.0f : 0.0f);
+
+		P out = zero;
+		for (uint32_t i = 0; i < frames; i++)
+		{
+			P width = pulseWidth;
+			if constexpr (Shape == AnalogWaveform::Pulse)
+			{
+				lfo = Simd::Add(lfo, lfoIncrement);
+				lfo = Simd::Sub(lfo, Simd::Floor(lfo));
+				const P triangle = Simd::Sub(Simd::Mul(Simd::Abs(
+					Simd::Sub(Simd::Mul(lfo, two), one)), two), one);
+				width = Simd::Min(Simd::Max(
+					Simd::MulAdd(pwmDepth, triangle, pulseWidth),
+					Simd::Set<P>(MinPulseWidth)), Simd::Set<P>(MaxPulseWidth));
+			}
+
+			P currentJump = zero;
+			P previousJump = zero;
+			P sinceRestart = zero;
+			if constexpr (Synced)
+			{
+				master = Simd::Add(master, increment);
+				const P running = Simd::Less(master, one);
+				master = Simd::Sub(master, Simd::Floor(master));
+				sinceRestart = Simd::Min(Simd::Mul(master, inverseMaster),
+										 belowOne);
+
+				// Phase the synced oscillator had reached at the restart.
+				P atRestart = Simd::MulAdd(slaveIncrement,
+										   Simd::Sub(one, sinceRestart), phase);
+				atRestart = Simd::Sub(atRestart, Simd::Floor(atRestart));
+				const P interrupted = Naive<P, Shape>(atRestart, width);
+
+				phase = Simd::Add(phase, slaveIncrement);
+				phase = Simd::Select(running,
+									 Simd::Sub(phase, Simd::Floor(phase)),
+									 Simd::Mul(sinceRestart, slaveIncrement));
+
+				// The edge at phase 0 is corrected below as a jump from the
+				// end of the cycle; this adds the rest of the actual jump.
+				currentJump = Simd::Select(running, zero,
+										   Simd::Sub(endValue, interrupted));
+				previousJump = Simd::Select(
+					running, zero, Simd::Sub(startValue, interrupted));
+			}
+			else
+			{
+				phase = Simd::Add(phase, slaveIncrement);
+				phase = Simd::Sub(phase, Simd::Floor(phase));
+			}
+
+			out = Corrected<P, Shape>(phase, width, slaveIncrement,
+									  inverseIncrement);
+			if constexpr (Synced)
+			{
+				out = Simd::MulAdd(currentJump,
+								   PolyBlep::StepResidual(sinceRestart), out);
+				delayed = Simd::MulAdd(
+					previousJump,
+					PolyBlep::StepResidual(Simd::Sub(sinceRestart, one)),
+					delayed);
+				const P emitted = delayed;
+				delayed = out;
+				out = emitted;
+			}
+
+			envelope = EnvelopeBank::Step(envelope, scale, offset);
+			P voiced = out;
+			if constexpr (Filtered)
+			{
+				const P cutoff = Simd::Min(Simd::Max(Simd::Exp2(
+					Simd::MulAdd(filterEnvelope, envelope, pitch)),
+					lowestCutoff), highestCutoff);
+				const auto y = Svf::Tick(Svf::Design(cutoff, damping), band,
+										 low, out);
+				voiced = Simd::MulAdd(notch, y.Notch, Simd::MulAdd(
+					highPass, y.HighPass, Simd::MulAdd(
+						bandPass, y.BandPass, Simd::Mul(lowPass, y.LowPass))));
+			}
+			float* sum = sums + i * Simd::Width;
+			Simd::StoreAligned(sum, Simd::MulAdd(
+				Simd::Mul(voiced, envelope), amplitude,
+				Simd::LoadAligned<P>(sum)));
+		}
+
+		Simd::StoreAligned(m_Phase.Data() + first, phase);
+		Simd::StoreAligned(m_MasterPhase.Data() + first, master);
+		Simd::StoreAligned(m_LfoPhase.Data() + first, lfo);
+		Simd::StoreAligned(levels, envelope);
+		// Without sync this keeps the last sample, so enabling sync mid-note
+		// only repeats one sample.
+		Simd::StoreAligned(m_Delayed.Data() + first, Synced ? delayed : out);
+		if constexpr (Filtered)
+		{
+			// Released voices ring into silence; keep them from going
+			// denormal.
+			const P flush = Simd::Set<P>(1e-20f);
+			Simd::StoreAligned(m_FilterBand.Data() + first, Simd::Select(
+				Simd::Less(Simd::Abs(band), flush), zero, band));
+			Simd::StoreAligned(m_FilterLow.Data() + first, Simd::Select(
+				Simd::Less(Simd::Abs(low), flush), zero, low));
+		}
+	}
+
+	/** @brief Uncorrected waveform, in [-1, 1]. */
+	template<typename P, AnalogWaveform Shape>
+	static P Naive(const P& phase, const P& width)
+	{
+		const P one = Simd::Set<P>(1.0f);
+		if constexpr (Shape == AnalogWaveform::Saw)
+			return Simd::Sub(Simd::Mul(phase, Simd::Set<P>(2.0f)), one);
+		else if constexpr (Shape == AnalogWaveform::Triangle)
+		{
+			return Simd::Sub(one, Simd::Mul(Simd::Set<P>(4.0f), Simd::Abs(
+				Simd::Sub(phase, Simd::Set<P>(0.5f)))));
+		}
+		else
+		{
+			return Simd::Select(Simd::Less(phase, width), one,
+								Simd::Set<P>(-1.0f));
+		}
+	}
+
+	template<typename P, AnalogWaveform Shape>
+	static P Corrected(const P& phase, const P& width, const P& increment,
+					   const P& inverseIncrement)
+	{
+		const P naive = Naive<P, Shape>(phase, width);
+		const P zero = Simd::Set<P>(0.0f);
+		const P start = PolyBlep::EdgeDistance(phase, zero, inverseIncrement);
+		if constexpr (Shape == AnalogWaveform::Saw)
+		{
+			// Falls by 2 at the wrap.
+			return Simd::MulAdd(Simd::Set<P>(-2.0f),
+								PolyBlep::StepResidual(start), naive);
+		}
+		else if constexpr (Shape == AnalogWaveform::Triangle)
+		{
+			// Slope turns by +-8 per cycle at phases 0 and 0.5.
+			const P middle = PolyBlep::EdgeDistance(
+				phase, Simd::Set<P>(0.5f), inverseIncrement);
+			const P turn = Simd::Mul(Simd::Set<P>(8.0f), increment);
+			return Simd::MulAdd(turn, Simd::Sub(
+				PolyBlep::RampResidual(start),
+				PolyBlep::RampResidual(middle)), naive);
+		}
+		else
+		{
+			// Rises by 2 at phase 0, falls by 2 at the width.
+			const P fall = PolyBlep::EdgeDistance(phase, width,
+												  inverseIncrement);
+			return Simd::MulAdd(Simd::Set<P>(2.0f), Simd::Sub(
+				PolyBlep::StepResidual(start),
+				PolyBlep::StepResidual(fall)), naive);
+		}
+	}
+
+	/** @brief Value just after phase 0. */
+	template<AnalogWaveform Shape>
+	static constexpr float StartValue()
+	{
+		return Shape == AnalogWaveform::Saw || Shape ==
+			AnalogWaveform::Triangle ? -1.0f : 1.0f;
+	}
+
+	/** @brief Value just before the cycle ends. */
+	template<AnalogWaveform Shape>
+	static constexpr float EndValue()
+	{
+		return Shape == AnalogWaveform::Saw ? 1.0f : -1.0f;
+	}
+
+	void SetVoiceParameter(const uint32_t id, const float value) override
+	{
+		switch (id)
+		{
+			case Waveform:
+				m_Waveform = static_cast<AnalogWaveform>(std::min(
+					static_cast<uint32_t>(std::max(value, 0.0f)),
+					static_cast<uint32_t>(AnalogWaveform::Count) - 1));
+				break;
+			case PulseWidth:
+				m_PulseWidth = std::clamp(value, MinPulseWidth, MaxPulseWidth);
+				break;
+			case PwmDepth:
+				m_PwmDepth = std::clamp(value, 0.0f, 0.48f);
+				break;
+			case PwmRate:
+				m_PwmRate = std::max(value, 0.0f);
+				break;
+			case Sync:
+				m_Sync = value >= 0.5f;
+				break;
+			case SyncRatio:
+				m_SyncRatio = std::clamp(value, 1.0f, 16.0f);
+				break;
+			case FilterType:
+				m_Filter = static_cast<AnalogFilter>(std::min(
+					static_cast<uint32_t>(std::max(value, 0.0f)),
+					static_cast<uint32_t>(AnalogFilter::Count) - 1));
+				break;
+			case FilterCutoff:
+				m_FilterCutoff = std::max(value, 1.0f);
+				break;
+			case FilterResonance:
+				m_FilterResonance = std::clamp(value, 0.5f, 50.0f);
+				break;
+			case FilterEnvelope:
+				m_FilterEnvelope = value;
+				break;
+			case FilterKeyTrack:
+				m_FilterKeyTrack = std::clamp(value, 0.0f, 1.0f);
+				break;
+			default:
+				break;
+		}
+	}
+
+private:
+	bool m_Vectorized;
+	AnalogWaveform m_Waveform = AnalogWaveform::Saw;
+	float m_PulseWidth = 0.5f;
+	float m_PwmDepth = 0.0f;
+	float m_PwmRate = 0.5f;
+	bool m_Sync = false;
+	float m_SyncRatio = 2.0f;
+	AnalogFilter m_Filter = AnalogFilter::Off;
+	float m_FilterCutoff = 2000.0f;
+	float m_FilterResonance = 0.70710678f;
+	float m_FilterEnvelope = 0.0f;
+	float m_FilterKeyTrack = 0.0f;
+
+	// Structure of arrays, one element per voice.
+	ArenaArray<float> m_Phase;
+	ArenaArray<float> m_MasterPhase;
+	ArenaArray<float> m_Increment;
+	ArenaArray<float> m_Amplitude;
+	// Output held back one sample while synced.
+	ArenaArray<float> m_Delayed;
+	ArenaArray<float> m_LfoPhase;
+	ArenaArray<float> m_FilterBand;
+	ArenaArray<float> m_FilterLow;
+	/** @brief Octaves from middle C to the note. */
+	ArenaArray<float> m_FilterTrack;
+};
+}
@@ -0,0 +1,572 @@
+﻿#pragma once
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <numbers>
+
+#include "../MemoryArena.hpp"
+#include "../PolyphonicNode.hpp"
+#include "../Random.hpp"
+#include "../Simd.hpp"
+
+namespace MT::DSP
+{
+/** @brief Instruments a @ref WaveguideNode models. */
+enum class WaveguideInstrument : uint32_t
+{
+	/** @brief Plucked string, Karplus-Strong style. */
+	String,
+	/** @brief Reed-blown tube closed at one end, clarinet style. */
+	Tube,
+	Count
+};
+
+/** @brief How a @ref WaveguideNode reads between delay line samples. */
+enum class FractionalDelay : uint32_t
+{
+	/** @brief Third-order Lagrange FIR, four taps, flat phase. */
+	Lagrange,
+	/** @brief First-order Thiran allpass, one tap, flat magnitude. */
+	Allpass,
+	Count
+};
+
+/**
+ * @brief Bank of digital waveguides, one plucked string or blown tube per
+ * voice.
+ *
+ * Each voice is a delay line closed into a loop through a one-pole loss
+ * filter. Strings also pass two first-order allpasses that delay low
+ * frequencies more than high ones, the dispersion of a stiff string, and
+ * are excited by filling the loop with shaped noise. Tubes invert at the
+ * open end and are driven through a reed table by the breath pressure,
+ * which follows the voice envelope. The node's inputs are mixed to mono
+ * and fed into every loop, so other nodes can excite the bank.
+ *
+ * The loop length is tuned to the note: the phase delays of the loss and
+ * dispersion filters at the fundamental are subtracted, and the remainder
+ * is read with Lagrange or allpass interpolation.
+ *
+ * All delay lines come out of one arena block. Each SIMD group owns a
+ * contiguous region holding its lanes interleaved, so a sample of the whole
+ * group is written with one aligned store and read back with a gather per
+ * tap. The first taps are mirrored past the end, which lets interpolation
+ * read across the wrap point without a second bounds check.
+ */
+class WaveguideNode : public PolyphonicNode
+{
+public:
+	/** @brief Lowest note the delay lines are sized for, in Hz. */
+	static constexpr float MinFrequency = 20.0f;
+
+	enum Parameter : uint32_t
+	{
+		/** @brief A @ref WaveguideInstrument, passed as a float. */
+		Instrument = PolyphonicNode::ParameterCount,
+		/** @brief A @ref FractionalDelay, passed as a float. */
+		Interpolation,
+		/** @brief Seconds for a string to fall 60 dB. */
+		RingTime,
+		/** @brief 0-1, how much treble survives each trip round the loop. */
+		Brightness,
+		/** @brief 0-1, dispersion of the strings. */
+		Stiffness,
+		/** @brief 0-0.5, where the string is plucked along its length. */
+		PluckPosition,
+		/** @brief Peak breath pressure of the tubes; 0.6-0.9 speaks. */
+		Pressure,
+		/** @brief 0-1, turbulence added to the breath. */
+		BreathNoise,
+		/** @brief Scale of the mixed node inputs fed into every loop. */
+		InputGain
+	};
+
+	explicit WaveguideNode(const uint32_t voices = 128,
+						   const VoiceStealPolicy policy =
+								   VoiceStealPolicy::Oldest) :
+		PolyphonicNode(voices, policy)
+	{
+		// The loop shapes the decay; the envelope only gates the note.
+		SetParameter(Attack, 0.002f);
+		SetParameter(PolyphonicNode::Sustain, 1.0f);
+		SetParameter(Release, 0.3f);
+	}
+
+	[[nodiscard]] uint32_t GetMaxInputs() const override { return 8; }
+	[[nodiscard]] const char* GetName() const override { return "Waveguide"; }
+
+private:
+	/** @brief Loop delay the interpolators need as a minimum. */
+	static constexpr float MinLoopDelay = 2.0f;
+	/** @brief Taps mirrored past the end of every line. */
+	static constexpr uint32_t GuardTaps = 3;
+	static constexpr float TubeReflection = 0.95f;
+	static constexpr float ReedOffset = 0.7f;
+	static constexpr float ReedSlope = -0.3f;
+	static constexpr float DcBlockPole = 0.995f;
+
+	void PrepareVoices(const PrepareContext& context) override
+	{
+		m_LineLength = static_cast<uint32_t>(
+			std::ceil(m_SampleRate / MinFrequency)) + 8;
+		m_LineStride = (m_LineLength + GuardTaps) * Simd::Width;
+		m_Lines.Allocate(context.Memory, static_cast<size_t>(m_LineStride) *
+			(m_Capacity / Simd::Width));
+		m_Write.Allocate(context.Memory, m_Capacity / Simd::Width);
+		m_Excitation.Allocate(context.Memory, m_LineLength);
+
+		for (ArenaArray<float>* array : {&m_Frequency, &m_ReadDelay, &m_Tap0,
+										 &m_Tap1, &m_Tap2, &m_Tap3,
+										 &m_LossGain, &m_Dispersion,
+										 &m_Amplitude, &m_InterpIn,
+										 &m_InterpOut, &m_Loss, &m_StageIn,
+										 &m_StageOut, &m_StageOut2,
+										 &m_DcIn, &m_DcOut})
+			array->Allocate(context.Memory, m_Capacity);
+		m_Input.Allocate(context.Memory, context.MaxBlockFrames);
+		m_HasInput = false;
+		m_TuningDirty = false;
+	}
+
+	void StartVoice(const uint32_t voice, const uint32_t note,
+					const float velocity, const bool stolen) override
+	{
+		m_Frequency[voice] = NoteFrequency(note);
+		m_Amplitude[voice] = m_Instrument == WaveguideInstrument::Tube
+			? velocity
+			: 1.0f;
+		Retune(voice);
+		if (!stolen)
+		{
+			for (ArenaArray<float>* array : {&m_InterpIn, &m_InterpOut,
+											 &m_Loss, &m_StageIn, &m_StageOut,
+											 &m_StageOut2, &m_DcIn, &m_DcOut})
+				(*array)[voice] = 0.0f;
+		}
+
+		// Everything the loop reads next comes from the new excitation;
+		// a re-plucked string keeps ringing underneath.
+		const auto length = static_cast<uint32_t>(m_ReadDelay[voice]) +
+			GuardTaps + 1;
+		if (m_Instrument == WaveguideInstrument::Tube)
+		{
+			if (!stolen)
+				WriteLane(voice, length, nullptr, false);
+			return;
+		}
+		const float period = m_SampleRate / m_Frequency[voice];
+		Pluck(velocity, std::min(static_cast<uint32_t>(period), length));
+		WriteLane(voice, length, m_Excitation.Data(), stolen);
+	}
+
+	void UpdateControl() override
+	{
+		if (!m_TuningDirty)
+			return;
+		for (uint32_t voice = 0; voice < m_Capacity; voice++)
+		{
+			if (IsVoiceActive(voice))
+				Retune(voice);
+		}
+		m_TuningDirty = false;
+	}
+
+	void BeginBlock(const ProcessContext& context) override
+	{
+		m_HasInput = !context.Inputs.empty() && m_InputGain != 0.0f;
+		if (m_HasInput)
+			MixInputsToMono(context, m_InputGain, m_Input.Data(), 0,
+							context.Frames);
+	}
+
+	void RenderGroup(const uint32_t group, const uint32_t frames,
+					 float* sums) override
+	{
+		const bool lagrange = m_Interpolation == FractionalDelay::Lagrange;
+		if (m_Instrument == WaveguideInstrument::Tube)
+		{
+			if (lagrange)
+				RenderLoop<true, true>(group, frames, sums);
+			else
+				RenderLoop<true, false>(group, frames, sums);
+		}
+		else if (lagrange)
+			RenderLoop<false, true>(group, frames, sums);
+		else
+			RenderLoop<false, false>(group, frames, sums);
+	}
+
+	void SetVoiceParameter(const uint32_t id, const float value) override
+	{
+		switch (id)
+		{
+			case Instrument:
+				m_Instrument = static_cast<WaveguideInstrument>(std::min(
+					static_cast<uint32_t>(std::max(value, 0.0f)),
+					static_cast<uint32_t>(WaveguideInstrument::Count) - 1));
+				m_TuningDirty = true;
+				break;
+			case Interpolation:
+				m_Interpolation = static_cast<FractionalDelay>(std::min(
+					static_cast<uint32_t>(std::max(value, 0.0f)),
+					static_cast<uint32_t>(FractionalDelay::Count) - 1));
+				m_TuningDirty = true;
+				break;
+			case RingTime:
+				m_RingTime = std::max(value, 0.01f);
+				m_TuningDirty = true;
+				break;
+			case Brightness:
+				m_Brightness = std::clamp(value, 0.0f, 1.0f);
+				m_TuningDirty = true;
+				break;
+			case Stiffness:
+				m_Stiffness = std::clamp(value, 0.0f, 1.0f);
+				m_TuningDirty = true;
+				break;
+			case PluckPosition:
+				m_PluckPosition = std::clamp(value, 0.0f, 0.5f);
+				break;
+			case Pressure:
+				m_Pressure = std::clamp(value, 0.0f, 1.5f);
+				break;
+			case BreathNoise:
+				m_BreathNoise = std::clamp(value, 0.0f, 1.0f);
+				break;
+			case InputGain:
+				m_InputGain = value;
+				break;
+			default:
+				break;
+		}
+	}
+
+	/** @brief Pole of the loss filter, shared by every voice. */
+	[[nodiscard]] float LossPole() const
+	{
+		return 0.9f * (1.0f - m_Brightness);
+	}
+
+	/**
+	 * @brief Phase delay in samples of (b0 + b1 z^-1) / (1 + a1 z^-1) at
+	 * @p omega radians per sample.
+	 */
+	static float PhaseDelay(const float b0, const float b1, const float a1,
+							const float omega)
+	{
+		const std::complex<float> z = std::polar(1.0f, -omega);
+		const std::complex<float> response = (b0 + b1 * z) / (1.0f + a1 * z);
+		return -std::arg(response) / omega;
+	}
+
+	/**
+	 * @brief Sets the loop gain, dispersion and interpolator of @p voice
+	 * for its note and the current parameters.
+	 */
+	void Retune(const uint32_t voice)
+	{
+		const float period = m_SampleRate / m_Frequency[voice];
+		const float omega = 2.0f * std::numbers::pi_v<float> / period;
+		const bool tube = m_Instrument == WaveguideInstrument::Tube;
+		// A tube closed at one end sounds a quarter wavelength: the wave
+		// goes round twice, inverting each time, per period.
+		const float loop = tube ? 0.5f * period : period;
+
+		const float pole = LossPole();
+		const float gain = tube
+			? TubeReflection
+			: std::pow(10.0f, -3.0f * period / (m_RingTime * m_SampleRate));
+		m_LossGain[voice] = gain * (1.0f - pole);
+		float delay = loop - PhaseDelay(1.0f - pole, 0.0f, -pole, omega);
+
+		// Back the dispersion off on short strings until the loop fits.
+		float dispersion = tube ? 0.0f : -0.9f * m_Stiffness;
+		float stages = 2.0f * PhaseDelay(dispersion, 1.0f, dispersion, omega);
+		while (delay - stages < MinLoopDelay && dispersion < -1e-3f)
+		{
+			dispersion *= 0.5f;
+			stages = 2.0f * PhaseDelay(dispersion, 1.0f, dispersion, omega);
+		}
+		m_Dispersion[voice] = dispersion;
+		if (!tube)
+			delay -= stages;
+		delay = std::clamp(delay, MinLoopDelay,
+						   static_cast<float>(m_LineLength - GuardTaps - 2));
+
+		if (m_Interpolation == FractionalDelay::Lagrange)
+		{
+			// Taps at whole delays n + 3 down to n, oldest first, with the
+			// fraction in [1, 2) where third-order Lagrange behaves best.
+			const float whole = std::floor(delay) - 1.0f;
+			const float d = delay - whole;
+			m_ReadDelay[voice] = whole + 3.0f;
+			m_Tap0[voice] = d * (d - 1.0f) * (d - 2.0f) / 6.0f;
+			m_Tap1[voice] = -d * (d - 1.0f) * (d - 3.0f) / 2.0f;
+			m_Tap2[voice] = d * (d - 2.0f) * (d - 3.0f) / 2.0f;
+			m_Tap3[voice] = -(d - 1.0f) * (d - 2.0f) * (d - 3.0f) / 6.0f;
+		}
+		else
+		{
+			// Thiran allpass, fraction in [0.5, 1.5).
+			const float whole = std::floor(delay - 0.5f);
+			const float d = delay - whole;
+			m_ReadDelay[voice] = whole;
+			m_Tap0[voice] = (1.0f - d) / (1.0f + d);
+		}
+	}
+
+	/**
+	 * @brief Fills m_Excitation with @p length samples of lowpassed noise,
+	 * harder notes brighter, combed at the pluck position, peak 1.
+	 */
+	void Pluck(const float velocity, const uint32_t length)
+	{
+		float* excitation = m_Excitation.Data();
+		const float smoothing = 0.15f + 0.85f * velocity;
+		float state = 0.0f;
+		for (uint32_t i = 0; i < length; i++)
+		{
+			state += smoothing * (m_Random.NextBipolar() - state);
+			excitation[i] = state;
+		}
+		const auto comb = static_cast<uint32_t>(
+			m_PluckPosition * static_cast<float>(length));
+		if (comb > 0)
+		{
+			for (uint32_t i = length; i-- > comb;)
+				excitation[i] -= excitation[i - comb];
+		}
+
+		float mean = 0.0f;
+		for (uint32_t i = 0; i < length; i++)
+			mean += excitation[i];
+		mean /= static_cast<float>(length);
+		float peak = 0.0f;
+		for (uint32_t i = 0; i < length; i++)
+		{
+			excitation[i] -= mean;
+			peak = std::max(peak, std::abs(excitation[i]));
+		}
+		const float scale = peak > 0.0f ? velocity / peak : 0.0f;
+		for (uint32_t i = 0; i < length; i++)
+			excitation[i] *= scale;
+	}
+
+	/**
+	 * @brief Writes the @p count samples before the write position of
+	 * @p voice's line, newest first from @p samples (zeros past the end of
+	 * m_Excitation's pluck, all zeros if null), adding to what is there
+	 * when @p add is set.
+	 */
+	void WriteLane(const uint32_t voice, const uint32_t count,
+				   const float* samples, const bool add)
+	{
+		const uint32_t group = voice / Simd::Width;
+		const uint32_t lane = voice % Simd::Width;
+		float* line = m_Lines.Data() +
+			static_cast<size_t>(group) * m_LineStride + lane;
+		const float period = m_SampleRate / m_Frequency[voice];
+		const auto valid = samples
+			? std::min(count, static_cast<uint32_t>(period))
+			: 0u;
+
+		uint32_t position = m_Write[group];
+		for (uint32_t i = 0; i < count; i++)
+		{
+			position = position == 0 ? m_LineLength - 1 : position - 1;
+			const float value = i < valid ? samples[i] : 0.0f;
+			float& slot = line[position * Simd::Width];
+			slot = add ? slot + value : value;
+			if (position < GuardTaps)
+				line[(m_LineLength + position) * Simd::Width] = slot;
+		}
+	}
+
+	template<bool Tube, bool Lagrange>
+	void RenderLoop(const uint32_t group, const uint32_t frames, float* sums)
+	{
+		const uint32_t base = group * Simd::Width;
+		float* line = m_Lines.Data() +
+			static_cast<size_t>(group) * m_LineStride;
+		constexpr auto Stride = static_cast<float>(Simd::Width);
+		const Simd::Float lanes = Simd::Ramp(0.0f);
+		const Simd::Float zero = Simd::Set(0.0f);
+		const Simd::Float length = Simd::Set(
+			static_cast<float>(m_LineLength));
+		const float* input = m_Input.Data() + GetChunkStart();
+
+		const Simd::Float readDelay = Simd::LoadAligned(
+			m_ReadDelay.Data() + base);
+		const Simd::Float tap0 = Simd::LoadAligned(m_Tap0.Data() + base);
+		const Simd::Float tap1 = Simd::LoadAligned(m_Tap1.Data() + base);
+		const Simd::Float tap2 = Simd::LoadAligned(m_Tap2.Data() + base);
+		const Simd::Float tap3 = Simd::LoadAligned(m_Tap3.Data() + base);
+		const Simd::Float lossGain = Simd::LoadAligned(
+			m_LossGain.Data() + base);
+		const Simd::Float pole = Simd::Set(LossPole());
+		const Simd::Float dispersion = Simd::LoadAligned(
+			m_Dispersion.Data() + base);
+		const Simd::Float amplitude = Simd::LoadAligned(
+			m_Amplitude.Data() + base);
+		Simd::Float interpIn = Simd::LoadAligned(m_InterpIn.Data() + base);
+		Simd::Float interpOut = Simd::LoadAligned(m_InterpOut.Data() + base);
+		Simd::Float loss = Simd::LoadAligned(m_Loss.Data() + base);
+		Simd::Float stageIn = Simd::LoadAligned(m_StageIn.Data() + base);
+		Simd::Float stageOut = Simd::LoadAligned(m_StageOut.Data() + base);
+		Simd::Float stageOut2 = Simd::LoadAligned(m_StageOut2.Data() + base);
+		Simd::Float dcIn = Simd::LoadAligned(m_DcIn.Data() + base);
+		Simd::Float dcOut = Simd::LoadAligned(m_DcOut.Data() + base);
+
+		float* levels = m_Envelopes.GetLevels() + base;
+		Simd::Float envelope = Simd::LoadAligned(levels);
+		const Simd::Float scale = Simd::LoadAligned(
+			m_Envelopes.GetScales() + base);
+		const Simd::Float offset = Simd::LoadAligned(
+			m_Envelopes.GetOffsets() + base);
+		const Simd::Float pressure = Simd::Set(m_Pressure);
+		const Simd::Float breathNoise = Simd::Set(m_BreathNoise);
+
+		uint32_t write = m_Write[group];
+		for (uint32_t i = 0; i < frames; i++)
+		{
+			envelope = EnvelopeBank::Step(envelope, scale, offset);
+
+			// Oldest tap first; the guard taps cover reads over the end.
+			Simd::Float read = Simd::Sub(
+				Simd::Set(static_cast<float>(write)), readDelay);
+			read = Simd::Add(read, Simd::Select(Simd::Less(read, zero),
+												length, zero));
+			const Simd::Int index = Simd::TruncateToInt(
+				Simd::MulAdd(read, Simd::Set(Stride), lanes));
+			Simd::Float delayed;
+			if constexpr (Lagrange)
+			{
+				delayed = Simd::Mul(tap0, Simd::Gather(line, index));
+				delayed = Simd::MulAdd(tap1, Simd::Gather(
+					line + Simd::Width, index), delayed);
+				delayed = Simd::MulAdd(tap2, Simd::Gather(
+					line + 2 * Simd::Width, index), delayed);
+				delayed = Simd::MulAdd(tap3, Simd::Gather(
+					line + 3 * Simd::Width, index), delayed);
+			}
+			else
+			{
+				const Simd::Float sample = Simd::Gather(line, index);
+				interpOut = Simd::MulAdd(tap0, Simd::Sub(sample, interpOut),
+										 interpIn);
+				interpIn = sample;
+				delayed = interpOut;
+			}
+			loss = Simd::MulAdd(pole, loss, Simd::Mul(lossGain, delayed));
+
+			Simd::Float value;
+			Simd::Float output;
+			if constexpr (Tube)
+			{
+				Simd::Float breath = Simd::Mul(Simd::Mul(envelope, pressure),
+					Simd::MulAdd(breathNoise, m_Noise.NextBipolar(),
+								 Simd::Set(1.0f)));
+				if (m_HasInput)
+					breath = Simd::Add(breath, Simd::Set(input[i]));
+				const Simd::Float difference = Simd::Sub(
+					Simd::Sub(zero, loss), breath);
+				const Simd::Float reed = Simd::Min(Simd::Max(
+					Simd::MulAdd(difference, Simd::Set(ReedSlope),
+								 Simd::Set(ReedOffset)),
+					Simd::Set(-1.0f)), Simd::Set(1.0f));
+				value = Simd::MulAdd(difference, reed, breath);
+				dcOut = Simd::MulAdd(Simd::Set(DcBlockPole), dcOut,
+									 Simd::Sub(value, dcIn));
+				dcIn = value;
+				output = Simd::Mul(dcOut, amplitude);
+			}
+			else
+			{
+				// Two first-order allpasses, the second fed by the first.
+				const Simd::Float first = Simd::MulAdd(dispersion,
+					Simd::Sub(loss, stageOut), stageIn);
+				const Simd::Float second = Simd::MulAdd(dispersion,
+					Simd::Sub(first, stageOut2), stageOut);
+				stageIn = loss;
+				stageOut = first;
+				stageOut2 = second;
+				value = second;
+				if (m_HasInput)
+					value = Simd::Add(value, Simd::Set(input[i]));
+				output = Simd::Mul(value, envelope);
+			}
+
+			Simd::StoreAligned(line + write * Simd::Width, value);
+			if (write < GuardTaps)
+			{
+				Simd::StoreAligned(line + (m_LineLength + write) *
+					Simd::Width, value);
+			}
+			if (++write == m_LineLength)
+				write = 0;
+
+			float* sum = sums + i * Simd::Width;
+			Simd::StoreAligned(sum, Simd::Add(Simd::LoadAligned(sum),
+											  output));
+		}
+		m_Write[group] = write;
+		Simd::StoreAligned(levels, envelope);
+
+		Simd::StoreAligned(m_InterpIn.Data() + base, interpIn);
+		Simd::StoreAligned(m_InterpOut.Data() + base, interpOut);
+		Simd::StoreAligned(m_Loss.Data() + base, loss);
+		Simd::StoreAligned(m_StageIn.Data() + base, stageIn);
+		Simd::StoreAligned(m_StageOut.Data() + base, stageOut);
+		Simd::StoreAligned(m_StageOut2.Data() + base, stageOut2);
+		Simd::StoreAligned(m_DcIn.Data() + base, dcIn);
+		Simd::StoreAligned(m_DcOut.Data() + base, dcOut);
+	}
+
+private:
+	WaveguideInstrument m_Instrument = WaveguideInstrument::String;
+	FractionalDelay m_Interpolation = FractionalDelay::Lagrange;
+	float m_RingTime = 4.0f;
+	float m_Brightness = 0.5f;
+	float m_Stiffness = 0.0f;
+	float m_PluckPosition = 0.13f;
+	float m_Pressure = 0.75f;
+	float m_BreathNoise = 0.1f;
+	float m_InputGain = 0.0f;
+	bool m_TuningDirty = false;
+	bool m_HasInput = false;
+
+	// Every line, group after group, lanes interleaved, GuardTaps extra.
+	ArenaArray<float> m_Lines;
+	uint32_t m_LineLength = 0;
+	uint32_t m_LineStride = 0;
+	/** @brief Next position written, per group. */
+	ArenaArray<uint32_t> m_Write;
+	ArenaArray<float> m_Excitation;
+	ArenaArray<float> m_Input;
+
+	// Tuning per voice. Allpass interpolation keeps its coefficient in Tap0.
+	ArenaArray<float> m_Frequency;
+	/** @brief Distance back from the write position to the oldest tap. */
+	ArenaArray<float> m_ReadDelay;
+	ArenaArray<float> m_Tap0;
+	ArenaArray<float> m_Tap1;
+	ArenaArray<float> m_Tap2;
+	ArenaArray<float> m_Tap3;
+	ArenaArray<float> m_LossGain;
+	ArenaArray<float> m_Dispersion;
+	ArenaArray<float> m_Amplitude;
+
+	// Filter state per voice.
+	ArenaArray<float> m_InterpIn;
+	ArenaArray<float> m_InterpOut;
+	ArenaArray<float> m_Loss;
+	ArenaArray<float> m_StageIn;
+	ArenaArray<float> m_StageOut;
+	ArenaArray<float> m_StageOut2;
+	ArenaArray<float> m_DcIn;
+	ArenaArray<float> m_DcOut;
+
+	Xorshift32 m_Random{0x57A1};
+	XorshiftLanes m_Noise{0x7B3};
+};
+}
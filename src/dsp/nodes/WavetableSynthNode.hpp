@@ -0,0 +1,173 @@
+﻿#pragma once
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <utility>
+
+#include "../MemoryArena.hpp"
+#include "../PolyphonicNode.hpp"
+#include "../Simd.hpp"
+#include "../WavetableBank.hpp"
+
+namespace MT::DSP
+{
+/**
+ * @brief Polyphonic wavetable oscillators reading a shared
+ * @ref WavetableBank.
+ *
+ * Each voice picks the mip level of its pitch when the note starts, so it
+ * stays free of aliasing. A SIMD group of voices steps its phases
+ * together and fetches its table samples with one gather per tap,
+ * interpolating linearly within a table and, while morphing, between two
+ * neighbouring frames of the bank.
+ */
+class WavetableSynthNode : public PolyphonicNode
+{
+public:
+	enum Parameter : uint32_t
+	{
+		/** @brief Position 0-1 across the frames of the bank. */
+		Morph = PolyphonicNode::ParameterCount
+	};
+
+	explicit WavetableSynthNode(std::shared_ptr<const WavetableBank> bank,
+								const uint32_t voices = 256,
+								const VoiceStealPolicy policy =
+										VoiceStealPolicy::Oldest) :
+		PolyphonicNode(voices, policy),
+		m_Bank(std::move(bank))
+	{
+		SetMorph(0.0f);
+	}
+
+	[[nodiscard]] const char* GetName() const override { return "Wavetable"; }
+
+private:
+	void PrepareVoices(const PrepareContext& context) override
+	{
+		m_Phase.Allocate(context.Memory, m_Capacity);
+		m_Increment.Allocate(context.Memory, m_Capacity);
+		m_Amplitude.Allocate(context.Memory, m_Capacity);
+		m_LevelOffset.Allocate(context.Memory, m_Capacity);
+	}
+
+	void StartVoice(const uint32_t voice, const uint32_t note,
+					const float velocity, const bool stolen) override
+	{
+		if (!stolen)
+			m_Phase[voice] = 0.0f;
+		const float increment = NoteFrequency(note) / m_SampleRate;
+		m_Increment[voice] = increment;
+		m_Amplitude[voice] = velocity;
+		m_LevelOffset[voice] = WavetableBank::SelectLevel(increment) *
+			WavetableBank::LevelStride;
+	}
+
+	void RenderGroup(const uint32_t group, const uint32_t frames,
+					 float* sums) override
+	{
+		if (m_MorphFraction > 0.0f)
+			RenderGroup<true>(group, frames, sums);
+		else
+			RenderGroup<false>(group, frames, sums);
+	}
+
+	template<bool Morphing>
+	void RenderGroup(const uint32_t group, const uint32_t frames, float* sums)
+	{
+		const uint32_t base = group * Simd::Width;
+		float* levels = m_Envelopes.GetLevels() + base;
+		Simd::Float phase = Simd::LoadAligned(m_Phase.Data() + base);
+		Simd::Float envelope = Simd::LoadAligned(levels);
+		const Simd::Float increment = Simd::LoadAligned(
+			m_Increment.Data() + base);
+		const Simd::Float amplitude = Simd::LoadAligned(
+			m_Amplitude.Data() + base);
+		const Simd::Float scale = Simd::LoadAligned(
+			m_Envelopes.GetScales() + base);
+		const Simd::Float offset = Simd::LoadAligned(
+			m_Envelopes.GetOffsets() + base);
+		const Simd::Int levelOffset = Simd::LoadInt(
+			m_LevelOffset.Data() + base);
+
+		const float* first = m_Bank->GetData() + m_FrameOffset;
+		const float* second = first + WavetableBank::FrameStride;
+		const Simd::Float tableSize = Simd::Set(
+			static_cast<float>(WavetableBank::TableSize));
+		const Simd::Float morph = Simd::Set(m_MorphFraction);
+		for (uint32_t i = 0; i < frames; i++)
+		{
+			phase = Simd::Add(phase, increment);
+			phase = Simd::Sub(phase, Simd::Floor(phase));
+			envelope = EnvelopeBank::Step(envelope, scale, offset);
+
+			const Simd::Float position = Simd::Mul(phase, tableSize);
+			const Simd::Int whole = Simd::TruncateToInt(position);
+			const Simd::Float fraction = Simd::Sub(position,
+												   Simd::ToFloat(whole));
+			const Simd::Int index = Simd::AddInt(whole, levelOffset);
+
+			Simd::Float sample = Interpolate(first, index, fraction);
+			if constexpr (Morphing)
+			{
+				const Simd::Float next = Interpolate(second, index, fraction);
+				sample = Simd::MulAdd(morph, Simd::Sub(next, sample), sample);
+			}
+
+			float* sum = sums + i * Simd::Width;
+			Simd::StoreAligned(sum, Simd::MulAdd(
+				Simd::Mul(sample, envelope), amplitude,
+				Simd::LoadAligned(sum)));
+		}
+
+		Simd::StoreAligned(m_Phase.Data() + base, phase);
+		Simd::StoreAligned(levels, envelope);
+	}
+
+	static Simd::Float Interpolate(const float* table, const Simd::Int& index,
+								   const Simd::Float& fraction)
+	{
+		// Every level ends in a guard sample, index + 1 stays in the table.
+		const Simd::Float a = Simd::Gather(table, index);
+		const Simd::Float b = Simd::Gather(table + 1, index);
+		return Simd::MulAdd(fraction, Simd::Sub(b, a), a);
+	}
+
+	void SetVoiceParameter(const uint32_t id, const float value) override
+	{
+		if (id == Morph)
+			SetMorph(value);
+	}
+
+	void SetMorph(const float value)
+	{
+		const uint32_t frames = m_Bank->GetFrameCount();
+		if (frames < 2)
+		{
+			m_FrameOffset = 0;
+			m_MorphFraction = 0.0f;
+			return;
+		}
+		const float position = std::clamp(value, 0.0f, 1.0f) *
+			static_cast<float>(frames - 1);
+		const uint32_t frame = std::min(static_cast<uint32_t>(position),
+										frames - 2);
+		m_FrameOffset = static_cast<size_t>(frame) *
+			WavetableBank::FrameStride;
+		m_MorphFraction = position - static_cast<float>(frame);
+	}
+
+private:
+	std::shared_ptr<const WavetableBank> m_Bank;
+	// First of the two frames being crossfaded, and the weight of the second.
+	size_t m_FrameOffset = 0;
+	float m_MorphFraction = 0.0f;
+
+	// Structure of arrays, one element per voice.
+	ArenaArray<float> m_Phase;
+	ArenaArray<float> m_Increment;
+	ArenaArray<float> m_Amplitude;
+	// Start of the voice's mip level within a frame, in floats.
+	ArenaArray<uint32_t> m_LevelOffset;
+};
+}
@@ -1,140 +1,415 @@
-#include <Audioclient.h>
-#include <Windows.h>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
-#include <mmdeviceapi.h>
-#include <print>
-#include <random>
+#include <string>
+#include <string_view>
 #include <thread>
 
+/**
+ * @brief Builds the launcher without the window, ImGui and GLFW, as the
+ * CMake pae_headless target does; it then always runs headless.
+ */
+#ifndef PAE_HEADLESS_ONLY
+#define PAE_HEADLESS_ONLY 0
+#endif
+
+#include "audio/AudioBackend.hpp"
+#include "audio/AudioEngine.hpp"
+#include "audio/OfflineBounce.hpp"
+#include "audio/RealtimeGuard.hpp"
+#if !PAE_HEADLESS_ONLY
 #include "core/Application.hpp"
 #include "core/ImGuiLayer.hpp"
 #include "core/Window.hpp"
+#endif
+#include "dsp/CompiledGraph.hpp"
+#include "dsp/Patches.hpp"
+#include "dsp/nodes/FdtdPlateNode.hpp"
 
 
-int main()
+namespace
 {
-	const MT::Core::Window window(1280, 720, "Musical Trunk - PAE");
-	if (!window.Ptr)
-		return EXIT_FAILURE;
+struct LaunchOptions
+{
+	MT::Audio::AudioBackendConfig Backend;
+	/// <summary> Run without a window for HeadlessSeconds, then print stats. </summary>
+	bool Headless = false;
+	double HeadlessSeconds = 10.0;
+	/// <summary> Graph worker threads besides the render thread, 0 = auto. </summary>
+	uint32_t WorkerThreads = 0;
+	/// <summary> Voice pool size of the default patch's synth. </summary>
+	uint32_t Voices = 256;
+	/// <summary> Partial count of the additive engine. </summary>
+	uint32_t Partials = 4096;
+	/// <summary> Grain pool size of the granular engine. </summary>
+	uint32_t Grains = 8192;
+	/// <summary> Voice engine the default patch plays. </summary>
+	MT::DSP::SynthEngine Engine = MT::DSP::SynthEngine::Subtractive;
+	/// <summary> Where the wavetable engine caches its tables. </summary>
+	std::string WavetableCache = "wavetables.cache";
+	/// <summary> Where the modal engine caches its decomposed objects. </summary>
+	std::string ModalCache = "modal.cache";
+	/// <summary> Cells across and down the FDTD engine's grid. </summary>
+	uint32_t GridWidth = 64;
+	uint32_t GridHeight = 48;
+	/// <summary> Render BounceSeconds to the output file as fast as possible. </summary>
+	bool Bounce = false;
+	double BounceSeconds = 10.0;
+};
 
+/** @brief Parses all of @p text as a number, leaving @p value alone on failure. */
+template<typename T>
+bool ParseNumber(const std::string_view text, T& value)
+{
+	T parsed{};
+	const char* end = text.data() + text.size();
+	const auto [ptr, ec] = std::from_chars(text.data(), end, parsed);
+	if (ec != std::errc() || ptr != end)
+		return false;
+	value = parsed;
+	return true;
+}
 
-	// Init COM (Component Object Model).
-	HRESULT result = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
-	if (FAILED(result))
-		return EXIT_FAILURE;
+bool ParseArguments(const int argc, char** argv, LaunchOptions& options)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string_view arg = argv[i];
+		const bool hasValue = i + 1 < argc;
+		if (arg == "--backend" && hasValue)
+		{
+			const std::string_view name = argv[++i];
+			if (name == "wasapi")
+				options.Backend.Type = MT::Audio::BackendType::Wasapi;
+			else if (name == "null")
+				options.Backend.Type = MT::Audio::BackendType::Null;
+			else if (name == "wav")
+				options.Backend.Type = MT::Audio::BackendType::WavFile;
+			else
+				return false;
+		}
+		else if (arg == "--output" && hasValue)
+			options.Backend.FilePath = argv[++i];
+		else if (arg == "--rate" && hasValue)
+		{
+			if (!ParseNumber(argv[++i], options.Backend.Format.SampleRate))
+				return false;
+		}
+		else if (arg == "--channels" && hasValue)
+		{
+			if (!ParseNumber(argv[++i], options.Backend.Format.Channels))
+				return false;
+		}
+		else if (arg == "--period" && hasValue)
+		{
+			if (!ParseNumber(argv[++i], options.Backend.PeriodFrames))
+				return false;
+		}
+		else if (arg == "--buffer" && hasValue)
+		{
+			if (!ParseNumber(argv[++i], options.Backend.BufferFrames))
+				return false;
+		}
+		else if (arg == "--workers" && hasValue)
+		{
+			if (!ParseNumber(argv[++i], options.WorkerThreads))
+				return false;
+		}
+		else if (arg == "--voices" && hasValue)
+		{
+			if (!ParseNumber(argv[++i], options.Voices))
+				return false;
+		}
+		else if (arg == "--partials" && hasValue)
+		{
+			if (!ParseNumber(argv[++i], options.Partials))
+				return false;
+		}
+		else if (arg == "--grains" && hasValue)
+		{
+			if (!ParseNumber(argv[++i], options.Grains))
+				return false;
+		}
+		else if (arg == "--synth" && hasValue)
+		{
+			const std::string_view name = argv[++i];
+			if (name == "subtractive")
+				options.Engine = MT::DSP::SynthEngine::Subtractive;
+			else if (name == "wavetable")
+				options.Engine = MT::DSP::SynthEngine::Wavetable;
+			else if (name == "analog")
+				options.Engine = MT::DSP::SynthEngine::Analog;
+			else if (name == "additive")
+				options.Engine = MT::DSP::SynthEngine::Additive;
+			else if (name == "fm")
+				options.Engine = MT::DSP::SynthEngine::Fm;
+			else if (name == "granular")
+				options.Engine = MT::DSP::SynthEngine::Granular;
+			else if (name == "waveguide")
+				options.Engine = MT::DSP::SynthEngine::Waveguide;
+			else if (name == "modal")
+				options.Engine = MT::DSP::SynthEngine::Modal;
+			else if (name == "fdtd")
+				options.Engine = MT::DSP::SynthEngine::Fdtd;
+			else if (name == "impacts")
+				options.Engine = MT::DSP::SynthEngine::Impacts;
+			else
+				return false;
+		}
+		else if (arg == "--grid" && hasValue)
+		{
+			const std::string_view grid = argv[++i];
+			const size_t split = grid.find('x');
+			uint32_t width = 0;
+			uint32_t height = 0;
+			if (!ParseNumber(grid.substr(0, split), width) ||
+				!ParseNumber(split == std::string_view::npos
+								 ? grid
+								 : grid.substr(split + 1),
+							 height))
+				return false;
+			constexpr uint32_t maxSize = MT::DSP::FdtdPlateNode::MaxSize;
+			if (width < 4 || height < 4 || width > maxSize ||
+				height > maxSize)
+				return false;
+			options.GridWidth = width;
+			options.GridHeight = height;
+		}
+		else if (arg == "--wavetable-cache" && hasValue)
+			options.WavetableCache = argv[++i];
+		else if (arg == "--modal-cache" && hasValue)
+			options.ModalCache = argv[++i];
+		else if (arg == "--bits" && hasValue)
+		{
+			const std::string_view bits = argv[++i];
+			if (bits == "16")
+				options.Backend.FileFormat = MT::Audio::WavSampleFormat::Int16;
+			else if (bits == "24")
+				options.Backend.FileFormat = MT::Audio::WavSampleFormat::Int24;
+			else if (bits == "32")
+				options.Backend.FileFormat = MT::Audio::WavSampleFormat::Float32;
+			else
+				return false;
+		}
+		else if (arg == "--bounce" && hasValue)
+		{
+			options.Bounce = true;
+			if (!ParseNumber(argv[++i], options.BounceSeconds))
+				return false;
+		}
+		else if (arg == "--rt-trap")
+			MT::Audio::SetTrapOnRealtimeViolation(true);
+		else if (arg == "--fast")
+			options.Backend.RealTime = false;
+		else if (arg == "--headless")
+		{
+			options.Headless = true;
+			if (hasValue && argv[i + 1][0] != '-' &&
+				!ParseNumber(argv[++i], options.HeadlessSeconds))
+				return false;
+		}
+		else
+			return false;
+	}
+	return true;
+}
+
+void PrintUsage()
+{
+	std::puts("Usage: \"Procedural Audio Engine\" [options]\n"
+				 "  --backend wasapi|null|wav  Output backend.\n"
+				 "  --output <path>            WAV file written by the wav backend.\n"
+				 "  --rate <hz>                Requested sample rate.\n"
+				 "  --channels <n>             Requested channel count.\n"
+				 "  --period <frames>          Frames rendered per device wakeup.\n"
+				 "  --buffer <frames>          Requested device buffer size.\n"
+				 "  --workers <n>              Graph worker threads, 0 picks one per core.\n"
+				 "  --voices <n>               Synth voices, rounded up to the SIMD width.\n"
+				 "  --partials <n>             Additive partials, rounded up likewise.\n"
+				 "  --grains <n>               Granular grain pool, rounded up likewise.\n"
+				 "  --synth subtractive|wavetable|analog|additive|fm|granular|\n"
+				 "          waveguide|modal|fdtd|impacts\n"
+				 "                             Voice engine of the patch.\n"
+				 "  --grid <w>x<h>             FDTD grid in cells, 4 to 1024 a side (64x48).\n"
+				 "  --wavetable-cache <path>   Where wavetables are cached between runs.\n"
+				 "  --modal-cache <path>       Where modal objects are cached between runs.\n"
+				 "  --bits 16|24|32            WAV sample format, 32 is float.\n"
+				 "  --bounce <seconds>         Render offline to the output file and exit.\n"
+				 "  --fast                     Null/wav backends run faster than real time.\n"
+				 "  --rt-trap                  Stop on heap or lock use while rendering\n"
+				 "                             (builds with PAE_ENABLE_RT_GUARD).\n"
+				 "  --headless [seconds]       Render without a window, then print stats\n"
+				 "                             (always on in headless-only builds).");
+}
+
+void PrintStats(const MT::Audio::AudioEngine& engine, const double seconds)
+{
+	const MT::Audio::RenderStats stats = engine.GetStats();
+	const MT::Audio::AudioFormat format = engine.GetBackend().GetFormat();
+	const double audioSeconds = static_cast<double>(stats.FramesRendered) /
+		format.SampleRate;
+	std::printf("Rendered %llu frames in %llu blocks (%.2fx real time), "
+				"%llu underruns, %llu empty wakeups, max refill interval "
+				"%.3f ms, max block render %.3f ms, max wakeup to "
+				"write %.3f ms.\n",
+				static_cast<unsigned long long>(stats.FramesRendered),
+				static_cast<unsigned long long>(stats.BlocksRendered),
+				audioSeconds / seconds,
+				static_cast<unsigned long long>(stats.Underruns),
+				static_cast<unsigned long long>(stats.EmptyWakeups),
+				stats.MaxRefillIntervalNs / 1e6,
+				stats.MaxRenderTimeNs / 1e6, stats.MaxWakeToWriteNs / 1e6);
+#if PAE_ENABLE_RT_GUARD
+	const MT::Audio::RealtimeViolations violations =
+		MT::Audio::GetRealtimeViolations();
+	std::printf("While rendering: %llu allocations, %llu deallocations, "
+				"%llu locks.\n",
+				static_cast<unsigned long long>(violations.Allocations),
+				static_cast<unsigned long long>(violations.Deallocations),
+				static_cast<unsigned long long>(violations.Locks));
+#endif
+}
+}
 
-	// "IMMDeviceEnumerator" lists audio devices.
-	IMMDeviceEnumerator* deviceEnumerator = nullptr;
-	result = CoCreateInstance(__uuidof(MMDeviceEnumerator),
-							  nullptr,
-							  CLSCTX_ALL,
-							  __uuidof(IMMDeviceEnumerator),
-							  IID_PPV_ARGS_Helper(&deviceEnumerator));
-	if (FAILED(result))
-		return EXIT_FAILURE;
 
-	// Get default audio device. eRender -> Output, eConsole -> (use-case) normal app.
-	IMMDevice* device = nullptr;
-	result = deviceEnumerator->GetDefaultAudioEndpoint(
-			eRender, eConsole, &device);
-	if (FAILED(result))
+int main(const int argc, char** argv)
+{
+	LaunchOptions options;
+	if (!ParseArguments(argc, argv, options))
 	{
-		std::cerr << "Failed to get default audio device.\n";
-		deviceEnumerator->Release();
+		PrintUsage();
 		return EXIT_FAILURE;
 	}
 
-	// Lets us communicate with the audio device.
-	IAudioClient* audioClient = nullptr;
-	result = device->Activate(__uuidof(IAudioClient),
-							  CLSCTX_ALL,
-							  nullptr,
-							  IID_PPV_ARGS_Helper(&audioClient));
-	if (FAILED(result))
+	// A bounce never touches a device, the null backend only supplies the
+	// format the engine renders in.
+	if (options.Bounce)
 	{
-		std::cerr << "Failed to activate the audio client.\n";
-		device->Release();
-		deviceEnumerator->Release();
-		return EXIT_FAILURE;
+		options.Backend.Type = MT::Audio::BackendType::Null;
+		options.Backend.RealTime = false;
 	}
 
-	WAVEFORMATEX* mixFormat = nullptr;
-	result = audioClient->GetMixFormat(&mixFormat);
-	if (FAILED(result))
+	const auto backend = MT::Audio::CreateAudioBackend(options.Backend);
+	if (!backend)
 	{
-		std::cerr << "Failed to get mix format.\n";
-		audioClient->Release();
-		device->Release();
-		deviceEnumerator->Release();
+		std::cerr << "Failed to open the audio backend.\n";
 		return EXIT_FAILURE;
 	}
 
-	std::println("Channels: {}\nSampleRate: {}\nBits per sample: {}",
-				 mixFormat->nChannels, mixFormat->nSamplesPerSec,
-				 mixFormat->wBitsPerSample);
+	const MT::Audio::AudioFormat format = backend->GetFormat();
+	std::printf("Backend: %s (%u Hz, %u channels, %u frame period, "
+				"%u frames latency)\n",
+				backend->GetName(), format.SampleRate, format.Channels,
+				backend->GetPeriodFrames(), backend->GetLatencyFrames());
 
-	result = audioClient->Initialize(AUDCLNT_SHAREMODE_SHARED,
-									 0, 0, 0, mixFormat, nullptr);
-	if (FAILED(result))
-		std::cerr << "IAudioClient::Initialize failed!\n";
-	std::println("Audio client initialized successfully!");
+	// Audio is produced on its own thread, the loop below only drives the UI.
+	MT::Audio::AudioEngine engine(*backend, options.WorkerThreads);
 
+	MT::DSP::PatchSettings patchSettings;
+	patchSettings.Engine = options.Engine;
+	patchSettings.Voices = options.Voices;
+	patchSettings.Partials = options.Partials;
+	patchSettings.Grains = options.Grains;
+	patchSettings.GridWidth = options.GridWidth;
+	patchSettings.GridHeight = options.GridHeight;
+	if (options.Engine == MT::DSP::SynthEngine::Wavetable ||
+		options.Engine == MT::DSP::SynthEngine::Granular)
+	{
+		patchSettings.Wavetables = MT::DSP::WavetableBank::LoadOrBuild(
+			options.WavetableCache, MT::DSP::WavetableBank::MakeBasicShapes());
+	}
+	std::string error;
+	if (options.Engine == MT::DSP::SynthEngine::Modal)
+	{
+		patchSettings.ModalModels = MT::DSP::ModalModel::LoadOrBuild(
+			options.ModalCache, MT::DSP::ModalObject::MakePresets(), &error);
+		if (patchSettings.ModalModels.empty())
+		{
+			std::cerr << "Failed to build the modal objects: " << error << "\n";
+			return EXIT_FAILURE;
+		}
+	}
 
-	// Actually write audio into buffer.
-	IAudioRenderClient* renderClient = nullptr;
-	audioClient->GetService(__uuidof(IAudioRenderClient),
-							IID_PPV_ARGS_Helper(&renderClient));
+	MT::DSP::Graph graph;
+	// Only the window's controls use the patch's node ids.
+	[[maybe_unused]] const MT::DSP::DefaultPatch patch =
+		MT::DSP::BuildDefaultPatch(graph, patchSettings);
+	auto compiled = MT::DSP::CompiledGraph::Compile(
+		graph, engine.GetPrepareContext(), &error,
+		engine.GetCompileOptions());
+	if (!compiled)
+	{
+		std::cerr << "Failed to compile the patch: " << error << "\n";
+		return EXIT_FAILURE;
+	}
+	engine.SetGraph(std::move(compiled));
 
-	uint32_t bufferFrameCount = 0;
-	audioClient->GetBufferSize(&bufferFrameCount);
-	audioClient->Start();
+	if (options.Bounce)
+	{
+		MT::Audio::BounceSettings settings;
+		settings.FilePath = options.Backend.FilePath;
+		settings.Format = options.Backend.FileFormat;
+		settings.Seconds = options.BounceSeconds;
+		MT::Audio::BounceResult result;
+		if (!MT::Audio::BounceToWav(engine, settings, result, &error))
+		{
+			std::cerr << "Bounce failed: " << error << "\n";
+			return EXIT_FAILURE;
+		}
+		std::printf("Bounced %.2f s (%llu frames) to %s in %.3f s, "
+					"%.1fx real time.\n",
+					result.AudioSeconds,
+					static_cast<unsigned long long>(result.Frames),
+					settings.FilePath.c_str(), result.WallSeconds,
+					result.GetRealTimeFactor());
+		return EXIT_SUCCESS;
+	}
+
+	if (!engine.Start())
+	{
+		std::cerr << "Failed to start the audio render thread.\n";
+		return EXIT_FAILURE;
+	}
+
+	if (PAE_HEADLESS_ONLY || options.Headless)
+	{
+		std::this_thread::sleep_for(
+			std::chrono::duration<double>(options.HeadlessSeconds));
+		engine.Stop();
+		PrintStats(engine, options.HeadlessSeconds);
+		return EXIT_SUCCESS;
+	}
+
+#if !PAE_HEADLESS_ONLY
+	const MT::Core::Window window(1280, 720, "Musical Trunk - PAE");
+	if (!window.Ptr)
+		return EXIT_FAILURE;
 
 	MT::Core::ImGuiLayer imGuiLayer(window.Ptr.get());
-	const auto app = std::make_unique<MT::Application>(window.Ptr.get());
+	const auto app = std::make_unique<MT::Application>(window.Ptr.get(),
+														engine, graph, patch);
+	auto frameStart = std::chrono::steady_clock::now();
 	while (!window.ShouldClose())
 	{
 		glfwPollEvents();
 
 		app->Update();
 
-		uint32_t padding = 0;
-		audioClient->GetCurrentPadding(&padding);
-		uint32_t framesAvailable = bufferFrameCount - padding;
-
-		if (framesAvailable == 0)
-		{
-			std::this_thread::sleep_for(std::chrono::milliseconds(1));
-			continue;
-		}
-
-		float* buffer = nullptr;
-		renderClient->GetBuffer(framesAvailable,
-								reinterpret_cast<BYTE**>(&buffer));
-
-		static std::mt19937 gen(std::random_device{}());
-		static std::uniform_real_distribution dist(-1.0f, 1.0f);
-		for (uint32_t i = 0; i < framesAvailable; i++)
-		{
-			float sample = dist(gen);
-			buffer[i * mixFormat->nChannels + 0] = sample;
-			if (mixFormat->nChannels > 1)
-				buffer[i * mixFormat->nChannels + 1] = sample;
-
-		}
-
 		imGuiLayer.BeginFrame();
 		app->Render();
 
-		renderClient->ReleaseBuffer(framesAvailable, 0);
 		window.SwapBuffers(&imGuiLayer);
 
+		const auto frameEnd = std::chrono::steady_clock::now();
+		engine.ReportUiFrame(static_cast<uint64_t>(
+			std::chrono::duration_cast<std::chrono::nanoseconds>(
+				frameEnd - frameStart).count()));
+		frameStart = frameEnd;
 	}
 
-	audioClient->Stop();
-	renderClient->Release();
-	audioClient->Release();
-	device->Release();
-	deviceEnumerator->Release();
-	CoUninitialize();
+	engine.Stop();
 	return EXIT_SUCCESS;
+#endif
 }